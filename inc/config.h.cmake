@@ -1,2 +1,3 @@
 #cmakedefine DISABLE_THREAD_SAFETY
 #cmakedefine DISABLE_SOCKET_LOGGER
+#cmakedefine DISABLE_SHM_LOGGER
@@ -0,0 +1,75 @@
+/*
+       Licensed to the Apache Software Foundation (ASF) under one
+       or more contributor license agreements.  See the NOTICE file
+       distributed with this work for additional information
+       regarding copyright ownership.  The ASF licenses this file
+       to you under the Apache License, Version 2.0 (the
+       "License"); you may not use this file except in compliance
+       with the License.  You may obtain a copy of the License at
+
+         http://www.apache.org/licenses/LICENSE-2.0
+
+       Unless required by applicable law or agreed to in writing,
+       software distributed under the License is distributed on an
+       "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+       KIND, either express or implied.  See the License for the
+       specific language governing permissions and limitations
+       under the License.
+ */
+#ifndef __ASYNC_LOGGER_H__
+#define __ASYNC_LOGGER_H__
+
+#include <liblogger/liblogger_levels.h>
+
+/** The behaviour of an asynchronous log writer, when the producers outrun 
+ * the log destination and the log queue is full.
+ * */
+typedef enum tBackPressurePolicy
+{
+	/** The producer waits for room in the queue, at most for 
+	 * \ref tAsyncLogParams::blockTimeoutMs "blockTimeoutMs", then the record is dropped.
+	 * It waits without holding the logger lock, the other threads keep logging meanwhile. */
+	BackPressureBlock = 0,
+	/** The record being logged is dropped. */
+	BackPressureDropNewest,
+	/** The oldest records in the queue are dropped to make room. */
+	BackPressureDropOldest,
+	/** Records with a level lower than \ref tAsyncLogParams::dropBelowLevel "dropBelowLevel"
+	 * are dropped, the others wait for room in the queue as long as it takes, they are never
+	 * dropped. */
+	BackPressureDropBelowLevel
+} tBackPressurePolicy;
+
+/** Asynchronous logging parameters, part of the logger initialization parameters.
+ * When enabled, the records are formatted by the logging thread and put in a bounded
+ * queue, a background writer thread writes them to the log destination.
+ * Dropped records are counted and summarised in the log, for example :
+ * \code
+ * ----- liblogger dropped 1234 Debug records -----
+ * \endcode
+ * Records longer than 64 KB are truncated in asynchronous mode.
+ * */
+typedef struct tAsyncLogParams
+{
+	/** The size of the log queue in \b bytes, 0 (the default) disables asynchronous
+	 * logging, the records are then written by the logging thread. */
+	unsigned int		queueSize;
+	/** The behaviour when the queue is full. */
+	tBackPressurePolicy	policy;
+	/** The maximum time in milliseconds to wait for room in the queue with
+	 * \ref BackPressureBlock, 0 waits forever. With \ref BackPressureDropBelowLevel the
+	 * records of \ref dropBelowLevel and above always wait for room, they are never lost. */
+	unsigned int		blockTimeoutMs;
+	/** With \ref BackPressureDropBelowLevel, the records with a lower level are dropped
+	 * when the queue is full. */
+	LogLevel			dropBelowLevel;
+	/** Records at or above this level go to a separate priority lane, which the
+	 * writer thread drains first and flushes immediately, so they do not wait behind
+	 * the queued low severity records. They may therefore appear in the log before
+	 * records logged earlier. 0 (the default) is \ref Error, \ref Disable uses a
+	 * single lane. The priority lane is a quarter of 
+	 * \ref tAsyncLogParams::queueSize "queueSize". */
+	LogLevel			priorityLevel;
+} tAsyncLogParams;
+
+#endif // __ASYNC_LOGGER_H__
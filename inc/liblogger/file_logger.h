@@ -20,6 +20,8 @@
 #define __FILE_LOGGER_H__
 
 #include <stdio.h>
+#include <liblogger/async_logger.h>
+#include <liblogger/liblogger_kv.h>
 
 /* The rollback feature has been disabled, due to limitations 
  * in open modes of fopen(), will be enabled after further study.
@@ -58,6 +60,18 @@ typedef struct tConsoleLoggerInitParams
 	char*		moduleName;
 	/** The destination of the console log. */
 	tConsoleDest	consoleDest;
+	/** The output format, text (the default) or JSON. */
+	tOutputFormat	outputFormat;
+	/** Non zero to suppress consecutive identical records from the same call site,
+	 * a summary is logged when the run ends : "last message repeated N times over T s". */
+	int		suppressRepeats;
+	/** Non zero to add the context of the logging thread to each record : the thread id,
+	 * the thread name and the pairs pushed with \ref LogContextPush(). */
+	int		includeContext;
+	/** The asynchronous logging parameters, all zero logs synchronously. */
+	tAsyncLogParams	asyncParams;
+	/** The layout of the text records, see \ref tFileLoggerInitParams::layout. */
+	const char*	layout;
 } tConsoleLoggerInitParams;
 
 /** File Logger Initialization parameters. */
@@ -71,12 +85,71 @@ typedef struct tFileLoggerInitParams
 	char* 		fileName;
 	/** The file open mode. */
 	tFileOpenMode 	fileOpenMode;
+	/** The output format, text (the default), JSON or binary. */
+	tOutputFormat	outputFormat;
+	/** Non zero to suppress consecutive identical records from the same call site,
+	 * a summary is logged when the run ends : "last message repeated N times over T s". */
+	int		suppressRepeats;
+	/** Non zero to add the context of the logging thread to each record : the thread id,
+	 * the thread name and the pairs pushed with \ref LogContextPush(). */
+	int		includeContext;
 #ifdef _ENABLE_LL_ROLLBACK_
 	/** The rollback size in \b bytes to use, when \ref tFileLoggerInitParams::fileOpenMode "fileOpenMode"
 	 * is equal \ref tFileOpenMode::RollbackMode "RollbackMode"
 	 * */
 	unsigned long	rollbackSize;
 #endif // _ENABLE_LL_ROLLBACK_
+	/** The asynchronous logging parameters, all zero logs synchronously. */
+	tAsyncLogParams	asyncParams;
+	/** The size in \b bytes of the blocks the log is compressed in, 0 (the default) to write
+	 * the log uncompressed. The blocks are compressed by the background writer thread, which
+	 * is started with a default queue size if \ref asyncParams is all zero. The offset and the
+	 * time span of each block are written to the index "<fileName>.idx", tools/llzcat reads
+	 * the whole log or the blocks of a time range. The rollback mode is not supported.
+	 * */
+	unsigned int	compressBlockSize;
+	/** Non zero to write each record with a single write(2) to the file opened with O_APPEND,
+	 * instead of stdio, so that the processes logging to the same file (the workers of a
+	 * pre-fork server for example) never interleave nor tear their records. The records up
+	 * to this size in \b bytes are written atomically, the longer ones are truncated to it
+	 * (at least 512). With a background writer thread, its batches are split on the ends
+	 * of lines so that a write never exceeds this size. Not supported with the binary
+	 * output format nor with compression.
+	 * */
+	unsigned int	atomicWriteSize;
+	/** The commit window of the durable records in ms, see \ref GRP_DURABLE : the first
+	 * caller waits this long for other durable records before the log is synced once for
+	 * all of them. 0 (the default) syncs at once, the callers arriving during a sync still
+	 * share the next one. A longer window means fewer syncs, and a longer wait per record.
+	 * */
+	unsigned int	durableWindowMs;
+	/** The number of writes the background writer thread keeps in flight with io_uring
+	 * (Linux), 0 (the default) writes the log with stdio. The batches are coalesced in as
+	 * many registered buffers of 256 KB, appended by chains of linked writes so that the
+	 * writer thread does not block in write(2) nor fsync(2). The writer thread is started
+	 * with a default queue size if \ref asyncParams is all zero. stdio is used where
+	 * io_uring is not available. Not supported with compression nor the atomic writes.
+	 * */
+	unsigned int	ioUringDepth;
+	/** The layout of the text records, NULL (the default) for the built-in one. The pattern
+	 * is compiled once at init, the conversions are those of log4j :
+	 * - %d the date time, %d{DEFAULT} "2024-01-31 12:34:56", %d{ISO8601} "2024-01-31T12:34:56",
+	 *   followed by .ms or .us for the milliseconds or microseconds, %d{ISO8601.us}.
+	 * - %r the milliseconds elapsed since the init.
+	 * - %p the log level, TRACE to FATAL.
+	 * - %t the thread name, or its id if it has no name.
+	 * - %c the module name, %F the source file, %L the line, %M the function.
+	 * - %X the context of the thread, the one of \ref includeContext which is ignored.
+	 * - %m the message, exactly once, %n the newline, only at the end of the pattern as the
+	 *   records always end with one, %% a percent.
+	 *
+	 * The conversions take the format modifiers of log4j : %-5p pads on the right to 5
+	 * characters, %10c on the left, %.20F keeps the last 20 characters. The part after %m is
+	 * limited to 256 bytes. For example "%d{ISO8601.us} %-5p [%t] %c %F:%L %M - %m%n".
+	 * Not used with the JSON nor the binary output format, an invalid pattern is reported
+	 * and the built-in layout is used.
+	 * */
+	const char*	layout;
 }tFileLoggerInitParams;
 
 #endif // __FILE_LOGGER_H__
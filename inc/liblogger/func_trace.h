@@ -0,0 +1,77 @@
+/*
+       Licensed to the Apache Software Foundation (ASF) under one
+       or more contributor license agreements.  See the NOTICE file
+       distributed with this work for additional information
+       regarding copyright ownership.  The ASF licenses this file
+       to you under the Apache License, Version 2.0 (the
+       "License"); you may not use this file except in compliance
+       with the License.  You may obtain a copy of the License at
+
+         http://www.apache.org/licenses/LICENSE-2.0
+
+       Unless required by applicable law or agreed to in writing,
+       software distributed under the License is distributed on an
+       "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+       KIND, either express or implied.  See the License for the
+       specific language governing permissions and limitations
+       under the License.
+ */
+#ifndef __FUNC_TRACE_H__
+#define __FUNC_TRACE_H__
+
+/** \defgroup GRP_FUNC_TRACE Function tracing
+ * Once \ref InitFuncTrace is called, \ref LogFuncEntry / \ref LogFuncExit no longer write
+ * text records : each call stores a compact binary begin / end event (monotonic timestamp,
+ * thread id, function id) in a buffer of the calling thread, without taking the logger
+ * mutex. The buffers are appended to the capture file when they are full, and by
+ * \ref DeInitFuncTrace. The capture is independent of the log level.
+ *
+ * The lltrace tool converts a capture to the Chrome Trace Event format, which can be
+ * loaded in chrome://tracing or https://ui.perfetto.dev :
+ * \code
+ * lltrace app.lltrace > app.json
+ * \endcode
+ *
+ * Whole programs can be traced without \ref LogFuncEntry calls : build them with
+ * -finstrument-functions and link the logger-trace library, which records the address of
+ * each instrumented function in the same buffers. lltrace symbolises the addresses with the
+ * symbol tables of the modules mapped in the process, snapshotted in the capture.
+ * @{
+ * */
+
+/** Function trace parameters, see \ref InitFuncTrace. */
+typedef struct tFuncTraceParams
+{
+	/** The capture file, it is truncated. */
+	const char*		fileName;
+	/** The size of the buffer of each thread in events (24 bytes each),
+	 * 0 (the default) is 8192 events. */
+	unsigned int	bufferEvents;
+	/** With -finstrument-functions, only the functions of the modules (executable / shared
+	 * libraries) whose path contains this string are captured, NULL (the default) captures all
+	 * the instrumented functions. The modules are matched when the capture starts (Linux only). */
+	const char*		moduleFilter;
+	/** Non zero to timestamp the events with the time stamp counter of the processor (x86),
+	 * read in a few cycles instead of the monotonic clock. The raw ticks are stored, the
+	 * counter is calibrated against the wall clock at the start, when the buffers are
+	 * written (at most every 100 ms) and at the end of the capture, and lltrace converts
+	 * the ticks to the wall clock time. The monotonic clock is used if the counter is not
+	 * invariant, or if the operating system does not use it as its clock.
+	 * */
+	int				tscTimestamps;
+} tFuncTraceParams;
+
+/** Start capturing the function entry / exit events.
+ * \param [in] params	The function trace parameters.
+ * \returns 0 on success, -1 on failure.
+ * */
+int InitFuncTrace(const tFuncTraceParams* params);
+
+/** Stop capturing, the buffers of all the threads are written to the capture file.
+ * The traced threads may log function entries / exits concurrently, these events are
+ * dropped. Each buffer is freed by its thread, on its next event or when it exits. */
+void DeInitFuncTrace(void);
+
+/** @} */
+
+#endif // __FUNC_TRACE_H__
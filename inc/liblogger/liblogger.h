@@ -24,6 +24,7 @@ extern "C"
 {
 #endif
 
+#include <stddef.h>
 #include <liblogger/liblogger_levels.h>
 #include <liblogger/liblogger_config.h>
 
@@ -41,7 +42,13 @@ typedef enum LogDest
 	LogToConsole,
 	/** Indicates that logging should be done to socket. Please note that log server should be 
 	 *  running. */
-	LogToSocket
+	LogToSocket,
+	/** Indicates that logging should be done to a shared memory ring, read by a collector
+	 *  process such as llcollector, see \ref tShmLoggerInitParams. */
+	LogToSharedMemory,
+	/** Indicates that each thread should log to its own file, merged in time order by
+	 *  llmerge, see \ref tShardLoggerInitParams. */
+	LogToShards
 }LogDest;
 
 /* few compilers dont support variadic macros,so initially undef it, 
@@ -73,6 +80,23 @@ typedef enum LogDest
 int LogStub_vm(LogLevel logLevel,
 	const char* file, const char* funcName, const int lineNum,
 	const char* fmt,...);
+
+/** Logs a constant format without conversion specifiers, as a string. */
+int LogConstStub_vm(LogLevel logLevel,
+	const char* file, const char* funcName, const int lineNum,
+	const char* fmt, size_t len);
+
+#if defined(__GNUC__) && !defined(DISABLE_CONST_FMT_CHECK)
+	/* a constant format without conversion specifiers is copied to the record as is,
+	 * without va_start and without parsing it. The test is folded by the compiler, even
+	 * without optimizations, and the format is evaluated once. */
+	#define __LL_LOG(level, file, fmt, ...)	\
+		( (__builtin_constant_p(fmt) && !__builtin_strchr(fmt, '%')) ?	\
+			LogConstStub_vm(level, file, __func__, __LINE__, fmt, __builtin_strlen(fmt)) :	\
+			LogStub_vm(level, file, __func__, __LINE__, fmt , ## __VA_ARGS__) )
+#else
+	#define __LL_LOG(level, file, fmt, ...)	LogStub_vm(level, file, __func__, __LINE__, fmt , ## __VA_ARGS__)
+#endif
 #endif
 /** 
  * Function used to initialize the logger.
@@ -85,14 +109,114 @@ int InitLogger(LogDest ldest,void* loggerInitParams);
 /** Function used to deinitialize the logger. */
 void DeInitLogger();
 
+/**
+ * Installs a crash handler for SIGSEGV, SIGBUS, SIGFPE, SIGILL and SIGABRT (POSIX only).
+ * When one of these signals is caught, the pending log data is drained and a final record
+ * with the signal number is written, using only async-signal-safe calls. The signal is then
+ * re-raised with the previous disposition, so core dumps / other handlers still work.
+ * The handler runs on an alternate signal stack, so that stack overflows are reported : the
+ * calling thread gets one here, the other threads when they log their first record after
+ * this call. The threads which have not logged yet overflow without the final record.
+ * \returns 0 if successful, -1 if there is a failure.
+ * */
+int InitCrashHandler(void);
+
+/** Uninstalls the crash handler, restoring the previous signal dispositions. */
+void DeInitCrashHandler(void);
+
+/** Returns the time elapsed since an arbitrary, fixed point in the past in nanoseconds,
+ * not affected by changes to the wall clock. */
+unsigned long long LogGetTimeNs(void);
+
+/** Log governor parameters, see \ref InitLogGovernor. */
+typedef struct tLogGovernorParams
+{
+	/** The budget in records per second, 0 for no limit. */
+	unsigned long	maxRecordsPerSec;
+	/** The budget in bytes per second, 0 for no limit. */
+	unsigned long	maxBytesPerSec;
+	/** The highest minimum level the governor can set, 0 (the default) is \ref Error,
+	 * so that Error and Fatal records are never dropped. */
+	LogLevel		maxLevel;
+	/** The number of consecutive seconds the load must stay below half of the budget,
+	 * before the minimum level is lowered by one step, 0 (the default) is 5 seconds. */
+	unsigned int	coolDownSec;
+} tLogGovernorParams;
+
+/**
+ * Starts the log governor, which measures the records / bytes logged per second and
+ * raises the minimum log level by one step each second the budget is exceeded. Once the
+ * load drops, the level is lowered again step by step, down to the level of the log writer :
+ * the load is then counted with the records dropped by the governor that the lower level
+ * would let through, so that the level is not lowered only to be raised again.
+ * Each level transition is logged with the Warn level.
+ * \param [in] params The governor parameters.
+ * \returns 0 if successful, -1 if there is a failure.
+ * */
+int InitLogGovernor(const tLogGovernorParams* params);
+
+/** Stops the log governor, the level of the log writer applies again. */
+void DeInitLogGovernor(void);
+
+/** Stack trace parameters, see \ref InitStackTrace. */
+typedef struct tStackTraceParams
+{
+	/** The lowest level of the records with a stack trace, 0 (the default) is \ref Error. */
+	LogLevel		minLevel;
+	/** The maximum number of frames, 0 (the default) is 16, at most 64. */
+	unsigned int	maxFrames;
+} tStackTraceParams;
+
+/**
+ * Appends the call stack to the records of \ref tStackTraceParams::minLevel and above,
+ * " [stack: /usr/bin/app+0x1a2b /lib/libc.so.6+0x29d90 ...]". Only the return addresses
+ * are captured on the logging thread (glibc, Apple and Windows), the frames are written
+ * as module+offset and symbolised offline with the llstack tool or addr2line.
+ * \param [in] params The stack trace parameters.
+ * \returns 0 if successful, -1 if there is a failure.
+ * */
+int InitStackTrace(const tStackTraceParams* params);
+
+/** Stops appending the call stack to the records. */
+void DeInitStackTrace(void);
+
+/** The number of buckets of \ref tLogDurableStats::batches. */
+#define LL_DURABLE_BATCH_BUCKETS	16
+
+/** The statistics of the durable records, see \ref GRP_DURABLE. */
+typedef struct tLogDurableStats
+{
+	/** The number of syncs of the log. */
+	unsigned long long	commits;
+	/** The number of durable records they covered. */
+	unsigned long long	records;
+	/** The number of syncs which failed. */
+	unsigned long long	failures;
+	/** The largest number of durable records covered by a sync. */
+	unsigned long long	maxBatch;
+	/** The histogram of the number of durable records per sync : the bucket i counts the
+	 * syncs covering 2^i to 2^(i+1)-1 records, the last one the larger syncs. */
+	unsigned long long	batches[LL_DURABLE_BATCH_BUCKETS];
+	/** The total / the longest time the callers waited for their record to be synced, in ns. */
+	unsigned long long	totalWaitNs;
+	unsigned long long	maxWaitNs;
+} tLogDurableStats;
+
+/**
+ * Gets the statistics of the durable records logged since the logger was initialized.
+ * \param [out] stats The statistics.
+ * \returns 0 if successful, -1 if the log writer does not group the durable records.
+ * */
+int LogGetDurableStats(tLogDurableStats* stats);
+
 
 /* -- Log Level Trace -- */
 #ifdef VARIADIC_MACROS
 	#if defined(DISABLE_FILENAMES)
 		/* the filename should be disabled. */
-		#define LogTrace(fmt, ...) LogStub_vm(Trace,"",__func__, __LINE__ , fmt , ## __VA_ARGS__)
+		#define LogTrace(fmt, ...) __LL_LOG(Trace,"", fmt , ## __VA_ARGS__)
 	#else 
-		#define LogTrace(fmt, ...) LogStub_vm(Trace,__FILE__,__func__, __LINE__ , fmt , ## __VA_ARGS__)
+		#define LogTrace(fmt, ...) __LL_LOG(Trace,__FILE__, fmt , ## __VA_ARGS__)
 	#endif // DISABLE_FILENAMES
 #else
 	/** Emit a log with Trace level. */
@@ -103,9 +227,9 @@ void DeInitLogger();
 #ifdef VARIADIC_MACROS
 	#if defined(DISABLE_FILENAMES)
 		/* the filename should be disabled. */
-		#define LogDebug(fmt, ...) LogStub_vm(Debug,"",__func__, __LINE__ , fmt , ## __VA_ARGS__)
+		#define LogDebug(fmt, ...) __LL_LOG(Debug,"", fmt , ## __VA_ARGS__)
 	#else 
-		#define LogDebug(fmt, ...) LogStub_vm(Debug,__FILE__,__func__, __LINE__ , fmt , ## __VA_ARGS__)
+		#define LogDebug(fmt, ...) __LL_LOG(Debug,__FILE__, fmt , ## __VA_ARGS__)
 	#endif // DISABLE_FILENAMES
 #else
 	/** Emit a log with Debug level. */
@@ -116,9 +240,9 @@ void DeInitLogger();
 #ifdef VARIADIC_MACROS
 	#if defined(DISABLE_FILENAMES)
 		/* the filename should be disabled. */
-		#define LogInfo(fmt, ...) LogStub_vm(Info,"",__func__, __LINE__ , fmt , ## __VA_ARGS__)
+		#define LogInfo(fmt, ...) __LL_LOG(Info,"", fmt , ## __VA_ARGS__)
 	#else 
-		#define LogInfo(fmt, ...) LogStub_vm(Info,__FILE__,__func__, __LINE__ , fmt , ## __VA_ARGS__)
+		#define LogInfo(fmt, ...) __LL_LOG(Info,__FILE__, fmt , ## __VA_ARGS__)
 	#endif // DISABLE_FILENAMES
 #else
 	/** Emit a log with Info level. */
@@ -129,9 +253,9 @@ void DeInitLogger();
 #ifdef VARIADIC_MACROS
 	#if defined(DISABLE_FILENAMES)
 		/* the filename should be disabled. */
-		#define LogWarn(fmt, ...) LogStub_vm(Warn,"",__func__, __LINE__ , fmt , ## __VA_ARGS__)
+		#define LogWarn(fmt, ...) __LL_LOG(Warn,"", fmt , ## __VA_ARGS__)
 	#else 
-		#define LogWarn(fmt, ...) LogStub_vm(Warn,__FILE__,__func__, __LINE__ , fmt , ## __VA_ARGS__)
+		#define LogWarn(fmt, ...) __LL_LOG(Warn,__FILE__, fmt , ## __VA_ARGS__)
 	#endif // DISABLE_FILENAMES
 #else
 	/** Emit a log with Warn level. */
@@ -142,9 +266,9 @@ void DeInitLogger();
 #ifdef VARIADIC_MACROS
 	#if defined(DISABLE_FILENAMES)
 		/* the filename should be disabled. */
-		#define LogError(fmt, ...) LogStub_vm(Error,"",__func__, __LINE__ , fmt , ## __VA_ARGS__)
+		#define LogError(fmt, ...) __LL_LOG(Error,"", fmt , ## __VA_ARGS__)
 	#else 
-		#define LogError(fmt, ...) LogStub_vm(Error,__FILE__,__func__, __LINE__ , fmt , ## __VA_ARGS__)
+		#define LogError(fmt, ...) __LL_LOG(Error,__FILE__, fmt , ## __VA_ARGS__)
 	#endif // DISABLE_FILENAMES
 #else
 	/** Emit a log with Error level. */
@@ -155,20 +279,173 @@ void DeInitLogger();
 #ifdef VARIADIC_MACROS
 	#if defined(DISABLE_FILENAMES)
 		/* the filename should be disabled. */
-		#define LogFatal(fmt, ...) LogStub_vm(Fatal,"",__func__, __LINE__ , fmt , ## __VA_ARGS__)
+		#define LogFatal(fmt, ...) __LL_LOG(Fatal,"", fmt , ## __VA_ARGS__)
 	#else 
-		#define LogFatal(fmt, ...) LogStub_vm(Fatal,__FILE__,__func__, __LINE__ , fmt , ## __VA_ARGS__)
+		#define LogFatal(fmt, ...) __LL_LOG(Fatal,__FILE__, fmt , ## __VA_ARGS__)
 	#endif // DISABLE_FILENAMES
 #else
-	/** Emit a log with Fatal level. */
+	/** Emit a log with Fatal level, the log is flushed to the storage device before returning. */
 	int LogFatal(const char *fmt, ...);
 #endif // VARIADIC_MACROS
 
+/** \defgroup GRP_STR String records
+ * The following macros log a string which is already built, it is copied to the record
+ * as is : it is not a format and is not parsed. The string does not need to be terminated.
+ * \code
+ * LogInfoStr(line, lineLen);
+ * \endcode
+ * LogInfo("%s", msg) takes the same path, and so does a format without conversion
+ * specifiers : with GCC compatible compilers the macros detect the constant formats
+ * without conversion specifiers at compile time (define DISABLE_CONST_FMT_CHECK to turn
+ * it off), the other formats are checked when they are logged.
+ * The macros are available only with compilers supporting variadic macros.
+ * @{
+ * */
+#ifdef VARIADIC_MACROS
+
+int LogStrStub_vm(LogLevel logLevel,
+	const char* file, const char* funcName, const int lineNum,
+	const char* str, size_t len);
+
+#if defined(DISABLE_FILENAMES)
+	#define LogStr(level, str, len)	LogStrStub_vm(level,"",__func__, __LINE__ , str, len)
+#else
+	/** Emit a record with the string \a str of \a len bytes as message,
+	 * returns the amount of bytes logged, -1 on failure. */
+	#define LogStr(level, str, len)	LogStrStub_vm(level,__FILE__,__func__, __LINE__ , str, len)
+#endif // DISABLE_FILENAMES
+
+#define LogTraceStr(str, len)	LogStr(Trace, str, len)
+#define LogDebugStr(str, len)	LogStr(Debug, str, len)
+#define LogInfoStr(str, len)	LogStr(Info, str, len)
+#define LogWarnStr(str, len)	LogStr(Warn, str, len)
+#define LogErrorStr(str, len)	LogStr(Error, str, len)
+#define LogFatalStr(str, len)	LogStr(Fatal, str, len)
+
+#endif // VARIADIC_MACROS
+/** @} */
+
+/** \defgroup GRP_RATE_LIMIT Rate limited logs
+ * The following macros limit the amount of records emitted by a single call site,
+ * for example a warning in a retry loop. Each call site keeps its state in a static
+ * \ref LLSiteLimit, the decision is taken with lock-free arithmetic before the message
+ * is formatted. The number of records suppressed at a call site is appended to the
+ * next record emitted from it, " (suppressed N similar records)".
+ * The macros are statements, not expressions, and are available only with compilers 
+ * supporting variadic macros.
+ * @{
+ * */
+#ifdef VARIADIC_MACROS
+
+/** The state of a rate limited call site, zero initialized. */
+typedef struct LLSiteLimit
+{
+	/** The number of calls. */
+	volatile long long	count;
+	/** The time in ns (monotonic clock) before which records are suppressed. */
+	volatile long long	next;
+	/** The number of records suppressed since the last one emitted. */
+	volatile long long	suppressed;
+} LLSiteLimit;
+
+/* Functions deciding whether a rate limited record is emitted, they return the number of
+ * records suppressed since the last emitted one, -1 if this record should be suppressed. */
+long LLSiteEveryN(LLSiteLimit* site, unsigned long n);
+long LLSiteEveryMs(LLSiteLimit* site, unsigned long ms);
+long LLSiteSampled(LLSiteLimit* site, double probability);
+long LLSiteTokenBucket(LLSiteLimit* site, double ratePerSec, unsigned long burst);
+
+int LogStubLimited_vm(LogLevel logLevel, long suppressed,
+	const char* file, const char* funcName, const int lineNum,
+	const char* fmt,...);
+
+/** Returns non zero if a record of \a level logged by the calling thread would not be
+ * dropped for its level, checked before the decision so that a disabled call site costs no
+ * atomic operation and does not lose its count of suppressed records. */
+int LogLevelEnabled(LogLevel level);
+
+#if defined(DISABLE_FILENAMES)
+	#define __LL_SITE_FILE	""
+#else
+	#define __LL_SITE_FILE	__FILE__
+#endif // DISABLE_FILENAMES
+
+/* helper macro, emits a record if its level is enabled and the decision function allows it. */
+#define __LL_LIMITED(level, decide, fmt, ...)	do {							\
+		static LLSiteLimit __llSite;											\
+		if(LogLevelEnabled(level))												\
+		{																		\
+			long __llSuppressed = decide;										\
+			if(__llSuppressed >= 0)												\
+				LogStubLimited_vm(level, __llSuppressed, __LL_SITE_FILE, __func__, __LINE__ , fmt , ## __VA_ARGS__); \
+		}																		\
+	} while(0)
+
+/** Emit the 1st, (n+1)th, (2n+1)th ... record of the call site. */
+#define LogEveryN(level, n, fmt, ...)		__LL_LIMITED(level, LLSiteEveryN(&__llSite, (n)), fmt , ## __VA_ARGS__)
+/** Emit at most one record of the call site every \a ms milliseconds. */
+#define LogEveryMs(level, ms, fmt, ...)		__LL_LIMITED(level, LLSiteEveryMs(&__llSite, (ms)), fmt , ## __VA_ARGS__)
+/** Emit a record of the call site with the probability \a p (0.0 - 1.0). */
+#define LogSampled(level, p, fmt, ...)		__LL_LIMITED(level, LLSiteSampled(&__llSite, (p)), fmt , ## __VA_ARGS__)
+/** Emit the records of the call site at an average of \a ratePerSec, with bursts of at most 
+ * \a burst records (token bucket). */
+#define LogRateLimited(level, ratePerSec, burst, fmt, ...)	\
+	__LL_LIMITED(level, LLSiteTokenBucket(&__llSite, (ratePerSec), (burst)), fmt , ## __VA_ARGS__)
+
+#define LogInfoEveryN(n, fmt, ...)		LogEveryN(Info, n, fmt , ## __VA_ARGS__)
+#define LogWarnEveryN(n, fmt, ...)		LogEveryN(Warn, n, fmt , ## __VA_ARGS__)
+#define LogErrorEveryN(n, fmt, ...)		LogEveryN(Error, n, fmt , ## __VA_ARGS__)
+#define LogInfoEveryMs(ms, fmt, ...)	LogEveryMs(Info, ms, fmt , ## __VA_ARGS__)
+#define LogWarnEveryMs(ms, fmt, ...)	LogEveryMs(Warn, ms, fmt , ## __VA_ARGS__)
+#define LogErrorEveryMs(ms, fmt, ...)	LogEveryMs(Error, ms, fmt , ## __VA_ARGS__)
+#define LogDebugSampled(p, fmt, ...)	LogSampled(Debug, p, fmt , ## __VA_ARGS__)
+#define LogInfoSampled(p, fmt, ...)		LogSampled(Info, p, fmt , ## __VA_ARGS__)
+
+#endif // VARIADIC_MACROS
+/** @} */
+
+/** \defgroup GRP_DURABLE Durable records
+ * The following macros return once the record is on the storage device, for the audit
+ * records which must survive a power loss. The log is not synced per record : the callers
+ * waiting at the same time are released together by a single fdatasync (group commit),
+ * done outside of the logger lock, so the other records keep flowing meanwhile. The first
+ * caller waits \ref tFileLoggerInitParams::durableWindowMs for others to join before the
+ * sync, which trades the latency of the durable records for fewer syncs.
+ * The log writers without group commit (socket, shared memory) are synced for each
+ * durable record. A durable record suppressed as a repeat is only counted in the summary,
+ * which is synced by the next durable record.
+ * The macros are available only with compilers supporting variadic macros.
+ * @{
+ * */
+#ifdef VARIADIC_MACROS
+
+int LogDurableStub_vm(LogLevel logLevel,
+	const char* file, const char* funcName, const int lineNum,
+	const char* fmt,...);
+
+#if defined(DISABLE_FILENAMES)
+	#define LogDurable(level, fmt, ...)	LogDurableStub_vm(level,"",__func__, __LINE__ , fmt , ## __VA_ARGS__)
+#else
+	/** Emit a record and wait until it is on the storage device,
+	 * returns the amount of bytes logged, -1 on failure. */
+	#define LogDurable(level, fmt, ...)	LogDurableStub_vm(level,__FILE__,__func__, __LINE__ , fmt , ## __VA_ARGS__)
+#endif // DISABLE_FILENAMES
+
+#define LogInfoDurable(fmt, ...)	LogDurable(Info, fmt , ## __VA_ARGS__)
+#define LogWarnDurable(fmt, ...)	LogDurable(Warn, fmt , ## __VA_ARGS__)
+#define LogErrorDurable(fmt, ...)	LogDurable(Error, fmt , ## __VA_ARGS__)
+
+#endif // VARIADIC_MACROS
+/** @} */
+
 #ifdef VARIADIC_MACROS
 	/* Log Entry to a function. */
 	int FuncLogEntry(const char* funcName);
 	/* Log return from a function. */
 	int FuncLogExit(const char* funcName,const int lineNumber);
+	/* Log the exit of a scope with its duration, see \ref LL_SCOPE. */
+	int FuncLogScopeExit(const char* scopeName,const char* file,const char* funcName,
+			const int lineNumber,unsigned long long elapsedNs);
 	
 	#define LogFuncEntry()	FuncLogEntry(__func__)
 	#define LogFuncExit()	FuncLogExit(__func__,__LINE__)
@@ -177,10 +454,15 @@ void DeInitLogger();
 	#define LogFuncExit()	    /*NOP*/
 #endif
 
+#include <liblogger/liblogger_kv.h>
+#include <liblogger/liblogger_blob.h>
+#include <liblogger/func_trace.h>
 
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
 
+#include <liblogger/log_context.h>
+
 #endif /* __EXP_LOGGER_H__ */
 
@@ -0,0 +1,98 @@
+/*
+       Licensed to the Apache Software Foundation (ASF) under one
+       or more contributor license agreements.  See the NOTICE file
+       distributed with this work for additional information
+       regarding copyright ownership.  The ASF licenses this file
+       to you under the Apache License, Version 2.0 (the
+       "License"); you may not use this file except in compliance
+       with the License.  You may obtain a copy of the License at
+
+         http://www.apache.org/licenses/LICENSE-2.0
+
+       Unless required by applicable law or agreed to in writing,
+       software distributed under the License is distributed on an
+       "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+       KIND, either express or implied.  See the License for the
+       specific language governing permissions and limitations
+       under the License.
+ */
+#ifndef __LIBLOGGER_BLOB_H__
+#define __LIBLOGGER_BLOB_H__
+
+#include <stddef.h>
+#include <liblogger/liblogger_levels.h>
+#include <liblogger/liblogger_config.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/** \defgroup GRP_BLOB Large payloads
+ * A payload, such as the body of a request, can follow the message of a record without
+ * being formatted nor truncated to the size of the record buffer :
+ * \code
+ * LogDebugBlob(LogBlobRaw, body, bodyLen, "response %d from %s : ", status, host);
+ * \endcode
+ * The message is formatted as usual, the payload follows it as is or encoded in hex or in
+ * base64. The file and socket loggers write the record with a single writev / sendmsg,
+ * which references the payload of the caller. In asynchronous mode the payload is
+ * encoded straight into the queue, which is its only copy, and is truncated so that the
+ * record fits in \ref LL_ASYNC_RECORD_MAX bytes; a truncated payload ends with
+ * " [... N bytes omitted]".
+ * With \ref OutputFormatJson the payload is the "blob" member of the record, next to its
+ * length in "blob_len". With \ref OutputFormatBinary and with the shared memory logger,
+ * the payload is appended to the message and truncated to the record size.
+ * The blob records are never suppressed as repeats.
+ * The macros are available only with compilers supporting variadic macros.
+ * @{
+ * */
+
+/** The largest payload, longer payloads are truncated. */
+#define LL_BLOB_MAX			(256 * 1024 * 1024)
+
+/** The largest record in asynchronous mode, see \ref tAsyncLogParams. */
+#define LL_ASYNC_RECORD_MAX	(64 * 1024)
+
+/** The encodings of a payload. */
+typedef enum tLogBlobEncoding
+{
+	/** The payload is written as is, for text payloads. It is escaped in JSON records. */
+	LogBlobRaw = 0,
+	/** Two lowercase hex digits per byte. */
+	LogBlobHex,
+	/** Base64 with padding (RFC 4648). */
+	LogBlobBase64
+} tLogBlobEncoding;
+
+#ifdef VARIADIC_MACROS
+
+/** Logs a record whose message, formatted from \a fmt, is followed by a payload.
+ * \returns the amount of bytes logged, -1 on failure.
+ * */
+int LogBlobStub_vm(LogLevel logLevel,
+	const char* file, const char* funcName, const int lineNum,
+	tLogBlobEncoding encoding, const void* data, size_t len,
+	const char* fmt,...);
+
+#if defined(DISABLE_FILENAMES)
+	#define __LL_BLOB_FILE	""
+#else
+	#define __LL_BLOB_FILE	__FILE__
+#endif // DISABLE_FILENAMES
+
+#define LogBlob(level, encoding, data, len, fmt, ...)	LogBlobStub_vm(level, __LL_BLOB_FILE, __func__, __LINE__, encoding, data, len, fmt , ## __VA_ARGS__)
+#define LogTraceBlob(encoding, data, len, fmt, ...)	LogBlob(Trace, encoding, data, len, fmt , ## __VA_ARGS__)
+#define LogDebugBlob(encoding, data, len, fmt, ...)	LogBlob(Debug, encoding, data, len, fmt , ## __VA_ARGS__)
+#define LogInfoBlob(encoding, data, len, fmt, ...)	LogBlob(Info, encoding, data, len, fmt , ## __VA_ARGS__)
+#define LogWarnBlob(encoding, data, len, fmt, ...)	LogBlob(Warn, encoding, data, len, fmt , ## __VA_ARGS__)
+#define LogErrorBlob(encoding, data, len, fmt, ...)	LogBlob(Error, encoding, data, len, fmt , ## __VA_ARGS__)
+
+#endif // VARIADIC_MACROS
+/** @} */
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif // __LIBLOGGER_BLOB_H__
@@ -0,0 +1,114 @@
+/*
+       Licensed to the Apache Software Foundation (ASF) under one
+       or more contributor license agreements.  See the NOTICE file
+       distributed with this work for additional information
+       regarding copyright ownership.  The ASF licenses this file
+       to you under the Apache License, Version 2.0 (the
+       "License"); you may not use this file except in compliance
+       with the License.  You may obtain a copy of the License at
+
+         http://www.apache.org/licenses/LICENSE-2.0
+
+       Unless required by applicable law or agreed to in writing,
+       software distributed under the License is distributed on an
+       "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+       KIND, either express or implied.  See the License for the
+       specific language governing permissions and limitations
+       under the License.
+ */
+#ifndef __LIBLOGGER_KV_H__
+#define __LIBLOGGER_KV_H__
+
+#include <liblogger/liblogger_levels.h>
+#include <liblogger/liblogger_config.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/** \defgroup GRP_KV Structured logs
+ * Typed key / value fields can be attached to a record, without any heap allocation :
+ * \code
+ * LogInfoKV("request done", LL_INT("status", status), LL_STR("path", path));
+ * \endcode
+ * With \ref OutputFormatJson the record is written as one line of JSON, the fields are
+ * members of the JSON object. With \ref OutputFormatText the fields are appended to the
+ * message as key=value pairs.
+ * The KV macros are available only with compilers supporting variadic macros.
+ * @{
+ * */
+
+/** The output format of a log writer, part of the logger initialization parameters. */
+typedef enum tOutputFormat
+{
+	/** The "[date] [I] module::file#line:func() - msg" text records (the default). */
+	OutputFormatText = 0,
+	/** Newline delimited JSON, one object per record, with the members 
+	 * ts, level, module, file, line, func, msg and the KV fields. */
+	OutputFormatJson,
+	/** Binary records, file logger only : each call site (format, file, function, line,
+	 * level) is written once, its records store the call site id, the time, the thread id
+	 * and the raw arguments of the format. The message is formatted offline, the lldecode
+	 * tool renders the log in the text layout. The KV fields are written as text.
+	 * The rollback mode is not supported. */
+	OutputFormatBinary
+} tOutputFormat;
+
+/** The types of the fields, each field is passed as a type / key / value triple. */
+typedef enum tLLFieldType
+{
+	/** Terminates the list of fields. */
+	LL_KV_END = 0,
+	/** long long value. */
+	LL_KV_INT,
+	/** unsigned long long value. */
+	LL_KV_UINT,
+	/** double value. */
+	LL_KV_DOUBLE,
+	/** const char* value, NULL is written as null. */
+	LL_KV_STR,
+	/** boolean value, passed as int. */
+	LL_KV_BOOL
+} tLLFieldType;
+
+/** Integer field. */
+#define LL_INT(key, val)	(int)LL_KV_INT, (const char*)(key), (long long)(val)
+/** Unsigned integer field. */
+#define LL_UINT(key, val)	(int)LL_KV_UINT, (const char*)(key), (unsigned long long)(val)
+/** Floating point field. */
+#define LL_DOUBLE(key, val)	(int)LL_KV_DOUBLE, (const char*)(key), (double)(val)
+/** String field. */
+#define LL_STR(key, val)	(int)LL_KV_STR, (const char*)(key), (const char*)(val)
+/** Boolean field. */
+#define LL_BOOL(key, val)	(int)LL_KV_BOOL, (const char*)(key), (int)((val) != 0)
+
+#ifdef VARIADIC_MACROS
+
+/** Logs a record with fields, the list of fields must be terminated by \ref LL_KV_END. */
+int LogKVStub_vm(LogLevel logLevel,
+	const char* file, const char* funcName, const int lineNum,
+	const char* msg,...);
+
+#if defined(DISABLE_FILENAMES)
+	#define __LL_KV_FILE	""
+#else
+	#define __LL_KV_FILE	__FILE__
+#endif // DISABLE_FILENAMES
+
+#define LogKV(level, msg, ...)	LogKVStub_vm(level, __LL_KV_FILE, __func__, __LINE__, msg , ## __VA_ARGS__ , (int)LL_KV_END)
+#define LogTraceKV(msg, ...)	LogKV(Trace, msg , ## __VA_ARGS__)
+#define LogDebugKV(msg, ...)	LogKV(Debug, msg , ## __VA_ARGS__)
+#define LogInfoKV(msg, ...)		LogKV(Info, msg , ## __VA_ARGS__)
+#define LogWarnKV(msg, ...)		LogKV(Warn, msg , ## __VA_ARGS__)
+#define LogErrorKV(msg, ...)	LogKV(Error, msg , ## __VA_ARGS__)
+#define LogFatalKV(msg, ...)	LogKV(Fatal, msg , ## __VA_ARGS__)
+
+#endif // VARIADIC_MACROS
+/** @} */
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif // __LIBLOGGER_KV_H__
@@ -0,0 +1,156 @@
+/*
+       Licensed to the Apache Software Foundation (ASF) under one
+       or more contributor license agreements.  See the NOTICE file
+       distributed with this work for additional information
+       regarding copyright ownership.  The ASF licenses this file
+       to you under the Apache License, Version 2.0 (the
+       "License"); you may not use this file except in compliance
+       with the License.  You may obtain a copy of the License at
+
+         http://www.apache.org/licenses/LICENSE-2.0
+
+       Unless required by applicable law or agreed to in writing,
+       software distributed under the License is distributed on an
+       "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+       KIND, either express or implied.  See the License for the
+       specific language governing permissions and limitations
+       under the License.
+ */
+#ifndef __LOG_CONTEXT_H__
+#define __LOG_CONTEXT_H__
+
+#include <liblogger/liblogger_levels.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/** \defgroup GRP_CONTEXT Mapped diagnostic context
+ * Each thread has a stack of key / value pairs, which the writers add to every record
+ * logged by the thread, when \c includeContext is set in the logger initialization
+ * parameters. The thread id and the thread name come first :
+ * \code
+ * LogContextPush("request", requestId);
+ * LogInfo("request started");	// [..] [I] module::main.c#12:handle() - [tid=4242 thread=worker-1 request=abc] request started
+ * LogContextPop();
+ * \endcode
+ * With \ref OutputFormatJson, the pairs are members of the record : "tid":4242,"thread":"worker-1","request":"abc".
+ * The context is rendered once when it changes and cached per thread, so that it is
+ * only copied in each record.
+ * @{
+ * */
+
+/** The maximum number of pairs in the context of a thread. */
+#define LL_CONTEXT_MAX_ENTRIES	16
+/** The maximum length of a key, longer keys are truncated. */
+#define LL_CONTEXT_MAX_KEY		31
+/** The maximum length of a value, longer values are truncated. */
+#define LL_CONTEXT_MAX_VALUE	127
+
+/** Push a key / value pair on the context of the calling thread, the strings are copied.
+ * A key pushed again hides the previous value until it is popped.
+ * \returns 0 on success, -1 if the context is full or the args are invalid.
+ * */
+int LogContextPush(const char* key, const char* value);
+
+/** Pop the pair pushed last on the context of the calling thread.
+ * \returns 0 on success, -1 if the context is empty.
+ * */
+int LogContextPop(void);
+
+/** Remove all the pairs from the context of the calling thread,
+ * the thread id and the thread name are kept. */
+void LogContextClear(void);
+
+/** Set the thread name written in the context of the calling thread, by default the
+ * name given to the thread by the system (pthread_setname_np) is read once.
+ * \param [in] name		The thread name, NULL or empty to omit it.
+ * */
+void LogSetThreadName(const char* name);
+
+/** @} */
+
+/** \defgroup GRP_THREAD_LEVEL Thread log level
+ * The log level of the calling thread can be overridden, for example to trace a single
+ * request while the rest of the process keeps the level of the log writer :
+ * \code
+ * if(debugHeaderPresent)
+ *     LogSetThreadLevel(Trace);
+ * handleRequest();
+ * LogClearThreadLevel();
+ * \endcode
+ * The other threads still reject the records below the level of the log writer with a
+ * single load and compare. The log governor still applies to the overridden threads.
+ * The override of a thread is removed when it exits, if it is set once the logger is
+ * initialized.
+ * @{
+ * */
+
+/** Override the log level of the calling thread.
+ * \param [in] level	The log level, \ref Disable mutes the thread.
+ * \returns 0 on success, -1 if the level is invalid.
+ * */
+int LogSetThreadLevel(LogLevel level);
+
+/** Returns the log level override of the calling thread, 0 if there is none. */
+LogLevel LogGetThreadLevel(void);
+
+/** Remove the log level override of the calling thread. */
+void LogClearThreadLevel(void);
+
+/** @} */
+
+#ifdef __cplusplus
+}
+
+/** Pushes a pair on the context of the calling thread for the lifetime of the scope :
+ * \code
+ * LogContextScope ctx("request", requestId);
+ * \endcode
+ * */
+class LogContextScope
+{
+public:
+	LogContextScope(const char* key, const char* value)
+		: mPushed(0 == LogContextPush(key, value))
+	{
+	}
+	~LogContextScope()
+	{
+		if(mPushed)
+			LogContextPop();
+	}
+private:
+	/* not copyable. */
+	LogContextScope(const LogContextScope&);
+	LogContextScope& operator=(const LogContextScope&);
+	bool mPushed;
+};
+
+/** Overrides the log level of the calling thread for the lifetime of the scope,
+ * the previous override is restored on exit. */
+class LogThreadLevelScope
+{
+public:
+	explicit LogThreadLevelScope(LogLevel level)
+		: mPrevious(LogGetThreadLevel())
+	{
+		LogSetThreadLevel(level);
+	}
+	~LogThreadLevelScope()
+	{
+		if(mPrevious)
+			LogSetThreadLevel(mPrevious);
+		else
+			LogClearThreadLevel();
+	}
+private:
+	/* not copyable. */
+	LogThreadLevelScope(const LogThreadLevelScope&);
+	LogThreadLevelScope& operator=(const LogThreadLevelScope&);
+	LogLevel mPrevious;
+};
+#endif /* __cplusplus */
+
+#endif // __LOG_CONTEXT_H__
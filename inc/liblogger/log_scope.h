@@ -0,0 +1,132 @@
+/*
+       Licensed to the Apache Software Foundation (ASF) under one
+       or more contributor license agreements.  See the NOTICE file
+       distributed with this work for additional information
+       regarding copyright ownership.  The ASF licenses this file
+       to you under the Apache License, Version 2.0 (the
+       "License"); you may not use this file except in compliance
+       with the License.  You may obtain a copy of the License at
+
+         http://www.apache.org/licenses/LICENSE-2.0
+
+       Unless required by applicable law or agreed to in writing,
+       software distributed under the License is distributed on an
+       "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+       KIND, either express or implied.  See the License for the
+       specific language governing permissions and limitations
+       under the License.
+ */
+#ifndef __LOG_SCOPE_H__
+#define __LOG_SCOPE_H__
+
+#include <liblogger/liblogger.h>
+
+/** \defgroup GRP_LOG_SCOPE Scoped tracing (C++)
+ * \ref LL_SCOPE logs the entry of a scope when it is constructed, and the exit with the
+ * elapsed time when it is destroyed, so that early returns and exceptions are covered :
+ * \code
+ * void handle()
+ * {
+ *     LL_SCOPE("handle");
+ *     if(cached)
+ *         return;		// the exit is logged here too.
+ * }
+ * \endcode
+ * The entry / exit follow the \ref LogFuncEntry / \ref LogFuncExit path : Trace records,
+ * or begin / end events once \ref InitFuncTrace is called.
+ *
+ * \ref LL_SCOPE_SLOW logs nothing unless the scope takes longer than the threshold, it
+ * then logs a Warn record with the elapsed time. It costs two clock reads, so it can be
+ * left enabled in production :
+ * \code
+ * LL_SCOPE_SLOW("db query", 50);	// warns if the query takes 50 ms or more.
+ * \endcode
+ * Available only with compilers supporting variadic macros.
+ * @{
+ * */
+
+#if defined(__cplusplus) && defined(VARIADIC_MACROS)
+
+/** Logs the entry / exit of a scope, use \ref LL_SCOPE. */
+class LogScope
+{
+public:
+	LogScope(const char* name, const char* file, const char* func, int line)
+		: mName(name), mFile(file), mFunc(func), mLine(line), mStartNs(0)
+	{
+		/* nothing is measured if the entry is not logged. */
+		if(FuncLogEntry(name) >= 0)
+			mStartNs = LogGetTimeNs();
+	}
+	~LogScope()
+	{
+		if(mStartNs)
+			FuncLogScopeExit(mName, mFile, mFunc, mLine, LogGetTimeNs() - mStartNs);
+	}
+private:
+	/* not copyable. */
+	LogScope(const LogScope&);
+	LogScope& operator=(const LogScope&);
+	const char*	mName;
+	const char*	mFile;
+	const char*	mFunc;
+	int			mLine;
+	unsigned long long	mStartNs;
+};
+
+/** Logs a scope which takes longer than a threshold, use \ref LL_SCOPE_SLOW. */
+class LogSlowScope
+{
+public:
+	LogSlowScope(const char* name, const char* file, const char* func, int line, unsigned long thresholdMs)
+		: mName(name), mFile(file), mFunc(func), mLine(line),
+		mThresholdNs(thresholdMs * 1000000ULL), mStartNs(LogGetTimeNs())
+	{
+	}
+	~LogSlowScope()
+	{
+		unsigned long long elapsedNs = LogGetTimeNs() - mStartNs;
+		if(elapsedNs >= mThresholdNs)
+			LogStub_vm(Warn, mFile, mFunc, mLine, "slow scope %s : %llu.%03llu ms (threshold %llu ms)",
+					mName, elapsedNs / 1000000ULL, (elapsedNs / 1000ULL) % 1000ULL, mThresholdNs / 1000000ULL);
+	}
+private:
+	/* not copyable. */
+	LogSlowScope(const LogSlowScope&);
+	LogSlowScope& operator=(const LogSlowScope&);
+	const char*	mName;
+	const char*	mFile;
+	const char*	mFunc;
+	int			mLine;
+	unsigned long long	mThresholdNs;
+	unsigned long long	mStartNs;
+};
+
+#if defined(DISABLE_FILENAMES)
+	#define __LL_SCOPE_FILE	""
+#else
+	#define __LL_SCOPE_FILE	__FILE__
+#endif // DISABLE_FILENAMES
+
+/* helper macros, to name the scope object after the line. */
+#define __LL_SCOPE_CAT2(a, b)	a ## b
+#define __LL_SCOPE_CAT(a, b)	__LL_SCOPE_CAT2(a, b)
+
+/** Logs the entry / exit of the enclosing scope, with the elapsed time. */
+#define LL_SCOPE(name)	\
+	LogScope __LL_SCOPE_CAT(__llScope, __LINE__)(name, __LL_SCOPE_FILE, __func__, __LINE__)
+
+/** Logs a Warn record if the enclosing scope takes \a thresholdMs milliseconds or more. */
+#define LL_SCOPE_SLOW(name, thresholdMs)	\
+	LogSlowScope __LL_SCOPE_CAT(__llScope, __LINE__)(name, __LL_SCOPE_FILE, __func__, __LINE__, (thresholdMs))
+
+#elif defined(__cplusplus)
+
+	#define LL_SCOPE(name)						/* NOP */
+	#define LL_SCOPE_SLOW(name, thresholdMs)	/* NOP */
+
+#endif // __cplusplus && VARIADIC_MACROS
+
+/** @} */
+
+#endif // __LOG_SCOPE_H__
@@ -33,6 +33,29 @@ typedef int (*Log)(struct LogWriter* _this,const LogLevel logLevel,
 typedef int (*LogFuncEntry)(struct LogWriter * _this,const char* funcName);
 typedef int (*LogFuncExit)(struct LogWriter* _this,const char* funcName,int lineNum);
 typedef int (*LoggerDeInit)(struct LogWriter* _this);
+typedef int (*LoggerSync)(struct LogWriter* _this);
+typedef int (*LoggerCrashFlush)(struct LogWriter* _this,int signum);
+typedef int (*LoggerAtFork)(struct LogWriter* _this,int phase);
+typedef int (*LoggerCommit)(struct LogWriter* _this);
+typedef int (*LoggerCommitStats)(struct LogWriter* _this,tLogDurableStats* stats);
+typedef int (*LogFields)(struct LogWriter* _this,const LogLevel logLevel,
+		const char* moduleName,
+		const char* file,const char* funcName, const int lineNum, 
+		const char* msg,va_list fields);
+typedef int (*LogString)(struct LogWriter* _this,const LogLevel logLevel,
+		const char* moduleName,
+		const char* file,const char* funcName, const int lineNum, 
+		const char* fmt,const char* msg,int len);
+typedef int (*LogBlobRecord)(struct LogWriter* _this,const LogLevel logLevel,
+		const char* moduleName,
+		const char* file,const char* funcName, const int lineNum, 
+		int encoding,const void* data,int len,
+		const char* fmt,va_list ap);
+
+/** The phases of a fork(), see \ref LogWriter::atFork. */
+#define LL_FORK_PREPARE		0
+#define LL_FORK_PARENT		1
+#define LL_FORK_CHILD		2
 
 /** The log writer object */
 typedef struct LogWriter
@@ -41,7 +64,7 @@ typedef struct LogWriter
 	LogLevel	logLevel;
 	/** The log module name */
 	char		moduleName[256];
-	/** Member function to log. */
+	/** Member function to log, returns the amount of bytes logged, -1 on failure. */
 	Log 			log;
 	/** Member function to log the function entry. */
 	LogFuncEntry 	logFuncEntry;
@@ -50,6 +73,54 @@ typedef struct LogWriter
 	/** Member function to deinitialize the log writer object, the log writer object will
 	 * not be referenced after this call.*/
 	LoggerDeInit	loggerDeInit;
+	/** Member function to drain all pending log data and flush it to the storage 
+	 * device, called after a Fatal log. */
+	LoggerSync		sync;
+	/** Member function called by the crash handler when a fatal signal is caught,
+	 * to drain the pending log data and emit a final record with the signal number.
+	 * This is called from a signal handler and must be async-signal-safe 
+	 * (no stdio, no malloc, no locks). */
+	LoggerCrashFlush	crashFlush;
+	/** Member function to log a record with typed key / value fields, see \ref GRP_KV.
+	 * \a fields is the list of type / key / value triples, terminated by \ref LL_KV_END. */
+	LogFields		logKV;
+	/** Member function called around fork(), with the logger mutex locked : with
+	 * \ref LL_FORK_PREPARE before the fork, to wait for the background thread and to flush
+	 * the buffers, then with \ref LL_FORK_PARENT in the parent, and with \ref LL_FORK_CHILD
+	 * in the child, to reset the locks and the buffers and to restart the background thread. */
+	LoggerAtFork	atFork;
+	/** Member function to wait until the records logged so far are on the storage device,
+	 * called \b without the logger mutex after a durable record, see \ref GRP_DURABLE.
+	 * The callers waiting at the same time share a single sync. Can be NULL, \ref sync is
+	 * then called with the logger mutex locked. */
+	LoggerCommit	commit;
+	/** Member function to get the statistics of \ref commit (can be NULL). */
+	LoggerCommitStats	commitStats;
+	/** Member function to log a record followed by a payload, see \ref GRP_BLOB.
+	 * \a len is at most \ref LL_BLOB_MAX. Can be NULL, the payload is then encoded and
+	 * appended to the message. */
+	LogBlobRecord	logBlob;
+	/** Member function to log a message which is not a format, see \ref GRP_STR.
+	 * \a fmt is the format the message comes from (a format without conversion specifiers,
+	 * \a msg is then \a fmt), for the log writers which identify the call sites by their
+	 * format, NULL if the message is a string. Can be NULL, \ref log is then called with "%.*s". */
+	LogString		logStr;
+	/** Non zero if the log writer keeps its state per thread, see \ref LogToShards : the
+	 * records are logged without the logger mutex, unless they use the stack trace or the
+	 * log governor, shared by the threads. The other member functions are called with the
+	 * logger mutex locked. */
+	int				perThread;
+	/** Non zero if the log writer writes the notes of a record apart from its message : the
+	 * call stack (see \ref InitStackTrace) and the count of the records suppressed by the
+	 * rate limit of the call site (see \ref LogEveryN). The format is logged as it is, the
+	 * notes are in \ref stack and \ref suppressed. */
+	int				notesApart;
+	/** The call stack of the record being logged, rendered as text, or NULL. Set with the
+	 * logger mutex locked, for the log writers with \ref notesApart. */
+	const char*		stack;
+	/** The count of the records suppressed before the record being logged, or 0. Set with the
+	 * logger mutex locked, for the log writers with \ref notesApart. */
+	long			suppressed;
 }LogWriter;
 
 
@@ -0,0 +1,65 @@
+/*
+       Licensed to the Apache Software Foundation (ASF) under one
+       or more contributor license agreements.  See the NOTICE file
+       distributed with this work for additional information
+       regarding copyright ownership.  The ASF licenses this file
+       to you under the Apache License, Version 2.0 (the
+       "License"); you may not use this file except in compliance
+       with the License.  You may obtain a copy of the License at
+
+         http://www.apache.org/licenses/LICENSE-2.0
+
+       Unless required by applicable law or agreed to in writing,
+       software distributed under the License is distributed on an
+       "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+       KIND, either express or implied.  See the License for the
+       specific language governing permissions and limitations
+       under the License.
+ */
+#ifndef __SHARD_LOGGER_H__
+#define __SHARD_LOGGER_H__
+
+#include <liblogger/liblogger_levels.h>
+
+/** The length of the head of a record of a shard : the time, 19 digits, a space, the length
+ * of the record, 8 digits, and a space. */
+#define LL_SHARD_HEAD_LEN	29
+
+/** Sharded Logger Initialization parameters, used with \ref LogToShards.
+ * Each logging thread writes its records to its own file, a shard named after the thread id :
+ * "<fileName>.<tid>". The records are buffered per thread and written without locking, the
+ * logging threads share nothing but the list of the shards, locked when a thread logs its
+ * first record. The llmerge tool streams the shards back as a single log, in time order :
+ * \code
+ * llmerge -o myapp.log myapp.log.*
+ * \endcode
+ * Each record of a shard is prefixed by its head, see \ref LL_SHARD_HEAD_LEN : the wall
+ * clock time in ns since the epoch and the length of the text record which follows,
+ * "[date time] [I] module::file#line:function() - message\n", both zero padded.
+ * The buffer of a thread is written when it is full, when its oldest record is older than
+ * \ref flushIntervalMs as the thread logs, after a Fatal record, when the thread exits and
+ * when the logger is deinitialized. The shard of a thread is closed as the thread exits, a
+ * thread which gets the id of an ended one appends to its shard.
+ * \ref DeInitLogger() must not be called while other threads log nor exit.
+ * The stack traces (\ref InitStackTrace) and the log governor (\ref InitLogGovernor) are
+ * shared by the threads, the records which use them lock the logger mutex.
+ * */
+typedef struct tShardLoggerInitParams
+{
+	/** The log level */
+	LogLevel	logLevel;
+	/** The log module name */
+	char*		moduleName;
+	/** The path of the shards, the thread id is appended. The shards are opened in append mode. */
+	char*		fileName;
+	/** The size of the buffer of a thread in bytes, 0 for 64 KB. */
+	unsigned int	bufferSize;
+	/** The largest time a record stays in the buffer of a thread which keeps logging,
+	 * 0 for 1000 ms. */
+	unsigned int	flushIntervalMs;
+	/** Non zero to add the context of the logging thread to each record : the thread id,
+	 * the thread name and the pairs pushed with \ref LogContextPush(). */
+	int		includeContext;
+}tShardLoggerInitParams;
+
+#endif // __SHARD_LOGGER_H__
@@ -0,0 +1,56 @@
+/*
+       Licensed to the Apache Software Foundation (ASF) under one
+       or more contributor license agreements.  See the NOTICE file
+       distributed with this work for additional information
+       regarding copyright ownership.  The ASF licenses this file
+       to you under the Apache License, Version 2.0 (the
+       "License"); you may not use this file except in compliance
+       with the License.  You may obtain a copy of the License at
+
+         http://www.apache.org/licenses/LICENSE-2.0
+
+       Unless required by applicable law or agreed to in writing,
+       software distributed under the License is distributed on an
+       "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+       KIND, either express or implied.  See the License for the
+       specific language governing permissions and limitations
+       under the License.
+ */
+#ifndef __SHM_LOGGER_H__
+#define __SHM_LOGGER_H__
+
+#include <liblogger/liblogger_levels.h>
+#include <liblogger/liblogger_kv.h>
+
+/** Shared memory Logger Initialization parameters, used with \ref LogToSharedMemory.
+ * The records are written to a ring in a named shared memory, read by a collector
+ * process such as llcollector :
+ * \code
+ * llcollector myapp-log /var/log/myapp.log
+ * \endcode
+ * The logging threads never lock nor make a system call to log, except to wake the
+ * collector when it waits for records. The records stay in the shared memory if the
+ * process crashes, and are read by the collector, even if it is started afterwards.
+ * When the ring is full the records are dropped, the collector reports their count.
+ * Several processes may log to the same ring.
+ * */
+typedef struct tShmLoggerInitParams
+{
+	/** The log level */
+	LogLevel	logLevel;
+	/** The log module name */
+	char*		moduleName;
+	/** The name of the shared memory, a file of /dev/shm on Linux.
+	 * It is created if the collector has not created it yet. */
+	char*		shmName;
+	/** The size of the ring in bytes if it is created, rounded to a power of two,
+	 * 0 for 4 MB. */
+	unsigned int	ringSize;
+	/** The output format, text (the default) or JSON. */
+	tOutputFormat	outputFormat;
+	/** Non zero to add the context of the logging thread to each record : the thread id,
+	 * the thread name and the pairs pushed with \ref LogContextPush(). */
+	int		includeContext;
+}tShmLoggerInitParams;
+
+#endif // __SHM_LOGGER_H__
@@ -19,6 +19,9 @@
 #ifndef __SOCKET_LOGGER_H__
 #define __SOCKET_LOGGER_H__
 
+#include <liblogger/async_logger.h>
+#include <liblogger/liblogger_kv.h>
+
 /** Socket Logger Initialization parameters. */
 typedef struct tSockLoggerInitParams
 {
@@ -30,6 +33,18 @@ typedef struct tSockLoggerInitParams
 	char* 	server;
 	/** The port of the log server. */
 	int		port;
+	/** The output format, text (the default) or JSON. */
+	tOutputFormat	outputFormat;
+	/** Non zero to suppress consecutive identical records from the same call site,
+	 * a summary is logged when the run ends : "last message repeated N times over T s". */
+	int		suppressRepeats;
+	/** Non zero to add the context of the logging thread to each record : the thread id,
+	 * the thread name and the pairs pushed with \ref LogContextPush(). */
+	int		includeContext;
+	/** The asynchronous logging parameters, all zero logs synchronously. */
+	tAsyncLogParams	asyncParams;
+	/** The layout of the text records, see \ref tFileLoggerInitParams::layout. */
+	const char*	layout;
 }tSockLoggerInitParams;
 
 #endif // __SOCKET_LOGGER_H__
@@ -21,6 +21,10 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#if defined(WIN32) || defined(_WIN32)
+	#include <windows.h>
+#endif
+
 /*
  * Returns the current date time as a string.
  * \param [out] str String where the date time is returned.
@@ -30,10 +34,16 @@
 int LLGetCurDateTime(char* str, int strLen)
 {
 	time_t t;
+	struct tm tmBuf;
 	struct tm *tmp;
 
 	t = time(NULL);
-	tmp = localtime(&t);
+	/* the reentrant version, the sharded logger calls it without the logger mutex. */
+#if defined(WIN32) || defined(_WIN32)
+	tmp = localtime_s(&tmBuf, &t) ? NULL : &tmBuf;
+#else
+	tmp = localtime_r(&t, &tmBuf);
+#endif
 	if (tmp == NULL) {
 		perror("localtime");
 		return -1;
@@ -46,3 +56,63 @@ int LLGetCurDateTime(char* str, int strLen)
 	return 0;
 
 }
+
+/*
+ * Returns the time elapsed since an arbitrary, fixed point in the past in nanoseconds.
+ * */
+unsigned long long LLGetMonotonicNs(void)
+{
+#if defined(WIN32) || defined(_WIN32)
+	static LARGE_INTEGER freq;
+	LARGE_INTEGER count;
+	if(!freq.QuadPart)
+		QueryPerformanceFrequency(&freq);
+	QueryPerformanceCounter(&count);
+	return (unsigned long long)(count.QuadPart / freq.QuadPart) * 1000000000ULL
+		+ (unsigned long long)(count.QuadPart % freq.QuadPart) * 1000000000ULL / freq.QuadPart;
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long long)ts.tv_sec * 1000000000ULL + (unsigned long long)ts.tv_nsec;
+#endif
+}
+
+/*
+ * Returns the wall clock time in microseconds since the epoch (UTC).
+ * */
+unsigned long long LLGetWallClockUs(void)
+{
+#if defined(WIN32) || defined(_WIN32)
+	FILETIME ft;
+	ULARGE_INTEGER t;
+	GetSystemTimeAsFileTime(&ft);
+	t.LowPart = ft.dwLowDateTime;
+	t.HighPart = ft.dwHighDateTime;
+	/* 100 ns intervals since 1601-01-01. */
+	return (t.QuadPart - 116444736000000000ULL) / 10;
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_REALTIME, &ts);
+	return (unsigned long long)ts.tv_sec * 1000000ULL + (unsigned long long)ts.tv_nsec / 1000;
+#endif
+}
+
+/*
+ * Returns the wall clock time in nanoseconds since the epoch (UTC).
+ * */
+unsigned long long LLGetWallClockNs(void)
+{
+#if defined(WIN32) || defined(_WIN32)
+	FILETIME ft;
+	ULARGE_INTEGER t;
+	GetSystemTimePreciseAsFileTime(&ft);
+	t.LowPart = ft.dwLowDateTime;
+	t.HighPart = ft.dwHighDateTime;
+	/* 100 ns intervals since 1601-01-01. */
+	return (t.QuadPart - 116444736000000000ULL) * 100;
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_REALTIME, &ts);
+	return (unsigned long long)ts.tv_sec * 1000000000ULL + (unsigned long long)ts.tv_nsec;
+#endif
+}
@@ -27,4 +27,16 @@
  * */
 int LLGetCurDateTime(char* str, int strLen);
 
+/**
+ * Returns the time elapsed since an arbitrary, fixed point in the past in nanoseconds,
+ * not affected by changes to the wall clock.
+ * */
+unsigned long long LLGetMonotonicNs(void);
+
+/** Returns the wall clock time in microseconds since the epoch (UTC). */
+unsigned long long LLGetWallClockUs(void);
+
+/** Returns the wall clock time in nanoseconds since the epoch (UTC). */
+unsigned long long LLGetWallClockNs(void);
+
 #endif // __LLTIMEUTIL_H__
@@ -0,0 +1,817 @@
+/*
+       Licensed to the Apache Software Foundation (ASF) under one
+       or more contributor license agreements.  See the NOTICE file
+       distributed with this work for additional information
+       regarding copyright ownership.  The ASF licenses this file
+       to you under the Apache License, Version 2.0 (the
+       "License"); you may not use this file except in compliance
+       with the License.  You may obtain a copy of the License at
+
+         http://www.apache.org/licenses/LICENSE-2.0
+
+       Unless required by applicable law or agreed to in writing,
+       software distributed under the License is distributed on an
+       "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+       KIND, either express or implied.  See the License for the
+       specific language governing permissions and limitations
+       under the License.
+ */
+/**
+ * \file Bounded queue of formatted records and the background writer thread.
+ * The queue has two lanes, each one a ring of variable length records preceded by a
+ * \ref RecHdr. Records at or above \ref tAsyncLogParams::priorityLevel go to the
+ * priority lane, which the writer thread drains first.
+ * The writer thread copies the queued records to a batch buffer and writes the
+ * whole batch with a single call to the sink, outside of the queue lock.
+ * The records are pushed with the logger mutex locked, a producer which would have to wait
+ * for room copies its record aside instead, and waits once the mutex is unlocked, see
+ * \ref LLAsyncQueuePushDeferred : the other threads keep logging meanwhile.
+ * */
+#include "async_queue.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef DISABLE_THREAD_SAFETY
+
+#include "tPLThread.h"
+#include "LLTimeUtil.h"
+#include "json_encoder.h"
+#include "binary_log.h"
+
+/** The minimum size of the queue. */
+#define QUEUE_SIZE_MIN		4096
+/** The size of the batch buffer of the writer thread. */
+#define BATCH_SIZE			LL_ASYNC_RECORD_MAX
+/** The alignment of the records in the ring. */
+#define REC_ALIGN			8
+#define REC_ALIGNED(n)		(((n) + REC_ALIGN - 1) & ~(REC_ALIGN - 1))
+/** Header length marking the end of the ring as unused, the next record is at offset 0. */
+#define REC_PAD				0xFFFFFFFFu
+/** The size of the priority lane, relative to the size of the queue. */
+#define PRIORITY_LANE_DIV	4
+/** The number of log levels for which the drops are counted. */
+#define NUM_LEVELS			(LOG_LEVEL_FATAL + 1)
+
+/** The header of a record in the ring. */
+typedef struct RecHdr
+{
+	/** The length of the record, excluding the header. */
+	unsigned int	len;
+	/** The log level of the record. */
+	unsigned int	level;
+} RecHdr;
+
+/** The lanes of the queue. */
+enum
+{
+	LANE_NORMAL = 0,
+	LANE_PRIORITY,
+	NUM_LANES
+};
+
+/** A lane of the queue, a ring of records. */
+typedef struct LLLane
+{
+	/** The ring. */
+	char*				ring;
+	unsigned int		capacity;
+	/** The offset of the oldest record. */
+	volatile unsigned int	head;
+	/** The offset where the next record is put. */
+	volatile unsigned int	tail;
+	/** The bytes in use, including the padding at the end of the ring. */
+	volatile unsigned int	used;
+	/** The number of records queued. */
+	unsigned long long	pushSeq;
+	/** The number of records written (or dropped) by the writer thread. */
+	unsigned long long	doneSeq;
+	/** The records up to this sequence number should be synced. */
+	unsigned long long	syncSeq;
+	/** The records up to this sequence number have been synced. */
+	unsigned long long	syncedSeq;
+} LLLane;
+
+struct LLAsyncQueue
+{
+	tAsyncLogParams		params;
+	LLSink				sink;
+	tPLMonitor			mon;
+	tPLThread			thread;
+	/** The lanes, the priority lane is not allocated when disabled. */
+	LLLane				lanes[NUM_LANES];
+	/** Cleared to stop the writer thread. */
+	int					running;
+	int					writerWaiting;
+	int					producersWaiting;
+	/** Non zero when the sink was flushed since the last batch, see \ref LLSink::idleFlushMs. */
+	int					idleFlushed;
+	/** The number of records dropped per log level since the last summary. */
+	unsigned long		dropped[NUM_LEVELS];
+	/** The number of records dropped since the queue was created. */
+	volatile unsigned long	totalDropped;
+	/** The batch buffer of the writer thread. */
+	char*				batch;
+	/** The length of the batch being written, used by the crash handler. */
+	volatile int		batchLen;
+	/** Non zero while a fork waits for the batch being written. */
+	int					forking;
+	/** The number of records copied aside, which wait for room in the queue. */
+	int					deferred;
+};
+
+/** A record copied aside as there was no room for it in the queue. */
+typedef struct LLDeferredRec
+{
+	struct LLDeferredRec*	next;
+	LLAsyncQueue*			q;
+	LogLevel				level;
+	/** The time after which the record is dropped (monotonic clock, ns), 0 to wait forever. */
+	unsigned long long		deadline;
+	/** The length of the record, which follows. */
+	int						len;
+} LLDeferredRec;
+
+/** The records of the calling thread waiting for room, in the order they were logged. */
+static PL_THREAD_LOCAL LLDeferredRec* sDeferredHead = 0;
+static PL_THREAD_LOCAL LLDeferredRec* sDeferredTail = 0;
+
+/** helper function to count a dropped record. */
+static void sCountDrop(LLAsyncQueue* q, unsigned int level)
+{
+	q->dropped[(level < NUM_LEVELS) ? level : 0]++;
+	q->totalDropped++;
+}
+
+/** helper function to check if there are drops to report. */
+static int sHasDrops(LLAsyncQueue* q)
+{
+	int i;
+	for(i = 0; i < NUM_LEVELS; i++)
+		if(q->dropped[i])
+			return 1;
+	return 0;
+}
+
+/** helper function to get the oldest record in the ring, the queue must be locked.
+ * \returns the header of the record, NULL if the ring is empty.
+ * */
+static RecHdr* sPeekRecord(LLLane* l)
+{
+	RecHdr* hdr;
+	while(l->used > 0)
+	{
+		hdr = (RecHdr*)(l->ring + l->head);
+		if(hdr->len != REC_PAD)
+			return hdr;
+		/* skip the unused end of the ring. */
+		l->used -= l->capacity - l->head;
+		l->head = 0;
+	}
+	return NULL;
+}
+
+/** helper function to remove the oldest record from the ring, the queue must be locked.
+ * The record stays valid until the queue is unlocked.
+ * \returns the header of the record, NULL if the ring is empty.
+ * */
+static RecHdr* sPopRecord(LLLane* l)
+{
+	RecHdr* hdr = sPeekRecord(l);
+	if(!hdr)
+		return NULL;
+	l->used -= REC_ALIGNED(sizeof(RecHdr) + hdr->len);
+	l->head += REC_ALIGNED(sizeof(RecHdr) + hdr->len);
+	if(l->head == l->capacity)
+		l->head = 0;
+	return hdr;
+}
+
+/** helper function to find room for \a need bytes in the ring, the queue must be locked.
+ * \returns the offset, -1 if there is no room.
+ * */
+static long sReserve(LLLane* l, unsigned int need)
+{
+	if(l->used == 0)
+		l->head = l->tail = 0;
+	if(l->capacity - l->used < need)
+		return -1;
+	if(l->tail >= l->head)
+	{
+		if(l->capacity - l->tail >= need)
+			return l->tail;
+		if(l->head >= need)
+		{
+			/* mark the end of the ring as unused and wrap around. */
+			((RecHdr*)(l->ring + l->tail))->len = REC_PAD;
+			l->used += l->capacity - l->tail;
+			l->tail = 0;
+			return 0;
+		}
+		return -1;
+	}
+	return (l->head - l->tail >= need) ? (long)l->tail : -1;
+}
+
+/** helper function to check if there are records pending in any lane, the queue must be locked. */
+static int sHasRecords(LLAsyncQueue* q)
+{
+	return (q->lanes[LANE_NORMAL].used > 0) || (q->lanes[LANE_PRIORITY].used > 0);
+}
+
+/** helper function to check if a sync was requested, the queue must be locked. */
+static int sSyncPending(LLAsyncQueue* q)
+{
+	int i;
+	for(i = 0; i < NUM_LANES; i++)
+		if(q->lanes[i].syncSeq > q->lanes[i].syncedSeq)
+			return 1;
+	return 0;
+}
+
+/** helper function to check if the records to be synced have all been written, the queue must be locked. */
+static int sSyncReady(LLAsyncQueue* q)
+{
+	int i;
+	for(i = 0; i < NUM_LANES; i++)
+		if(q->lanes[i].doneSeq < q->lanes[i].syncSeq)
+			return 0;
+	return 1;
+}
+
+/** helper function to write the summary of the dropped records. */
+static void sWriteDropSummary(LLAsyncQueue* q, const unsigned long* dropped)
+{
+	int i;
+	for(i = 0; i < NUM_LEVELS; i++)
+	{
+		char buf[256];
+		int len;
+		if(!dropped[i])
+			continue;
+		if(OutputFormatJson == q->sink.outputFormat)
+		{
+			char curDateTime[32];
+			char msg[64];
+			int msgLen = snprintf(msg, sizeof(msg), "liblogger dropped %lu %s records", dropped[i], LLLevelName((LogLevel)i));
+			LLOutBuf out;
+			memset(curDateTime, 0, sizeof(curDateTime));
+			LLGetCurDateTime(curDateTime, sizeof(curDateTime));
+			LLOutInit(&out, buf, sizeof(buf) - 1);
+			LLJsonAppendRecordStart(&out, curDateTime);
+			LLJsonAppendRecordInfo(&out, Warn, NULL, NULL, NULL, 0);
+			LLJsonAppendKey(&out, "msg");
+			LLJsonAppendString(&out, msg, msgLen);
+			LLJsonAppendKey(&out, "dropped");
+			LLJsonAppendUInt(&out, dropped[i]);
+			LLJsonAppendRecordEnd(&out);
+			buf[out.len] = '\n';
+			len = out.len + 1;
+		}
+		else
+		{
+			len = snprintf(buf, sizeof(buf), "\n----- liblogger dropped %lu %s records -----\n",
+					dropped[i], LLLevelName((LogLevel)i));
+			if((len < 0) || (len >= (int)sizeof(buf)))
+				len = sizeof(buf) - 1;
+		}
+		if(OutputFormatBinary == q->sink.outputFormat)
+		{
+			/* the summary in a note record. */
+			char note[sizeof(buf) + 32];
+			q->sink.write(q->sink.ctx, note, LLBinEncodeNote(note, sizeof(note), LLGetWallClockUs(), (LogLevel)i, buf, len));
+			continue;
+		}
+		q->sink.write(q->sink.ctx, buf, len);
+	}
+}
+
+/** The background writer thread. */
+static void sWriterThread(void* arg)
+{
+	LLAsyncQueue* q = (LLAsyncQueue*)arg;
+	PLEnterMonitor(q->mon);
+	for(;;)
+	{
+		unsigned long dropped[NUM_LEVELS];
+		unsigned long long doneSeq[NUM_LANES];
+		LLLane* lane;
+		int doSync = 0;
+		int idle = 0;
+		int len = 0;
+		int i;
+
+		while( !sHasRecords(q) && q->running && !sHasDrops(q) && !sSyncPending(q) )
+		{
+			int timeoutMs = (q->sink.idleFlushMs && !q->idleFlushed) ? (int)q->sink.idleFlushMs : -1;
+			q->writerWaiting = 1;
+			idle = (1 == PLWaitMonitor(q->mon, timeoutMs));
+			q->writerWaiting = 0;
+			if(idle)
+				break;
+		}
+		if(idle)
+		{
+			q->idleFlushed = 1;
+			PLExitMonitor(q->mon);
+			q->sink.flush(q->sink.ctx);
+			PLEnterMonitor(q->mon);
+			continue;
+		}
+		if( !sHasRecords(q) && !q->running && !sHasDrops(q) && !sSyncPending(q) )
+			break;
+
+		/* the priority lane is drained first, a batch never mixes both lanes so that
+		 * a priority record is flushed without waiting for a full batch. */
+		lane = (q->lanes[LANE_PRIORITY].used > 0) ? &q->lanes[LANE_PRIORITY] : &q->lanes[LANE_NORMAL];
+		/* copy as many records as possible to the batch buffer. */
+		for(;;)
+		{
+			RecHdr* hdr = sPeekRecord(lane);
+			if( !hdr || (len + (int)hdr->len > BATCH_SIZE) )
+				break;
+			sPopRecord(lane);
+			memcpy(q->batch + len, hdr + 1, hdr->len);
+			len += hdr->len;
+			lane->doneSeq++;
+		}
+		memcpy(dropped, q->dropped, sizeof(dropped));
+		memset(q->dropped, 0, sizeof(q->dropped));
+		for(i = 0; i < NUM_LANES; i++)
+			doneSeq[i] = q->lanes[i].doneSeq;
+		doSync = sSyncPending(q) && sSyncReady(q);
+		q->batchLen = len;
+		q->idleFlushed = 0;
+		if(q->producersWaiting)
+			PLNotifyMonitor(q->mon);
+		PLExitMonitor(q->mon);
+
+		if(len)
+			q->sink.write(q->sink.ctx, q->batch, len);
+		sWriteDropSummary(q, dropped);
+		if(q->sink.flush)
+			q->sink.flush(q->sink.ctx);
+		if(doSync && q->sink.sync)
+			q->sink.sync(q->sink.ctx);
+
+		PLEnterMonitor(q->mon);
+		q->batchLen = 0;
+		if(q->forking)
+			PLNotifyMonitor(q->mon);
+		if(doSync)
+		{
+			for(i = 0; i < NUM_LANES; i++)
+				q->lanes[i].syncedSeq = doneSeq[i];
+			PLNotifyMonitor(q->mon);
+		}
+	}
+	PLExitMonitor(q->mon);
+}
+
+/* Creates the queue and starts the background writer thread. */
+LLAsyncQueue* LLCreateAsyncQueue(const tAsyncLogParams* params, const LLSink* sink)
+{
+	LLAsyncQueue* q;
+	if(!params || !sink || !sink->write)
+	{
+		fprintf(stderr,"Invalid args to function LLCreateAsyncQueue\n");
+		return NULL;
+	}
+	q = (LLAsyncQueue*)calloc(1, sizeof(LLAsyncQueue));
+	if(!q)
+		return NULL;
+	q->params = *params;
+	q->sink = *sink;
+	if(!q->sink.flush)
+		q->sink.idleFlushMs = 0;
+	if(!q->params.priorityLevel)
+		q->params.priorityLevel = Error;
+	q->lanes[LANE_NORMAL].capacity = REC_ALIGNED(params->queueSize < QUEUE_SIZE_MIN ? QUEUE_SIZE_MIN : params->queueSize);
+	q->lanes[LANE_NORMAL].ring = (char*)malloc(q->lanes[LANE_NORMAL].capacity);
+	if(q->params.priorityLevel != Disable)
+	{
+		unsigned int size = params->queueSize / PRIORITY_LANE_DIV;
+		q->lanes[LANE_PRIORITY].capacity = REC_ALIGNED(size < QUEUE_SIZE_MIN ? QUEUE_SIZE_MIN : size);
+		q->lanes[LANE_PRIORITY].ring = (char*)malloc(q->lanes[LANE_PRIORITY].capacity);
+	}
+	q->batch = (char*)malloc(BATCH_SIZE);
+	q->running = 1;
+	if( !q->lanes[LANE_NORMAL].ring || ((q->params.priorityLevel != Disable) && !q->lanes[LANE_PRIORITY].ring) 
+			|| !q->batch || (0 != PLCreateMonitor(&q->mon)) )
+	{
+		fprintf(stderr,"[liblogger] could not allocate the log queue\n");
+		goto FREE_RETURN;
+	}
+	if(0 != PLCreateThread(&q->thread, sWriterThread, q))
+	{
+		fprintf(stderr,"[liblogger] could not start the log writer thread\n");
+		PLDestroyMonitor(&q->mon);
+		goto FREE_RETURN;
+	}
+	return q;
+
+FREE_RETURN:
+	free(q->lanes[LANE_NORMAL].ring);
+	free(q->lanes[LANE_PRIORITY].ring);
+	free(q->batch);
+	free(q);
+	return NULL;
+}
+
+/* Puts a formatted record in the queue, applying the back pressure policy if the queue is full. */
+int LLAsyncQueuePush(LLAsyncQueue* q, LogLevel level, const char* data, int len)
+{
+	LLRecordPart part;
+	if(!data)
+		return -1;
+	part.data = data;
+	part.len = len;
+	part.encoding = LogBlobRaw;
+	return LLAsyncQueuePushParts(q, level, &part, 1);
+}
+
+/** helper function to get the time a record copied aside is dropped at, 0 to wait for room
+ * forever. With \ref BackPressureDropBelowLevel, the records of the level and above are
+ * never dropped, the lower ones are dropped at once if there is still no room. */
+static unsigned long long sGetDeadline(LLAsyncQueue* q, LogLevel level)
+{
+	if(BackPressureDropBelowLevel == q->params.policy)
+		return (level < q->params.dropBelowLevel) ? LLGetMonotonicNs() : 0;
+	return q->params.blockTimeoutMs ?
+		LLGetMonotonicNs() + (unsigned long long)q->params.blockTimeoutMs * 1000000ULL : 0;
+}
+
+/** helper function to get the lane of a record. */
+static LLLane* sGetLane(LLAsyncQueue* q, LogLevel level)
+{
+	return ( q->lanes[LANE_PRIORITY].ring && (level >= q->params.priorityLevel) ) ?
+		&q->lanes[LANE_PRIORITY] : &q->lanes[LANE_NORMAL];
+}
+
+/** helper function to encode the parts of a record, the parts which do not fit in \a room
+ * bytes are truncated. Returns the length of the record. */
+static int sEncodeParts(char* out, int room, const LLRecordPart* parts, int numParts)
+{
+	int len = 0;
+	int i;
+	for(i = 0; (i < numParts) && (len < room); i++)
+	{
+		int srcLen = LLBlobSourceLen(parts[i].encoding, room - len);
+		len += LLBlobEncode(parts[i].encoding, parts[i].data,
+				(parts[i].len < srcLen) ? parts[i].len : srcLen, out + len);
+	}
+	return len;
+}
+
+/** helper function to add the record written at \a offset to a lane, the queue must be locked. */
+static void sCommitRecord(LLAsyncQueue* q, LLLane* lane, long offset, LogLevel level, int len)
+{
+	RecHdr* hdr = (RecHdr*)(lane->ring + offset);
+	unsigned int need = REC_ALIGNED(sizeof(RecHdr) + len);
+	hdr->level = level;
+	hdr->len = len;
+	lane->used += need;
+	lane->tail = offset + need;
+	if(lane->tail == lane->capacity)
+		lane->tail = 0;
+	lane->pushSeq++;
+	if(q->writerWaiting)
+		PLNotifyMonitor(q->mon);
+}
+
+/* Puts a record made of several parts in the queue, the parts are encoded in the ring. */
+int LLAsyncQueuePushParts(LLAsyncQueue* q, LogLevel level, const LLRecordPart* parts, int numParts)
+{
+	unsigned int need;
+	long offset;
+	RecHdr* hdr;
+	LLLane* lane;
+	LLDeferredRec* rec;
+	int len = 0;
+	int i;
+
+	if(!q || !parts || (numParts < 0))
+		return -1;
+	for(i = 0; i < numParts; i++)
+	{
+		if(parts[i].len < 0)
+			return -1;
+		len += LLBlobEncodedLen(parts[i].encoding, parts[i].len);
+	}
+	lane = sGetLane(q, level);
+	/* a record must fit in the batch buffer, and in an empty ring. */
+	if(len > BATCH_SIZE)
+		len = BATCH_SIZE;
+	if(len > (int)(lane->capacity - sizeof(RecHdr)))
+		len = lane->capacity - sizeof(RecHdr);
+	need = REC_ALIGNED(sizeof(RecHdr) + len);
+
+	PLEnterMonitor(q->mon);
+	/* the records of a thread are queued in order, after its records copied aside. */
+	if(sDeferredHead)
+		goto DEFER;
+	while( -1 == (offset = sReserve(lane, need)) )
+	{
+		switch(q->params.policy)
+		{
+			case BackPressureDropNewest:
+				goto DROP_RETURN;
+			case BackPressureDropOldest:
+				hdr = sPopRecord(lane);
+				if(!hdr)
+					goto DROP_RETURN;
+				sCountDrop(q, hdr->level);
+				lane->doneSeq++;
+				continue;
+			case BackPressureDropBelowLevel:
+				if(level < q->params.dropBelowLevel)
+					goto DROP_RETURN;
+				goto DEFER;
+			case BackPressureBlock:
+			default:
+				goto DEFER;
+		}
+	}
+	sCommitRecord(q, lane, offset, level,
+			sEncodeParts(lane->ring + offset + sizeof(RecHdr), len, parts, numParts));
+	PLExitMonitor(q->mon);
+	return 0;
+
+DEFER:
+	/* waiting here would keep the logger mutex locked, and every logging thread waiting
+	 * for it : the record is copied aside and queued by LLAsyncQueuePushDeferred(). */
+	rec = (LLDeferredRec*)malloc(sizeof(LLDeferredRec) + len);
+	if(!rec)
+		goto DROP_RETURN;
+	rec->next = NULL;
+	rec->q = q;
+	rec->level = level;
+	rec->deadline = sGetDeadline(q, level);
+	rec->len = sEncodeParts((char*)(rec + 1), len, parts, numParts);
+	if(sDeferredTail)
+		sDeferredTail->next = rec;
+	else
+		sDeferredHead = rec;
+	sDeferredTail = rec;
+	q->deferred++;
+	PLExitMonitor(q->mon);
+	return 0;
+
+DROP_RETURN:
+	sCountDrop(q, level);
+	/* wake up the writer thread, so that the drop is reported. */
+	if(q->writerWaiting)
+		PLNotifyMonitor(q->mon);
+	PLExitMonitor(q->mon);
+	return -1;
+}
+
+/** helper function to queue a record copied aside, waiting for room. */
+static void sPushDeferred(LLDeferredRec* rec)
+{
+	LLAsyncQueue* q = rec->q;
+	LLLane* lane = sGetLane(q, rec->level);
+	unsigned int need = REC_ALIGNED(sizeof(RecHdr) + rec->len);
+	long offset;
+
+	PLEnterMonitor(q->mon);
+	while( -1 == (offset = sReserve(lane, need)) )
+	{
+		int timeoutMs = -1;
+		if(rec->deadline)
+		{
+			unsigned long long now = LLGetMonotonicNs();
+			if(now >= rec->deadline)
+				break;
+			timeoutMs = (int)((rec->deadline - now + 999999ULL) / 1000000ULL);
+		}
+		/* wait for the writer thread to make room. */
+		q->producersWaiting++;
+		PLWaitMonitor(q->mon, timeoutMs);
+		q->producersWaiting--;
+	}
+	if(-1 != offset)
+	{
+		memcpy(lane->ring + offset + sizeof(RecHdr), rec + 1, rec->len);
+		sCommitRecord(q, lane, offset, rec->level, rec->len);
+	}
+	else
+	{
+		sCountDrop(q, rec->level);
+		if(q->writerWaiting)
+			PLNotifyMonitor(q->mon);
+	}
+	/* LLDestroyAsyncQueue() waits for the records copied aside. */
+	if(0 == --q->deferred)
+		PLNotifyMonitor(q->mon);
+	PLExitMonitor(q->mon);
+}
+
+/* Queues the records of the calling thread copied aside, waiting for room. */
+void LLAsyncQueuePushDeferred(void)
+{
+	while(sDeferredHead)
+	{
+		LLDeferredRec* rec = sDeferredHead;
+		sDeferredHead = rec->next;
+		if(!sDeferredHead)
+			sDeferredTail = NULL;
+		sPushDeferred(rec);
+		free(rec);
+	}
+}
+
+/* Returns the number of records dropped since the queue was created. */
+unsigned long LLAsyncQueueDropCount(LLAsyncQueue* q)
+{
+	return q->totalDropped;
+}
+
+/* Waits until all the records queued so far are written and synced to the storage device. */
+int LLAsyncQueueSync(LLAsyncQueue* q)
+{
+	unsigned long long target[NUM_LANES];
+	int i, done;
+	if(!q)
+		return -1;
+	/* the records of the calling thread are synced too. */
+	LLAsyncQueuePushDeferred();
+	PLEnterMonitor(q->mon);
+	for(i = 0; i < NUM_LANES; i++)
+	{
+		target[i] = q->lanes[i].pushSeq;
+		if(q->lanes[i].syncSeq < target[i])
+			q->lanes[i].syncSeq = target[i];
+	}
+	PLNotifyMonitor(q->mon);
+	do
+	{
+		done = 1;
+		for(i = 0; i < NUM_LANES; i++)
+			if(q->lanes[i].syncedSeq < target[i])
+				done = 0;
+		if(!done)
+			PLWaitMonitor(q->mon, -1);
+	} while(!done);
+	PLExitMonitor(q->mon);
+	return 0;
+}
+
+/** helper function to write the records pending in a lane without taking any lock. */
+static void sCrashDrainLane(LLAsyncQueue* q, LLLane* l)
+{
+	unsigned int head, used, walked = 0;
+	if(!l->ring)
+		return;
+	head = l->head;
+	used = l->used;
+	while( (used > 0) && (walked < l->capacity) )
+	{
+		RecHdr* hdr = (RecHdr*)(l->ring + head);
+		unsigned int size;
+		if(hdr->len == REC_PAD)
+			size = l->capacity - head;
+		else if(hdr->len <= l->capacity - head - sizeof(RecHdr))
+		{
+			size = REC_ALIGNED(sizeof(RecHdr) + hdr->len);
+			q->sink.crashWrite(q->sink.ctx, (const char*)(hdr + 1), hdr->len);
+		}
+		else
+			break; /* the record is being written. */
+		if(size > used)
+			break;
+		used -= size;
+		walked += size;
+		head += size;
+		if(head >= l->capacity)
+			head = 0;
+	}
+}
+
+/* Writes the records pending in the queue without taking any lock, called from a signal handler. */
+void LLAsyncQueueCrashDrain(LLAsyncQueue* q)
+{
+	LLDeferredRec* rec;
+	if(!q || !q->sink.crashWrite)
+		return;
+	/* the batch being written might have been written partially,
+	 * so a few records may appear twice. */
+	if(q->batchLen > 0)
+		q->sink.crashWrite(q->sink.ctx, q->batch, q->batchLen);
+	sCrashDrainLane(q, &q->lanes[LANE_NORMAL]);
+	sCrashDrainLane(q, &q->lanes[LANE_PRIORITY]);
+	/* the records the crashing thread copied aside, those of the other threads are lost. */
+	for(rec = sDeferredHead; rec; rec = rec->next)
+		if(rec->q == q)
+			q->sink.crashWrite(q->sink.ctx, (const char*)(rec + 1), rec->len);
+}
+
+/* Called around fork(). */
+void LLAsyncQueueAtFork(LLAsyncQueue* q, int phase)
+{
+	int i;
+	if(!q)
+		return;
+	switch(phase)
+	{
+		case LL_FORK_PREPARE:
+			/* the monitor stays locked until after the fork, once the writer thread is
+			 * done with its batch, so that the child gets a consistent queue. */
+			PLEnterMonitor(q->mon);
+			q->forking = 1;
+			while(q->batchLen > 0)
+				PLWaitMonitor(q->mon, -1);
+			q->forking = 0;
+			break;
+		case LL_FORK_PARENT:
+			PLExitMonitor(q->mon);
+			break;
+		case LL_FORK_CHILD:
+			/* the monitor of the parent is left as is, its waiters do not exist here. */
+			if(0 != PLCreateMonitor(&q->mon))
+			{
+				q->running = 0;
+				return;
+			}
+			for(i = 0; i < NUM_LANES; i++)
+			{
+				LLLane* l = &q->lanes[i];
+				l->head = l->tail = l->used = 0;
+				l->doneSeq = l->syncSeq = l->syncedSeq = l->pushSeq;
+			}
+			memset(q->dropped, 0, sizeof(q->dropped));
+			/* the threads which copied records aside do not exist here. */
+			q->deferred = 0;
+			q->writerWaiting = 0;
+			q->producersWaiting = 0;
+			q->idleFlushed = 0;
+			q->batchLen = 0;
+			q->running = 1;
+			if(0 != PLCreateThread(&q->thread, sWriterThread, q))
+				fprintf(stderr,"[liblogger] could not restart the log writer thread after fork()\n");
+			break;
+	}
+}
+
+/* Writes the pending records, stops the background writer thread and frees the queue. */
+void LLDestroyAsyncQueue(LLAsyncQueue* q)
+{
+	if(!q)
+		return;
+	LLAsyncQueuePushDeferred();
+	PLEnterMonitor(q->mon);
+	/* the other threads queue the records they copied aside first. */
+	while(q->deferred > 0)
+		PLWaitMonitor(q->mon, -1);
+	q->running = 0;
+	PLNotifyMonitor(q->mon);
+	PLExitMonitor(q->mon);
+	PLJoinThread(&q->thread);
+	PLDestroyMonitor(&q->mon);
+	free(q->lanes[LANE_NORMAL].ring);
+	free(q->lanes[LANE_PRIORITY].ring);
+	free(q->batch);
+	free(q);
+}
+
+#else // DISABLE_THREAD_SAFETY
+
+/* Asynchronous logging needs a background thread. */
+LLAsyncQueue* LLCreateAsyncQueue(const tAsyncLogParams* params, const LLSink* sink)
+{
+	fprintf(stderr,"[liblogger] asynchronous logging is not available when thread safety is disabled\n");
+	return NULL;
+}
+
+int LLAsyncQueuePush(LLAsyncQueue* q, LogLevel level, const char* data, int len)
+{
+	return -1;
+}
+
+int LLAsyncQueuePushParts(LLAsyncQueue* q, LogLevel level, const LLRecordPart* parts, int numParts)
+{
+	return -1;
+}
+
+void LLAsyncQueuePushDeferred(void)
+{
+}
+
+int LLAsyncQueueSync(LLAsyncQueue* q)
+{
+	return -1;
+}
+
+void LLAsyncQueueCrashDrain(LLAsyncQueue* q)
+{
+}
+
+void LLAsyncQueueAtFork(LLAsyncQueue* q, int phase)
+{
+}
+
+void LLDestroyAsyncQueue(LLAsyncQueue* q)
+{
+}
+
+#endif // DISABLE_THREAD_SAFETY
@@ -0,0 +1,108 @@
+/*
+       Licensed to the Apache Software Foundation (ASF) under one
+       or more contributor license agreements.  See the NOTICE file
+       distributed with this work for additional information
+       regarding copyright ownership.  The ASF licenses this file
+       to you under the Apache License, Version 2.0 (the
+       "License"); you may not use this file except in compliance
+       with the License.  You may obtain a copy of the License at
+
+         http://www.apache.org/licenses/LICENSE-2.0
+
+       Unless required by applicable law or agreed to in writing,
+       software distributed under the License is distributed on an
+       "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+       KIND, either express or implied.  See the License for the
+       specific language governing permissions and limitations
+       under the License.
+ */
+#ifndef __ASYNC_QUEUE_H__
+#define __ASYNC_QUEUE_H__
+
+#include <liblogger/liblogger.h>
+#include <liblogger/logger_object.h>
+#include <liblogger/async_logger.h>
+#include "blob_encoder.h"
+
+/** The log destination written by the background writer thread. */
+typedef struct LLSink
+{
+	/** Writes data to the destination. */
+	int (*write)(void* ctx, const char* data, int len);
+	/** Flushes the data written so far, called after each batch of records (can be NULL). */
+	int (*flush)(void* ctx);
+	/** Flushes the data to the storage device (can be NULL). */
+	int (*sync)(void* ctx);
+	/** Writes data to the destination from a signal handler, must be async-signal-safe
+	 * (can be NULL). */
+	int (*crashWrite)(void* ctx, const char* data, int len);
+	/** The context passed to the above functions. */
+	void* ctx;
+	/** The format of the summaries written by the writer thread. */
+	tOutputFormat outputFormat;
+	/** If not 0, \ref flush is called again once no record was queued for this time, in ms. */
+	unsigned int idleFlushMs;
+} LLSink;
+
+/** A bounded queue of formatted records, drained by a background writer thread. */
+typedef struct LLAsyncQueue LLAsyncQueue;
+
+/** Creates the queue and starts the background writer thread.
+ * \param [in] params	The asynchronous logging parameters.
+ * \param [in] sink		The log destination.
+ * \returns the queue, NULL on failure.
+ * */
+LLAsyncQueue* LLCreateAsyncQueue(const tAsyncLogParams* params, const LLSink* sink);
+
+/** Puts a formatted record in the queue, applying the back pressure policy if the queue is full.
+ * The record is never waited for here : when the policy waits for room, the record is copied
+ * aside and queued by \ref LLAsyncQueuePushDeferred.
+ * \param [in] q		The queue.
+ * \param [in] level	The log level of the record.
+ * \param [in] data		The formatted record.
+ * \param [in] len		The length of \a data.
+ * \returns 0 if the record was queued, -1 if it was dropped.
+ * */
+int LLAsyncQueuePush(LLAsyncQueue* q, LogLevel level, const char* data, int len);
+
+/** Puts a record made of several parts in the queue, see \ref LLAsyncQueuePush. The parts
+ * are encoded as they are copied to the queue, the record is truncated to
+ * \ref LL_ASYNC_RECORD_MAX bytes.
+ * \param [in] q			The queue.
+ * \param [in] level		The log level of the record.
+ * \param [in] parts		The parts of the record.
+ * \param [in] numParts	The number of parts.
+ * \returns 0 if the record was queued, -1 if it was dropped.
+ * */
+int LLAsyncQueuePushParts(LLAsyncQueue* q, LogLevel level, const LLRecordPart* parts, int numParts);
+
+/** Queues the records of the calling thread which were copied aside by \ref LLAsyncQueuePush,
+ * waiting for room as the back pressure policy requires. Called once the logger mutex is
+ * unlocked, so that the other threads keep logging, does nothing if there is no such record.
+ * */
+void LLAsyncQueuePushDeferred(void);
+
+/** Returns the number of records dropped since the queue was created, read without locking. */
+unsigned long LLAsyncQueueDropCount(LLAsyncQueue* q);
+
+/** Waits until all the records queued so far are written and synced to the storage device.
+ * \returns 0 on success, -1 on failure.
+ * */
+int LLAsyncQueueSync(LLAsyncQueue* q);
+
+/** Writes the records pending in the queue with \ref LLSink::crashWrite, without taking any lock.
+ * Called from a signal handler.
+ * */
+void LLAsyncQueueCrashDrain(LLAsyncQueue* q);
+
+/** Called around fork(), see \ref LogWriter::atFork. Before the fork the queue is locked once
+ * the batch being written is done, it is unlocked in the parent after the fork. In the child,
+ * the records queued by the parent are discarded (the parent writes them) and the background
+ * writer thread, which does not exist in the child, is started again.
+ * */
+void LLAsyncQueueAtFork(LLAsyncQueue* q, int phase);
+
+/** Writes the pending records, stops the background writer thread and frees the queue. */
+void LLDestroyAsyncQueue(LLAsyncQueue* q);
+
+#endif // __ASYNC_QUEUE_H__
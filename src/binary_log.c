@@ -0,0 +1,764 @@
+/*
+       Licensed to the Apache Software Foundation (ASF) under one
+       or more contributor license agreements.  See the NOTICE file
+       distributed with this work for additional information
+       regarding copyright ownership.  The ASF licenses this file
+       to you under the Apache License, Version 2.0 (the
+       "License"); you may not use this file except in compliance
+       with the License.  You may obtain a copy of the License at
+
+         http://www.apache.org/licenses/LICENSE-2.0
+
+       Unless required by applicable law or agreed to in writing,
+       software distributed under the License is distributed on an
+       "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+       KIND, either express or implied.  See the License for the
+       specific language governing permissions and limitations
+       under the License.
+ */
+/**
+ * \file Encoder of the binary log format, see binary_log.h.
+ * The records of a call site store its id and the raw arguments of the format, the
+ * message is formatted by the decoder. The call sites are found by the address of their
+ * format, and the content of the format is checked since it might be a reused buffer.
+ * */
+#include "binary_log.h"
+#include "LLTimeUtil.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <time.h>
+
+#ifndef DISABLE_THREAD_SAFETY
+	#include "tPLThread.h"
+	#define LL_THREAD_LOCAL	PL_THREAD_LOCAL
+#else
+	#define LL_THREAD_LOCAL
+#endif
+
+#ifdef _WIN32
+	#define  vsnprintf(buf,buf_size,fmt,ap) _vsnprintf(buf,buf_size,fmt,ap)
+#endif
+
+#ifndef va_copy
+	#define va_copy(dst,src) ((dst) = (src))
+#endif
+
+/** The initial size of the call site dictionary, a power of 2. */
+#define INITIAL_SITES	1024
+
+/** How the value of a conversion is read from the arguments. */
+enum
+{
+	VA_INT = 0,
+	VA_CHAR,
+	VA_SHORT,
+	VA_LONG,
+	VA_LLONG,
+	VA_SIZE,
+	VA_INTMAX,
+	VA_PTRDIFF,
+	VA_DOUBLE,
+	VA_LDOUBLE,
+	VA_PTR,
+	VA_STR
+};
+
+/** A call site, the key is its format / file / function addresses, line, level and kind. */
+typedef struct LLBinSite
+{
+	/** The id of the site, 0 for an empty slot. */
+	unsigned int	id;
+	const char*		fmt;
+	const char*		file;
+	const char*		funcName;
+	int				line;
+	unsigned char	level;
+	unsigned char	kind;
+	/** The generation the site was last defined with. */
+	unsigned int	generation;
+	/** A copy of the format, compared with the format of each record. */
+	char*			fmtCopy;
+	/** The conversions of the format, -1 if the records are written as text. */
+	int				numConvs;
+	LLBinConv*		convs;
+} LLBinSite;
+
+/** The id of the calling thread, 0 until it is known. */
+static LL_THREAD_LOCAL unsigned long sTid = 0;
+
+/* Encodes a varint. */
+int LLBinPutVarint(char* buf, unsigned long long v)
+{
+	int n = 0;
+	while(v >= 0x80)
+	{
+		buf[n++] = (char)(0x80 | (v & 0x7f));
+		v >>= 7;
+	}
+	buf[n++] = (char)v;
+	return n;
+}
+
+/* Decodes a varint. */
+int LLBinGetVarint(const char* buf, int len, unsigned long long* v)
+{
+	int n = 0;
+	int shift = 0;
+	*v = 0;
+	while((n < len) && (shift < 64))
+	{
+		unsigned char c = (unsigned char)buf[n++];
+		*v |= (unsigned long long)(c & 0x7f) << shift;
+		if(!(c & 0x80))
+			return n;
+		shift += 7;
+	}
+	return 0;
+}
+
+/* Parses the conversions of a printf format. */
+int LLBinParseFormat(const char* fmt, LLBinConv* convs, int maxConvs)
+{
+	int num = 0;
+	const char* p = fmt;
+	while((p = strchr(p, '%')) != NULL)
+	{
+		LLBinConv* c;
+		const char* start = p;
+		int lenMod = 0;		/* 'h', 'H' (hh), 'l', 'q' (ll), 'L', 'j', 'z', 't' */
+		if(num == maxConvs)
+			return -1;
+		c = &convs[num];
+		c->stars = 0;
+		c->precision = -1;
+		c->arg = LL_BIN_ARG_NONE;
+		c->va = VA_INT;
+		p++;
+		if(*p == '%')
+		{
+			p++;
+			c->start = (unsigned short)(start - fmt);
+			c->len = 2;
+			num++;
+			continue;
+		}
+		while(*p && strchr("-+ #0'", *p))
+			p++;
+		if(*p == '*')
+		{
+			c->stars++;
+			p++;
+		}
+		else
+		{
+			while((*p >= '0') && (*p <= '9'))
+				p++;
+			/* positional arguments are not supported. */
+			if(*p == '$')
+				return -1;
+		}
+		if(*p == '.')
+		{
+			p++;
+			c->precision = 0;
+			if(*p == '*')
+			{
+				c->stars++;
+				c->precision = -2;
+				p++;
+			}
+			else
+				while((*p >= '0') && (*p <= '9'))
+					c->precision = (short)(c->precision * 10 + (*p++ - '0'));
+		}
+		switch(*p)
+		{
+			case 'h': lenMod = (p[1] == 'h') ? 'H' : 'h'; p += (p[1] == 'h') ? 2 : 1; break;
+			case 'l': lenMod = (p[1] == 'l') ? 'q' : 'l'; p += (p[1] == 'l') ? 2 : 1; break;
+			case 'q': case 'L': case 'j': case 'z': case 't': lenMod = *p++; break;
+			default: break;
+		}
+		switch(*p)
+		{
+			case 'd': case 'i':
+			case 'u': case 'o': case 'x': case 'X':
+				c->arg = ((*p == 'd') || (*p == 'i')) ? LL_BIN_ARG_INT : LL_BIN_ARG_UINT;
+				switch(lenMod)
+				{
+					case 'H': c->va = VA_CHAR; break;
+					case 'h': c->va = VA_SHORT; break;
+					case 'l': c->va = VA_LONG; break;
+					case 'q': case 'L': c->va = VA_LLONG; break;
+					case 'j': c->va = VA_INTMAX; break;
+					case 'z': c->va = VA_SIZE; break;
+					case 't': c->va = VA_PTRDIFF; break;
+					default: c->va = VA_INT; break;
+				}
+				break;
+			case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+				c->arg = LL_BIN_ARG_DOUBLE;
+				c->va = (lenMod == 'L') ? VA_LDOUBLE : VA_DOUBLE;
+				break;
+			case 'c':
+				/* wide characters are not supported. */
+				if(lenMod)
+					return -1;
+				c->arg = LL_BIN_ARG_INT;
+				c->va = VA_INT;
+				break;
+			case 's':
+				if(lenMod)
+					return -1;
+				c->arg = LL_BIN_ARG_STR;
+				c->va = VA_STR;
+				break;
+			case 'p':
+				c->arg = LL_BIN_ARG_PTR;
+				c->va = VA_PTR;
+				break;
+			default:
+				/* %n, %m, %C, %S and the unknown conversions. */
+				return -1;
+		}
+		p++;
+		c->start = (unsigned short)(start - fmt);
+		c->len = (unsigned short)(p - start);
+		num++;
+	}
+	return num;
+}
+
+/* helper function to hash the key of a call site. */
+static unsigned int sHashSite(const char* fmt, const char* funcName, int line, int kind)
+{
+	size_t h = ((size_t)fmt >> 3) ^ ((size_t)funcName >> 3) * 31;
+	h ^= (size_t)line * 2654435761u;
+	return (unsigned int)(h ^ (h >> 15) ^ (size_t)kind);
+}
+
+/* Allocates the call site dictionary. */
+int LLBinEncoderInit(LLBinEncoder* e)
+{
+	memset(e, 0, sizeof(*e));
+	e->sites = (LLBinSite*)calloc(INITIAL_SITES, sizeof(LLBinSite));
+	if(!e->sites)
+	{
+		fprintf(stderr, "[liblogger] out of memory for the binary log call sites\n");
+		return -1;
+	}
+	e->capacity = INITIAL_SITES;
+	e->generation = 1;
+	e->startNs = LLGetMonotonicNs();
+	return 0;
+}
+
+/* Frees the call site dictionary. */
+void LLBinEncoderDestroy(LLBinEncoder* e)
+{
+	unsigned int i;
+	for(i = 0; e->sites && (i < e->capacity); i++)
+	{
+		free(e->sites[i].fmtCopy);
+		free(e->sites[i].convs);
+	}
+	free(e->sites);
+	memset(e, 0, sizeof(*e));
+}
+
+/* Defines the call sites again before their next record. */
+void LLBinEncoderInvalidate(LLBinEncoder* e)
+{
+	e->generation++;
+	e->lastDefined = NULL;
+}
+
+/* Reads the thread id again, called in the child after fork(). */
+void LLBinAfterFork(void)
+{
+	sTid = 0;
+}
+
+/* helper function to double the size of the call site dictionary. */
+static int sGrowSites(LLBinEncoder* e)
+{
+	unsigned int newCapacity = e->capacity * 2;
+	LLBinSite* sites = (LLBinSite*)calloc(newCapacity, sizeof(LLBinSite));
+	unsigned int i;
+	if(!sites)
+		return -1;
+	for(i = 0; i < e->capacity; i++)
+	{
+		unsigned int j;
+		if(!e->sites[i].id)
+			continue;
+		j = sHashSite(e->sites[i].fmt, e->sites[i].funcName, e->sites[i].line, e->sites[i].kind) & (newCapacity - 1);
+		while(sites[j].id)
+			j = (j + 1) & (newCapacity - 1);
+		sites[j] = e->sites[i];
+	}
+	free(e->sites);
+	e->sites = sites;
+	e->capacity = newCapacity;
+	e->lastDefined = NULL;
+	return 0;
+}
+
+/* helper function to find a call site, it is added if needed. */
+static LLBinSite* sGetSite(LLBinEncoder* e, int kind, LogLevel level,
+		const char* file, const char* funcName, int line, const char* fmt)
+{
+	unsigned int i = sHashSite(fmt, funcName, line, kind) & (e->capacity - 1);
+	LLBinSite* s;
+	for(;; i = (i + 1) & (e->capacity - 1))
+	{
+		s = &e->sites[i];
+		if(!s->id)
+			break;
+		if( (s->fmt == fmt) && (s->funcName == funcName) && (s->line == line) && (s->file == file)
+				&& (s->level == (unsigned char)level) && (s->kind == (unsigned char)kind)
+				&& (!fmt || !strcmp(s->fmtCopy, fmt)) )
+			return s;
+	}
+	/* a new call site. */
+	if(4 * (e->numSites + 1) > 3 * e->capacity)
+	{
+		if(sGrowSites(e))
+			return NULL;
+		return sGetSite(e, kind, level, file, funcName, line, fmt);
+	}
+	s->fmt = fmt;
+	s->file = file;
+	s->funcName = funcName;
+	s->line = line;
+	s->level = (unsigned char)level;
+	s->kind = (unsigned char)kind;
+	s->generation = 0;
+	s->numConvs = -1;
+	s->fmtCopy = NULL;
+	s->convs = NULL;
+	if(fmt)
+	{
+		LLBinConv convs[LL_BIN_MAX_CONVS];
+		s->fmtCopy = (char*)malloc(strlen(fmt) + 1);
+		if(!s->fmtCopy)
+			return NULL;
+		strcpy(s->fmtCopy, fmt);
+		if(LL_BIN_SITE_LOG == kind)
+			s->numConvs = LLBinParseFormat(fmt, convs, LL_BIN_MAX_CONVS);
+		if(s->numConvs > 0)
+		{
+			s->convs = (LLBinConv*)malloc(s->numConvs * sizeof(LLBinConv));
+			if(s->convs)
+				memcpy(s->convs, convs, s->numConvs * sizeof(LLBinConv));
+			else
+				s->numConvs = -1;
+		}
+	}
+	s->id = ++e->numSites;
+	return s;
+}
+
+/** The output of the encoder. */
+typedef struct LLBinOut
+{
+	char*	buf;
+	int		size;
+	int		len;
+	/** Set when something did not fit. */
+	int		overflow;
+} LLBinOut;
+
+/* helper functions to append to the output, nothing is appended once it overflows. */
+static void sPutByte(LLBinOut* o, int c)
+{
+	if(o->len + 1 > o->size)
+		o->overflow = 1;
+	else
+		o->buf[o->len++] = (char)c;
+}
+
+static void sPutVarint(LLBinOut* o, unsigned long long v)
+{
+	if(o->len + 10 > o->size)
+		o->overflow = 1;
+	else
+		o->len += LLBinPutVarint(o->buf + o->len, v);
+}
+
+static void sPutInt(LLBinOut* o, long long v)
+{
+	/* zigzag. */
+	sPutVarint(o, ((unsigned long long)v << 1) ^ (unsigned long long)(v >> 63));
+}
+
+/* helper function to encode an integer argument, zigzag if it is signed. */
+static void sPutInteger(LLBinOut* o, int arg, long long v)
+{
+	if(LL_BIN_ARG_UINT == arg)
+		sPutVarint(o, (unsigned long long)v);
+	else
+		sPutInt(o, v);
+}
+
+static void sPutString(LLBinOut* o, const char* s, int len)
+{
+	if(!s)
+	{
+		sPutVarint(o, 0);
+		return;
+	}
+	if(len < 0)
+		len = (int)strlen(s);
+	sPutVarint(o, (unsigned long long)len + 1);
+	if(o->len + len > o->size)
+		o->overflow = 1;
+	if(!o->overflow)
+	{
+		memcpy(o->buf + o->len, s, len);
+		o->len += len;
+	}
+}
+
+/* helper function to start a record, its length is written by \ref sEndRecord.
+ * \returns the offset of the payload. */
+static int sBeginRecord(LLBinOut* o, int type)
+{
+	sPutByte(o, type);
+	/* room for a 2 bytes length. */
+	if(o->len + 2 > o->size)
+		o->overflow = 1;
+	else
+		o->len += 2;
+	return o->len;
+}
+
+/* helper function to write the length of a record.
+ * \returns the number of bytes the payload moved back, 1 if the length takes a single byte. */
+static int sEndRecord(LLBinOut* o, int payloadOffset)
+{
+	int len = o->len - payloadOffset;
+	if(o->overflow || (len >= (1 << 14)))
+	{
+		o->overflow = 1;
+		return 0;
+	}
+	if(len < 0x80)
+	{
+		memmove(o->buf + payloadOffset - 1, o->buf + payloadOffset, len);
+		o->buf[payloadOffset - 2] = (char)len;
+		o->len--;
+		return 1;
+	}
+	o->buf[payloadOffset - 2] = (char)(0x80 | (len & 0x7f));
+	o->buf[payloadOffset - 1] = (char)(len >> 7);
+	return 0;
+}
+
+/* helper function to encode the definition of a call site. */
+static void sPutSite(LLBinOut* o, const LLBinSite* s)
+{
+	int payload = sBeginRecord(o, LL_BIN_REC_SITE);
+	sPutVarint(o, s->id);
+	sPutByte(o, s->kind);
+	sPutByte(o, s->level);
+	sPutVarint(o, (unsigned long long)(s->line > 0 ? s->line : 0));
+	sPutString(o, s->file, -1);
+	sPutString(o, s->funcName, -1);
+	sPutString(o, s->fmtCopy, -1);
+	sEndRecord(o, payload);
+}
+
+/* helper function to encode the arguments of a format. */
+static void sPutArgs(LLBinOut* o, const LLBinSite* s, va_list ap)
+{
+	int i;
+	for(i = 0; (i < s->numConvs) && !o->overflow; i++)
+	{
+		const LLBinConv* c = &s->convs[i];
+		int precision = c->precision;
+		int star;
+		if(LL_BIN_ARG_NONE == c->arg)
+			continue;
+		for(star = 0; star < c->stars; star++)
+		{
+			int v = va_arg(ap, int);
+			sPutInt(o, v);
+			/* the precision is the last one. */
+			if(-2 == c->precision)
+				precision = v;
+		}
+		switch(c->va)
+		{
+			case VA_CHAR:	{ int v = va_arg(ap, int); sPutInteger(o, c->arg, (LL_BIN_ARG_INT == c->arg) ? (long long)(signed char)v : (long long)(unsigned char)v); break; }
+			case VA_SHORT:	{ int v = va_arg(ap, int); sPutInteger(o, c->arg, (LL_BIN_ARG_INT == c->arg) ? (long long)(short)v : (long long)(unsigned short)v); break; }
+			case VA_LONG:	{ long v = va_arg(ap, long); sPutInteger(o, c->arg, (LL_BIN_ARG_INT == c->arg) ? (long long)v : (long long)(unsigned long)v); break; }
+			case VA_LLONG:	{ long long v = va_arg(ap, long long); sPutInteger(o, c->arg, v); break; }
+			case VA_SIZE:	{ size_t v = va_arg(ap, size_t); sPutInteger(o, c->arg, (long long)v); break; }
+			/* intmax_t is long long, or long of the same size. */
+			case VA_INTMAX:	{ long long v = va_arg(ap, long long); sPutInteger(o, c->arg, v); break; }
+			case VA_PTRDIFF:{ ptrdiff_t v = va_arg(ap, ptrdiff_t); sPutInteger(o, c->arg, (long long)v); break; }
+			case VA_DOUBLE:
+			case VA_LDOUBLE:
+			{
+				double v = (VA_LDOUBLE == c->va) ? (double)va_arg(ap, long double) : va_arg(ap, double);
+				if(o->len + (int)sizeof(v) > o->size)
+					o->overflow = 1;
+				else
+				{
+					memcpy(o->buf + o->len, &v, sizeof(v));
+					o->len += sizeof(v);
+				}
+				break;
+			}
+			case VA_PTR:	{ void* v = va_arg(ap, void*); sPutVarint(o, (unsigned long long)(size_t)v); break; }
+			case VA_STR:
+			{
+				const char* v = va_arg(ap, const char*);
+				int len = -1;
+				/* with a precision, the string might not be terminated. */
+				if(v && (precision >= 0))
+				{
+					const char* end = (const char*)memchr(v, 0, (size_t)precision);
+					len = end ? (int)(end - v) : precision;
+				}
+				sPutString(o, v, len);
+				break;
+			}
+			case VA_INT:
+			default:		{ int v = va_arg(ap, int); sPutInteger(o, c->arg, (LL_BIN_ARG_INT == c->arg) ? (long long)v : (long long)(unsigned int)v); break; }
+		}
+	}
+}
+
+/* Encodes a session record, and starts a new session. */
+int LLBinEncodeSession(LLBinEncoder* e, char* buf, int size, const char* moduleName)
+{
+	LLBinOut o;
+	time_t now = time(NULL);
+	struct tm lt, gt;
+	long utcOffset;
+	int payload;
+	/* the UTC offset, so that the decoder shows the local time of the logging host. */
+	lt = *localtime(&now);
+	gt = *gmtime(&now);
+	gt.tm_isdst = lt.tm_isdst;
+	utcOffset = (long)difftime(now, mktime(&gt));
+
+	LLBinEncoderInvalidate(e);
+	e->startNs = LLGetMonotonicNs();
+	o.buf = buf;
+	o.size = size;
+	o.len = 0;
+	o.overflow = 0;
+	payload = sBeginRecord(&o, LL_BIN_REC_SESSION);
+	if(o.len + LL_BIN_MAGIC_LEN <= o.size)
+	{
+		memcpy(o.buf + o.len, LL_BIN_MAGIC, LL_BIN_MAGIC_LEN);
+		o.len += LL_BIN_MAGIC_LEN;
+	}
+	sPutVarint(&o, LL_BIN_VERSION);
+	sPutVarint(&o, LLGetWallClockUs());
+	sPutInt(&o, utcOffset);
+	sPutString(&o, moduleName, -1);
+	sEndRecord(&o, payload);
+	return o.overflow ? 0 : o.len;
+}
+
+/* helper function to encode the site id, the flags and the context of a record. */
+static void sPutBody(LLBinOut* o, const LLBinSite* s, int flags, const char* ctx, int ctxLen)
+{
+	sPutVarint(o, s->id);
+	sPutByte(o, flags | ((ctx && ctxLen) ? LL_BIN_FLAG_CONTEXT : 0));
+	if(ctx && ctxLen)
+		sPutString(o, ctx, ctxLen);
+}
+
+/* helper function to get the flags of a record for its notes, the suppressed count and the
+ * stack, and to set aside their room. The stack is truncated to half of the record. */
+static int sReserveNotes(LLBinEncoder* e, LLBinOut* o, int* stackLen)
+{
+	int flags = 0;
+	*stackLen = 0;
+	if(e->suppressed > 0)
+	{
+		/* the room of the varint. */
+		o->size -= 10;
+		flags |= LL_BIN_FLAG_SUPPRESSED;
+	}
+	if(e->stack)
+	{
+		*stackLen = (int)strlen(e->stack);
+		if(*stackLen > o->size / 2)
+			*stackLen = o->size / 2;
+		/* the room of the length of the string. */
+		o->size -= *stackLen + 4;
+		flags |= LL_BIN_FLAG_STACK;
+	}
+	return flags;
+}
+
+/* helper function to append the notes of a record in the room set aside. */
+static void sPutNotes(LLBinEncoder* e, LLBinOut* o, int stackLen)
+{
+	if(e->suppressed > 0)
+	{
+		o->size += 10;
+		sPutVarint(o, (unsigned long long)e->suppressed);
+	}
+	if(e->stack)
+	{
+		o->size += stackLen + 4;
+		sPutString(o, e->stack, stackLen);
+	}
+}
+
+/* helper function to encode the head of a record, preceded by the site definition if needed.
+ * \returns the offset of the payload of the record. */
+static int sPutRecordHead(LLBinEncoder* e, LLBinOut* o, int* bodyOffset, LLBinSite* s,
+		int flags, const char* ctx, int ctxLen)
+{
+	int payload;
+	e->lastDefined = NULL;
+	if(s->generation != e->generation)
+	{
+		sPutSite(o, s);
+		s->generation = e->generation;
+		e->lastDefined = s;
+	}
+	if(!sTid)
+	{
+#ifndef DISABLE_THREAD_SAFETY
+		sTid = PLGetThreadId();
+#else
+		sTid = 1;
+#endif
+	}
+	payload = sBeginRecord(o, LL_BIN_REC_LOG);
+	sPutVarint(o, (LLGetMonotonicNs() - e->startNs) / 1000);
+	sPutVarint(o, sTid);
+	/* the repeated records are compared from the site id. */
+	*bodyOffset = o->len;
+	sPutBody(o, s, flags, ctx, ctxLen);
+	return payload;
+}
+
+/* helper function to append the formatted message of a record, truncated to fit.
+ * Its length is a 3 bytes varint, written once the message is formatted. */
+static void sPutFormatted(LLBinOut* o, const char* fmt, va_list ap)
+{
+	int room = o->size - o->len - 3;
+	int len;
+	if(room <= 0)
+	{
+		o->overflow = 1;
+		return;
+	}
+	len = vsnprintf(o->buf + o->len + 3, room, fmt, ap);
+	if((len < 0) || (len > room - 1))
+		len = (int)strlen(o->buf + o->len + 3);
+	len++;
+	o->buf[o->len] = (char)(0x80 | (len & 0x7f));
+	o->buf[o->len + 1] = (char)(0x80 | ((len >> 7) & 0x7f));
+	o->buf[o->len + 2] = (char)((len >> 14) & 0x7f);
+	o->len += 3 + len - 1;
+}
+
+/* Encodes a record, preceded by the definition of its call site if needed. */
+int LLBinEncodeRecord(LLBinEncoder* e, char* buf, int size, int* bodyOffset,
+		LogLevel level, const char* file, const char* funcName, int lineNum,
+		const char* fmt, va_list ap, const char* ctx, int ctxLen)
+{
+	LLBinOut o;
+	int payload, stackFlag, stackLen;
+	LLBinSite* s = sGetSite(e, LL_BIN_SITE_LOG, level, file, funcName, lineNum, fmt);
+	if(!s)
+		return -1;
+	o.buf = buf;
+	o.size = size;
+	o.len = 0;
+	o.overflow = 0;
+	stackFlag = sReserveNotes(e, &o, &stackLen);
+	payload = sPutRecordHead(e, &o, bodyOffset, s, ((s->numConvs < 0) ? LL_BIN_FLAG_TEXT : 0) | stackFlag,
+			ctx, ctxLen);
+	if(o.overflow)
+		return -1;
+	if(s->numConvs >= 0)
+	{
+		va_list apCopy;
+		va_copy(apCopy, ap);
+		sPutArgs(&o, s, apCopy);
+		va_end(apCopy);
+		if(!o.overflow)
+		{
+			sPutNotes(e, &o, stackLen);
+			*bodyOffset -= sEndRecord(&o, payload);
+			return o.overflow ? -1 : o.len;
+		}
+		/* the arguments do not fit, the message is formatted and truncated. */
+		o.overflow = 0;
+		o.len = *bodyOffset;
+		sPutBody(&o, s, LL_BIN_FLAG_TEXT | stackFlag, ctx, ctxLen);
+	}
+	sPutFormatted(&o, fmt, ap);
+	sPutNotes(e, &o, stackLen);
+	*bodyOffset -= sEndRecord(&o, payload);
+	return o.overflow ? -1 : o.len;
+}
+
+/* Encodes a record of a call site without arguments, or with the message already formatted. */
+int LLBinEncodeText(LLBinEncoder* e, char* buf, int size, int* bodyOffset,
+		int kind, LogLevel level, const char* file, const char* funcName, int lineNum,
+		const char* key, const char* text, int textLen, const char* ctx, int ctxLen)
+{
+	LLBinOut o;
+	int payload, stackFlag, stackLen;
+	LLBinSite* s = sGetSite(e, kind, level, file, funcName, lineNum, key);
+	if(!s)
+		return -1;
+	o.buf = buf;
+	o.size = size;
+	o.len = 0;
+	o.overflow = 0;
+	stackFlag = sReserveNotes(e, &o, &stackLen);
+	payload = sPutRecordHead(e, &o, bodyOffset, s, (text ? LL_BIN_FLAG_TEXT : 0) | stackFlag, ctx, ctxLen);
+	if(text)
+	{
+		/* the text is truncated to fit. */
+		int room = o.size - o.len - 4;
+		if(textLen > room)
+			textLen = (room > 0) ? room : 0;
+		sPutString(&o, text, textLen);
+	}
+	sPutNotes(e, &o, stackLen);
+	*bodyOffset -= sEndRecord(&o, payload);
+	return o.overflow ? -1 : o.len;
+}
+
+/* Cancels the definition of the call site of the last record. */
+void LLBinCancelRecord(LLBinEncoder* e)
+{
+	if(e->lastDefined)
+		e->lastDefined->generation = 0;
+	e->lastDefined = NULL;
+}
+
+/* Encodes a note record, async-signal-safe. */
+int LLBinEncodeNote(char* buf, int size, unsigned long long wallUs, LogLevel level,
+		const char* text, int len)
+{
+	char head[24];
+	int headLen = 0;
+	int n = 0;
+	headLen += LLBinPutVarint(head, wallUs);
+	head[headLen++] = (char)level;
+	headLen += LLBinPutVarint(head + headLen, (unsigned long long)len + 1);
+	if(size < 1 + 10 + headLen + len)
+		return 0;
+	buf[n++] = LL_BIN_REC_NOTE;
+	n += LLBinPutVarint(buf + n, (unsigned long long)(headLen + len));
+	memcpy(buf + n, head, headLen);
+	memcpy(buf + n + headLen, text, len);
+	return n + headLen + len;
+}
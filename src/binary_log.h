@@ -0,0 +1,192 @@
+/*
+       Licensed to the Apache Software Foundation (ASF) under one
+       or more contributor license agreements.  See the NOTICE file
+       distributed with this work for additional information
+       regarding copyright ownership.  The ASF licenses this file
+       to you under the Apache License, Version 2.0 (the
+       "License"); you may not use this file except in compliance
+       with the License.  You may obtain a copy of the License at
+
+         http://www.apache.org/licenses/LICENSE-2.0
+
+       Unless required by applicable law or agreed to in writing,
+       software distributed under the License is distributed on an
+       "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+       KIND, either express or implied.  See the License for the
+       specific language governing permissions and limitations
+       under the License.
+ */
+/**
+ * \file The binary log format, see \ref OutputFormatBinary, decoded by tools/lldecode.
+ *
+ * A log is a sequence of records, each one made of its type byte, the length of its payload
+ * (a varint) and its payload :
+ * - \ref LL_BIN_REC_SESSION : starts the log, and each session appended to it :
+ *   "LLBLOG1", version, wall clock (us since the epoch), UTC offset (s), module name.
+ * - \ref LL_BIN_REC_SITE : defines a call site : id, kind, level, line, file, function
+ *   and format. A site is defined before its first record, and again when records may
+ *   have been lost, a decoder reads all the definitions of a session first since the
+ *   asynchronous writer may reorder the records.
+ * - \ref LL_BIN_REC_LOG : a record of a call site : time (us since the session start),
+ *   thread id, site id, flags, the context of the thread if \ref LL_BIN_FLAG_CONTEXT is set,
+ *   then the arguments of the format, or the formatted message if \ref LL_BIN_FLAG_TEXT is set,
+ *   then the count of the records suppressed by the rate limit of the call site if
+ *   \ref LL_BIN_FLAG_SUPPRESSED is set, then the call stack rendered as text if
+ *   \ref LL_BIN_FLAG_STACK is set, so that the records with these notes share the site of
+ *   their format.
+ * - \ref LL_BIN_REC_NOTE : a line written as it is : wall clock (us, 0 if unknown),
+ *   level, text. Used for the summaries of the repeated / dropped records and the crash record.
+ *
+ * The integers are LEB128 varints, the signed ones zigzag encoded, the strings are a varint
+ * length + 1 (0 for a NULL string) followed by the bytes, the doubles are 8 bytes in the byte
+ * order of the host.
+ * */
+#ifndef __BINARY_LOG_H__
+#define __BINARY_LOG_H__
+
+#include <stdarg.h>
+#include <liblogger/liblogger.h>
+
+/** The magic of a session record, after its type byte. */
+#define LL_BIN_MAGIC		"LLBLOG1"
+#define LL_BIN_MAGIC_LEN	7
+/** The version of the format. */
+#define LL_BIN_VERSION		1
+
+/** The record types. */
+#define LL_BIN_REC_SITE		1
+#define LL_BIN_REC_LOG		2
+#define LL_BIN_REC_NOTE		3
+#define LL_BIN_REC_SESSION	4
+
+/** The kinds of call sites. */
+#define LL_BIN_SITE_LOG			0
+#define LL_BIN_SITE_FUNC_ENTRY	1
+#define LL_BIN_SITE_FUNC_EXIT	2
+
+/** The flags of a record. */
+#define LL_BIN_FLAG_CONTEXT	0x01
+#define LL_BIN_FLAG_TEXT	0x02
+#define LL_BIN_FLAG_STACK	0x04
+#define LL_BIN_FLAG_SUPPRESSED	0x08
+
+/** The encodings of the arguments. */
+#define LL_BIN_ARG_NONE		0
+#define LL_BIN_ARG_INT		1
+#define LL_BIN_ARG_UINT		2
+#define LL_BIN_ARG_DOUBLE	3
+#define LL_BIN_ARG_STR		4
+#define LL_BIN_ARG_PTR		5
+
+/** The maximum number of conversions of a format, the records of longer formats are
+ * written with \ref LL_BIN_FLAG_TEXT. */
+#define LL_BIN_MAX_CONVS	32
+
+/** A conversion of a format. */
+typedef struct LLBinConv
+{
+	/** The offset of the conversion in the format, at its '%'. */
+	unsigned short	start;
+	/** The length of the conversion. */
+	unsigned short	len;
+	/** The number of '*' width / precision, passed as int arguments before the value. */
+	unsigned char	stars;
+	/** The precision, -1 if none, -2 if it is a '*' argument. */
+	short			precision;
+	/** The encoding of the value, \ref LL_BIN_ARG_NONE for "%%". */
+	unsigned char	arg;
+	/** How the value is read from the arguments, private to the encoder. */
+	unsigned char	va;
+} LLBinConv;
+
+/** Parses the conversions of a printf format.
+ * \param [in]  fmt			The format.
+ * \param [out] convs		The conversions.
+ * \param [in]  maxConvs	The size of \a convs.
+ * \returns the number of conversions, -1 if the format has too many conversions or
+ * conversions which are not supported (%n, positional arguments, wide characters).
+ * */
+int LLBinParseFormat(const char* fmt, LLBinConv* convs, int maxConvs);
+
+/** Encodes / decodes a varint, the decoders return the number of bytes read, 0 on error. */
+int LLBinPutVarint(char* buf, unsigned long long v);
+int LLBinGetVarint(const char* buf, int len, unsigned long long* v);
+
+/** A call site of the encoder. */
+struct LLBinSite;
+
+/** The state of the encoder of a log, the call site dictionary. */
+typedef struct LLBinEncoder
+{
+	/** The call sites, an open addressing hash table. */
+	struct LLBinSite*	sites;
+	unsigned int		capacity;
+	unsigned int		numSites;
+	/** The sites defined with another generation are defined again before their next record. */
+	unsigned int		generation;
+	/** The site defined by the last record, see \ref LLBinCancelRecord. */
+	struct LLBinSite*	lastDefined;
+	/** The monotonic time of the start of the session, in ns. */
+	unsigned long long	startNs;
+	/** The call stack of the records being encoded, rendered as text, appended to the
+	 * records with \ref LL_BIN_FLAG_STACK. NULL for none, set by the log writer. */
+	const char*			stack;
+	/** The count of the records suppressed before the records being encoded, written in the
+	 * records with \ref LL_BIN_FLAG_SUPPRESSED. 0 for none, set by the log writer. */
+	long				suppressed;
+} LLBinEncoder;
+
+/** Allocates the call site dictionary.
+ * \returns 0 on success, -1 on failure.
+ * */
+int LLBinEncoderInit(LLBinEncoder* e);
+
+/** Frees the call site dictionary. */
+void LLBinEncoderDestroy(LLBinEncoder* e);
+
+/** Defines the call sites again before their next record, when records may have been lost. */
+void LLBinEncoderInvalidate(LLBinEncoder* e);
+
+/** Reads the thread id again, called in the child after fork(). */
+void LLBinAfterFork(void);
+
+/** Encodes a session record, and starts a new session.
+ * \returns the length of the record.
+ * */
+int LLBinEncodeSession(LLBinEncoder* e, char* buf, int size, const char* moduleName);
+
+/** Encodes a record, preceded by the definition of its call site if needed.
+ * \param [out] buf			The buffer where the record is encoded.
+ * \param [in]  size		The size of \a buf.
+ * \param [out] bodyOffset	The offset of the part of the record compared to find the
+ *							repeated records : the site, the context and the arguments.
+ * \param [in]  fmt			The format, the call site is identified by its address and content.
+ * \param [in]  ap			The arguments of \a fmt.
+ * \param [in]  ctx			The context of the thread, NULL / 0 for none.
+ * \returns the length of the record, -1 on failure.
+ * */
+int LLBinEncodeRecord(LLBinEncoder* e, char* buf, int size, int* bodyOffset,
+		LogLevel level, const char* file, const char* funcName, int lineNum,
+		const char* fmt, va_list ap, const char* ctx, int ctxLen);
+
+/** Encodes a record of a call site without arguments (function entry / exit), or with the
+ * message already formatted (\ref LL_BIN_FLAG_TEXT).
+ * \param [in] kind	The kind of the call site, \ref LL_BIN_SITE_LOG ...
+ * \param [in] key	The format of the call site, NULL for none.
+ * \param [in] text	The message, NULL for none.
+ * \returns the length of the record, -1 on failure.
+ * */
+int LLBinEncodeText(LLBinEncoder* e, char* buf, int size, int* bodyOffset,
+		int kind, LogLevel level, const char* file, const char* funcName, int lineNum,
+		const char* key, const char* text, int textLen, const char* ctx, int ctxLen);
+
+/** Cancels the definition of the call site of the last record, if the record is not written. */
+void LLBinCancelRecord(LLBinEncoder* e);
+
+/** Encodes a note record, async-signal-safe.
+ * \returns the length of the record, 0 if it does not fit.
+ * */
+int LLBinEncodeNote(char* buf, int size, unsigned long long wallUs, LogLevel level,
+		const char* text, int len);
+
+#endif // __BINARY_LOG_H__
@@ -0,0 +1,245 @@
+/*
+       Licensed to the Apache Software Foundation (ASF) under one
+       or more contributor license agreements.  See the NOTICE file
+       distributed with this work for additional information
+       regarding copyright ownership.  The ASF licenses this file
+       to you under the Apache License, Version 2.0 (the
+       "License"); you may not use this file except in compliance
+       with the License.  You may obtain a copy of the License at
+
+         http://www.apache.org/licenses/LICENSE-2.0
+
+       Unless required by applicable law or agreed to in writing,
+       software distributed under the License is distributed on an
+       "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+       KIND, either express or implied.  See the License for the
+       specific language governing permissions and limitations
+       under the License.
+ */
+/**
+ * \file Encoders of the payloads of the blob records, see blob_encoder.h.
+ * The hex encoder renders 16 bytes at a time with SSE2, the base64 encoder 12 bytes at a
+ * time with SSSE3 when the compiler targets it (the byte shuffles have no SSE2 equivalent),
+ * both fall back to tables.
+ * */
+#include "blob_encoder.h"
+#include "win32_support.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+	#include <emmintrin.h>
+	#define LL_USE_SSE2
+#endif
+#if defined(LL_USE_SSE2) && (defined(__SSSE3__) || defined(__AVX__))
+	#include <tmmintrin.h>
+	#define LL_USE_SSSE3
+#endif
+
+static const char sHexDigits[] = "0123456789abcdef";
+
+static const char sBase64Digits[] =
+	"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+/* Returns the length of len bytes once encoded. */
+int LLBlobEncodedLen(int encoding, int len)
+{
+	switch(encoding)
+	{
+		case LogBlobHex:	return len * 2;
+		case LogBlobBase64:	return ((len + 2) / 3) * 4;
+		default:			return len;
+	}
+}
+
+/* Returns the largest number of bytes whose encoding fits in room bytes. */
+int LLBlobSourceLen(int encoding, int room)
+{
+	if(room <= 0)
+		return 0;
+	switch(encoding)
+	{
+		case LogBlobHex:	return room / 2;
+		case LogBlobBase64:	return (room / 4) * 3;
+		default:			return room;
+	}
+}
+
+/** helper function to encode in hex. */
+static int sHexEncode(const unsigned char* in, int len, char* out)
+{
+	int i = 0;
+#ifdef LL_USE_SSE2
+	const __m128i mask = _mm_set1_epi8(0x0F);
+	const __m128i nine = _mm_set1_epi8(9);
+	const __m128i zero = _mm_set1_epi8('0');
+	/* the distance from '9' + 1 to 'a'. */
+	const __m128i alpha = _mm_set1_epi8('a' - '0' - 10);
+	for(; len - i >= 16; i += 16)
+	{
+		__m128i chunk = _mm_loadu_si128((const __m128i*)(in + i));
+		__m128i hi = _mm_and_si128(_mm_srli_epi16(chunk, 4), mask);
+		__m128i lo = _mm_and_si128(chunk, mask);
+		hi = _mm_add_epi8(_mm_add_epi8(hi, zero), _mm_and_si128(_mm_cmpgt_epi8(hi, nine), alpha));
+		lo = _mm_add_epi8(_mm_add_epi8(lo, zero), _mm_and_si128(_mm_cmpgt_epi8(lo, nine), alpha));
+		_mm_storeu_si128((__m128i*)(out + 2 * i), _mm_unpacklo_epi8(hi, lo));
+		_mm_storeu_si128((__m128i*)(out + 2 * i + 16), _mm_unpackhi_epi8(hi, lo));
+	}
+#endif
+	for(; i < len; i++)
+	{
+		out[2 * i] = sHexDigits[in[i] >> 4];
+		out[2 * i + 1] = sHexDigits[in[i] & 0x0F];
+	}
+	return len * 2;
+}
+
+#ifdef LL_USE_SSSE3
+/** helper function to encode 12 bytes (16 are read) to 16 base64 digits. */
+static __m128i sBase64Encode12(__m128i in)
+{
+	__m128i t0, t1, t2, t3, indices, result, less;
+	/* each 3 bytes a, b, c are spread over 4 bytes : b a c b. */
+	in = _mm_shuffle_epi8(in, _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+	/* the four 6 bit indices are moved to the low bits of each byte. */
+	t0 = _mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00));
+	t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+	t2 = _mm_and_si128(in, _mm_set1_epi32(0x003f03f0));
+	t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+	indices = _mm_or_si128(t1, t3);
+	/* the digit is the index plus an offset, which depends on the range of the index :
+	 * 0-25 'A', 26-51 'a' - 26, 52-61 '0' - 52, 62 '+' - 62, 63 '/' - 63. */
+	result = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+	less = _mm_cmpgt_epi8(_mm_set1_epi8(26), indices);
+	result = _mm_or_si128(result, _mm_and_si128(less, _mm_set1_epi8(13)));
+	result = _mm_shuffle_epi8(_mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+			'0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0), result);
+	return _mm_add_epi8(result, indices);
+}
+#endif
+
+/** helper function to encode in base64. */
+static int sBase64Encode(const unsigned char* in, int len, char* out)
+{
+	int i = 0;
+	char* o = out;
+#ifdef LL_USE_SSSE3
+	/* 16 bytes are loaded for 12. */
+	for(; len - i >= 16; i += 12, o += 16)
+		_mm_storeu_si128((__m128i*)o, sBase64Encode12(_mm_loadu_si128((const __m128i*)(in + i))));
+#endif
+	for(; len - i >= 3; i += 3, o += 4)
+	{
+		unsigned long v = ((unsigned long)in[i] << 16) | ((unsigned long)in[i + 1] << 8) | in[i + 2];
+		o[0] = sBase64Digits[(v >> 18) & 0x3F];
+		o[1] = sBase64Digits[(v >> 12) & 0x3F];
+		o[2] = sBase64Digits[(v >> 6) & 0x3F];
+		o[3] = sBase64Digits[v & 0x3F];
+	}
+	if(len - i == 1)
+	{
+		o[0] = sBase64Digits[in[i] >> 2];
+		o[1] = sBase64Digits[(in[i] & 0x03) << 4];
+		o[2] = '=';
+		o[3] = '=';
+		o += 4;
+	}
+	else if(len - i == 2)
+	{
+		o[0] = sBase64Digits[in[i] >> 2];
+		o[1] = sBase64Digits[((in[i] & 0x03) << 4) | (in[i + 1] >> 4)];
+		o[2] = sBase64Digits[(in[i + 1] & 0x0F) << 2];
+		o[3] = '=';
+		o += 4;
+	}
+	return (int)(o - out);
+}
+
+/* Encodes len bytes of data to out. */
+int LLBlobEncode(int encoding, const void* data, int len, char* out)
+{
+	if(len <= 0)
+		return 0;
+	switch(encoding)
+	{
+		case LogBlobHex:	return sHexEncode((const unsigned char*)data, len, out);
+		case LogBlobBase64:	return sBase64Encode((const unsigned char*)data, len, out);
+		default:
+			memcpy(out, data, len);
+			return len;
+	}
+}
+
+/* Formats the end of a blob record. */
+int LLBlobFormatTail(char* out, tOutputFormat format, int encoding, int omitted)
+{
+	int len = 0;
+	if(OutputFormatJson == format)
+	{
+		/* a raw payload is a complete JSON string, the encoded ones are quoted here. */
+		if(LogBlobRaw != encoding)
+			out[len++] = '"';
+		if(omitted)
+		{
+			memcpy(out + len, ",\"truncated\":true", 17);
+			len += 17;
+		}
+		out[len++] = '}';
+	}
+	else if(omitted)
+		len = snprintf(out, LL_BLOB_TAIL_MAX, " [... %d bytes omitted]", omitted);
+	return len;
+}
+
+/* Prepares the parts of a record for a vectored write. */
+int LLBlobPartsToIoVec(const LLRecordPart* parts, int numParts, tPLIoVec* iov, LLBlobBuf* scratch)
+{
+	int encodedLen = 0;
+	int total = 0;
+	char* out = NULL;
+	int i;
+	for(i = 0; i < numParts; i++)
+		if(LogBlobRaw != parts[i].encoding)
+			encodedLen += LLBlobEncodedLen(parts[i].encoding, parts[i].len);
+	if( encodedLen && !(out = LLBlobBufReserve(scratch, encodedLen)) )
+		return -1;
+	for(i = 0; i < numParts; i++)
+	{
+		if(LogBlobRaw == parts[i].encoding)
+		{
+			iov[i].data = parts[i].data;
+			iov[i].len = parts[i].len;
+		}
+		else
+		{
+			iov[i].data = out;
+			iov[i].len = LLBlobEncode(parts[i].encoding, parts[i].data, parts[i].len, out);
+			out += iov[i].len;
+		}
+		total += iov[i].len;
+	}
+	return total;
+}
+
+/* Returns the scratch buffer grown to size bytes. */
+char* LLBlobBufReserve(LLBlobBuf* b, int size)
+{
+	if(size > b->size)
+	{
+		char* data = (char*)realloc(b->data, size);
+		if(!data)
+			return NULL;
+		b->data = data;
+		b->size = size;
+	}
+	return b->data;
+}
+
+/* Frees the scratch buffer. */
+void LLBlobBufFree(LLBlobBuf* b)
+{
+	free(b->data);
+	b->data = NULL;
+	b->size = 0;
+}
@@ -0,0 +1,84 @@
+/*
+       Licensed to the Apache Software Foundation (ASF) under one
+       or more contributor license agreements.  See the NOTICE file
+       distributed with this work for additional information
+       regarding copyright ownership.  The ASF licenses this file
+       to you under the Apache License, Version 2.0 (the
+       "License"); you may not use this file except in compliance
+       with the License.  You may obtain a copy of the License at
+
+         http://www.apache.org/licenses/LICENSE-2.0
+
+       Unless required by applicable law or agreed to in writing,
+       software distributed under the License is distributed on an
+       "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+       KIND, either express or implied.  See the License for the
+       specific language governing permissions and limitations
+       under the License.
+ */
+/**
+ * \file Encoders of the payloads of the blob records (hex, base64), see \ref GRP_BLOB.
+ * The records are written in parts, the payload part references the data of the caller
+ * and is encoded only where it is copied : in the queue, or in a scratch buffer right
+ * before the vectored write.
+ * */
+#ifndef __BLOB_ENCODER_H__
+#define __BLOB_ENCODER_H__
+
+#include <liblogger/liblogger.h>
+#include "tPLFile.h"
+
+/** The largest length of the end of a blob record, see \ref LLBlobFormatTail. */
+#define LL_BLOB_TAIL_MAX	64
+
+/** A part of a record, the data is encoded as it is copied. */
+typedef struct LLRecordPart
+{
+	/** The data. */
+	const void*	data;
+	/** The length of \ref data, before encoding. */
+	int			len;
+	/** The encoding of \ref data, one of \ref tLogBlobEncoding. */
+	int			encoding;
+} LLRecordPart;
+
+/** A scratch buffer, grown on demand and kept for the next records. */
+typedef struct LLBlobBuf
+{
+	char*	data;
+	int		size;
+} LLBlobBuf;
+
+/** Returns the length of \a len bytes once encoded. */
+int LLBlobEncodedLen(int encoding, int len);
+
+/** Returns the largest number of bytes whose encoding fits in \a room bytes. */
+int LLBlobSourceLen(int encoding, int room);
+
+/** Encodes \a len bytes of \a data to \a out, which must hold \ref LLBlobEncodedLen bytes.
+ * \returns the length of the encoded data.
+ * */
+int LLBlobEncode(int encoding, const void* data, int len, char* out);
+
+/** Formats the end of a blob record to \a out (\ref LL_BLOB_TAIL_MAX bytes) : the note of
+ * the bytes omitted if the payload was truncated, and the end of the blob member and of
+ * the record for JSON. The newline is not included.
+ * \returns the length of the end of the record.
+ * */
+int LLBlobFormatTail(char* out, tOutputFormat format, int encoding, int omitted);
+
+/** Prepares the parts of a record for a vectored write : the encoded parts are encoded in
+ * \a scratch, the others are referenced as is.
+ * \param [in]  parts		The parts of the record, at most \ref PL_IOV_MAX.
+ * \param [out] iov			The vector to write.
+ * \returns the total length of the record, -1 if the scratch buffer could not be allocated.
+ * */
+int LLBlobPartsToIoVec(const LLRecordPart* parts, int numParts, tPLIoVec* iov, LLBlobBuf* scratch);
+
+/** Returns the scratch buffer grown to \a size bytes, NULL if it could not be allocated. */
+char* LLBlobBufReserve(LLBlobBuf* b, int size);
+
+/** Frees the scratch buffer. */
+void LLBlobBufFree(LLBlobBuf* b);
+
+#endif // __BLOB_ENCODER_H__
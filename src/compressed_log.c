@@ -0,0 +1,231 @@
+/*
+       Licensed to the Apache Software Foundation (ASF) under one
+       or more contributor license agreements.  See the NOTICE file
+       distributed with this work for additional information
+       regarding copyright ownership.  The ASF licenses this file
+       to you under the Apache License, Version 2.0 (the
+       "License"); you may not use this file except in compliance
+       with the License.  You may obtain a copy of the License at
+
+         http://www.apache.org/licenses/LICENSE-2.0
+
+       Unless required by applicable law or agreed to in writing,
+       software distributed under the License is distributed on an
+       "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+       KIND, either express or implied.  See the License for the
+       specific language governing permissions and limitations
+       under the License.
+ */
+/**
+ * \file Compressed log files, see compressed_log.h.
+ * The records are added to the block being filled, which is compressed and written with
+ * its index entry once it is full. A block is written before a record which does not fit
+ * in it, so that the blocks end at the end of a record and can be decompressed alone.
+ * */
+#include "compressed_log.h"
+#include "lz_codec.h"
+#include "LLTimeUtil.h"
+#include "tPLFile.h"
+#include <stdlib.h>
+#include <string.h>
+
+static void sPut32(char* p, unsigned int v)
+{
+	p[0] = (char)v;
+	p[1] = (char)(v >> 8);
+	p[2] = (char)(v >> 16);
+	p[3] = (char)(v >> 24);
+}
+
+static unsigned int sGet32(const char* p)
+{
+	const unsigned char* u = (const unsigned char*)p;
+	return u[0] | (u[1] << 8) | (u[2] << 16) | ((unsigned int)u[3] << 24);
+}
+
+static void sPut64(char* p, unsigned long long v)
+{
+	sPut32(p, (unsigned int)v);
+	sPut32(p + 4, (unsigned int)(v >> 32));
+}
+
+static unsigned long long sGet64(const char* p)
+{
+	return sGet32(p) | ((unsigned long long)sGet32(p + 4) << 32);
+}
+
+/* Encodes the header of a block. */
+void LLLzPutBlockHeader(char* buf, unsigned int rawLen, unsigned int compLen)
+{
+	memcpy(buf, LL_LZ_BLOCK_MAGIC, 4);
+	sPut32(buf + 4, rawLen);
+	sPut32(buf + 8, compLen);
+}
+
+/* Decodes the header of a block. */
+int LLLzGetBlockHeader(const char* buf, unsigned int* rawLen, unsigned int* compLen)
+{
+	if(memcmp(buf, LL_LZ_BLOCK_MAGIC, 4))
+		return -1;
+	*rawLen = sGet32(buf + 4);
+	*compLen = sGet32(buf + 8);
+	if( (*rawLen > LL_LZ_RAW_MAX) || (*compLen > *rawLen) )
+		return -1;
+	return 0;
+}
+
+/* Encodes an entry of the index. */
+void LLLzPutIndexEntry(char* buf, const LLLzIndexEntry* entry)
+{
+	sPut64(buf, entry->offset);
+	sPut64(buf + 8, entry->firstUs);
+	sPut64(buf + 16, entry->lastUs);
+	sPut32(buf + 24, entry->rawLen);
+	sPut32(buf + 28, entry->compLen);
+}
+
+/* Decodes an entry of the index. */
+void LLLzGetIndexEntry(const char* buf, LLLzIndexEntry* entry)
+{
+	entry->offset = sGet64(buf);
+	entry->firstUs = sGet64(buf + 8);
+	entry->lastUs = sGet64(buf + 16);
+	entry->rawLen = sGet32(buf + 24);
+	entry->compLen = sGet32(buf + 28);
+}
+
+/* helper function to write a block and its index entry, async-signal-safe.
+ * \param [in] comp		The compressed data, NULL to store the data uncompressed.
+ * */
+static int sWriteBlock(LLCompressedLog* c, const char* data, unsigned int rawLen,
+		const char* comp, unsigned int compLen, unsigned long long firstUs, unsigned long long lastUs)
+{
+	char header[LL_LZ_BLOCK_HEADER];
+	char idx[LL_LZ_INDEX_ENTRY];
+	LLLzIndexEntry entry;
+	int ret = 0;
+	if(!comp)
+		compLen = rawLen;
+	LLLzPutBlockHeader(header, rawLen, compLen);
+	if( (PLFileWrite(c->fd, header, sizeof(header)) < 0)
+			|| (PLFileWrite(c->fd, comp ? comp : data, compLen) < 0) )
+		ret = -1;
+	entry.offset = c->offset;
+	entry.firstUs = firstUs;
+	entry.lastUs = lastUs;
+	entry.rawLen = rawLen;
+	entry.compLen = compLen;
+	LLLzPutIndexEntry(idx, &entry);
+	if((c->idxFd >= 0) && (PLFileWrite(c->idxFd, idx, sizeof(idx)) < 0))
+		ret = -1;
+	c->offset += sizeof(header) + compLen;
+	return ret;
+}
+
+/* helper function to compress and write the block being filled. */
+static int sCompressBlock(LLCompressedLog* c)
+{
+	unsigned int rawLen = c->blockLen;
+	/* stored uncompressed if it does not get smaller. */
+	int compLen = LLLzCompress(c->block, (int)rawLen, c->out, (int)rawLen - 1, c->work);
+	c->blockLen = 0;
+	return sWriteBlock(c, c->block, rawLen, (compLen > 0) ? c->out : NULL, (unsigned int)compLen,
+			c->firstUs, c->lastUs);
+}
+
+/* Starts writing a compressed log. */
+int LLCompressedLogOpen(LLCompressedLog* c, int fd, int idxFd, unsigned long long offset,
+		unsigned int blockSize)
+{
+	memset(c, 0, sizeof(*c));
+	if(blockSize < LL_LZ_BLOCK_MIN)
+		blockSize = LL_LZ_BLOCK_MIN;
+	else if(blockSize > LL_LZ_BLOCK_MAX)
+		blockSize = LL_LZ_BLOCK_MAX;
+	c->fd = fd;
+	c->idxFd = idxFd;
+	c->offset = offset;
+	c->blockSize = blockSize;
+	c->blockCapacity = blockSize + LL_LZ_CHUNK_MAX;
+	c->block = (char*)malloc(c->blockCapacity);
+	c->out = (char*)malloc(c->blockCapacity);
+	c->work = malloc(LL_LZ_WORKMEM_SIZE);
+	if(!c->block || !c->out || !c->work)
+	{
+		LLCompressedLogClose(c);
+		return -1;
+	}
+	return 0;
+}
+
+/* Adds data to the log, the full blocks are compressed and written. */
+int LLCompressedLogWrite(LLCompressedLog* c, const char* data, int len)
+{
+	unsigned long long now = LLGetWallClockUs();
+	int ret = 0;
+	while(len > 0)
+	{
+		unsigned int n = (unsigned int)len;
+		/* the block ends before the data which does not fit. */
+		if(c->blockLen && (c->blockLen + n > c->blockSize) && sCompressBlock(c))
+			ret = -1;
+		if(n > c->blockCapacity - c->blockLen)
+			n = c->blockCapacity - c->blockLen;
+		if(!c->blockLen)
+			c->firstUs = now;
+		c->lastUs = now;
+		memcpy(c->block + c->blockLen, data, n);
+		c->blockLen += n;
+		data += n;
+		len -= n;
+		if((c->blockLen >= c->blockSize) && sCompressBlock(c))
+			ret = -1;
+	}
+	return ret;
+}
+
+/* Writes the block being filled, if forced or if its first record is old enough. */
+int LLCompressedLogFlush(LLCompressedLog* c, int force)
+{
+	if(!c->blockLen)
+		return 0;
+	if(!force && (LLGetWallClockUs() - c->firstUs < LL_LZ_FLUSH_MS * 1000ULL))
+		return 0;
+	return sCompressBlock(c);
+}
+
+/* Writes the block being filled and the data as uncompressed blocks, async-signal-safe. */
+int LLCompressedLogCrashWrite(LLCompressedLog* c, const char* data, int len)
+{
+	unsigned long long now = LLGetWallClockUs();
+	unsigned int pending = c->blockLen;
+	int ret = 0;
+	if(!c->block)
+		return -1;
+	c->blockLen = 0;
+	if(pending && sWriteBlock(c, c->block, pending, NULL, 0, c->firstUs, c->lastUs))
+		ret = -1;
+	while(len > 0)
+	{
+		int n = (len > LL_LZ_CHUNK_MAX) ? LL_LZ_CHUNK_MAX : len;
+		if(sWriteBlock(c, data, (unsigned int)n, NULL, 0, now, now))
+			ret = -1;
+		data += n;
+		len -= n;
+	}
+	return ret;
+}
+
+/* Writes the block being filled and frees the writer. */
+void LLCompressedLogClose(LLCompressedLog* c)
+{
+	if(c->block && c->out && c->work)
+		LLCompressedLogFlush(c, 1);
+	free(c->block);
+	free(c->out);
+	free(c->work);
+	c->block = 0;
+	c->out = 0;
+	c->work = 0;
+	c->blockLen = 0;
+}
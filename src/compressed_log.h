@@ -0,0 +1,124 @@
+/*
+       Licensed to the Apache Software Foundation (ASF) under one
+       or more contributor license agreements.  See the NOTICE file
+       distributed with this work for additional information
+       regarding copyright ownership.  The ASF licenses this file
+       to you under the Apache License, Version 2.0 (the
+       "License"); you may not use this file except in compliance
+       with the License.  You may obtain a copy of the License at
+
+         http://www.apache.org/licenses/LICENSE-2.0
+
+       Unless required by applicable law or agreed to in writing,
+       software distributed under the License is distributed on an
+       "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+       KIND, either express or implied.  See the License for the
+       specific language governing permissions and limitations
+       under the License.
+ */
+/**
+ * \file Compressed log files, see \ref tFileLoggerInitParams::compressBlockSize.
+ *
+ * The log is a sequence of independent blocks, each one made of a 12 bytes header :
+ * the magic "LLZB", the length of the data and the length of the compressed data
+ * (equal to the length of the data if the block is stored uncompressed), followed by
+ * the compressed data (see lz_codec.h). A block always ends at the end of a record.
+ *
+ * The index "<log>.idx" has a 32 bytes entry per block : the offset of the block in the
+ * log, the wall clock times (us since the epoch) when the writer got the first and the
+ * last records of the block, the length of the data and the length of the compressed data.
+ * The records are logged before the writer gets them, at most by the latency of the queue.
+ * All the integers are little endian.
+ * */
+#ifndef __COMPRESSED_LOG_H__
+#define __COMPRESSED_LOG_H__
+
+/** The magic of a block. */
+#define LL_LZ_BLOCK_MAGIC		"LLZB"
+/** The size of the header of a block. */
+#define LL_LZ_BLOCK_HEADER		12
+/** The size of an entry of the index. */
+#define LL_LZ_INDEX_ENTRY		32
+/** The suffix of the index file name. */
+#define LL_LZ_INDEX_SUFFIX		".idx"
+/** The limits of the block size. */
+#define LL_LZ_BLOCK_MIN			4096
+#define LL_LZ_BLOCK_MAX			(4 * 1024 * 1024)
+/** The largest data added at once to a block, longer data is split over several blocks.
+ * It is the size of the batches of the background writer thread. */
+#define LL_LZ_CHUNK_MAX			(64 * 1024)
+/** The maximum length of the data of a block. */
+#define LL_LZ_RAW_MAX			(LL_LZ_BLOCK_MAX + LL_LZ_CHUNK_MAX)
+/** A block is written once its first record is older than this, even if it is not full. */
+#define LL_LZ_FLUSH_MS			1000
+
+/** An entry of the index. */
+typedef struct LLLzIndexEntry
+{
+	unsigned long long	offset;
+	unsigned long long	firstUs;
+	unsigned long long	lastUs;
+	unsigned int		rawLen;
+	unsigned int		compLen;
+} LLLzIndexEntry;
+
+/** The writer of a compressed log, used by the background writer thread only. */
+typedef struct LLCompressedLog
+{
+	/** The log and index files. */
+	int					fd;
+	int					idxFd;
+	/** The offset of the next block in the log. */
+	unsigned long long	offset;
+	/** The data of the block being filled. */
+	char*				block;
+	unsigned int		blockSize;
+	unsigned int		blockCapacity;
+	volatile unsigned int	blockLen;
+	/** The times the first / last records of the block were written. */
+	unsigned long long	firstUs;
+	unsigned long long	lastUs;
+	/** The compressed block, with its header. */
+	char*				out;
+	/** The work memory of the compressor. */
+	void*				work;
+} LLCompressedLog;
+
+/** Encodes / decodes the header of a block, the decoder returns -1 if it is not a valid header. */
+void LLLzPutBlockHeader(char* buf, unsigned int rawLen, unsigned int compLen);
+int LLLzGetBlockHeader(const char* buf, unsigned int* rawLen, unsigned int* compLen);
+
+/** Encodes / decodes an entry of the index. */
+void LLLzPutIndexEntry(char* buf, const LLLzIndexEntry* entry);
+void LLLzGetIndexEntry(const char* buf, LLLzIndexEntry* entry);
+
+/** Starts writing a compressed log.
+ * \param [in] fd			The log file, the blocks are written at its end.
+ * \param [in] idxFd		The index file, -1 for none.
+ * \param [in] offset		The size of the log file.
+ * \param [in] blockSize	The size of the data of a block.
+ * \returns 0 on success, -1 on failure.
+ * */
+int LLCompressedLogOpen(LLCompressedLog* c, int fd, int idxFd, unsigned long long offset,
+		unsigned int blockSize);
+
+/** Adds data to the log, the full blocks are compressed and written.
+ * \returns 0 on success, -1 on failure.
+ * */
+int LLCompressedLogWrite(LLCompressedLog* c, const char* data, int len);
+
+/** Writes the block being filled, if \a force is non zero or if its first record is older
+ * than \ref LL_LZ_FLUSH_MS.
+ * \returns 0 on success, -1 on failure.
+ * */
+int LLCompressedLogFlush(LLCompressedLog* c, int force);
+
+/** Writes the block being filled and \a data as uncompressed blocks, async-signal-safe.
+ * Called from a signal handler.
+ * */
+int LLCompressedLogCrashWrite(LLCompressedLog* c, const char* data, int len);
+
+/** Writes the block being filled and frees the writer, the files are not closed. */
+void LLCompressedLogClose(LLCompressedLog* c);
+
+#endif // __COMPRESSED_LOG_H__
@@ -0,0 +1,340 @@
+/*
+       Licensed to the Apache Software Foundation (ASF) under one
+       or more contributor license agreements.  See the NOTICE file
+       distributed with this work for additional information
+       regarding copyright ownership.  The ASF licenses this file
+       to you under the Apache License, Version 2.0 (the
+       "License"); you may not use this file except in compliance
+       with the License.  You may obtain a copy of the License at
+
+         http://www.apache.org/licenses/LICENSE-2.0
+
+       Unless required by applicable law or agreed to in writing,
+       software distributed under the License is distributed on an
+       "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+       KIND, either express or implied.  See the License for the
+       specific language governing permissions and limitations
+       under the License.
+ */
+/**
+ * \file Crash handler, drains the pending log data when a fatal signal is caught.
+ * Everything reachable from the signal handler is async-signal-safe : no stdio,
+ * no malloc, no locks, only write(2) on raw file descriptors.
+ * */
+#include "crash_handler.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <signal.h>
+
+#if !defined(WIN32) && !defined(_WIN32)
+	#include <stdlib.h>
+	#include <unistd.h>
+#endif
+#ifndef DISABLE_THREAD_SAFETY
+	#include "tPLThread.h"
+#endif
+
+/** The offset of the local time from UTC in seconds, computed when the crash handler
+ * is installed, since localtime() cannot be called from a signal handler. */
+static long sUtcOffset = 0;
+
+/* helper functions to format the crash record, async-signal-safe. */
+static int sAppendStr(char* buf, int pos, int size, const char* s)
+{
+	while(*s && (pos < size - 1))
+		buf[pos++] = *s++;
+	return pos;
+}
+
+static int sAppendNum(char* buf, int pos, int size, long val, int width)
+{
+	char digits[24];
+	int n = 0;
+	unsigned long v = (val < 0) ? (unsigned long)(-val) : (unsigned long)val;
+	if(val < 0)
+		pos = sAppendStr(buf, pos, size, "-");
+	do
+	{
+		digits[n++] = (char)('0' + (v % 10));
+		v /= 10;
+	} while(v && (n < (int)sizeof(digits)));
+	while((n < width) && (n < (int)sizeof(digits)))
+		digits[n++] = '0';
+	while(n && (pos < size - 1))
+		buf[pos++] = digits[--n];
+	return pos;
+}
+
+/* helper function to append a JSON string without its quotes, characters which need 
+ * an escape sequence are replaced, this is only used for the module name. */
+static int sAppendJsonStr(char* buf, int pos, int size, const char* s)
+{
+	while(*s && (pos < size - 1))
+	{
+		unsigned char c = (unsigned char)*s++;
+		buf[pos++] = ((c < 0x20) || (c == '"') || (c == '\\')) ? '?' : (char)c;
+	}
+	return pos;
+}
+
+/* helper function to format the date time as LLGetCurDateTime() does, without localtime(). */
+static int sAppendDateTime(char* buf, int pos, int size)
+{
+	long t = (long)time(NULL) + sUtcOffset;
+	long days = t / 86400;
+	long secs = t % 86400;
+	long z, era, doe, yoe, doy, mp, d, m, y;
+	if(secs < 0)
+	{
+		secs += 86400;
+		days--;
+	}
+	/* days since epoch to the civil date. */
+	z = days + 719468;
+	era = (z >= 0 ? z : z - 146096) / 146097;
+	doe = z - era * 146097;
+	yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+	doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+	mp = (5 * doy + 2) / 153;
+	d = doy - (153 * mp + 2) / 5 + 1;
+	m = (mp < 10) ? mp + 3 : mp - 9;
+	y = yoe + era * 400 + (m <= 2);
+
+	pos = sAppendNum(buf, pos, size, y, 4);
+	pos = sAppendStr(buf, pos, size, "-");
+	pos = sAppendNum(buf, pos, size, m, 2);
+	pos = sAppendStr(buf, pos, size, "-");
+	pos = sAppendNum(buf, pos, size, d, 2);
+	pos = sAppendStr(buf, pos, size, " ");
+	pos = sAppendNum(buf, pos, size, secs / 3600, 2);
+	pos = sAppendStr(buf, pos, size, ":");
+	pos = sAppendNum(buf, pos, size, (secs / 60) % 60, 2);
+	pos = sAppendStr(buf, pos, size, ":");
+	pos = sAppendNum(buf, pos, size, secs % 60, 2);
+	return pos;
+}
+
+/* helper function to get the name of a signal, strsignal() is not async-signal-safe. */
+static const char* sSignalName(int signum)
+{
+	switch(signum)
+	{
+		case SIGSEGV:	return "SIGSEGV";
+		case SIGABRT:	return "SIGABRT";
+		case SIGFPE:	return "SIGFPE";
+		case SIGILL:	return "SIGILL";
+#ifdef SIGBUS
+		case SIGBUS:	return "SIGBUS";
+#endif
+		default:		return "unknown";
+	}
+}
+
+/* Formats the final record emitted when a fatal signal is caught. */
+int LLFormatCrashRecord(char* buf, int bufSize, const char* moduleName, int signum, tOutputFormat format)
+{
+	int pos = 0;
+	if(!buf || (bufSize <= 0))
+		return 0;
+	if(OutputFormatJson == format)
+	{
+		pos = sAppendStr(buf, pos, bufSize, "{\"ts\":\"");
+		pos = sAppendDateTime(buf, pos, bufSize);
+		pos = sAppendStr(buf, pos, bufSize, "\",\"level\":\"Fatal\",\"module\":\"");
+		pos = sAppendJsonStr(buf, pos, bufSize, moduleName ? moduleName : "");
+		pos = sAppendStr(buf, pos, bufSize, "\",\"msg\":\"caught signal ");
+		pos = sAppendNum(buf, pos, bufSize, signum, 0);
+		pos = sAppendStr(buf, pos, bufSize, " (");
+		pos = sAppendStr(buf, pos, bufSize, sSignalName(signum));
+		pos = sAppendStr(buf, pos, bufSize, ")\",\"signal\":");
+		pos = sAppendNum(buf, pos, bufSize, signum, 0);
+		pos = sAppendStr(buf, pos, bufSize, "}");
+		buf[pos] = 0;
+		return pos;
+	}
+	pos = sAppendStr(buf, pos, bufSize, "[");
+	pos = sAppendDateTime(buf, pos, bufSize);
+	pos = sAppendStr(buf, pos, bufSize, "] [F] ");
+	pos = sAppendStr(buf, pos, bufSize, moduleName ? moduleName : "");
+	pos = sAppendStr(buf, pos, bufSize, "::liblogger - caught signal ");
+	pos = sAppendNum(buf, pos, bufSize, signum, 0);
+	pos = sAppendStr(buf, pos, bufSize, " (");
+	pos = sAppendStr(buf, pos, bufSize, sSignalName(signum));
+	pos = sAppendStr(buf, pos, bufSize, ")");
+	buf[pos] = 0;
+	return pos;
+}
+
+#if !defined(WIN32) && !defined(_WIN32)
+
+/** The signals handled by the crash handler. */
+static const int sCrashSignals[] = { SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT };
+#define NUM_CRASH_SIGNALS	((int)(sizeof(sCrashSignals) / sizeof(sCrashSignals[0])))
+
+/** The dispositions in place before the crash handler was installed. */
+static struct sigaction sOldActions[NUM_CRASH_SIGNALS];
+static int sInstalled = 0;
+/** Set once a fatal signal is being handled, to avoid recursing if draining crashes. */
+static volatile sig_atomic_t sInCrash = 0;
+/** The size of the alternate signal stacks, so that a stack overflow can still be reported. */
+#define ALT_STACK_SIZE	((SIGSTKSZ < 65536) ? 65536 : SIGSTKSZ)
+/** The alternate stack of the thread which called InitCrashHandler(). */
+static void* sAltStack = 0;
+#ifndef DISABLE_THREAD_SAFETY
+/** Non zero once the other threads install their alternate stack, see \ref LLCrashThreadInit. */
+static volatile int sThreadAltStacks = 0;
+/** The key whose destructor releases the alternate stack of an exiting thread. */
+static tPLThreadKey sAltStackKey = 0;
+/** Non zero once the calling thread has been through \ref LLCrashThreadInit. */
+static PL_THREAD_LOCAL int sThreadAltStackDone = 0;
+#endif
+
+/* helper function to install an alternate signal stack for the calling thread, unless it
+ * already has one. Returns the stack allocated, NULL if none is. */
+static void* sInstallAltStack(void)
+{
+	stack_t ss;
+	if((0 == sigaltstack(NULL, &ss)) && !(ss.ss_flags & SS_DISABLE))
+		return NULL;
+	memset(&ss, 0, sizeof(ss));
+	ss.ss_size = ALT_STACK_SIZE;
+	ss.ss_sp = malloc(ss.ss_size);
+	if(ss.ss_sp && (0 == sigaltstack(&ss, NULL)))
+		return ss.ss_sp;
+	free(ss.ss_sp);
+	return NULL;
+}
+
+#ifndef DISABLE_THREAD_SAFETY
+/* helper function to uninstall and release the alternate stack of an exiting thread. */
+static void sReleaseAltStack(void* stack)
+{
+	stack_t ss;
+	if((0 == sigaltstack(NULL, &ss)) && (ss.ss_sp == stack))
+	{
+		memset(&ss, 0, sizeof(ss));
+		ss.ss_flags = SS_DISABLE;
+		sigaltstack(&ss, NULL);
+	}
+	free(stack);
+}
+#endif
+
+/* Install the alternate stack of the calling thread. */
+void LLCrashThreadInit(void)
+{
+#ifndef DISABLE_THREAD_SAFETY
+	void* stack;
+	if(sThreadAltStackDone || !sThreadAltStacks)
+		return;
+	sThreadAltStackDone = 1;
+	stack = sInstallAltStack();
+	if(stack && PLSetThreadKey(sAltStackKey, stack))
+		sReleaseAltStack(stack);
+#endif
+}
+
+/** The signal handler. */
+static void sCrashSignalHandler(int signum)
+{
+	int i;
+	if(!sInCrash)
+	{
+		LogWriter* lw = LLGetLogWriter();
+		sInCrash = 1;
+		if(lw && lw->crashFlush)
+			lw->crashFlush(lw, signum);
+	}
+	/* restore the previous disposition and re-raise, so that the default action
+	 * (core dump) or the handler of the application still runs. */
+	for(i = 0; i < NUM_CRASH_SIGNALS; i++)
+	{
+		if(sCrashSignals[i] == signum)
+			sigaction(signum, &sOldActions[i], NULL);
+	}
+	raise(signum);
+}
+
+/* Install the crash handler. */
+int InitCrashHandler(void)
+{
+	struct sigaction sa;
+	time_t now;
+	struct tm lt, gt;
+	int i;
+
+	if(sInstalled)
+		return 0;
+
+	/* note down the UTC offset, used to format the date in the crash record. */
+	now = time(NULL);
+	lt = *localtime(&now);
+	gt = *gmtime(&now);
+	gt.tm_isdst = lt.tm_isdst;
+	sUtcOffset = (long)difftime(now, mktime(&gt));
+
+	if(!sAltStack)
+		sAltStack = sInstallAltStack();
+#ifndef DISABLE_THREAD_SAFETY
+	/* the other threads install theirs as they log, the key is never destroyed : the
+	 * threads release their stack as they exit, after DeInitCrashHandler() too. */
+	if(!sAltStackKey && PLCreateThreadKey(&sAltStackKey, sReleaseAltStack))
+		fprintf(stderr, "[liblogger] could not create the alternate stacks of the threads\n");
+	sThreadAltStackDone = 1;
+	sThreadAltStacks = (sAltStackKey != 0);
+#endif
+
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = sCrashSignalHandler;
+	sigemptyset(&sa.sa_mask);
+	sa.sa_flags = SA_ONSTACK;
+	for(i = 0; i < NUM_CRASH_SIGNALS; i++)
+	{
+		if(-1 == sigaction(sCrashSignals[i], &sa, &sOldActions[i]))
+		{
+			fprintf(stderr, "[liblogger] could not install crash handler for signal %d\n", sCrashSignals[i]);
+			while(--i >= 0)
+				sigaction(sCrashSignals[i], &sOldActions[i], NULL);
+			return -1;
+		}
+	}
+	sInstalled = 1;
+	return 0;
+}
+
+/* Uninstall the crash handler. */
+void DeInitCrashHandler(void)
+{
+	int i;
+	if(!sInstalled)
+		return;
+	for(i = 0; i < NUM_CRASH_SIGNALS; i++)
+		sigaction(sCrashSignals[i], &sOldActions[i], NULL);
+	sInstalled = 0;
+	/* the alternate stacks stay installed until their thread exits. */
+#ifndef DISABLE_THREAD_SAFETY
+	sThreadAltStacks = 0;
+#endif
+}
+
+#else
+
+/* Install the crash handler. */
+int InitCrashHandler(void)
+{
+	fprintf(stderr, "[liblogger] crash handler is not supported on this platform\n");
+	return -1;
+}
+
+/* Uninstall the crash handler. */
+void DeInitCrashHandler(void)
+{
+}
+
+/* There is no alternate stack to install. */
+void LLCrashThreadInit(void)
+{
+}
+
+#endif // WIN32
@@ -0,0 +1,49 @@
+/*
+       Licensed to the Apache Software Foundation (ASF) under one
+       or more contributor license agreements.  See the NOTICE file
+       distributed with this work for additional information
+       regarding copyright ownership.  The ASF licenses this file
+       to you under the Apache License, Version 2.0 (the
+       "License"); you may not use this file except in compliance
+       with the License.  You may obtain a copy of the License at
+
+         http://www.apache.org/licenses/LICENSE-2.0
+
+       Unless required by applicable law or agreed to in writing,
+       software distributed under the License is distributed on an
+       "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+       KIND, either express or implied.  See the License for the
+       specific language governing permissions and limitations
+       under the License.
+ */
+#ifndef __CRASH_HANDLER_H__
+#define __CRASH_HANDLER_H__
+
+#include <liblogger/liblogger.h>
+#include <liblogger/logger_object.h>
+
+/** Returns the log writer currently in use (NULL if the logger is not
+ * initialized), used by the crash handler. Defined in liblogger.c
+ * */
+LogWriter* LLGetLogWriter(void);
+
+/** Formats the final record emitted when a fatal signal is caught,
+ * "[date] [F] module::liblogger - caught signal 11 (SIGSEGV)"
+ * without a line break. Async-signal-safe.
+ * \param [out] buf			The buffer where the record is formatted.
+ * \param [in]	bufSize		The size of \a buf.
+ * \param [in]	moduleName	The log module name.
+ * \param [in]	signum		The signal caught.
+ * \param [in]	format		The output format of the log writer.
+ * \returns the length of the record.
+ * */
+int LLFormatCrashRecord(char* buf, int bufSize, const char* moduleName, int signum, tOutputFormat format);
+
+/** Installs the alternate signal stack of the calling thread if the crash handler is
+ * installed and the thread has none, so that its stack overflows are reported too. Called
+ * as the threads log, does nothing after the first call of a thread. The stack is released
+ * when the thread exits.
+ * */
+void LLCrashThreadInit(void);
+
+#endif // __CRASH_HANDLER_H__
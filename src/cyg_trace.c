@@ -0,0 +1,44 @@
+/*
+       Licensed to the Apache Software Foundation (ASF) under one
+       or more contributor license agreements.  See the NOTICE file
+       distributed with this work for additional information
+       regarding copyright ownership.  The ASF licenses this file
+       to you under the Apache License, Version 2.0 (the
+       "License"); you may not use this file except in compliance
+       with the License.  You may obtain a copy of the License at
+
+         http://www.apache.org/licenses/LICENSE-2.0
+
+       Unless required by applicable law or agreed to in writing,
+       software distributed under the License is distributed on an
+       "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+       KIND, either express or implied.  See the License for the
+       specific language governing permissions and limitations
+       under the License.
+ */
+/**
+ * \file The logger-trace library : the hooks called by the code built with
+ * -finstrument-functions, they capture the entry / exit of each instrumented function
+ * once \ref InitFuncTrace is called, see \ref GRP_FUNC_TRACE.
+ * This is a separate library, so that linking liblogger alone never defines the hooks.
+ * */
+#include "trace_buffer.h"
+
+#define NO_INSTRUMENT	__attribute__((no_instrument_function))
+
+void __cyg_profile_func_enter(void* func, void* callSite) NO_INSTRUMENT;
+void __cyg_profile_func_exit(void* func, void* callSite) NO_INSTRUMENT;
+
+/* Called on the entry of an instrumented function. */
+void __cyg_profile_func_enter(void* func, void* callSite)
+{
+	(void)callSite;
+	LLTraceAddr(LL_TRACE_ADDR_BEGIN, func);
+}
+
+/* Called on the exit of an instrumented function. */
+void __cyg_profile_func_exit(void* func, void* callSite)
+{
+	(void)callSite;
+	LLTraceAddr(LL_TRACE_ADDR_END, func);
+}
@@ -17,19 +17,55 @@
        under the License.
  */
 #include "file_logger_impl.h"
+#include "crash_handler.h"
+#include "async_queue.h"
+#include "repeat_filter.h"
+#include "json_encoder.h"
+#include "binary_log.h"
+#include "compressed_log.h"
+#include "log_context.h"
+#include "group_commit.h"
+#include "blob_encoder.h"
+#include "prefix_cache.h"
+#include "layout.h"
 #include "LLTimeUtil.h"
+#include "tPLFile.h"
+#include "tPLAsyncFile.h"
+#include <win32_support.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
 #include <memory.h>
 
 /** Default log file name, if InitLogger() is not done and a 
   logger function is directly called. */
 #define FILE_NAME_LOG "NoNameLogFile.txt"
 #define MAX_PATH 255
+/** The size of the buffer in which a record is assembled before it is written,
+ * records which do not fit are handed to stdio directly. */
+#define RECORD_BUF_MAX 4096
+/** The size of the queue of a compressed log, if asynchronous logging is not configured. */
+#define COMPRESS_QUEUE_SIZE (256 * 1024)
+/** The minimum of \ref tFileLoggerInitParams::atomicWriteSize. */
+#define ATOMIC_WRITE_MIN 512
+/** The size of the buffers of io_uring, see \ref tFileLoggerInitParams::ioUringDepth. */
+#define URING_BUFFER_SIZE (256 * 1024)
+/** The size of the queue with io_uring, if asynchronous logging is not configured. */
+#define URING_QUEUE_SIZE (256 * 1024)
+/** The batches are coalesced in a buffer of io_uring while a chain of writes is in flight,
+ * for at most this time in ms. */
+#define URING_FLUSH_MS 2
 
 /* win32 support */
 #ifdef _WIN32
-	#define  vsnprintf(buf,buf_size,fmt,ap) _vsnprintf(buf,buf_size,fmt,ap);
+	#define  vsnprintf(buf,buf_size,fmt,ap) _vsnprintf(buf,buf_size,fmt,ap)
 	#define	inline __inline
+	#define fileno _fileno
+#endif
+
+#ifndef va_copy
+	#define va_copy(dst,src) ((dst) = (src))
 #endif
 
 /** Helper function to write the logs to file */
@@ -41,6 +77,25 @@ static int sWriteToFile(LogWriter *_this,
 #endif
 		const char* fmt,va_list ap);
 
+/** File Logger object function to log a record with key / value fields. */
+static int sWriteKVToFile(LogWriter *_this,const LogLevel logLevel,
+		const char* moduleName,
+		const char* file,const char* funcName, const int lineNum, 
+		const char* msg,va_list fields);
+
+/** File Logger object function to log a record followed by a payload. */
+static int sWriteBlobToFile(LogWriter *_this,const LogLevel logLevel,
+		const char* moduleName,
+		const char* file,const char* funcName, const int lineNum, 
+		int encoding,const void* data,int len,
+		const char* fmt,va_list ap);
+
+/** File Logger object function to log a message which is not a format. */
+static int sWriteStrToFile(LogWriter *_this,const LogLevel logLevel,
+		const char* moduleName,
+		const char* file,const char* funcName, const int lineNum, 
+		const char* fmt,const char* msg,int len);
+
 /** File Logger object function to log function entry */
 static int sFileFuncLogEntry(LogWriter *_this,const char* funcName);
 
@@ -51,6 +106,21 @@ static int sFileFuncLogExit(LogWriter * _this,
 /** File Logger object function deinitialization function */
 static int sFileLoggerDeInit(LogWriter* _this);
 
+/** File Logger object function to flush the log file to the storage device. */
+static int sFileLoggerSync(LogWriter* _this);
+
+/** File Logger object function to drain the pending record from a signal handler. */
+static int sFileLoggerCrashFlush(LogWriter* _this,int signum);
+
+/** File Logger object function called around fork(). */
+static int sFileLoggerAtFork(LogWriter* _this,int phase);
+
+/** File Logger object function to wait until the records logged so far are on the storage device. */
+static int sFileLoggerCommit(LogWriter* _this);
+
+/** File Logger object function to get the statistics of the durable records. */
+static int sFileLoggerCommitStats(LogWriter* _this,tLogDurableStats* stats);
+
 /* helper function to get the log prefix , the log prefix is added to help in greping*/
 static const char* sGetLogPrefix(const LogLevel logLevel);
 
@@ -66,6 +136,49 @@ typedef struct FileLogWriter
 #endif // _ENABLE_LL_ROLLBACK_
 	/** The log file pointer. */
 	FILE		*fp;
+	/** The file descriptor of \ref fp, used by the crash handler. */
+	int			fd;
+	/** The queue of the background writer thread, NULL when logging synchronously. */
+	LLAsyncQueue	*queue;
+	/** The filter of repeated records. */
+	LLRepeatFilter	repeats;
+	/** The output format. */
+	tOutputFormat	outputFormat;
+	/** Non zero to add the context of the logging thread to the records. */
+	int			includeContext;
+	/** The call site dictionary of \ref OutputFormatBinary. */
+	LLBinEncoder	bin;
+	/** The number of records dropped by the queue, when the call sites were last defined. */
+	unsigned long	binDrops;
+	/** Non zero if the log is compressed, see \ref tFileLoggerInitParams::compressBlockSize. */
+	int			compress;
+	/** The index of the compressed log. */
+	FILE		*idxFp;
+	/** The writer of the compressed log, used by the background writer thread. */
+	LLCompressedLog	lz;
+	/** Non zero to write each record with a single write(2), see
+	 * \ref tFileLoggerInitParams::atomicWriteSize. */
+	unsigned int	atomicWriteSize;
+	/** The buffer where a record longer than \ref atomicWriteSize is truncated. */
+	char		*atomicBuf;
+	/** The group commit of the durable records. */
+	LLGroupCommit	commit;
+	/** The log written with io_uring by the background writer thread, NULL with stdio. */
+	tPLAsyncFile	uring;
+	/** The time the data pending in \ref uring was first held back, 0 if none is. */
+	unsigned long long	uringFirstNs;
+	/** The buffer where the payloads of the blob records are encoded / escaped. */
+	LLBlobBuf	blobBuf;
+	/** The prefixes of the text records, rendered once per call site. */
+	LLPrefixCache	prefixes;
+	/** The layout of the text records, see \ref tFileLoggerInitParams::layout. */
+	LLLayout	layout;
+	/** The length of the record pending in \ref buf, which is not yet handed to stdio / queued. */
+	volatile int	bufLen;
+	/** The buffer where a record is assembled. */
+	char		buf[RECORD_BUF_MAX];
+	/** The buffer where the message is formatted, before it is encoded as JSON. */
+	char		msgBuf[RECORD_BUF_MAX];
 }FileLogWriter;
 
 #ifdef _ENABLE_LL_ROLLBACK_
@@ -73,6 +186,104 @@ typedef struct FileLogWriter
 static void __CHECK_AND_ROLLBACK(FileLogWriter* flw);
 #endif // _ENABLE_LL_ROLLBACK_
 
+/** helper function to start the background writer thread, if asynchronous logging is enabled. */
+static void sStartAsyncWriter(FileLogWriter* flw,const tAsyncLogParams* asyncParams);
+
+/** helper function to hand the record assembled in flw->buf to the queue or to stdio. */
+static int sEmitRecord(FileLogWriter* flw,const LogLevel logLevel,int len);
+
+/** helper function to write the summary of the repeated records suppressed so far. */
+static void sWriteRepeatSummary(FileLogWriter* flw);
+
+/** helper function to write the summary of the repeated records when a repeat is suppressed,
+ * if the repeats wait for too long. \returns 0, the length of the suppressed record. */
+static int sWriteDueRepeatSummary(FileLogWriter* flw);
+
+/** helper function to write the line marking the start of the log. */
+static void sWriteBanner(FileLogWriter* flw,const char* curDateTime);
+
+/** helper function to compile the layout of the text records, the built-in layout is used
+ * if \a layout is NULL or invalid. */
+static void sSetLayout(FileLogWriter* flw,const char* layout);
+
+/** helper function to start compressing the log, the records are then compressed by the
+ * background writer thread, which is started if asynchronous logging is not configured.
+ * */
+static int sOpenCompressedLog(FileLogWriter* flw,const tFileLoggerInitParams* initParams,
+		tAsyncLogParams* asyncParams);
+
+/** helper function to write data to the log, before the background writer thread starts or
+ * from a signal handler.
+ * */
+static void sWriteDirect(FileLogWriter* flw,const char* data,int len,int fromSignal);
+
+/** helper function to encode a record as JSON in flw->buf and to emit it. */
+static int sEmitJsonRecord(FileLogWriter* flw,const LogLevel logLevel,
+		const char* file,const char* funcName,const int lineNum,
+		const char* msg,int msgLen,va_list* fields);
+
+/** helper function to emit a binary record encoded in flw->buf.
+ * \param [in] len			The length of the record, -1 if it could not be encoded.
+ * \param [in] bodyOffset	The offset of the part compared to find the repeated records.
+ * */
+static int sEmitBinaryRecord(FileLogWriter* flw,const LogLevel logLevel,
+		const char* file,const int lineNum,int len,int bodyOffset);
+
+/** helper function to get the context of the thread and the notes of the record, for the binary records. */
+static const char* sBinaryContext(FileLogWriter* flw,int* len);
+
+/** helper function to write a record with a single write(2), see \ref tFileLoggerInitParams::atomicWriteSize. */
+static int sWriteAtomic(FileLogWriter* flw,const char* data,int len);
+
+/** helper function to sync the records written so far, for the group commit. */
+static int sCommitSync(void* ctx);
+
+/** helper function to format the head of a blob record in flw->buf, up to the payload.
+ * \returns the length of the head.
+ * */
+static int sFormatBlobHead(FileLogWriter* flw,const LogLevel logLevel,
+		const char* moduleName,const char* file,const char* funcName,const int lineNum,
+		int encoding,int len,const char* fmt,va_list ap);
+
+/** helper function to write a blob record of the binary output format, the payload is
+ * appended to the message. */
+static int sWriteBinaryBlob(FileLogWriter* flw,const LogLevel logLevel,
+		const char* file,const char* funcName,const int lineNum,
+		int encoding,const void* data,int len,const char* fmt,va_list ap);
+
+/** helper function to hand a record made of parts to the queue, or to write it with a
+ * single writev(2). */
+static int sEmitParts(FileLogWriter* flw,const LogLevel logLevel,const LLRecordPart* parts,int numParts);
+
+/** helper function to format the head of a text record in flw->buf, up to the message :
+ * the layout, or the prefix followed by the context.
+ * \param [in]  file		The source file of the call site, NULL for the records without call site.
+ * \param [out] bodyOffset	The offset of the part compared to find the repeated records.
+ * \returns the length of the head.
+ * */
+static int sFormatHead(FileLogWriter* flw,const LogLevel logLevel,const char* moduleName,
+		const char* file,const char* funcName,const int lineNum,int* bodyOffset);
+
+/** helper function to format the end of a text record to \a tail (\ref LL_LAYOUT_TAIL_MAX + 1
+ * bytes) : the tail of the layout and the newline.
+ * \returns the length of the end of the record.
+ * */
+static int sFormatTail(FileLogWriter* flw,char* tail,const LogLevel logLevel,const char* moduleName,
+		const char* file,const char* funcName,const int lineNum);
+
+/** helper function to format a record without call site with the layout : the head, \a msg
+ * and the end of the record, truncated to \a size bytes (more than \ref LL_LAYOUT_TAIL_MAX).
+ * \returns the length of the record.
+ * */
+static int sFormatLayoutRecord(FileLogWriter* flw,char* out,int size,const LogLevel logLevel,
+		const char* funcName,const int lineNum,const char* msg,int msgLen);
+
+/** helper function to log a constant format with \ref sWriteToFile. */
+static int sWriteFormat(LogWriter *_this,const LogLevel logLevel,
+		const char* moduleName,
+		const char* file,const char* funcName, const int lineNum, 
+		const char* fmt,...);
+
 static FileLogWriter sFileLogWriter = 
 {
 	{
@@ -82,11 +293,40 @@ static FileLogWriter sFileLogWriter =
 		/*.base.logFuncEntry	= */sFileFuncLogEntry,
 		/*.base.logFuncExit	= */sFileFuncLogExit,
 		/*.base.loggerDeInit	= */sFileLoggerDeInit,
+		/*.base.sync		= */sFileLoggerSync,
+		/*.base.crashFlush	= */sFileLoggerCrashFlush,
+		/*.base.logKV		= */sWriteKVToFile,
+		/*.base.atFork		= */sFileLoggerAtFork,
+		/*.base.commit		= */sFileLoggerCommit,
+		/*.base.commitStats	= */sFileLoggerCommitStats,
+		/*.base.logBlob		= */sWriteBlobToFile,
+		/*.base.logStr		= */sWriteStrToFile,
 	},
 #ifdef _ENABLE_LL_ROLLBACK_
 	/*.rollbackSize		= */ 0,
 #endif // _ENABLE_LL_ROLLBACK_
-		/* .fp					= */ 0
+		/* .fp					= */ 0,
+		/* .fd					= */ -1,
+		/* .queue				= */ 0,
+		/* .repeats				= */ {0},
+		/* .outputFormat		= */ OutputFormatText,
+		/* .includeContext	= */ 0,
+		/* .bin					= */ {0},
+		/* .binDrops			= */ 0,
+		/* .compress			= */ 0,
+		/* .idxFp				= */ 0,
+		/* .lz					= */ {0},
+		/* .atomicWriteSize		= */ 0,
+		/* .atomicBuf			= */ 0,
+		/* .commit				= */ {0},
+		/* .uring				= */ 0,
+		/* .uringFirstNs		= */ 0,
+		/* .blobBuf				= */ {0},
+		/* .prefixes			= */ {0},
+		/* .layout				= */ {0},
+		/* .bufLen				= */ 0,
+		/* .buf					= */ {0},
+		/* .msgBuf				= */ {0}
 };
 
 /* Function to initialize the console logger, a console logger is a special case of file logger, 
@@ -109,6 +349,12 @@ int InitConsoleLogger(LogWriter** logWriter,tConsoleLoggerInitParams* initParams
 
 	if (initParams->logLevel != Disable)
 	{
+	    sFileLogWriter.outputFormat = initParams->outputFormat;
+	    if (OutputFormatBinary == initParams->outputFormat)
+	    {
+		fprintf(stderr,"The binary output format is not supported by the console logger, text will be used.\n");
+		sFileLogWriter.outputFormat = OutputFormatText;
+	    }
 	    if (initParams->consoleDest == ConsoleDestStdout)
 	    {
 		sFileLogWriter.fp = stdout;
@@ -122,15 +368,21 @@ int InitConsoleLogger(LogWriter** logWriter,tConsoleLoggerInitParams* initParams
 		fprintf(stderr,"Incorrect init params for console logger, stdout will be used.\n");
 		sFileLogWriter.fp = stdout;
 	    }
+	    sFileLogWriter.fd = fileno(sFileLogWriter.fp);
 #ifdef _ENABLE_LL_ROLLBACK_
 	    sFileLogWriter.rollbackSize = 0;
 #endif // _ENABLE_LL_ROLLBACK_
 	    if( !LLGetCurDateTime(curDateTime,sizeof(curDateTime)) )
-		    fprintf(sFileLogWriter.fp,"\n----- Logging Started on %s -----\n", curDateTime);
+		    sWriteBanner(&sFileLogWriter,curDateTime);
+	    sStartAsyncWriter(&sFileLogWriter,&initParams->asyncParams);
+	    LLGroupCommitInit(&sFileLogWriter.commit,sCommitSync,&sFileLogWriter,0);
 	}
 
 	/* Set log level */
 	sFileLogWriter.base.logLevel = initParams->logLevel;
+	sFileLogWriter.repeats.enabled = initParams->suppressRepeats;
+	sFileLogWriter.includeContext = initParams->includeContext;
+	sSetLayout(&sFileLogWriter,initParams->layout);
 
 	/* Set log module name */
 	if (initParams->moduleName)
@@ -180,26 +432,92 @@ int InitFileLogger(LogWriter** logWriter,tFileLoggerInitParams* initParams)
 		default:			fileOpenMode = "w"; break;
 	}
 
+	/* Set log module name, before the session record of a binary log. */
+	if (initParams->moduleName)
+	{
+	    strncpy(sFileLogWriter.base.moduleName, initParams->moduleName, sizeof(sFileLogWriter.base.moduleName) - 1);
+	    sFileLogWriter.base.moduleName[sizeof(sFileLogWriter.base.moduleName) - 1] = '\0';
+	}
+
 	if (initParams->logLevel != Disable)
 	{
+		sFileLogWriter.outputFormat = initParams->outputFormat;
+		if((OutputFormatBinary == initParams->outputFormat) || initParams->compressBlockSize)
+		{
+			/* a binary or compressed log is never rewritten in place, the sessions are appended. */
+			fileOpenMode = (AppendMode == initParams->fileOpenMode) ? "ab" : "wb";
+#ifdef _ENABLE_LL_ROLLBACK_
+			if(RollbackMode == initParams->fileOpenMode)
+				fprintf(stderr,"The rollback mode is not supported with the binary output format or compression, the log is overwritten.\n");
+#endif // _ENABLE_LL_ROLLBACK_
+		}
+		sFileLogWriter.atomicWriteSize = initParams->atomicWriteSize;
+		if(sFileLogWriter.atomicWriteSize && ((OutputFormatBinary == initParams->outputFormat) || initParams->compressBlockSize))
+		{
+			fprintf(stderr,"The atomic writes are not supported with the binary output format or compression, stdio will be used.\n");
+			sFileLogWriter.atomicWriteSize = 0;
+		}
+		if(sFileLogWriter.atomicWriteSize)
+		{
+			/* the records are appended with O_APPEND, the log is truncated first if needed. */
+			if(AppendMode != initParams->fileOpenMode)
+			{
+				FILE* fp = fopen(initParams->fileName,"w");
+				if(fp)
+					fclose(fp);
+			}
+			fileOpenMode = "a";
+			if(sFileLogWriter.atomicWriteSize < ATOMIC_WRITE_MIN)
+				sFileLogWriter.atomicWriteSize = ATOMIC_WRITE_MIN;
+			sFileLogWriter.atomicBuf = (char*)malloc(sFileLogWriter.atomicWriteSize);
+			if(!sFileLogWriter.atomicBuf)
+			{
+				sFileLogWriter.atomicWriteSize = 0;
+				return -1;
+			}
+		}
+		if(OutputFormatBinary == initParams->outputFormat)
+		{
+			if(LLBinEncoderInit(&sFileLogWriter.bin))
+				return -1;
+			sFileLogWriter.binDrops = 0;
+			/* the stack traces and the suppressed counts do not make new call sites. */
+			sFileLogWriter.base.notesApart = 1;
+		}
 		sFileLogWriter.fp = fopen(initParams->fileName,fileOpenMode);
 		if( !sFileLogWriter.fp )
 		{
 			fprintf(stderr,"could not open log file %s",initParams->fileName);
+			free(sFileLogWriter.atomicBuf);
+			sFileLogWriter.atomicBuf = 0;
+			sFileLogWriter.atomicWriteSize = 0;
+			if(OutputFormatBinary == initParams->outputFormat)
+			{
+				LLBinEncoderDestroy(&sFileLogWriter.bin);
+				sFileLogWriter.base.notesApart = 0;
+			}
 			return -1;
 		}
 		else
 		{
 			/* file open success. */
 			char curDateTime[32];	
+			tAsyncLogParams asyncParams = initParams->asyncParams;
+			sFileLogWriter.fd = fileno(sFileLogWriter.fp);
+			if( initParams->compressBlockSize && sOpenCompressedLog(&sFileLogWriter,initParams,&asyncParams) )
+			{
+				sFileLoggerDeInit((LogWriter*)&sFileLogWriter);
+				return -1;
+			}
 			if( !LLGetCurDateTime(curDateTime,sizeof(curDateTime)) )
-				fprintf(sFileLogWriter.fp,"\n----- Logging Started on %s -----\n", curDateTime);
+				sWriteBanner(&sFileLogWriter,curDateTime);
 
 #ifdef _ENABLE_LL_ROLLBACK_
 			/* if the file open is successful, and rollback mode is specified, note down the
 			 * rollback size. 
 			 * */
-			if(RollbackMode == initParams->fileOpenMode)
+			if( (RollbackMode == initParams->fileOpenMode) && (OutputFormatBinary != initParams->outputFormat)
+					&& !initParams->compressBlockSize && !sFileLogWriter.atomicWriteSize )
 			{
 				sFileLogWriter.rollbackSize = initParams->rollbackSize;
 				fseek(sFileLogWriter.fp,0L,SEEK_END);
@@ -208,18 +526,32 @@ int InitFileLogger(LogWriter** logWriter,tFileLoggerInitParams* initParams)
 			else
 				sFileLogWriter.rollbackSize = 0;
 #endif // _ENABLE_LL_ROLLBACK_
+			if(initParams->ioUringDepth && (sFileLogWriter.compress || sFileLogWriter.atomicWriteSize))
+				fprintf(stderr,"io_uring is not supported with compression nor the atomic writes, stdio will be used.\n");
+			else if(initParams->ioUringDepth)
+			{
+				fflush(sFileLogWriter.fp);
+				if(PLAsyncFileOpen(&sFileLogWriter.uring,sFileLogWriter.fd,(int)initParams->ioUringDepth,URING_BUFFER_SIZE))
+					fprintf(stderr,"[liblogger] io_uring is not available, the log is written with stdio\n");
+				else if(!asyncParams.queueSize)
+					asyncParams.queueSize = URING_QUEUE_SIZE;
+			}
+			sStartAsyncWriter(&sFileLogWriter,&asyncParams);
+			if(sFileLogWriter.compress && !sFileLogWriter.queue)
+			{
+				fprintf(stderr,"[liblogger] the log can not be compressed without the background writer thread\n");
+				sFileLoggerDeInit((LogWriter*)&sFileLogWriter);
+				return -1;
+			}
+			LLGroupCommitInit(&sFileLogWriter.commit,sCommitSync,&sFileLogWriter,initParams->durableWindowMs);
 		}
 	}
 
 	/* Set log level */
 	sFileLogWriter.base.logLevel = initParams->logLevel;
-
-	/* Set log module name */
-	if (initParams->moduleName)
-	{
-	    strncpy(sFileLogWriter.base.moduleName, initParams->moduleName, sizeof(sFileLogWriter.base.moduleName) - 1);
-	    sFileLogWriter.base.moduleName[sizeof(sFileLogWriter.base.moduleName) - 1] = '\0';
-	}
+	sFileLogWriter.repeats.enabled = initParams->suppressRepeats;
+	sFileLogWriter.includeContext = initParams->includeContext;
+	sSetLayout(&sFileLogWriter,initParams->layout);
 
 	/* Log the current date time when the log is started. */
 	*logWriter = (LogWriter*)&sFileLogWriter;
@@ -243,21 +575,517 @@ static int sWriteToFile(LogWriter *_this,
 	}
 	else
 	{
-		char curDateTime[32];
-		memset(curDateTime, 0, sizeof(curDateTime));
-		LLGetCurDateTime(curDateTime, sizeof(curDateTime));
-		fprintf(flw->fp,"[%s] %s ", curDateTime, sGetLogPrefix(logLevel));
+		char tail[LL_LAYOUT_TAIL_MAX + 1];
+		int prefixLen = 0;
+		int headLen = 0;
+		int tailLen = 0;
+		int ctxLen = 0;
+		int msgLen = 0;
+		int written = 0;
+		va_list apCopy;
+		if(OutputFormatBinary == flw->outputFormat)
+		{
+			const char* ctx = sBinaryContext(flw,&ctxLen);
+			int bodyOffset = 0;
 #ifdef VARIADIC_MACROS
-		fprintf(flw->fp,"%s::%s#%d:%s() - ",moduleName,file,lineNum,funcName);
+			int len = LLBinEncodeRecord(&flw->bin,flw->buf,RECORD_BUF_MAX,&bodyOffset,logLevel,
+					file,funcName,lineNum,fmt,ap,ctx,ctxLen);
+			return sEmitBinaryRecord(flw,logLevel,file,lineNum,len,bodyOffset);
+#else
+			int len = LLBinEncodeRecord(&flw->bin,flw->buf,RECORD_BUF_MAX,&bodyOffset,logLevel,
+					NULL,NULL,0,fmt,ap,ctx,ctxLen);
+			return sEmitBinaryRecord(flw,logLevel,NULL,0,len,bodyOffset);
 #endif
-		vfprintf(flw->fp,fmt,ap); 
-		fprintf(flw->fp,"\n");
-		fflush(flw->fp);
+		}
+		if(OutputFormatJson == flw->outputFormat)
+		{
+			/* the message is formatted first, then escaped in the record. */
+			msgLen = vsnprintf(flw->msgBuf,RECORD_BUF_MAX,fmt,ap);
+			if((msgLen < 0) || (msgLen > RECORD_BUF_MAX - 1))
+				msgLen = (int)strlen(flw->msgBuf);
+#ifdef VARIADIC_MACROS
+			return sEmitJsonRecord(flw,logLevel,file,funcName,lineNum,flw->msgBuf,msgLen,NULL);
+#else
+			return sEmitJsonRecord(flw,logLevel,NULL,NULL,0,flw->msgBuf,msgLen,NULL);
+#endif
+		}
+		/* the record is assembled in flw->buf before it is handed to stdio, so that 
+		 * the crash handler can drain it with a plain write(2). */
+#ifdef VARIADIC_MACROS
+		headLen = sFormatHead(flw,logLevel,moduleName,file,funcName,lineNum,&prefixLen);
+		tailLen = sFormatTail(flw,tail,logLevel,moduleName,file,funcName,lineNum);
+#else
+		headLen = sFormatHead(flw,logLevel,flw->base.moduleName,NULL,NULL,0,&prefixLen);
+		tailLen = sFormatTail(flw,tail,logLevel,flw->base.moduleName,NULL,NULL,0);
+#endif
+		/* the context is compared with the message. */
+		ctxLen = headLen - prefixLen;
+		va_copy(apCopy,ap);
+		msgLen = vsnprintf(flw->buf + headLen,RECORD_BUF_MAX - headLen,fmt,apCopy);
+		va_end(apCopy);
+		if(msgLen >= 0)
+			msgLen += ctxLen;
+		if((msgLen >= 0) && (prefixLen + msgLen + tailLen < RECORD_BUF_MAX))
+		{
+			/* the date time is not part of the comparison. */
+#ifdef VARIADIC_MACROS
+			if(LLRepeatFilterCheck(&flw->repeats,logLevel,file,lineNum,flw->buf + prefixLen,msgLen))
+#else
+			if(LLRepeatFilterCheck(&flw->repeats,logLevel,NULL,0,flw->buf + prefixLen,msgLen))
+#endif
+				return sWriteDueRepeatSummary(flw);
+			sWriteRepeatSummary(flw);
+			memcpy(flw->buf + prefixLen + msgLen,tail,tailLen);
+			written = prefixLen + msgLen + tailLen;
+			sEmitRecord(flw,logLevel,written);
+		}
+		else
+		{
+			/* the record does not fit in the buffer, it is not compared with the previous one. */
+			LLRepeatFilterCheck(&flw->repeats,logLevel,NULL,0,NULL,0);
+			sWriteRepeatSummary(flw);
+			if(flw->queue || flw->atomicWriteSize)
+			{
+				/* format the record in a temporary buffer. */
+				int len = (msgLen >= 0) ? (prefixLen + msgLen + tailLen) : LL_ASYNC_RECORD_MAX;
+				char* record = (char*)malloc(len + 1);
+				if(record)
+				{
+					memcpy(record,flw->buf,headLen);
+					vsnprintf(record + headLen,len + 1 - headLen - tailLen,fmt,ap);
+					len = headLen + (int)strlen(record + headLen);
+					memcpy(record + len,tail,tailLen);
+					len += tailLen;
+					if(flw->queue)
+						LLAsyncQueuePush(flw->queue,logLevel,record,len);
+					else
+						sWriteAtomic(flw,record,len);
+					free(record);
+					written = len;
+				}
+			}
+			else
+			{
+				/* let stdio format the message. */
+				flw->bufLen = headLen;
+				fwrite(flw->buf,1,headLen,flw->fp);
+				msgLen = vfprintf(flw->fp,fmt,ap); 
+				fwrite(tail,1,tailLen,flw->fp);
+				written = headLen + ((msgLen > 0) ? msgLen : 0) + tailLen;
+				fflush(flw->fp);
+				flw->bufLen = 0;
 #ifdef _ENABLE_LL_ROLLBACK_
-		__CHECK_AND_ROLLBACK(flw);
+				__CHECK_AND_ROLLBACK(flw);
 #endif // _ENABLE_LL_ROLLBACK_
+			}
+		}
+		return written;
+	}
+}
+
+/** File Logger object function to log a record with key / value fields. */
+static int sWriteKVToFile(LogWriter *_this,const LogLevel logLevel,
+		const char* moduleName,
+		const char* file,const char* funcName, const int lineNum, 
+		const char* msg,va_list fields)
+{
+	FileLogWriter *flw = (FileLogWriter*) _this;
+	if(!_this || !flw->fp || !msg)
+	{
+		fprintf(stderr,"Invalid args to sWriteKVToFile.");
+		return -1;
+	}
+	else
+	{
+		va_list fieldsCopy;
+		int written = 0;
+		va_copy(fieldsCopy,fields);
+		if(OutputFormatJson == flw->outputFormat)
+			written = sEmitJsonRecord(flw,logLevel,file,funcName,lineNum,msg,(int)strlen(msg),&fieldsCopy);
+		else if(OutputFormatBinary == flw->outputFormat)
+		{
+			/* the message and the fields are written as text, the message identifies the call site. */
+			LLOutBuf out;
+			int ctxLen = 0;
+			const char* ctx = sBinaryContext(flw,&ctxLen);
+			int bodyOffset = 0;
+			int len;
+			LLOutInit(&out,flw->msgBuf,RECORD_BUF_MAX);
+			LLOutAppend(&out,msg,(int)strlen(msg));
+			LLAppendKVFields(&out,OutputFormatText,fieldsCopy);
+			len = LLBinEncodeText(&flw->bin,flw->buf,RECORD_BUF_MAX,&bodyOffset,LL_BIN_SITE_LOG,logLevel,
+					file,funcName,lineNum,msg,flw->msgBuf,out.len,ctx,ctxLen);
+			written = sEmitBinaryRecord(flw,logLevel,file,lineNum,len,bodyOffset);
+		}
+		else
+		{
+			char tail[LL_LAYOUT_TAIL_MAX + 1];
+			int prefixLen, headLen, tailLen;
+			LLOutBuf out;
+			headLen = sFormatHead(flw,logLevel,moduleName,file,funcName,lineNum,&prefixLen);
+			tailLen = sFormatTail(flw,tail,logLevel,moduleName,file,funcName,lineNum);
+			if(headLen > RECORD_BUF_MAX - LL_OUT_RESERVE - 1 - tailLen)
+				headLen = prefixLen = 0;
+			/* the message and the fields, key=value, follow the usual prefix, the end of
+			 * the record fits in the reserve. */
+			LLOutInit(&out,flw->buf,RECORD_BUF_MAX - tailLen);
+			out.len = headLen;
+			LLOutAppend(&out,msg,(int)strlen(msg));
+			LLAppendKVFields(&out,OutputFormatText,fieldsCopy);
+			if(LLRepeatFilterCheck(&flw->repeats,logLevel,file,lineNum,flw->buf + prefixLen,out.len - prefixLen))
+				written = sWriteDueRepeatSummary(flw);
+			else
+			{
+				sWriteRepeatSummary(flw);
+				memcpy(flw->buf + out.len,tail,tailLen);
+				written = out.len + tailLen;
+				sEmitRecord(flw,logLevel,written);
+			}
+		}
+		va_end(fieldsCopy);
+		return written;
+	}
+}
+
+/** helper function to encode a record as JSON in flw->buf and to emit it. */
+static int sEmitJsonRecord(FileLogWriter* flw,const LogLevel logLevel,
+		const char* file,const char* funcName,const int lineNum,
+		const char* msg,int msgLen,va_list* fields)
+{
+	char curDateTime[32];
+	int bodyOffset;
+	LLOutBuf out;
+	memset(curDateTime, 0, sizeof(curDateTime));
+	LLGetCurDateTime(curDateTime, sizeof(curDateTime));
+	/* room is kept for the newline. */
+	LLOutInit(&out,flw->buf,RECORD_BUF_MAX - 1);
+	LLJsonAppendRecordStart(&out,curDateTime);
+	/* the date time is not part of the comparison. */
+	bodyOffset = out.len;
+	LLJsonAppendRecordInfo(&out,logLevel,flw->base.moduleName,file,funcName,lineNum);
+	if(flw->includeContext)
+		out.len += LLCopyContext(flw->buf + out.len,out.size - out.len,OutputFormatJson);
+	LLJsonAppendKey(&out,"msg");
+	LLJsonAppendString(&out,msg,msgLen);
+	if(fields)
+		LLAppendKVFields(&out,OutputFormatJson,*fields);
+	LLJsonAppendRecordEnd(&out);
+	if(LLRepeatFilterCheck(&flw->repeats,logLevel,file,lineNum,flw->buf + bodyOffset,out.len - bodyOffset))
+		return sWriteDueRepeatSummary(flw);
+	sWriteRepeatSummary(flw);
+	flw->buf[out.len] = '\n';
+	sEmitRecord(flw,logLevel,out.len + 1);
+	return out.len + 1;
+}
+
+/** File Logger object function to log a record followed by a payload. The head of the
+ * record is assembled in flw->buf, the payload of the caller is referenced as is (or encoded
+ * in flw->blobBuf) and the record is written with a single writev(2), or it is encoded
+ * straight into the queue in asynchronous mode.
+ * */
+static int sWriteBlobToFile(LogWriter *_this,const LogLevel logLevel,
+		const char* moduleName,
+		const char* file,const char* funcName, const int lineNum, 
+		int encoding,const void* data,int len,
+		const char* fmt,va_list ap)
+{
+	FileLogWriter *flw = (FileLogWriter*) _this;
+	LLRecordPart parts[3];
+	char tail[LL_BLOB_TAIL_MAX + LL_LAYOUT_TAIL_MAX + 1];
+	char end[LL_LAYOUT_TAIL_MAX + 1];
+	int headLen, maxLen, srcLen, tailLen, endLen;
+	if(!_this || !flw->fp || (len < 0) || (len && !data))
+	{
+		fprintf(stderr,"Invalid args to sWriteBlobToFile.");
+		return -1;
+	}
+	/* the blob records are not compared with the previous one. */
+	LLRepeatFilterCheck(&flw->repeats,logLevel,NULL,0,NULL,0);
+	sWriteRepeatSummary(flw);
+	if(OutputFormatBinary == flw->outputFormat)
+		return sWriteBinaryBlob(flw,logLevel,file,funcName,lineNum,encoding,data,len,fmt,ap);
+
+	headLen = sFormatBlobHead(flw,logLevel,moduleName,file,funcName,lineNum,encoding,len,fmt,ap);
+	/* the end of the record, after the tail of the blob. */
+	end[0] = '\n';
+	endLen = 1;
+	if(OutputFormatText == flw->outputFormat)
+		endLen = sFormatTail(flw,end,logLevel,moduleName,file,funcName,lineNum);
+	/* the payload is truncated to the largest record of the queue / atomic write. */
+	maxLen = flw->queue ? LL_ASYNC_RECORD_MAX : (int)flw->atomicWriteSize;
+	srcLen = len;
+	if(maxLen)
+	{
+		int room = maxLen - headLen - LL_BLOB_TAIL_MAX - endLen;
+		/* a raw payload is escaped in JSON, up to 6 characters per byte. */
+		if((OutputFormatJson == flw->outputFormat) && (LogBlobRaw == encoding))
+			room /= 6;
+		if(srcLen > LLBlobSourceLen(encoding,room))
+			srcLen = LLBlobSourceLen(encoding,room);
+	}
+	parts[0].data = flw->buf;
+	parts[0].len = headLen;
+	parts[0].encoding = LogBlobRaw;
+	if((OutputFormatJson == flw->outputFormat) && (LogBlobRaw == encoding))
+	{
+		/* the payload is escaped as a JSON string. */
+		LLOutBuf out;
+		int size = srcLen * 6 + 2 + LL_OUT_RESERVE;
+		char* escaped = LLBlobBufReserve(&flw->blobBuf,size);
+		if(!escaped)
+			return -1;
+		LLOutInit(&out,escaped,size);
+		LLJsonAppendString(&out,(const char*)data,srcLen);
+		parts[1].data = escaped;
+		parts[1].len = out.len;
+		parts[1].encoding = LogBlobRaw;
+	}
+	else
+	{
+		parts[1].data = data;
+		parts[1].len = srcLen;
+		parts[1].encoding = encoding;
+	}
+	tailLen = LLBlobFormatTail(tail,flw->outputFormat,encoding,len - srcLen);
+	memcpy(tail + tailLen,end,endLen);
+	tailLen += endLen;
+	parts[2].data = tail;
+	parts[2].len = tailLen;
+	parts[2].encoding = LogBlobRaw;
+	if(sEmitParts(flw,logLevel,parts,3))
+		return -1;
+	return headLen + LLBlobEncodedLen(parts[1].encoding,parts[1].len) + tailLen;
+}
+
+/** helper function to format the head of a blob record in flw->buf, up to the payload. */
+static int sFormatBlobHead(FileLogWriter* flw,const LogLevel logLevel,
+		const char* moduleName,const char* file,const char* funcName,const int lineNum,
+		int encoding,int len,const char* fmt,va_list ap)
+{
+	char curDateTime[32];
+	int headLen, msgLen, bodyOffset;
+	if(OutputFormatJson == flw->outputFormat)
+	{
+		LLOutBuf out;
+		memset(curDateTime, 0, sizeof(curDateTime));
+		LLGetCurDateTime(curDateTime, sizeof(curDateTime));
+		msgLen = vsnprintf(flw->msgBuf,RECORD_BUF_MAX,fmt,ap);
+		if((msgLen < 0) || (msgLen > RECORD_BUF_MAX - 1))
+			msgLen = (int)strlen(flw->msgBuf);
+		LLOutInit(&out,flw->buf,RECORD_BUF_MAX);
+		LLJsonAppendRecordStart(&out,curDateTime);
+		LLJsonAppendRecordInfo(&out,logLevel,moduleName,file,funcName,lineNum);
+		if(flw->includeContext)
+			out.len += LLCopyContext(flw->buf + out.len,out.size - out.len,OutputFormatJson);
+		LLJsonAppendKey(&out,"blob_len");
+		LLJsonAppendUInt(&out,len);
+		LLJsonAppendKey(&out,"msg");
+		LLJsonAppendString(&out,flw->msgBuf,msgLen);
+		/* the message is closed even if it was truncated, the reserve holds the blob member. */
+		out.size += LL_OUT_RESERVE;
+		out.truncated = 0;
+		LLJsonAppendKey(&out,"blob");
+		if(LogBlobRaw != encoding)
+			LLOutAppend(&out,"\"",1);
+		return out.len;
+	}
+	headLen = sFormatHead(flw,logLevel,moduleName,file,funcName,lineNum,&bodyOffset);
+	msgLen = vsnprintf(flw->buf + headLen,RECORD_BUF_MAX - headLen,fmt,ap);
+	if((msgLen < 0) || (msgLen > RECORD_BUF_MAX - 1 - headLen))
+		msgLen = RECORD_BUF_MAX - 1 - headLen;
+	return headLen + msgLen;
+}
+
+/* helper function to format the head of a text record. */
+static int sFormatHead(FileLogWriter* flw,const LogLevel logLevel,const char* moduleName,
+		const char* file,const char* funcName,const int lineNum,int* bodyOffset)
+{
+	char curDateTime[32];
+	int len;
+	/* the context of a layout is placed by %X. */
+	if(flw->layout.ops)
+		return LLLayoutFormatHead(&flw->layout,flw->buf,RECORD_BUF_MAX,logLevel,moduleName,
+				file,funcName,lineNum,bodyOffset);
+	memset(curDateTime, 0, sizeof(curDateTime));
+	LLGetCurDateTime(curDateTime, sizeof(curDateTime));
+	if(file)
+		len = LLPrefixFormat(&flw->prefixes,flw->buf,RECORD_BUF_MAX,"",curDateTime,logLevel,
+				sGetLogPrefix(logLevel),moduleName,file,funcName,lineNum);
+	else
+	{
+		len = snprintf(flw->buf,RECORD_BUF_MAX,"[%s] %s ", curDateTime, sGetLogPrefix(logLevel));
+		if((len < 0) || (len > RECORD_BUF_MAX - 1))
+			len = RECORD_BUF_MAX - 1;
+	}
+	*bodyOffset = len;
+	if(flw->includeContext)
+		len += LLCopyContext(flw->buf + len,RECORD_BUF_MAX - 1 - len,OutputFormatText);
+	return len;
+}
+
+/* helper function to format the end of a text record. */
+static int sFormatTail(FileLogWriter* flw,char* tail,const LogLevel logLevel,const char* moduleName,
+		const char* file,const char* funcName,const int lineNum)
+{
+	int len = 0;
+	if(flw->layout.ops)
+		len = LLLayoutFormatTail(&flw->layout,tail,logLevel,moduleName,file,funcName,lineNum);
+	tail[len++] = '\n';
+	return len;
+}
+
+/* helper function to format a whole text record with the layout. */
+static int sFormatLayoutRecord(FileLogWriter* flw,char* out,int size,const LogLevel logLevel,
+		const char* funcName,const int lineNum,const char* msg,int msgLen)
+{
+	char tail[LL_LAYOUT_TAIL_MAX + 1];
+	int bodyOffset;
+	int tailLen = sFormatTail(flw,tail,logLevel,flw->base.moduleName,NULL,funcName,lineNum);
+	int len = LLLayoutFormatHead(&flw->layout,out,size - tailLen,logLevel,flw->base.moduleName,
+			NULL,funcName,lineNum,&bodyOffset);
+	if(msgLen > size - tailLen - len)
+		msgLen = size - tailLen - len;
+	memcpy(out + len,msg,msgLen);
+	memcpy(out + len + msgLen,tail,tailLen);
+	return len + msgLen + tailLen;
+}
+
+/** helper function to write a blob record of the binary output format, the payload is
+ * appended to the message, which is truncated to the record buffer. */
+static int sWriteBinaryBlob(FileLogWriter* flw,const LogLevel logLevel,
+		const char* file,const char* funcName,const int lineNum,
+		int encoding,const void* data,int len,const char* fmt,va_list ap)
+{
+	int ctxLen = 0;
+	const char* ctx = sBinaryContext(flw,&ctxLen);
+	int bodyOffset = 0;
+	int msgLen, srcLen;
+	msgLen = vsnprintf(flw->msgBuf,RECORD_BUF_MAX,fmt,ap);
+	if((msgLen < 0) || (msgLen > RECORD_BUF_MAX - 1))
+		msgLen = RECORD_BUF_MAX - 1;
+	srcLen = LLBlobSourceLen(encoding,RECORD_BUF_MAX - msgLen - LL_BLOB_TAIL_MAX);
+	if(srcLen > len)
+		srcLen = len;
+	msgLen += LLBlobEncode(encoding,data,srcLen,flw->msgBuf + msgLen);
+	msgLen += LLBlobFormatTail(flw->msgBuf + msgLen,OutputFormatText,encoding,len - srcLen);
+	len = LLBinEncodeText(&flw->bin,flw->buf,RECORD_BUF_MAX,&bodyOffset,LL_BIN_SITE_LOG,logLevel,
+			file,funcName,lineNum,fmt,flw->msgBuf,msgLen,ctx,ctxLen);
+	if(len <= 0)
+		return -1;
+	sEmitRecord(flw,logLevel,len);
+	return len;
+}
+
+/** helper function to hand a record made of parts to the queue, or to write it with a
+ * single writev(2) : the data buffered by stdio is flushed first. */
+static int sEmitParts(FileLogWriter* flw,const LogLevel logLevel,const LLRecordPart* parts,int numParts)
+{
+	tPLIoVec iov[PL_IOV_MAX];
+	if(flw->queue)
+		return LLAsyncQueuePushParts(flw->queue,logLevel,parts,numParts);
+	if(LLBlobPartsToIoVec(parts,numParts,iov,&flw->blobBuf) < 0)
+		return -1;
+#ifdef _ENABLE_LL_ROLLBACK_
+	if(flw->rollbackSize)
+	{
+		/* the offset of stdio decides when the log rolls back. */
+		int i;
+		for(i = 0; i < numParts; i++)
+			fwrite(iov[i].data,1,iov[i].len,flw->fp);
+		fflush(flw->fp);
+		__CHECK_AND_ROLLBACK(flw);
 		return 0;
 	}
+#endif // _ENABLE_LL_ROLLBACK_
+	if(!flw->atomicWriteSize)
+		fflush(flw->fp);
+	return (PLFileWriteV(flw->fd,iov,numParts) < 0) ? -1 : 0;
+}
+
+/** File Logger object function to log a message which is not a format : the message is
+ * copied after the prefix as is. A message which does not fit in flw->buf is not copied,
+ * it is written with a single writev(2) or encoded straight into the queue.
+ * */
+static int sWriteStrToFile(LogWriter *_this,const LogLevel logLevel,
+		const char* moduleName,
+		const char* file,const char* funcName, const int lineNum, 
+		const char* fmt,const char* msg,int len)
+{
+	FileLogWriter *flw = (FileLogWriter*) _this;
+	char tail[LL_LAYOUT_TAIL_MAX + 1];
+	int prefixLen, headLen, tailLen, maxLen;
+	LLRecordPart parts[3];
+	if(!_this || !flw->fp || !msg || (len < 0))
+	{
+		fprintf(stderr,"Invalid args to sWriteStrToFile.");
+		return -1;
+	}
+	if(OutputFormatBinary == flw->outputFormat)
+	{
+		int ctxLen = 0;
+		const char* ctx;
+		int bodyOffset = 0;
+		/* the call sites of the constant formats are identified by their format. */
+		if(fmt)
+			return sWriteFormat(_this,logLevel,moduleName,file,funcName,lineNum,fmt);
+		ctx = sBinaryContext(flw,&ctxLen);
+		len = LLBinEncodeText(&flw->bin,flw->buf,RECORD_BUF_MAX,&bodyOffset,LL_BIN_SITE_LOG,logLevel,
+				file,funcName,lineNum,NULL,msg,len,ctx,ctxLen);
+		return sEmitBinaryRecord(flw,logLevel,file,lineNum,len,bodyOffset);
+	}
+	if(OutputFormatJson == flw->outputFormat)
+	{
+		/* the message is truncated to the record by the encoder. */
+		if(len > RECORD_BUF_MAX)
+			len = RECORD_BUF_MAX;
+		return sEmitJsonRecord(flw,logLevel,file,funcName,lineNum,msg,len,NULL);
+	}
+	headLen = sFormatHead(flw,logLevel,moduleName,file,funcName,lineNum,&prefixLen);
+	tailLen = sFormatTail(flw,tail,logLevel,moduleName,file,funcName,lineNum);
+	if(headLen + len + tailLen < RECORD_BUF_MAX)
+	{
+		memcpy(flw->buf + headLen,msg,len);
+		/* the date time is not part of the comparison. */
+		if(LLRepeatFilterCheck(&flw->repeats,logLevel,file,lineNum,flw->buf + prefixLen,headLen + len - prefixLen))
+			return sWriteDueRepeatSummary(flw);
+		sWriteRepeatSummary(flw);
+		memcpy(flw->buf + headLen + len,tail,tailLen);
+		sEmitRecord(flw,logLevel,headLen + len + tailLen);
+		return headLen + len + tailLen;
+	}
+	/* the record does not fit in the buffer, it is not compared with the previous one. */
+	LLRepeatFilterCheck(&flw->repeats,logLevel,NULL,0,NULL,0);
+	sWriteRepeatSummary(flw);
+	/* the message is truncated to the largest record of the queue / atomic write. */
+	maxLen = flw->queue ? LL_ASYNC_RECORD_MAX : (int)flw->atomicWriteSize;
+	if(maxLen && (headLen + len + tailLen > maxLen))
+		len = (maxLen > headLen + tailLen) ? (maxLen - headLen - tailLen) : 0;
+	parts[0].data = flw->buf;
+	parts[0].len = headLen;
+	parts[0].encoding = LogBlobRaw;
+	parts[1].data = msg;
+	parts[1].len = len;
+	parts[1].encoding = LogBlobRaw;
+	parts[2].data = tail;
+	parts[2].len = tailLen;
+	parts[2].encoding = LogBlobRaw;
+	if(sEmitParts(flw,logLevel,parts,3))
+		return -1;
+	return headLen + len + tailLen;
+}
+
+/** helper function to log a constant format with sWriteToFile. */
+static int sWriteFormat(LogWriter *_this,const LogLevel logLevel,
+		const char* moduleName,
+		const char* file,const char* funcName, const int lineNum, 
+		const char* fmt,...)
+{
+	va_list ap;
+	int retVal;
+	va_start(ap,fmt);
+	retVal = sWriteToFile(_this,logLevel,moduleName,file,funcName,lineNum,fmt,ap);
+	va_end(ap);
+	return retVal;
 }
 
 /** File Logger object function to log function entry */
@@ -272,11 +1100,35 @@ static int sFileFuncLogEntry(LogWriter *_this,const char* funcName)
 	else
 	{
 		int bytes_written = 0;
-		bytes_written = fprintf(flw->fp,"{ %s \n", funcName);
-		fflush(flw->fp);
-#ifdef _ENABLE_LL_ROLLBACK_
-		__CHECK_AND_ROLLBACK(flw);
-#endif // _ENABLE_LL_ROLLBACK_
+		if(OutputFormatJson == flw->outputFormat)
+			return sEmitJsonRecord(flw,Trace,NULL,funcName,0,"function entry",14,NULL);
+		LLRepeatFilterCheck(&flw->repeats,Trace,NULL,0,NULL,0);
+		sWriteRepeatSummary(flw);
+		if(OutputFormatBinary == flw->outputFormat)
+		{
+			int bodyOffset = 0;
+			flw->bin.stack = NULL;
+			flw->bin.suppressed = 0;
+			bytes_written = LLBinEncodeText(&flw->bin,flw->buf,RECORD_BUF_MAX,&bodyOffset,LL_BIN_SITE_FUNC_ENTRY,
+					Trace,NULL,funcName,0,NULL,NULL,0,NULL,0);
+			if(bytes_written > 0)
+				sEmitRecord(flw,Trace,bytes_written);
+			return bytes_written;
+		}
+		if(flw->layout.ops)
+		{
+			char msg[256];
+			int msgLen = snprintf(msg,sizeof(msg),"{ %s", funcName);
+			if((msgLen < 0) || (msgLen > (int)sizeof(msg) - 1))
+				msgLen = sizeof(msg) - 1;
+			bytes_written = sFormatLayoutRecord(flw,flw->buf,RECORD_BUF_MAX,Trace,funcName,0,msg,msgLen);
+			sEmitRecord(flw,Trace,bytes_written);
+			return bytes_written;
+		}
+		bytes_written = snprintf(flw->buf,RECORD_BUF_MAX,"{ %s \n", funcName);
+		if((bytes_written < 0) || (bytes_written > RECORD_BUF_MAX - 1))
+			bytes_written = RECORD_BUF_MAX - 1;
+		sEmitRecord(flw,Trace,bytes_written);
 		return bytes_written;
 	}
 		
@@ -295,11 +1147,35 @@ static int sFileFuncLogExit(LogWriter * _this,
 	else
 	{
 		int bytes_written = 0;
-		bytes_written = fprintf(flw->fp,"%s : %d }\n", funcName,lineNumber);
-		fflush(flw->fp);
-#ifdef _ENABLE_LL_ROLLBACK_
-		__CHECK_AND_ROLLBACK(flw);
-#endif // _ENABLE_LL_ROLLBACK_
+		if(OutputFormatJson == flw->outputFormat)
+			return sEmitJsonRecord(flw,Trace,NULL,funcName,lineNumber,"function exit",13,NULL);
+		LLRepeatFilterCheck(&flw->repeats,Trace,NULL,0,NULL,0);
+		sWriteRepeatSummary(flw);
+		if(OutputFormatBinary == flw->outputFormat)
+		{
+			int bodyOffset = 0;
+			flw->bin.stack = NULL;
+			flw->bin.suppressed = 0;
+			bytes_written = LLBinEncodeText(&flw->bin,flw->buf,RECORD_BUF_MAX,&bodyOffset,LL_BIN_SITE_FUNC_EXIT,
+					Trace,NULL,funcName,lineNumber,NULL,NULL,0,NULL,0);
+			if(bytes_written > 0)
+				sEmitRecord(flw,Trace,bytes_written);
+			return bytes_written;
+		}
+		if(flw->layout.ops)
+		{
+			char msg[256];
+			int msgLen = snprintf(msg,sizeof(msg),"%s : %d }", funcName,lineNumber);
+			if((msgLen < 0) || (msgLen > (int)sizeof(msg) - 1))
+				msgLen = sizeof(msg) - 1;
+			bytes_written = sFormatLayoutRecord(flw,flw->buf,RECORD_BUF_MAX,Trace,funcName,lineNumber,msg,msgLen);
+			sEmitRecord(flw,Trace,bytes_written);
+			return bytes_written;
+		}
+		bytes_written = snprintf(flw->buf,RECORD_BUF_MAX,"%s : %d }\n", funcName,lineNumber);
+		if((bytes_written < 0) || (bytes_written > RECORD_BUF_MAX - 1))
+			bytes_written = RECORD_BUF_MAX - 1;
+		sEmitRecord(flw,Trace,bytes_written);
 		return bytes_written;
 	}
 }
@@ -309,12 +1185,52 @@ static int sFileFuncLogExit(LogWriter * _this,
 int sFileLoggerDeInit(LogWriter* _this)
 {
 	FileLogWriter *flw = (FileLogWriter*) _this;
+	if(flw && flw->fp)
+		sWriteRepeatSummary(flw);
+	/* the pending records are written before the file is closed. */
+	if(flw && flw->queue)
+	{
+		LLDestroyAsyncQueue(flw->queue);
+		flw->queue = 0;
+	}
+	if(flw && flw->uring)
+		PLAsyncFileClose(&flw->uring);
+	flw->uringFirstNs = 0;
+	if(flw && flw->compress)
+		LLCompressedLogClose(&flw->lz);
+	if(flw && flw->idxFp)
+		fclose(flw->idxFp);
+	if(flw && flw->atomicBuf)
+		free(flw->atomicBuf);
+	if(flw)
+	{
+		LLBlobBufFree(&flw->blobBuf);
+		LLPrefixCacheDestroy(&flw->prefixes);
+		LLLayoutDestroy(&flw->layout);
+	}
+	if(flw && flw->commit.sync)
+		LLGroupCommitDestroy(&flw->commit);
 	if(flw && flw->fp)
 	{
 		if( (flw->fp != stdout) && (flw->fp != stderr) )
 			fclose(flw->fp);
 	}
 	flw->fp = 0;
+	flw->fd = -1;
+	flw->bufLen = 0;
+	if(OutputFormatBinary == flw->outputFormat)
+		LLBinEncoderDestroy(&flw->bin);
+	flw->binDrops = 0;
+	flw->compress = 0;
+	flw->idxFp = 0;
+	flw->atomicWriteSize = 0;
+	flw->atomicBuf = 0;
+	flw->outputFormat = OutputFormatText;
+	flw->includeContext = 0;
+	flw->base.notesApart = 0;
+	flw->base.stack = NULL;
+	flw->base.suppressed = 0;
+	memset(&flw->repeats, 0, sizeof(flw->repeats));
 #ifdef _ENABLE_LL_ROLLBACK_
 	flw->rollbackSize = 0;
 #endif // _ENABLE_LL_ROLLBACK_
@@ -323,6 +1239,525 @@ int sFileLoggerDeInit(LogWriter* _this)
 	return 0;
 }
 
+/** File Logger object function to flush the log file to the storage device. */
+static int sFileLoggerSync(LogWriter* _this)
+{
+	FileLogWriter *flw = (FileLogWriter*) _this;
+	if(!_this || !flw->fp)
+		return -1;
+	sWriteRepeatSummary(flw);
+	if(flw->queue)
+		return LLAsyncQueueSync(flw->queue);
+	fflush(flw->fp);
+	/* console logs can not be synced, so errors are ignored. */
+	PLFileSync(flw->fd);
+	return 0;
+}
+
+/** File Logger object function to wait until the records logged so far are on the storage
+ * device, the concurrent callers share a single sync. Called without the logger mutex.
+ * */
+static int sFileLoggerCommit(LogWriter* _this)
+{
+	FileLogWriter *flw = (FileLogWriter*) _this;
+	if(!_this || !flw->commit.sync)
+		return -1;
+	return LLGroupCommitWait(&flw->commit);
+}
+
+/** File Logger object function to get the statistics of the durable records. */
+static int sFileLoggerCommitStats(LogWriter* _this,tLogDurableStats* stats)
+{
+	FileLogWriter *flw = (FileLogWriter*) _this;
+	if(!_this || !flw->commit.sync)
+		return -1;
+	LLGroupCommitStats(&flw->commit,stats);
+	return 0;
+}
+
+/** File Logger object function to drain the pending record from a signal handler.
+ * The record being written (if any) might appear twice in the log, if the signal
+ * was caught after it was handed to stdio.
+ * */
+static int sFileLoggerCrashFlush(LogWriter* _this,int signum)
+{
+	FileLogWriter *flw = (FileLogWriter*) _this;
+	char record[512];
+	int len = 0;
+	if(!_this || (flw->fd < 0))
+		return -1;
+	/* the data buffered for io_uring is older than the queued records,
+	 * which are older than the one being assembled. */
+	if(flw->uring)
+		PLAsyncFileCrashWrite(flw->uring,NULL,0);
+	if(flw->queue)
+		LLAsyncQueueCrashDrain(flw->queue);
+	if(flw->bufLen > 0)
+		sWriteDirect(flw,flw->buf,flw->bufLen,1);
+	len = LLFormatCrashRecord(record,sizeof(record) - 1,flw->base.moduleName,signum,flw->outputFormat);
+	record[len++] = '\n';
+	if(OutputFormatBinary == flw->outputFormat)
+	{
+		char note[sizeof(record) + 32];
+		sWriteDirect(flw,note,LLBinEncodeNote(note,sizeof(note),0,Fatal,record,len),1);
+	}
+	else
+		sWriteDirect(flw,record,len,1);
+	PLFileSync(flw->fd);
+	return 0;
+}
+
+/** File Logger object function called around fork(), with the logger mutex locked.
+ * The child gets its own writer thread, and forgets the records and the state of the parent
+ * which the parent writes : the queued records, the repeated records, the call sites defined.
+ * */
+static int sFileLoggerAtFork(LogWriter* _this,int phase)
+{
+	FileLogWriter *flw = (FileLogWriter*) _this;
+	if(!_this || !flw->fp)
+		return -1;
+	switch(phase)
+	{
+		case LL_FORK_PREPARE:
+			LLAsyncQueueAtFork(flw->queue,phase);
+			LLGroupCommitAtFork(&flw->commit,phase);
+			/* the child must not write the data buffered by stdio again. */
+			fflush(flw->fp);
+			break;
+		case LL_FORK_PARENT:
+			LLGroupCommitAtFork(&flw->commit,phase);
+			LLAsyncQueueAtFork(flw->queue,phase);
+			break;
+		case LL_FORK_CHILD:
+		{
+			int suppressRepeats = flw->repeats.enabled;
+			LLGroupCommitAtFork(&flw->commit,phase);
+			/* before the writer thread of the child starts. */
+			if(flw->uring)
+				PLAsyncFileAfterFork(flw->uring);
+			LLAsyncQueueAtFork(flw->queue,phase);
+			memset(&flw->repeats,0,sizeof(flw->repeats));
+			flw->repeats.enabled = suppressRepeats;
+			flw->bufLen = 0;
+			if(OutputFormatBinary == flw->outputFormat)
+				LLBinEncoderInvalidate(&flw->bin);
+			break;
+		}
+	}
+	return 0;
+}
+
+/** helper function to hand the record assembled in flw->buf to the queue or to stdio. */
+static int sEmitRecord(FileLogWriter* flw,const LogLevel logLevel,int len)
+{
+	int retVal = 0;
+	flw->bufLen = len;
+	if(flw->queue)
+	{
+		retVal = LLAsyncQueuePush(flw->queue,logLevel,flw->buf,len);
+	}
+	else if(flw->atomicWriteSize)
+	{
+		if(sWriteAtomic(flw,flw->buf,len) < 0)
+			retVal = -1;
+	}
+	else
+	{
+		fwrite(flw->buf,1,len,flw->fp);
+		fflush(flw->fp);
+#ifdef _ENABLE_LL_ROLLBACK_
+		__CHECK_AND_ROLLBACK(flw);
+#endif // _ENABLE_LL_ROLLBACK_
+	}
+	flw->bufLen = 0;
+	return retVal;
+}
+
+/** helper function to write the summary of the repeated records when a repeat is suppressed. */
+static int sWriteDueRepeatSummary(FileLogWriter* flw)
+{
+	if(LLRepeatFilterDue(&flw->repeats))
+		sWriteRepeatSummary(flw);
+	return 0;
+}
+
+/** helper function to write the summary of the repeated records suppressed so far. */
+static void sWriteRepeatSummary(FileLogWriter* flw)
+{
+	char summary[512];
+	/* the summary in a binary note record. */
+	char note[sizeof(summary) + 32];
+	const char* data = summary;
+	char curDateTime[32];
+	LogLevel level;
+	unsigned long long spanNs;
+	unsigned long repeats = LLRepeatFilterTakeSummary(&flw->repeats,&level,&spanNs);
+	int len;
+	if(!repeats)
+		return;
+	memset(curDateTime, 0, sizeof(curDateTime));
+	LLGetCurDateTime(curDateTime, sizeof(curDateTime));
+	if(OutputFormatJson == flw->outputFormat)
+	{
+		LLOutBuf out;
+		char msg[64];
+		int msgLen = snprintf(msg,sizeof(msg),"last message repeated %lu times",repeats);
+		LLOutInit(&out,summary,sizeof(summary) - 1);
+		LLJsonAppendRecordStart(&out,curDateTime);
+		LLJsonAppendRecordInfo(&out,level,flw->base.moduleName,NULL,NULL,0);
+		LLJsonAppendKey(&out,"msg");
+		LLJsonAppendString(&out,msg,msgLen);
+		LLJsonAppendKey(&out,"repeats");
+		LLJsonAppendUInt(&out,repeats);
+		LLJsonAppendKey(&out,"span_s");
+		LLJsonAppendDouble(&out,spanNs / 1e9);
+		LLJsonAppendRecordEnd(&out);
+		summary[out.len] = '\n';
+		len = out.len + 1;
+	}
+	else if(flw->layout.ops)
+	{
+		char msg[96];
+		int msgLen = snprintf(msg,sizeof(msg),"last message repeated %lu times over %.3f s",repeats,spanNs / 1e9);
+		/* the buffer of the records holds the record which follows the summary. */
+		len = sFormatLayoutRecord(flw,summary,sizeof(summary),level,NULL,0,msg,msgLen);
+	}
+	else
+	{
+		len = snprintf(summary,sizeof(summary),"[%s] %s %s - last message repeated %lu times over %.3f s\n",
+				curDateTime,sGetLogPrefix(level),flw->base.moduleName,repeats,spanNs / 1e9);
+		if((len < 0) || (len > (int)sizeof(summary) - 1))
+			len = sizeof(summary) - 1;
+	}
+	if(OutputFormatBinary == flw->outputFormat)
+	{
+		len = LLBinEncodeNote(note,sizeof(note),LLGetWallClockUs(),level,summary,len);
+		data = note;
+	}
+	if(flw->queue)
+		LLAsyncQueuePush(flw->queue,level,data,len);
+	else if(flw->atomicWriteSize)
+		sWriteAtomic(flw,data,len);
+	else
+	{
+		/* the summary of a run still going on is not followed by a record. */
+		fwrite(data,1,len,flw->fp);
+		fflush(flw->fp);
+	}
+}
+
+/** helper function to compile the layout of the text records. */
+static void sSetLayout(FileLogWriter* flw,const char* layout)
+{
+	LLLayoutDestroy(&flw->layout);
+	if(!layout)
+		return;
+	if(OutputFormatText != flw->outputFormat)
+		fprintf(stderr,"[liblogger] the layout is only used with the text output format\n");
+	else if(LLLayoutCompile(&flw->layout,layout))
+		fprintf(stderr,"[liblogger] the built-in layout will be used\n");
+}
+
+/** helper function to write the line marking the start of the log. */
+static void sWriteBanner(FileLogWriter* flw,const char* curDateTime)
+{
+	if(OutputFormatBinary == flw->outputFormat)
+	{
+		char session[128 + sizeof(flw->base.moduleName)];
+		int len = LLBinEncodeSession(&flw->bin,session,sizeof(session),flw->base.moduleName);
+		sWriteDirect(flw,session,len,0);
+	}
+	else if(OutputFormatJson == flw->outputFormat)
+	{
+		char banner[128];
+		LLOutBuf out;
+		LLOutInit(&out,banner,sizeof(banner));
+		LLJsonAppendRecordStart(&out,curDateTime);
+		LLJsonAppendKey(&out,"msg");
+		LLJsonAppendString(&out,"Logging Started",15);
+		LLJsonAppendRecordEnd(&out);
+		LLOutAppend(&out,"\n",1);
+		sWriteDirect(flw,banner,out.len,0);
+	}
+	else
+	{
+		char banner[128];
+		int len = snprintf(banner,sizeof(banner),"\n----- Logging Started on %s -----\n", curDateTime);
+		sWriteDirect(flw,banner,((len < 0) || (len >= (int)sizeof(banner))) ? (int)sizeof(banner) - 1 : len,0);
+	}
+}
+
+/* helper function to start compressing the log. */
+static int sOpenCompressedLog(FileLogWriter* flw,const tFileLoggerInitParams* initParams,
+		tAsyncLogParams* asyncParams)
+{
+	char idxName[MAX_PATH + sizeof(LL_LZ_INDEX_SUFFIX)];
+	long offset;
+	if(snprintf(idxName,sizeof(idxName),"%s%s",initParams->fileName,LL_LZ_INDEX_SUFFIX) >= (int)sizeof(idxName))
+	{
+		fprintf(stderr,"the log file name %s is too long\n",initParams->fileName);
+		return -1;
+	}
+	flw->idxFp = fopen(idxName,(AppendMode == initParams->fileOpenMode) ? "ab" : "wb");
+	if(!flw->idxFp)
+	{
+		fprintf(stderr,"could not open the log index %s\n",idxName);
+		return -1;
+	}
+	/* the blocks are appended, their offsets are noted down in the index. */
+	fseek(flw->fp,0L,SEEK_END);
+	offset = ftell(flw->fp);
+	if(LLCompressedLogOpen(&flw->lz,flw->fd,fileno(flw->idxFp),(offset > 0) ? offset : 0,initParams->compressBlockSize))
+	{
+		fprintf(stderr,"[liblogger] could not allocate the compression buffers\n");
+		return -1;
+	}
+	flw->compress = 1;
+	if(!asyncParams->queueSize)
+		asyncParams->queueSize = COMPRESS_QUEUE_SIZE;
+	return 0;
+}
+
+/* helper function to write data to the log, before the background writer thread starts or
+ * from a signal handler. */
+static void sWriteDirect(FileLogWriter* flw,const char* data,int len,int fromSignal)
+{
+	if(len <= 0)
+		return;
+	if(flw->compress)
+	{
+		if(fromSignal)
+			LLCompressedLogCrashWrite(&flw->lz,data,len);
+		else
+			LLCompressedLogWrite(&flw->lz,data,len);
+	}
+	else if(fromSignal)
+		PLFileWrite(flw->fd,data,len);
+	else if(flw->atomicWriteSize)
+		sWriteAtomic(flw,data,len);
+	else
+		fwrite(data,1,len,flw->fp);
+}
+
+/** helper function to write a record with a single write(2) to the file opened with O_APPEND,
+ * the record is truncated to the atomic write size. */
+static int sWriteAtomic(FileLogWriter* flw,const char* data,int len)
+{
+	if(len > (int)flw->atomicWriteSize)
+	{
+		/* the truncated record still ends the line. */
+		len = (int)flw->atomicWriteSize;
+		memcpy(flw->atomicBuf,data,len - 1);
+		flw->atomicBuf[len - 1] = '\n';
+		data = flw->atomicBuf;
+	}
+	return PLFileWrite(flw->fd,data,len);
+}
+
+/** helper function to get the context of the thread, for the binary records.
+ * The notes of the record, its call stack and suppressed count, are passed to the encoder as well. */
+static const char* sBinaryContext(FileLogWriter* flw,int* len)
+{
+	flw->bin.stack = flw->base.stack;
+	flw->bin.suppressed = flw->base.suppressed;
+	*len = 0;
+	if(!flw->includeContext)
+		return NULL;
+	return LLGetContext(OutputFormatText,len);
+}
+
+/** helper function to emit a binary record encoded in flw->buf. */
+static int sEmitBinaryRecord(FileLogWriter* flw,const LogLevel logLevel,
+		const char* file,const int lineNum,int len,int bodyOffset)
+{
+	if(len <= 0)
+		return -1;
+	if(LLRepeatFilterCheck(&flw->repeats,logLevel,file,lineNum,flw->buf + bodyOffset,len - bodyOffset))
+	{
+		LLBinCancelRecord(&flw->bin);
+		return sWriteDueRepeatSummary(flw);
+	}
+	sWriteRepeatSummary(flw);
+	sEmitRecord(flw,logLevel,len);
+	/* the records defining call sites might have been dropped by the queue. */
+	if(flw->queue && (LLAsyncQueueDropCount(flw->queue) != flw->binDrops))
+	{
+		flw->binDrops = LLAsyncQueueDropCount(flw->queue);
+		LLBinEncoderInvalidate(&flw->bin);
+	}
+	return len;
+}
+
+/* Sink functions used by the background writer thread. */
+static int sSinkWrite(void* ctx,const char* data,int len)
+{
+	return (int)fwrite(data,1,len,((FileLogWriter*)ctx)->fp);
+}
+
+static int sSinkFlush(void* ctx)
+{
+	return fflush(((FileLogWriter*)ctx)->fp);
+}
+
+static int sSinkSync(void* ctx)
+{
+	/* console logs can not be synced, so errors are ignored. */
+	PLFileSync(((FileLogWriter*)ctx)->fd);
+	return 0;
+}
+
+/* the records are flushed to the file as they are written, unless the writer thread has them. */
+static int sCommitSync(void* ctx)
+{
+	FileLogWriter* flw = (FileLogWriter*)ctx;
+	if(flw->queue)
+		return LLAsyncQueueSync(flw->queue);
+	/* console logs can not be synced, so errors are ignored. */
+	if( PLFileSync(flw->fd) && (flw->fp != stdout) && (flw->fp != stderr) )
+		return -1;
+	return 0;
+}
+
+static int sSinkCrashWrite(void* ctx,const char* data,int len)
+{
+	return PLFileWrite(((FileLogWriter*)ctx)->fd,data,len);
+}
+
+/* Sink function of the atomic writes, the batch is split on the ends of lines, so that each
+ * write holds whole records and does not exceed the atomic write size. */
+static int sAtomicSinkWrite(void* ctx,const char* data,int len)
+{
+	FileLogWriter* flw = (FileLogWriter*)ctx;
+	int size = (int)flw->atomicWriteSize;
+	int ret = 0;
+	while(len > 0)
+	{
+		int n = len;
+		if(n > size)
+		{
+			/* the last line which fits, or else the first line, truncated. */
+			n = size;
+			while((n > 0) && (data[n - 1] != '\n'))
+				n--;
+			if(!n)
+			{
+				const char* nl = (const char*)memchr(data + size,'\n',len - size);
+				n = nl ? (int)(nl - data) + 1 : len;
+			}
+		}
+		if(sWriteAtomic(flw,data,n) < 0)
+			ret = -1;
+		data += n;
+		len -= n;
+	}
+	return ret;
+}
+
+/* Sink functions of a compressed log, the records are compressed by the background writer thread. */
+/* the sink of io_uring, see \ref tFileLoggerInitParams::ioUringDepth. */
+static int sUringSinkWrite(void* ctx,const char* data,int len)
+{
+	return PLAsyncFileWrite(((FileLogWriter*)ctx)->uring,data,len) ? -1 : len;
+}
+
+/* the data is submitted at once if no chain of writes is in flight, else it is coalesced
+ * with the next batches, for at most URING_FLUSH_MS. */
+static int sUringSinkFlush(void* ctx)
+{
+	FileLogWriter* flw = (FileLogWriter*)ctx;
+	unsigned long long now;
+	int ret;
+	if(!PLAsyncFilePending(flw->uring))
+	{
+		flw->uringFirstNs = 0;
+		return PLAsyncFileSubmit(flw->uring,0);
+	}
+	now = LLGetMonotonicNs();
+	if(!flw->uringFirstNs)
+		flw->uringFirstNs = now;
+	ret = PLAsyncFileSubmit(flw->uring,now - flw->uringFirstNs >= URING_FLUSH_MS * 1000000ULL);
+	if(!PLAsyncFilePending(flw->uring))
+		flw->uringFirstNs = 0;
+	return ret;
+}
+
+static int sUringSinkSync(void* ctx)
+{
+	return PLAsyncFileSync(((FileLogWriter*)ctx)->uring);
+}
+
+static int sUringSinkCrashWrite(void* ctx,const char* data,int len)
+{
+	return PLAsyncFileCrashWrite(((FileLogWriter*)ctx)->uring,data,len);
+}
+
+static int sCompressSinkWrite(void* ctx,const char* data,int len)
+{
+	return LLCompressedLogWrite(&((FileLogWriter*)ctx)->lz,data,len);
+}
+
+static int sCompressSinkFlush(void* ctx)
+{
+	return LLCompressedLogFlush(&((FileLogWriter*)ctx)->lz,0);
+}
+
+static int sCompressSinkSync(void* ctx)
+{
+	FileLogWriter* flw = (FileLogWriter*)ctx;
+	LLCompressedLogFlush(&flw->lz,1);
+	PLFileSync(fileno(flw->idxFp));
+	PLFileSync(flw->fd);
+	return 0;
+}
+
+static int sCompressSinkCrashWrite(void* ctx,const char* data,int len)
+{
+	return LLCompressedLogCrashWrite(&((FileLogWriter*)ctx)->lz,data,len);
+}
+
+/** helper function to start the background writer thread, if asynchronous logging is enabled. */
+static void sStartAsyncWriter(FileLogWriter* flw,const tAsyncLogParams* asyncParams)
+{
+	LLSink sink;
+	if(!asyncParams->queueSize)
+		return;
+	fflush(flw->fp);
+	memset(&sink,0,sizeof(sink));
+	if(flw->compress)
+	{
+		sink.write = sCompressSinkWrite;
+		sink.flush = sCompressSinkFlush;
+		sink.sync = sCompressSinkSync;
+		sink.crashWrite = sCompressSinkCrashWrite;
+		/* a block which is not full is written once the log is idle. */
+		sink.idleFlushMs = LL_LZ_FLUSH_MS;
+	}
+	else if(flw->uring)
+	{
+		sink.write = sUringSinkWrite;
+		sink.flush = sUringSinkFlush;
+		sink.sync = sUringSinkSync;
+		sink.crashWrite = sUringSinkCrashWrite;
+		/* the data held back is submitted once the log is idle. */
+		sink.idleFlushMs = URING_FLUSH_MS;
+	}
+	else
+	{
+		sink.write = flw->atomicWriteSize ? sAtomicSinkWrite : sSinkWrite;
+		sink.flush = sSinkFlush;
+		sink.sync = sSinkSync;
+		sink.crashWrite = sSinkCrashWrite;
+	}
+	sink.ctx = flw;
+	sink.outputFormat = flw->outputFormat;
+	flw->queue = LLCreateAsyncQueue(asyncParams,&sink);
+	if(!flw->queue)
+	{
+		fprintf(stderr,"[liblogger] could not start asynchronous logging, logging synchronously\n");
+		PLAsyncFileClose(&flw->uring);
+	}
+}
+
 /* helper function to get the log prefix */
 static const char* sGetLogPrefix(const LogLevel logLevel)
 {
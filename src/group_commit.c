@@ -0,0 +1,195 @@
+/*
+       Licensed to the Apache Software Foundation (ASF) under one
+       or more contributor license agreements.  See the NOTICE file
+       distributed with this work for additional information
+       regarding copyright ownership.  The ASF licenses this file
+       to you under the Apache License, Version 2.0 (the
+       "License"); you may not use this file except in compliance
+       with the License.  You may obtain a copy of the License at
+
+         http://www.apache.org/licenses/LICENSE-2.0
+
+       Unless required by applicable law or agreed to in writing,
+       software distributed under the License is distributed on an
+       "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+       KIND, either express or implied.  See the License for the
+       specific language governing permissions and limitations
+       under the License.
+ */
+/**
+ * \file Group commit of the durable records, see group_commit.h.
+ * */
+#include "group_commit.h"
+#include "LLTimeUtil.h"
+#include <stdio.h>
+#include <string.h>
+
+/** helper function to account a sync of \a batch records, the monitor must be entered. */
+static void sAccountSync(LLGroupCommit* gc, unsigned long batch, int failed)
+{
+	int bucket = 0;
+	gc->stats.commits++;
+	gc->stats.records += batch;
+	if(failed)
+		gc->stats.failures++;
+	if(batch > gc->stats.maxBatch)
+		gc->stats.maxBatch = batch;
+	while((bucket < LL_DURABLE_BATCH_BUCKETS - 1) && (batch >> (bucket + 1)))
+		bucket++;
+	gc->stats.batches[bucket]++;
+}
+
+/** helper function to account the time a caller waited, the monitor must be entered. */
+static void sAccountWait(LLGroupCommit* gc, unsigned long long startNs)
+{
+	unsigned long long waitNs = LLGetMonotonicNs() - startNs;
+	gc->stats.totalWaitNs += waitNs;
+	if(waitNs > gc->stats.maxWaitNs)
+		gc->stats.maxWaitNs = waitNs;
+}
+
+#ifndef DISABLE_THREAD_SAFETY
+
+/* Initializes the group commit. */
+int LLGroupCommitInit(LLGroupCommit* gc, int (*sync)(void* ctx), void* ctx, unsigned int windowMs)
+{
+	memset(gc, 0, sizeof(*gc));
+	gc->sync = sync;
+	gc->ctx = ctx;
+	gc->windowMs = windowMs;
+	if(0 != PLCreateMonitor(&gc->mon))
+	{
+		fprintf(stderr,"[liblogger] could not create the monitor of the durable records\n");
+		gc->mon = 0;
+		return -1;
+	}
+	return 0;
+}
+
+/* Waits until the records written before the call are synced. */
+int LLGroupCommitWait(LLGroupCommit* gc)
+{
+	unsigned long long startNs = LLGetMonotonicNs();
+	unsigned long long target;
+	int ret;
+	if(!gc->mon)
+		return gc->sync(gc->ctx);
+	PLEnterMonitor(gc->mon);
+	/* a sync started from now on covers the record, the one in progress might not. */
+	target = gc->startedGen + 1;
+	gc->pending++;
+	while(gc->doneGen < target)
+	{
+		unsigned long long deadline, now, gen;
+		unsigned long batch;
+		if(gc->leader)
+		{
+			PLWaitMonitor(gc->mon, -1);
+			continue;
+		}
+		/* the leader lets the others join during the window, then syncs for all of them. */
+		gc->leader = 1;
+		deadline = startNs + (unsigned long long)gc->windowMs * 1000000ULL;
+		while( (now = LLGetMonotonicNs()) < deadline )
+			PLWaitMonitor(gc->mon, (int)((deadline - now + 999999ULL) / 1000000ULL));
+		batch = gc->pending;
+		gc->pending = 0;
+		gen = ++gc->startedGen;
+		PLExitMonitor(gc->mon);
+
+		ret = gc->sync(gc->ctx);
+
+		PLEnterMonitor(gc->mon);
+		gc->doneGen = gen;
+		if(ret)
+			gc->failedGen = gen;
+		gc->leader = 0;
+		sAccountSync(gc, batch, ret);
+		PLNotifyMonitor(gc->mon);
+	}
+	/* a later sync does not make up for a failed one, the data may be lost. */
+	ret = (gc->failedGen >= target) ? -1 : 0;
+	sAccountWait(gc, startNs);
+	PLExitMonitor(gc->mon);
+	return ret;
+}
+
+/* Gets the statistics of the syncs. */
+void LLGroupCommitStats(LLGroupCommit* gc, tLogDurableStats* stats)
+{
+	if(gc->mon)
+		PLEnterMonitor(gc->mon);
+	*stats = gc->stats;
+	if(gc->mon)
+		PLExitMonitor(gc->mon);
+}
+
+/* Called around fork(). */
+void LLGroupCommitAtFork(LLGroupCommit* gc, int phase)
+{
+	if(!gc->mon)
+		return;
+	switch(phase)
+	{
+		case LL_FORK_PREPARE:
+			/* the leader syncs outside of the monitor, so it is not held for long. */
+			PLEnterMonitor(gc->mon);
+			break;
+		case LL_FORK_PARENT:
+			PLExitMonitor(gc->mon);
+			break;
+		case LL_FORK_CHILD:
+			if(0 != PLCreateMonitor(&gc->mon))
+				gc->mon = 0;
+			gc->doneGen = gc->startedGen;
+			gc->leader = 0;
+			gc->pending = 0;
+			break;
+	}
+}
+
+/* Frees the group commit. */
+void LLGroupCommitDestroy(LLGroupCommit* gc)
+{
+	if(gc->mon)
+		PLDestroyMonitor(&gc->mon);
+	gc->mon = 0;
+	gc->sync = 0;
+}
+
+#else // DISABLE_THREAD_SAFETY
+
+/* Without threads there is a single caller, which syncs alone. */
+int LLGroupCommitInit(LLGroupCommit* gc, int (*sync)(void* ctx), void* ctx, unsigned int windowMs)
+{
+	memset(gc, 0, sizeof(*gc));
+	gc->sync = sync;
+	gc->ctx = ctx;
+	gc->windowMs = windowMs;
+	return 0;
+}
+
+int LLGroupCommitWait(LLGroupCommit* gc)
+{
+	unsigned long long startNs = LLGetMonotonicNs();
+	int ret = gc->sync(gc->ctx);
+	sAccountSync(gc, 1, ret);
+	sAccountWait(gc, startNs);
+	return ret ? -1 : 0;
+}
+
+void LLGroupCommitStats(LLGroupCommit* gc, tLogDurableStats* stats)
+{
+	*stats = gc->stats;
+}
+
+void LLGroupCommitAtFork(LLGroupCommit* gc, int phase)
+{
+}
+
+void LLGroupCommitDestroy(LLGroupCommit* gc)
+{
+	gc->sync = 0;
+}
+
+#endif // DISABLE_THREAD_SAFETY
@@ -0,0 +1,80 @@
+/*
+       Licensed to the Apache Software Foundation (ASF) under one
+       or more contributor license agreements.  See the NOTICE file
+       distributed with this work for additional information
+       regarding copyright ownership.  The ASF licenses this file
+       to you under the Apache License, Version 2.0 (the
+       "License"); you may not use this file except in compliance
+       with the License.  You may obtain a copy of the License at
+
+         http://www.apache.org/licenses/LICENSE-2.0
+
+       Unless required by applicable law or agreed to in writing,
+       software distributed under the License is distributed on an
+       "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+       KIND, either express or implied.  See the License for the
+       specific language governing permissions and limitations
+       under the License.
+ */
+/**
+ * \file Group commit of the durable records, see \ref GRP_DURABLE.
+ * The callers waiting for their record to be synced elect a leader, which waits for the
+ * commit window so that others can join, then syncs the log once for the whole group
+ * outside of the lock. The callers arriving during a sync wait for the next one, as their
+ * record might have been written after the sync started.
+ * */
+#ifndef __GROUP_COMMIT_H__
+#define __GROUP_COMMIT_H__
+
+#include <liblogger/logger_object.h>
+
+#ifndef DISABLE_THREAD_SAFETY
+	#include "tPLThread.h"
+#endif
+
+/** The state of the group commit. */
+typedef struct LLGroupCommit
+{
+	/** Syncs the records written so far to the storage device, returns 0 on success. */
+	int					(*sync)(void* ctx);
+	void*				ctx;
+	/** The time the leader waits for others before the sync, in ms. */
+	unsigned int		windowMs;
+#ifndef DISABLE_THREAD_SAFETY
+	tPLMonitor			mon;
+#endif
+	/** The number of syncs started / done. */
+	unsigned long long	startedGen;
+	unsigned long long	doneGen;
+	/** The last sync which failed. */
+	unsigned long long	failedGen;
+	/** Non zero while a leader waits for the window or syncs. */
+	int					leader;
+	/** The number of callers waiting for the next sync. */
+	unsigned long		pending;
+	tLogDurableStats	stats;
+} LLGroupCommit;
+
+/** Initializes the group commit.
+ * \param [in] sync		Syncs the records written so far, called without any lock of the logger.
+ * \param [in] ctx		The context passed to \a sync.
+ * \param [in] windowMs	The time the leader waits for others before the sync, in ms.
+ * \returns 0 on success, -1 on failure.
+ * */
+int LLGroupCommitInit(LLGroupCommit* gc, int (*sync)(void* ctx), void* ctx, unsigned int windowMs);
+
+/** Waits until the records written before the call are synced.
+ * \returns 0 on success, -1 if the sync failed.
+ * */
+int LLGroupCommitWait(LLGroupCommit* gc);
+
+/** Gets the statistics of the syncs. */
+void LLGroupCommitStats(LLGroupCommit* gc, tLogDurableStats* stats);
+
+/** Called around fork(), see \ref LogWriter::atFork, the child forgets the callers of the parent. */
+void LLGroupCommitAtFork(LLGroupCommit* gc, int phase);
+
+/** Frees the group commit, no caller must be waiting. */
+void LLGroupCommitDestroy(LLGroupCommit* gc);
+
+#endif // __GROUP_COMMIT_H__
@@ -0,0 +1,354 @@
+/*
+       Licensed to the Apache Software Foundation (ASF) under one
+       or more contributor license agreements.  See the NOTICE file
+       distributed with this work for additional information
+       regarding copyright ownership.  The ASF licenses this file
+       to you under the Apache License, Version 2.0 (the
+       "License"); you may not use this file except in compliance
+       with the License.  You may obtain a copy of the License at
+
+         http://www.apache.org/licenses/LICENSE-2.0
+
+       Unless required by applicable law or agreed to in writing,
+       software distributed under the License is distributed on an
+       "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+       KIND, either express or implied.  See the License for the
+       specific language governing permissions and limitations
+       under the License.
+ */
+#include "json_encoder.h"
+#include "win32_support.h"
+#include <stdio.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+	#include <emmintrin.h>
+	#define LL_USE_SSE2
+#endif
+
+/** The two digit strings 00 - 99, used to render the integers two digits at a time. */
+static const char sDigitPairs[] =
+	"00010203040506070809"
+	"10111213141516171819"
+	"20212223242526272829"
+	"30313233343536373839"
+	"40414243444546474849"
+	"50515253545556575859"
+	"60616263646566676869"
+	"70717273747576777879"
+	"80818283848586878889"
+	"90919293949596979899";
+
+static const char sHexDigits[] = "0123456789abcdef";
+
+/* Initializes an output buffer. */
+void LLOutInit(LLOutBuf* b, char* data, int dataSize)
+{
+	b->data = data;
+	b->size = dataSize - LL_OUT_RESERVE;
+	b->len = 0;
+	b->truncated = 0;
+}
+
+/* Appends raw data. */
+void LLOutAppend(LLOutBuf* b, const char* s, int len)
+{
+	if(b->truncated)
+		return;
+	if(len > b->size - b->len)
+	{
+		b->truncated = 1;
+		return;
+	}
+	memcpy(b->data + b->len, s, len);
+	b->len += len;
+}
+
+/** helper function to escape a character, returns the length of the escape sequence. */
+static int sEscapeChar(unsigned char c, char* out)
+{
+	out[0] = '\\';
+	switch(c)
+	{
+		case '"':	out[1] = '"';	return 2;
+		case '\\':	out[1] = '\\';	return 2;
+		case '\n':	out[1] = 'n';	return 2;
+		case '\r':	out[1] = 'r';	return 2;
+		case '\t':	out[1] = 't';	return 2;
+		case '\b':	out[1] = 'b';	return 2;
+		case '\f':	out[1] = 'f';	return 2;
+		default:
+			out[1] = 'u';
+			out[2] = '0';
+			out[3] = '0';
+			out[4] = sHexDigits[c >> 4];
+			out[5] = sHexDigits[c & 0xF];
+			return 6;
+	}
+}
+
+/* Appends a string as a JSON string. The string is truncated if it does not fit,
+ * but the closing quote always does, so the JSON stays valid. */
+void LLJsonAppendString(LLOutBuf* b, const char* s, int len)
+{
+	char* out;
+	int room;
+	int i = 0;
+	if(b->truncated)
+		return;
+	if(!s)
+	{
+		LLOutAppend(b, "null", 4);
+		return;
+	}
+	/* room for the quotes. */
+	if(b->size - b->len < 2)
+	{
+		b->truncated = 1;
+		return;
+	}
+	out = b->data + b->len;
+	room = b->size - b->len - 2;
+	*out++ = '"';
+	while(i < len)
+	{
+#ifdef LL_USE_SSE2
+		/* look for the characters to escape 16 at a time : < 0x20, '"' and '\\'. */
+		while( (len - i >= 16) && (room >= 16) )
+		{
+			__m128i chunk = _mm_loadu_si128((const __m128i*)(s + i));
+			__m128i ctrl = _mm_cmpeq_epi8(_mm_max_epu8(chunk, _mm_set1_epi8(0x1F)), _mm_set1_epi8(0x1F));
+			__m128i quote = _mm_cmpeq_epi8(chunk, _mm_set1_epi8('"'));
+			__m128i bslash = _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\\'));
+			int mask = _mm_movemask_epi8(_mm_or_si128(ctrl, _mm_or_si128(quote, bslash)));
+			_mm_storeu_si128((__m128i*)out, chunk);
+			if(mask)
+			{
+				/* keep the characters before the first one to escape. */
+				int n = 0;
+				while(!(mask & (1 << n)))
+					n++;
+				out += n;
+				room -= n;
+				i += n;
+				break;
+			}
+			out += 16;
+			room -= 16;
+			i += 16;
+		}
+		if(i >= len)
+			break;
+#endif
+		{
+			unsigned char c = (unsigned char)s[i];
+			if( (c < 0x20) || (c == '"') || (c == '\\') )
+			{
+				char esc[6];
+				int n = sEscapeChar(c, esc);
+				if(n > room)
+					break;
+				memcpy(out, esc, n);
+				out += n;
+				room -= n;
+			}
+			else
+			{
+				if(!room)
+					break;
+				*out++ = (char)c;
+				room--;
+			}
+			i++;
+		}
+	}
+	if( (i < len) && (((unsigned char)s[i] & 0xC0) == 0x80) )
+	{
+		/* do not split a UTF-8 sequence, drop its first bytes. */
+		while( (out > b->data + b->len + 1) && (((unsigned char)out[-1] & 0xC0) == 0x80) )
+			out--;
+		if( (out > b->data + b->len + 1) && ((unsigned char)out[-1] >= 0xC0) )
+			out--;
+	}
+	*out++ = '"';
+	b->len = (int)(out - b->data);
+	if(i < len)
+		b->truncated = 1;
+}
+
+/* Appends an unsigned integer, rendered two digits at a time from the end. */
+void LLJsonAppendUInt(LLOutBuf* b, unsigned long long v)
+{
+	char digits[24];
+	char* p = digits + sizeof(digits);
+	while(v >= 100)
+	{
+		unsigned int pair = (unsigned int)(v % 100);
+		v /= 100;
+		p -= 2;
+		p[0] = sDigitPairs[pair * 2];
+		p[1] = sDigitPairs[pair * 2 + 1];
+	}
+	if(v >= 10)
+	{
+		p -= 2;
+		p[0] = sDigitPairs[v * 2];
+		p[1] = sDigitPairs[v * 2 + 1];
+	}
+	else
+		*--p = (char)('0' + v);
+	LLOutAppend(b, p, (int)(digits + sizeof(digits) - p));
+}
+
+/* Appends a signed integer. */
+void LLJsonAppendInt(LLOutBuf* b, long long v)
+{
+	if(v < 0)
+	{
+		LLOutAppend(b, "-", 1);
+		LLJsonAppendUInt(b, 0ULL - (unsigned long long)v);
+	}
+	else
+		LLJsonAppendUInt(b, (unsigned long long)v);
+}
+
+/* Appends a floating point number. */
+void LLJsonAppendDouble(LLOutBuf* b, double v)
+{
+	char num[32];
+	int len;
+	/* NaN is the only value not equal to itself, infinities exceed the double range. */
+	if( (v != v) || (v > 1.7976931348623157e308) || (v < -1.7976931348623157e308) )
+	{
+		LLOutAppend(b, "null", 4);
+		return;
+	}
+	/* integral values are rendered with the fast integer path. */
+	if( (v == (double)(long long)v) && (v < 9007199254740992.0) && (v > -9007199254740992.0) )
+	{
+		LLJsonAppendInt(b, (long long)v);
+		return;
+	}
+	len = snprintf(num, sizeof(num), "%.17g", v);
+	if((len < 0) || (len >= (int)sizeof(num)))
+		len = sizeof(num) - 1;
+	LLOutAppend(b, num, len);
+}
+
+/* Opens a JSON record. */
+void LLJsonAppendRecordStart(LLOutBuf* b, const char* dateTime)
+{
+	LLOutAppend(b, "{\"ts\":", 6);
+	LLJsonAppendString(b, dateTime, (int)strlen(dateTime));
+}
+
+/* Appends a member to a JSON record. */
+void LLJsonAppendKey(LLOutBuf* b, const char* key)
+{
+	LLOutAppend(b, ",", 1);
+	LLJsonAppendString(b, key, key ? (int)strlen(key) : 0);
+	LLOutAppend(b, ":", 1);
+}
+
+/* Appends the level, module and call site members of a JSON record. */
+void LLJsonAppendRecordInfo(LLOutBuf* b, LogLevel level, const char* moduleName,
+		const char* file, const char* funcName, int lineNum)
+{
+	const char* levelName = LLLevelName(level);
+	LLJsonAppendKey(b, "level");
+	LLJsonAppendString(b, levelName, (int)strlen(levelName));
+	if(moduleName && moduleName[0])
+	{
+		LLJsonAppendKey(b, "module");
+		LLJsonAppendString(b, moduleName, (int)strlen(moduleName));
+	}
+	if(file && file[0])
+	{
+		LLJsonAppendKey(b, "file");
+		LLJsonAppendString(b, file, (int)strlen(file));
+	}
+	if(lineNum > 0)
+	{
+		LLJsonAppendKey(b, "line");
+		LLJsonAppendInt(b, lineNum);
+	}
+	if(funcName && funcName[0])
+	{
+		LLJsonAppendKey(b, "func");
+		LLJsonAppendString(b, funcName, (int)strlen(funcName));
+	}
+}
+
+/* Closes a JSON record, the reserve at the end of the buffer is used if needed. */
+void LLJsonAppendRecordEnd(LLOutBuf* b)
+{
+	b->size += LL_OUT_RESERVE;
+	if(b->truncated)
+	{
+		b->truncated = 0;
+		LLOutAppend(b, ",\"truncated\":true", 17);
+	}
+	LLOutAppend(b, "}", 1);
+	b->size -= LL_OUT_RESERVE;
+}
+
+/* Appends the typed fields. */
+void LLAppendKVFields(LLOutBuf* b, tOutputFormat format, va_list fields)
+{
+	int type;
+	while( LL_KV_END != (type = va_arg(fields, int)) )
+	{
+		const char* key = va_arg(fields, const char*);
+		if(OutputFormatJson == format)
+			LLJsonAppendKey(b, key);
+		else
+		{
+			LLOutAppend(b, " ", 1);
+			LLOutAppend(b, key, key ? (int)strlen(key) : 0);
+			LLOutAppend(b, "=", 1);
+		}
+		switch(type)
+		{
+			case LL_KV_INT:
+				LLJsonAppendInt(b, va_arg(fields, long long));
+				break;
+			case LL_KV_UINT:
+				LLJsonAppendUInt(b, va_arg(fields, unsigned long long));
+				break;
+			case LL_KV_DOUBLE:
+				LLJsonAppendDouble(b, va_arg(fields, double));
+				break;
+			case LL_KV_STR:
+				{
+					const char* val = va_arg(fields, const char*);
+					LLJsonAppendString(b, val, val ? (int)strlen(val) : 0);
+				}
+				break;
+			case LL_KV_BOOL:
+				if(va_arg(fields, int))
+					LLOutAppend(b, "true", 4);
+				else
+					LLOutAppend(b, "false", 5);
+				break;
+			default:
+				/* unknown type, the remaining arguments can not be decoded. */
+				LLOutAppend(b, "null", 4);
+				return;
+		}
+	}
+}
+
+/* Returns the name of a log level. */
+const char* LLLevelName(LogLevel level)
+{
+	switch(level)
+	{
+		case Trace:	return "Trace";
+		case Debug:	return "Debug";
+		case Info:	return "Info";
+		case Warn:	return "Warn";
+		case Error:	return "Error";
+		case Fatal:	return "Fatal";
+		default:	return "";
+	}
+}
@@ -0,0 +1,81 @@
+/*
+       Licensed to the Apache Software Foundation (ASF) under one
+       or more contributor license agreements.  See the NOTICE file
+       distributed with this work for additional information
+       regarding copyright ownership.  The ASF licenses this file
+       to you under the Apache License, Version 2.0 (the
+       "License"); you may not use this file except in compliance
+       with the License.  You may obtain a copy of the License at
+
+         http://www.apache.org/licenses/LICENSE-2.0
+
+       Unless required by applicable law or agreed to in writing,
+       software distributed under the License is distributed on an
+       "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+       KIND, either express or implied.  See the License for the
+       specific language governing permissions and limitations
+       under the License.
+ */
+/**
+ * \file Encoders of the structured records : JSON strings / numbers and the KV fields.
+ * The encoders write to a fixed size buffer, never allocate and never overflow it.
+ * */
+#ifndef __JSON_ENCODER_H__
+#define __JSON_ENCODER_H__
+
+#include <stdarg.h>
+#include <liblogger/liblogger.h>
+
+/** The space kept at the end of an \ref LLOutBuf to close a truncated JSON record. */
+#define LL_OUT_RESERVE	32
+
+/** An output buffer. */
+typedef struct LLOutBuf
+{
+	char*	data;
+	/** The usable size of data, \ref LL_OUT_RESERVE bytes less than its real size. */
+	int		size;
+	/** The length of the data written so far. */
+	int		len;
+	/** Set when something did not fit, further appends are ignored. */
+	int		truncated;
+} LLOutBuf;
+
+/** Initializes an output buffer on top of \a data, \a dataSize must be larger than \ref LL_OUT_RESERVE. */
+void LLOutInit(LLOutBuf* b, char* data, int dataSize);
+
+/** Appends raw data. */
+void LLOutAppend(LLOutBuf* b, const char* s, int len);
+
+/** Appends a string as a JSON string (quoted and escaped), a NULL string is written as null. */
+void LLJsonAppendString(LLOutBuf* b, const char* s, int len);
+
+/** Appends a signed / unsigned integer. */
+void LLJsonAppendInt(LLOutBuf* b, long long v);
+void LLJsonAppendUInt(LLOutBuf* b, unsigned long long v);
+
+/** Appends a floating point number, NaN and infinities are written as null. */
+void LLJsonAppendDouble(LLOutBuf* b, double v);
+
+/** Opens a JSON record with its date time : {"ts":"..." */
+void LLJsonAppendRecordStart(LLOutBuf* b, const char* dateTime);
+
+/** Appends the level, module and call site members of a JSON record,
+ * the members of the call site which are unknown (NULL / empty / 0) are omitted. */
+void LLJsonAppendRecordInfo(LLOutBuf* b, LogLevel level, const char* moduleName,
+		const char* file, const char* funcName, int lineNum);
+
+/** Appends a member to a JSON record : ,"key": the value must be appended next. */
+void LLJsonAppendKey(LLOutBuf* b, const char* key);
+
+/** Closes a JSON record, adds "truncated":true if something did not fit. */
+void LLJsonAppendRecordEnd(LLOutBuf* b);
+
+/** Appends the typed fields (see \ref GRP_KV), as JSON members or as " key=value" text,
+ * until the \ref LL_KV_END tag. */
+void LLAppendKVFields(LLOutBuf* b, tOutputFormat format, va_list fields);
+
+/** Returns the name of a log level. */
+const char* LLLevelName(LogLevel level);
+
+#endif // __JSON_ENCODER_H__
@@ -0,0 +1,392 @@
+/*
+       Licensed to the Apache Software Foundation (ASF) under one
+       or more contributor license agreements.  See the NOTICE file
+       distributed with this work for additional information
+       regarding copyright ownership.  The ASF licenses this file
+       to you under the Apache License, Version 2.0 (the
+       "License"); you may not use this file except in compliance
+       with the License.  You may obtain a copy of the License at
+
+         http://www.apache.org/licenses/LICENSE-2.0
+
+       Unless required by applicable law or agreed to in writing,
+       software distributed under the License is distributed on an
+       "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+       KIND, either express or implied.  See the License for the
+       specific language governing permissions and limitations
+       under the License.
+ */
+/**
+ * \file The layouts of the text records, see layout.h.
+ * */
+#include "layout.h"
+#include "log_context.h"
+#include "LLTimeUtil.h"
+#include "win32_support.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/** The kinds of operations. */
+enum
+{
+	OP_LITERAL = 0,
+	/** %d, the date time. */
+	OP_DATE,
+	/** %r, the ms elapsed since the logger started. */
+	OP_ELAPSED,
+	/** %p, the log level. */
+	OP_LEVEL,
+	/** %t, the thread name, or its id. */
+	OP_THREAD,
+	/** %c, the module name. */
+	OP_MODULE,
+	/** %F, %L, %M, the call site. */
+	OP_FILE,
+	OP_LINE,
+	OP_FUNC,
+	/** %X, the context of the thread. */
+	OP_CONTEXT
+};
+
+/** The styles of the date time. */
+enum
+{
+	/** 2024-01-31 12:34:56, as the default layout. */
+	DATE_DEFAULT = 0,
+	/** 2024-01-31T12:34:56 */
+	DATE_ISO8601
+};
+
+/** The names of the levels, as log4j. */
+static const char* const sLevelNames[] = { "TRACE", "DEBUG", "INFO", "WARN", "ERROR", "FATAL" };
+
+/** The output of the rendering, truncated to size bytes. */
+typedef struct LLLayoutOut
+{
+	char*	data;
+	int		size;
+	int		len;
+} LLLayoutOut;
+
+/* helper function to append data, truncated to the room left. */
+static void sAppend(LLLayoutOut* o, const char* s, int len)
+{
+	if(len > o->size - o->len)
+		len = o->size - o->len;
+	if(len <= 0)
+		return;
+	memcpy(o->data + o->len, s, len);
+	o->len += len;
+}
+
+/* helper function to append an unsigned integer, padded with zeros to digits characters. */
+static void sAppendUInt(LLLayoutOut* o, unsigned long long v, int digits)
+{
+	char tmp[24];
+	int i = sizeof(tmp);
+	do
+	{
+		tmp[--i] = (char)('0' + v % 10);
+		v /= 10;
+	} while(v || (int)sizeof(tmp) - i < digits);
+	sAppend(o, tmp + i, sizeof(tmp) - i);
+}
+
+/* helper function to append a string, NULL is written as an empty string. */
+static void sAppendString(LLLayoutOut* o, const char* s)
+{
+	if(s)
+		sAppend(o, s, (int)strlen(s));
+}
+
+/* helper function to append the date time, the seconds are rendered once per second. */
+static void sAppendDate(LLLayout* l, LLLayoutOut* o, const LLLayoutOp* op)
+{
+	unsigned long long us = LLGetWallClockUs();
+	long long sec = (long long)(us / 1000000);
+	int style = op->dateStyle;
+	if((sec != l->dateSec[style]) || !l->dateLen[style])
+	{
+		time_t t = (time_t)sec;
+		struct tm* tmp = localtime(&t);
+		int len = 0;
+		if(tmp)
+			len = (int)strftime(l->date[style], sizeof(l->date[style]),
+					(DATE_ISO8601 == style) ? "%Y-%m-%dT%H:%M:%S" : "%Y-%m-%d %H:%M:%S", tmp);
+		l->dateSec[style] = sec;
+		l->dateLen[style] = len;
+	}
+	sAppend(o, l->date[style], l->dateLen[style]);
+	if(op->decimals)
+	{
+		char frac[8];
+		LLLayoutOut f;
+		f.data = frac;
+		f.size = sizeof(frac);
+		f.len = 0;
+		sAppend(&f, ".", 1);
+		sAppendUInt(&f, us % 1000000, 6);
+		sAppend(o, frac, 1 + op->decimals);
+	}
+}
+
+/* helper function to render the operations from first to last. */
+static void sRender(LLLayout* l, LLLayoutOut* o, int first, int last, LogLevel level,
+		const char* moduleName, const char* file, const char* funcName, int line, int* bodyOffset)
+{
+	int i;
+	for(i = first; i < last; i++)
+	{
+		const LLLayoutOp* op = &l->ops[i];
+		int start = o->len;
+		int len;
+		switch(op->kind)
+		{
+			case OP_LITERAL:
+				sAppend(o, l->literals + op->literal, op->len);
+				continue;
+			case OP_DATE:
+				sAppendDate(l, o, op);
+				break;
+			case OP_ELAPSED:
+				sAppendUInt(o, (LLGetMonotonicNs() - l->startNs) / 1000000, 1);
+				break;
+			case OP_LEVEL:
+				if(((int)level >= Trace) && ((int)level <= Fatal))
+					sAppendString(o, sLevelNames[level - Trace]);
+				break;
+			case OP_THREAD:
+			{
+				unsigned long tid;
+				const char* name = LLGetThreadName(&tid);
+				if(name[0])
+					sAppendString(o, name);
+				else
+					sAppendUInt(o, tid, 1);
+				break;
+			}
+			case OP_MODULE:
+				sAppendString(o, moduleName);
+				break;
+			case OP_FILE:
+				sAppendString(o, file);
+				break;
+			case OP_LINE:
+				sAppendUInt(o, (unsigned long long)(line > 0 ? line : 0), 1);
+				break;
+			case OP_FUNC:
+				sAppendString(o, funcName);
+				break;
+			case OP_CONTEXT:
+			{
+				const char* ctx = LLGetContext(OutputFormatText, &len);
+				/* without the space which separates the context from the message. */
+				if(len && (' ' == ctx[len - 1]))
+					len--;
+				sAppend(o, ctx, len);
+				break;
+			}
+		}
+		if((OP_DATE == op->kind) || (OP_ELAPSED == op->kind))
+			*bodyOffset = o->len;
+		/* the width of the field. */
+		len = o->len - start;
+		if(op->maxWidth && (len > op->maxWidth))
+		{
+			memmove(o->data + start, o->data + start + len - op->maxWidth, op->maxWidth);
+			len = op->maxWidth;
+			o->len = start + len;
+		}
+		if(len < op->minWidth)
+		{
+			int pad = op->minWidth - len;
+			if(pad > o->size - o->len)
+				pad = o->size - o->len;
+			if(!op->leftAlign)
+				memmove(o->data + start + pad, o->data + start, len);
+			memset(o->data + (op->leftAlign ? start + len : start), ' ', pad);
+			o->len += pad;
+		}
+	}
+}
+
+/* Renders the head of a record. */
+int LLLayoutFormatHead(LLLayout* l, char* out, int size, LogLevel level, const char* moduleName,
+		const char* file, const char* funcName, int line, int* bodyOffset)
+{
+	LLLayoutOut o;
+	o.data = out;
+	o.size = size - 1;
+	o.len = 0;
+	*bodyOffset = 0;
+	sRender(l, &o, 0, l->numHead, level, moduleName, file, funcName, line, bodyOffset);
+	return o.len;
+}
+
+/* Renders the tail of a record. */
+int LLLayoutFormatTail(LLLayout* l, char* out, LogLevel level, const char* moduleName,
+		const char* file, const char* funcName, int line)
+{
+	LLLayoutOut o;
+	int bodyOffset;
+	o.data = out;
+	o.size = LL_LAYOUT_TAIL_MAX;
+	o.len = 0;
+	sRender(l, &o, l->numHead, l->numOps, level, moduleName, file, funcName, line, &bodyOffset);
+	return o.len;
+}
+
+/* helper function to parse the option of %d : {DEFAULT}, {ISO8601}, with .ms or .us. */
+static int sParseDateOption(LLLayoutOp* op, const char* option, int len)
+{
+	const char* dot = (const char*)memchr(option, '.', len);
+	int nameLen = dot ? (int)(dot - option) : len;
+	if((7 == nameLen) && !strncmp(option, "DEFAULT", 7))
+		op->dateStyle = DATE_DEFAULT;
+	else if((7 == nameLen) && !strncmp(option, "ISO8601", 7))
+		op->dateStyle = DATE_ISO8601;
+	else
+		return -1;
+	if(!dot)
+		return 0;
+	if((3 == len - nameLen) && !strncmp(dot, ".ms", 3))
+		op->decimals = 3;
+	else if((3 == len - nameLen) && !strncmp(dot, ".us", 3))
+		op->decimals = 6;
+	else
+		return -1;
+	return 0;
+}
+
+/* Compiles a pattern. */
+int LLLayoutCompile(LLLayout* l, const char* pattern)
+{
+	int maxOps = 1;
+	int numOps = 0;
+	int numHead = -1;
+	int litLen = 0;
+	const char* p;
+	LLLayoutOp* ops;
+	char* literals;
+	memset(l, 0, sizeof(*l));
+	/* each character starts at most one operation. */
+	for(p = pattern; *p; p++)
+		maxOps++;
+	ops = (LLLayoutOp*)calloc(maxOps, sizeof(LLLayoutOp));
+	literals = (char*)malloc(strlen(pattern) + 1);
+	if(!ops || !literals)
+	{
+		free(ops);
+		free(literals);
+		fprintf(stderr, "[liblogger] out of memory for the layout\n");
+		return -1;
+	}
+	for(p = pattern; *p; )
+	{
+		LLLayoutOp* op = &ops[numOps];
+		int width = 0;
+		if(('%' != *p) || ('%' == p[1]))
+		{
+			/* the literal text, merged with the previous one. */
+			if(!numOps || (OP_LITERAL != ops[numOps - 1].kind) || (numOps == numHead))
+			{
+				op->kind = OP_LITERAL;
+				op->literal = litLen;
+				numOps++;
+			}
+			literals[litLen++] = *p;
+			ops[numOps - 1].len++;
+			p += ('%' == *p) ? 2 : 1;
+			continue;
+		}
+		p++;
+		/* the format modifiers : %-5p, %.10c, %-10.20M. */
+		if('-' == *p)
+		{
+			op->leftAlign = 1;
+			p++;
+		}
+		while((*p >= '0') && (*p <= '9') && (width < 1000))
+			width = width * 10 + (*p++ - '0');
+		op->minWidth = (short)width;
+		if('.' == *p)
+		{
+			width = 0;
+			p++;
+			while((*p >= '0') && (*p <= '9') && (width < 1000))
+				width = width * 10 + (*p++ - '0');
+			op->maxWidth = (short)width;
+		}
+		switch(*p)
+		{
+			case 'd': op->kind = OP_DATE; break;
+			case 'r': op->kind = OP_ELAPSED; break;
+			case 'p': op->kind = OP_LEVEL; break;
+			case 't': op->kind = OP_THREAD; break;
+			case 'c': op->kind = OP_MODULE; break;
+			case 'F': op->kind = OP_FILE; break;
+			case 'L': op->kind = OP_LINE; break;
+			case 'M': op->kind = OP_FUNC; break;
+			case 'X': op->kind = OP_CONTEXT; break;
+			case 'm':
+				if(numHead >= 0)
+				{
+					fprintf(stderr, "[liblogger] the layout \"%s\" has more than one %%m\n", pattern);
+					goto error;
+				}
+				numHead = numOps;
+				p++;
+				continue;
+			case 'n':
+				/* the records always end with a newline. */
+				if(p[1])
+				{
+					fprintf(stderr, "[liblogger] %%n is only supported at the end of the layout \"%s\"\n", pattern);
+					goto error;
+				}
+				p++;
+				continue;
+			default:
+				fprintf(stderr, "[liblogger] unknown conversion %%%c in the layout \"%s\"\n", *p ? *p : ' ', pattern);
+				goto error;
+		}
+		p++;
+		if((OP_DATE == op->kind) && ('{' == *p))
+		{
+			const char* end = strchr(p, '}');
+			if(!end || sParseDateOption(op, p + 1, (int)(end - p - 1)))
+			{
+				fprintf(stderr, "[liblogger] invalid date option in the layout \"%s\"\n", pattern);
+				goto error;
+			}
+			p = end + 1;
+		}
+		numOps++;
+	}
+	if(numHead < 0)
+	{
+		fprintf(stderr, "[liblogger] the layout \"%s\" has no %%m\n", pattern);
+		goto error;
+	}
+	l->ops = ops;
+	l->numOps = numOps;
+	l->numHead = numHead;
+	l->literals = literals;
+	l->startNs = LLGetMonotonicNs();
+	return 0;
+
+error:
+	free(ops);
+	free(literals);
+	return -1;
+}
+
+/* Frees a compiled layout. */
+void LLLayoutDestroy(LLLayout* l)
+{
+	free(l->ops);
+	free(l->literals);
+	memset(l, 0, sizeof(*l));
+}
@@ -0,0 +1,96 @@
+/*
+       Licensed to the Apache Software Foundation (ASF) under one
+       or more contributor license agreements.  See the NOTICE file
+       distributed with this work for additional information
+       regarding copyright ownership.  The ASF licenses this file
+       to you under the Apache License, Version 2.0 (the
+       "License"); you may not use this file except in compliance
+       with the License.  You may obtain a copy of the License at
+
+         http://www.apache.org/licenses/LICENSE-2.0
+
+       Unless required by applicable law or agreed to in writing,
+       software distributed under the License is distributed on an
+       "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+       KIND, either express or implied.  See the License for the
+       specific language governing permissions and limitations
+       under the License.
+ */
+/**
+ * \file The layouts of the text records, see \ref tFileLoggerInitParams::layout.
+ * A pattern is compiled once, at init, into a flat array of operations : the literal text
+ * and the conversions with their width. A record is rendered by running the operations,
+ * the pattern is not parsed again. The operations before %m render the head of the record,
+ * the message follows it, the operations after %m render the tail.
+ * */
+#ifndef __LAYOUT_H__
+#define __LAYOUT_H__
+
+#include <liblogger/liblogger_levels.h>
+
+/** The largest tail of a record, the part of the pattern after %m. */
+#define LL_LAYOUT_TAIL_MAX	256
+
+/** An operation of a compiled layout. */
+typedef struct LLLayoutOp
+{
+	/** The kind of the operation, a literal or a conversion. */
+	unsigned char	kind;
+	/** Non zero to pad the field on the right, "%-5p". */
+	unsigned char	leftAlign;
+	/** The style of the date time and its number of decimals, for %d. */
+	unsigned char	dateStyle;
+	unsigned char	decimals;
+	/** The minimum width of the field, padded with spaces, 0 for none. */
+	short			minWidth;
+	/** The maximum width of the field, the beginning is cut, 0 for none. */
+	short			maxWidth;
+	/** The literal text, an offset in \ref LLLayout::literals. */
+	int				literal;
+	int				len;
+} LLLayoutOp;
+
+/** A compiled layout, all zero when none is used. */
+typedef struct LLLayout
+{
+	/** The operations of the head, then of the tail. */
+	LLLayoutOp*		ops;
+	int				numOps;
+	/** The number of operations of the head, before %m. */
+	int				numHead;
+	/** The literal text of the pattern. */
+	char*			literals;
+	/** The time of the compilation, for %r. */
+	unsigned long long	startNs;
+	/** The rendering of the date time of the last second, per style. */
+	long long		dateSec[2];
+	char			date[2][24];
+	int				dateLen[2];
+} LLLayout;
+
+/** Compiles a pattern.
+ * \returns 0 on success, -1 if the pattern is invalid (the error is written on stderr).
+ * */
+int LLLayoutCompile(LLLayout* l, const char* pattern);
+
+/** Frees a compiled layout. */
+void LLLayoutDestroy(LLLayout* l);
+
+/** Renders the head of a record, the part of the pattern before the message.
+ * \param [out] out			The record buffer.
+ * \param [in]  size		The size of \a out, the head is truncated to \a size - 1 bytes.
+ * \param [out] bodyOffset	The offset of the part which follows the time fields, the part
+ *							compared to find the repeated records.
+ * \returns the length of the head.
+ * */
+int LLLayoutFormatHead(LLLayout* l, char* out, int size, LogLevel level, const char* moduleName,
+		const char* file, const char* funcName, int line, int* bodyOffset);
+
+/** Renders the tail of a record, the part of the pattern after the message, to \a out
+ * (\ref LL_LAYOUT_TAIL_MAX bytes). The newline ending the record is not included.
+ * \returns the length of the tail.
+ * */
+int LLLayoutFormatTail(LLLayout* l, char* out, LogLevel level, const char* moduleName,
+		const char* file, const char* funcName, int line);
+
+#endif // __LAYOUT_H__
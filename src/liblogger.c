@@ -19,17 +19,41 @@
 #include <liblogger/liblogger.h>
 #include "file_logger_impl.h"
 #include "socket_logger_impl.h"
+#include "shm_logger_impl.h"
+#include "shard_logger_impl.h"
+#include "crash_handler.h"
+#include "LLTimeUtil.h"
+#include "json_encoder.h"
+#include "trace_buffer.h"
+#include "stack_trace.h"
+#include "log_context.h"
+#include "binary_log.h"
+#include "blob_encoder.h"
+#include "win32_support.h"
+#include "tPLAtomic.h"
 
 #ifndef DISABLE_THREAD_SAFETY
 	#include "tPLMutex.h"
+	#include "tPLThread.h"
+	#include "async_queue.h"
+	/* the records which wait for room in the queue of the log writer are queued once the
+	 * mutex is unlocked, see LLAsyncQueuePushDeferred(). */
 	#define __LOCK_MUTEX 	if(sMutex) PLLockMutex(sMutex)
-	#define __UNLOCK_MUTEX	if(sMutex) PLUnLockMutex(sMutex)
+	#define __UNLOCK_MUTEX	do { if(sMutex) PLUnLockMutex(sMutex); LLAsyncQueuePushDeferred(); } while(0)
+	/* the mutex is locked around a record unless the log writer keeps its state per thread
+	 * (LogWriter::perThread) and the record uses no shared state, locked is set if it is. */
+	#define __LOCK_RECORD(locked,shared)	do { locked = sMutex && (!pLogWriter->perThread || (shared) || sGovernor.enabled); \
+											if(locked) PLLockMutex(sMutex); } while(0)
+	#define __UNLOCK_RECORD(locked)	do { if(locked) PLUnLockMutex(sMutex); LLAsyncQueuePushDeferred(); } while(0)
 #else
 	#define __LOCK_MUTEX 	/* NOP */
 	#define __UNLOCK_MUTEX	/* NOP */
+	#define __LOCK_RECORD(locked,shared)	locked = 0
+	#define __UNLOCK_RECORD(locked)	(void)locked
 #endif // DISABLE_THREAD_SAFETY
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <stdarg.h>
 #include <string.h>
 
@@ -39,9 +63,133 @@ static LogWriter *pLogWriter = 0;
 static tPLMutex	sMutex = 0;
 #endif
 
+/** The state of the log governor. */
+typedef struct LogGovernor
+{
+	/** Non zero if the governor is running. */
+	int					enabled;
+	tLogGovernorParams	params;
+	/** The minimum level set by the governor, 0 if the level of the log writer applies. */
+	volatile int		level;
+	/** The start of the current window (monotonic clock, ns). */
+	volatile unsigned long long	windowStartNs;
+	/** The records / bytes logged in the current window. */
+	unsigned long		records;
+	unsigned long		bytes;
+	/** The records dropped by the governor in the current window, by level : the load is
+	 * lowered only if these records would fit in the budget. Counted without the lock. */
+	tPLAtomic64			dropped[Fatal + 1];
+	/** The average size of the records logged, to estimate the bytes of the dropped ones. */
+	unsigned long		recordBytes;
+	/** The number of consecutive windows with a low load. */
+	unsigned int		quietWindows;
+}LogGovernor;
+
+static LogGovernor sGovernor;
+
+/** The lowest level of the records with a stack trace, 0 if the stack is not captured. */
+static volatile int sStackLevel = 0;
+/** The maximum number of frames captured. */
+static int sStackFrames = 0;
+/** The size of the buffer where the stack is appended to the format / message. */
+#define STACK_FMT_MAX	8192
+/** The buffer where the stack is appended, the mutex must be locked. */
+static char sStackBuf[STACK_FMT_MAX];
+
+#ifndef DISABLE_THREAD_SAFETY
+	#define LL_THREAD_LOCAL	PL_THREAD_LOCAL
+#else
+	#define LL_THREAD_LOCAL
+#endif
+
+/** The log level override of the calling thread, 0 if the level of the log writer applies. */
+static LL_THREAD_LOCAL LogLevel sThreadLevel = (LogLevel)0;
+/** The number of threads with a log level override, per level. */
+static tPLAtomic64 sThreadLevelCounts[Fatal + 1];
+#ifndef DISABLE_THREAD_SAFETY
+/** The key whose destructor removes the log level override of an exiting thread, the value
+ * of a thread is its level. Created by the first \ref InitLogger, never destroyed. */
+static tPLThreadKey sThreadLevelKey = 0;
+
+/** helper function to remove the log level override of an exiting thread. */
+static void sThreadLevelExit(void* value);
+#endif
+
+/** The lowest level any thread logs at : the level of the log writer, lowered by the
+ * thread log level overrides. The records below it are rejected with a single load. */
+static volatile int sLevelGate = 0;
+
+/** The level below which the records of the calling thread are dropped. */
+#define THREAD_LOG_LEVEL	(sThreadLevel ? sThreadLevel : pLogWriter->logLevel)
+
+/** helper function to update \ref sLevelGate, the mutex must be locked. */
+static void sUpdateLevelGate(void);
+
+/** The length of a governor window, in ns. */
+#define GOVERNOR_WINDOW_NS	1000000000ULL
+
+/** helper function to account a record, and to adjust the level at the end of a window. */
+static void sGovernorAccount(int bytes);
+
+/** helper function to log a record, the count of the records suppressed before it is
+ * appended to the format by the caller or set in LogWriter::suppressed. */
+static int sLogRecord(LogLevel logLevel,
+#ifdef VARIADIC_MACROS
+		const char* file, const char* funcName, const int lineNum,
+#endif
+	long suppressed,const char* fmt,va_list ap);
+
+/** helper function to log with the log writer directly, the mutex must be locked. */
+static int sWriterLog(LogLevel logLevel,
+		const char* file,const char* funcName, const int lineNum,
+		const char* fmt,...);
+
+/** helper function to append the rendering of a stack to a format / message in
+ * \ref sStackBuf, the mutex must be locked. The log writers which write the notes apart
+ * get it in LogWriter::stack instead, and the format is returned as it is. */
+static const char* sAppendStack(const char* fmt,void* const* frames,int numFrames,int escape);
+
+/** helper function to account a record dropped by the governor, and to end the window
+ * so that the level can be lowered even if no record is logged. */
+static void sGovernorTick(LogLevel logLevel);
+
+/** helper function to log a record followed by a payload with the log writers which do not
+ * write the payload themselves, the mutex must be locked. */
+static int sWriterLogBlob(LogLevel logLevel,
+		const char* file,const char* funcName, const int lineNum,
+		int encoding,const void* data,int len,
+		const char* fmt,va_list ap);
+
+#ifdef VARIADIC_MACROS
+/** helper function to log a message which is not a format, see \ref GRP_STR. */
+static int sLogStr(LogLevel logLevel,
+		const char* file,const char* funcName, const int lineNum,
+		const char* fmt,const char* msg,size_t len);
+
+/** helper function to log a terminated message with \ref LogWriter::logStr, the mutex must be locked. */
+static int sWriterLogStr(LogLevel logLevel,
+		const char* file,const char* funcName, const int lineNum,
+		const char* fmt,const char* msg);
+#endif
+
+#ifndef DISABLE_THREAD_SAFETY
+/** Non zero once the fork() handlers are registered, they can not be removed. */
+static int sAtForkRegistered = 0;
+/** The mutex locked by \ref sForkPrepare. */
+static tPLMutex sForkMutex = 0;
+
+/** fork() handlers : the logger is locked during the fork, so that the child gets a
+ * consistent state. The threads of the parent do not exist in the child, so it gets a new
+ * mutex, and the log writer restarts its background thread. */
+static void sForkPrepare(void);
+static void sForkParent(void);
+static void sForkChild(void);
+#endif
+
 
 /** Macro to check if logger subsystem is initialize, 
- * if not, then it is initialized to log to file
+ * if not, then it is initialized to log to file.
+ * The alternate signal stack of the calling thread is installed with its first record.
  * */
 #define CHECK_AND_INIT_LOGGER	if(!pLogWriter)	\
 	{ 											\
@@ -54,6 +202,7 @@ static tPLMutex	sMutex = 0;
 		if(!pLogWriter)									\
 			return -1;								\
 	}											\
+	LLCrashThreadInit();
 
 
 /** Function to initialize the logger. */
@@ -68,8 +217,14 @@ int InitLogger(LogDest ldest,void* loggerInitParams)
 #ifndef DISABLE_THREAD_SAFETY
 	if(!sMutex)
 		PLCreateMutex(&sMutex);
+	if(!sAtForkRegistered)
+		sAtForkRegistered = (0 == PLRegisterAtFork(sForkPrepare,sForkParent,sForkChild));
 #endif
 	__LOCK_MUTEX;
+#ifndef DISABLE_THREAD_SAFETY
+	if(!sThreadLevelKey && PLCreateThreadKey(&sThreadLevelKey,sThreadLevelExit))
+		fprintf(stderr,"[liblogger] the log level overrides of the threads are not removed when they exit\n");
+#endif
 
 	switch(ldest)
 	{
@@ -93,6 +248,38 @@ int InitLogger(LogDest ldest,void* loggerInitParams)
 			#endif
 			break;
 
+		/* log to a shared memory ring. */
+		case LogToSharedMemory:
+			#ifndef DISABLE_SHM_LOGGER
+			{
+				if( -1 == InitShmLogger(&pLogWriter,loggerInitParams) )
+				{
+					fprintf(stderr,"\n [liblogger] could not init shared memory logging \n");
+					retVal = -1;
+					goto UNLOCK_RETURN;
+				}
+			}
+			#else
+			{
+				fprintf(stderr,"\n [liblogger] Shared memory logger not enabled during build\n");
+				retVal = -1;
+				goto UNLOCK_RETURN;
+			}
+			#endif
+			break;
+
+		/* log to a shard per thread. */
+		case LogToShards:
+			{
+				if( -1 == InitShardLogger(&pLogWriter,loggerInitParams) )
+				{
+					fprintf(stderr,"\n [liblogger] could not initialize sharded logger, check file path/name \n");
+					retVal = -1;
+					goto UNLOCK_RETURN;
+				}
+			}
+			break;
+
 		/* log to a console. */
 		case LogToConsole:
 			{
@@ -120,6 +307,7 @@ int InitLogger(LogDest ldest,void* loggerInitParams)
 	}
 	retVal = 0;
 UNLOCK_RETURN:
+	sUpdateLevelGate();
 	__UNLOCK_MUTEX;
 	return retVal; // success.
 }
@@ -130,6 +318,7 @@ void DeInitLogger()
 	__LOCK_MUTEX;
 	pLogWriter->loggerDeInit(pLogWriter);
 	pLogWriter = 0;
+	sUpdateLevelGate();
 	__UNLOCK_MUTEX;
 
 #ifndef DISABLE_THREAD_SAFETY
@@ -138,27 +327,146 @@ void DeInitLogger()
 #endif
 }
 
+#ifndef DISABLE_THREAD_SAFETY
+/* Locks the logger before fork(). */
+static void sForkPrepare(void)
+{
+	sForkMutex = sMutex;
+	if(sForkMutex)
+		PLLockMutex(sForkMutex);
+	if(pLogWriter && pLogWriter->atFork)
+		pLogWriter->atFork(pLogWriter,LL_FORK_PREPARE);
+}
+
+/* Unlocks the logger in the parent after fork(). */
+static void sForkParent(void)
+{
+	if(pLogWriter && pLogWriter->atFork)
+		pLogWriter->atFork(pLogWriter,LL_FORK_PARENT);
+	if(sForkMutex)
+		PLUnLockMutex(sForkMutex);
+	sForkMutex = 0;
+}
+
+/* Resets the logger in the child after fork(). */
+static void sForkChild(void)
+{
+	if(pLogWriter && pLogWriter->atFork)
+		pLogWriter->atFork(pLogWriter,LL_FORK_CHILD);
+	/* the mutex is owned by the thread which forked, in the parent. */
+	if(sForkMutex)
+	{
+		sMutex = 0;
+		PLCreateMutex(&sMutex);
+	}
+	sForkMutex = 0;
+	/* the thread ids cached by the thread which forked. */
+	LLContextAfterFork();
+	LLBinAfterFork();
+}
+#endif // DISABLE_THREAD_SAFETY
+
+/* Returns the time elapsed since an arbitrary point, in ns. */
+unsigned long long LogGetTimeNs(void)
+{
+	return LLGetMonotonicNs();
+}
+
+/* Gets the statistics of the durable records. */
+int LogGetDurableStats(tLogDurableStats* stats)
+{
+	int retVal = -1;
+	if(!stats)
+		return -1;
+	memset(stats,0,sizeof(*stats));
+	__LOCK_MUTEX;
+	if(pLogWriter && pLogWriter->commitStats)
+		retVal = pLogWriter->commitStats(pLogWriter,stats);
+	__UNLOCK_MUTEX;
+	return retVal;
+}
+
+/* Returns the log writer currently in use, used by the crash handler. */
+LogWriter* LLGetLogWriter(void)
+{
+	return pLogWriter;
+}
+
 int vsLogStub(LogLevel logLevel,
 #ifdef VARIADIC_MACROS
 		const char* file, const char* funcName, const int lineNum,
 #endif
 	const char* fmt,va_list ap)
+{
+	return sLogRecord(logLevel,
+#ifdef VARIADIC_MACROS
+			file,funcName,lineNum,
+#endif
+			0,fmt,ap);
+}
+
+/* helper function to log a record, with the count of the records suppressed before it by
+ * the rate limit of its call site. */
+static int sLogRecord(LogLevel logLevel,
+#ifdef VARIADIC_MACROS
+		const char* file, const char* funcName, const int lineNum,
+#endif
+	long suppressed,const char* fmt,va_list ap)
 {
 	int retVal = 0;
+	void* frames[LL_STACK_MAX_FRAMES];
+	int numFrames = 0;
+	int locked;
+	/* the fast path, for the threads without a log level override. */
+	if ((int)logLevel < sLevelGate)
+	    return -1;
 	CHECK_AND_INIT_LOGGER;
 
-	if (logLevel < pLogWriter->logLevel)
+	if (logLevel < THREAD_LOG_LEVEL)
 	    return -1;
+	if ((int)logLevel < sGovernor.level)
+	{
+		sGovernorTick(logLevel);
+	    return -1;
+	}
+	/* the stack is captured before locking, the callers of this function are skipped. */
+	if(sStackLevel && ((int)logLevel >= sStackLevel))
+		numFrames = LLStackCapture(frames,sStackFrames,2);
 
-	__LOCK_MUTEX;
+	__LOCK_RECORD(locked,(numFrames > 0) || (suppressed > 0));
 
+	if((suppressed > 0) && pLogWriter->notesApart)
+		pLogWriter->suppressed = suppressed;
+	if(numFrames > 0)
+		fmt = sAppendStack(fmt,frames,numFrames,1);
+#ifdef VARIADIC_MACROS
+	/* the formats the macros could not check : "%s" and the formats without conversion
+	 * specifiers are logged as strings, without parsing them. */
+	if(pLogWriter->logStr && (numFrames <= 0) && ('%' == fmt[0]) && ('s' == fmt[1]) && !fmt[2])
+		retVal = sWriterLogStr(logLevel,file,funcName,lineNum,NULL,va_arg(ap,const char*));
+	else if(pLogWriter->logStr && (numFrames <= 0) && !strchr(fmt,'%'))
+		retVal = sWriterLogStr(logLevel,file,funcName,lineNum,fmt,fmt);
+	else
+#endif
 	retVal = pLogWriter->log(pLogWriter,logLevel,
 #ifdef VARIADIC_MACROS
 			pLogWriter->moduleName,file,funcName,lineNum,
 #endif
 			fmt,ap);
+	if(numFrames > 0)
+		pLogWriter->stack = NULL;
+	if(suppressed > 0)
+		pLogWriter->suppressed = 0;
 
-	__UNLOCK_MUTEX;
+	if(sGovernor.enabled)
+		sGovernorAccount(retVal);
+
+	/* a fatal log is usually the last one before the application goes down,
+	 * make sure it reaches the disk before returning. */
+	if((logLevel >= Fatal) && pLogWriter->sync)
+		pLogWriter->sync(pLogWriter);
+
+	__UNLOCK_RECORD(locked);
 
 	return retVal;
 }
@@ -177,6 +485,261 @@ int LogStub_vm(LogLevel logLevel,
 	return retVal;
 }
 
+int LogStrStub_vm(LogLevel logLevel,
+		const char* file,const char* funcName, const int lineNum,
+		const char* str,size_t len)
+{
+	if(!str)
+	{
+		str = "(null)";
+		len = 6;
+	}
+	return sLogStr(logLevel,file,funcName,lineNum,NULL,str,len);
+}
+
+int LogConstStub_vm(LogLevel logLevel,
+		const char* file,const char* funcName, const int lineNum,
+		const char* fmt,size_t len)
+{
+	return sLogStr(logLevel,file,funcName,lineNum,fmt,fmt,len);
+}
+
+/* helper function to log a message which is not a format. */
+static int sLogStr(LogLevel logLevel,
+		const char* file,const char* funcName, const int lineNum,
+		const char* fmt,const char* msg,size_t len)
+{
+	int retVal = 0;
+	void* frames[LL_STACK_MAX_FRAMES];
+	int numFrames = 0;
+	const char* stack = "";
+	int locked;
+	if ((int)logLevel < sLevelGate)
+	    return -1;
+	CHECK_AND_INIT_LOGGER;
+
+	if (logLevel < THREAD_LOG_LEVEL)
+	    return -1;
+	if ((int)logLevel < sGovernor.level)
+	{
+		sGovernorTick(logLevel);
+	    return -1;
+	}
+	if(len > LL_BLOB_MAX)
+		len = LL_BLOB_MAX;
+	if(sStackLevel && ((int)logLevel >= sStackLevel))
+		numFrames = LLStackCapture(frames,sStackFrames,2);
+
+	__LOCK_RECORD(locked,numFrames > 0);
+
+	if(numFrames > 0)
+		stack = sAppendStack("",frames,numFrames,0);
+
+	/* the records with a stack in the message are formatted. */
+	if(stack[0])
+		retVal = sWriterLog(logLevel,file,funcName,lineNum,"%.*s%s",(int)len,msg,stack);
+	else if(pLogWriter->logStr)
+		retVal = pLogWriter->logStr(pLogWriter,logLevel,pLogWriter->moduleName,
+				file,funcName,lineNum,fmt,msg,(int)len);
+	else
+		retVal = sWriterLog(logLevel,file,funcName,lineNum,"%.*s",(int)len,msg);
+	if(numFrames > 0)
+		pLogWriter->stack = NULL;
+
+	if(sGovernor.enabled)
+		sGovernorAccount(retVal);
+
+	/* a fatal log is usually the last one before the application goes down,
+	 * make sure it reaches the disk before returning. */
+	if((logLevel >= Fatal) && pLogWriter->sync)
+		pLogWriter->sync(pLogWriter);
+
+	__UNLOCK_RECORD(locked);
+
+	return retVal;
+}
+
+int LogKVStub_vm(LogLevel logLevel,
+		const char* file,const char* funcName, const int lineNum,
+		const char* msg,...)
+{
+	va_list ap; 
+	int retVal = 0;
+	void* frames[LL_STACK_MAX_FRAMES];
+	int numFrames = 0;
+	int locked;
+	if ((int)logLevel < sLevelGate)
+	    return -1;
+	CHECK_AND_INIT_LOGGER;
+
+	if (logLevel < THREAD_LOG_LEVEL)
+	    return -1;
+	if ((int)logLevel < sGovernor.level)
+	{
+		sGovernorTick(logLevel);
+	    return -1;
+	}
+	if(sStackLevel && ((int)logLevel >= sStackLevel))
+		numFrames = LLStackCapture(frames,sStackFrames,1);
+
+	va_start(ap,msg);
+	__LOCK_RECORD(locked,numFrames > 0);
+
+	/* the message is not a format. */
+	if(numFrames > 0)
+		msg = sAppendStack(msg,frames,numFrames,0);
+
+	if(pLogWriter->logKV)
+		retVal = pLogWriter->logKV(pLogWriter,logLevel,pLogWriter->moduleName,
+				file,funcName,lineNum,msg,ap);
+	else
+		retVal = sWriterLog(logLevel,file,funcName,lineNum,"%s",msg);
+	if(numFrames > 0)
+		pLogWriter->stack = NULL;
+
+	if(sGovernor.enabled)
+		sGovernorAccount(retVal);
+
+	/* a fatal log is usually the last one before the application goes down,
+	 * make sure it reaches the disk before returning. */
+	if((logLevel >= Fatal) && pLogWriter->sync)
+		pLogWriter->sync(pLogWriter);
+
+	__UNLOCK_RECORD(locked);
+	va_end(ap);
+
+	return retVal;
+}
+
+int LogBlobStub_vm(LogLevel logLevel,
+		const char* file,const char* funcName, const int lineNum,
+		tLogBlobEncoding encoding,const void* data,size_t len,
+		const char* fmt,...)
+{
+	va_list ap; 
+	int retVal = 0;
+	void* frames[LL_STACK_MAX_FRAMES];
+	int numFrames = 0;
+	int locked;
+	if ((int)logLevel < sLevelGate)
+	    return -1;
+	CHECK_AND_INIT_LOGGER;
+
+	if (logLevel < THREAD_LOG_LEVEL)
+	    return -1;
+	if ((int)logLevel < sGovernor.level)
+	{
+		sGovernorTick(logLevel);
+	    return -1;
+	}
+	if(!data)
+		len = 0;
+	if(len > LL_BLOB_MAX)
+		len = LL_BLOB_MAX;
+	if(sStackLevel && ((int)logLevel >= sStackLevel))
+		numFrames = LLStackCapture(frames,sStackFrames,1);
+
+	va_start(ap,fmt);
+	__LOCK_RECORD(locked,numFrames > 0);
+
+	if(numFrames > 0)
+		fmt = sAppendStack(fmt,frames,numFrames,1);
+
+	if(pLogWriter->logBlob)
+		retVal = pLogWriter->logBlob(pLogWriter,logLevel,pLogWriter->moduleName,
+				file,funcName,lineNum,(int)encoding,data,(int)len,fmt,ap);
+	else
+		retVal = sWriterLogBlob(logLevel,file,funcName,lineNum,(int)encoding,data,(int)len,fmt,ap);
+	if(numFrames > 0)
+		pLogWriter->stack = NULL;
+
+	if(sGovernor.enabled)
+		sGovernorAccount(retVal);
+
+	/* a fatal log is usually the last one before the application goes down,
+	 * make sure it reaches the disk before returning. */
+	if((logLevel >= Fatal) && pLogWriter->sync)
+		pLogWriter->sync(pLogWriter);
+
+	__UNLOCK_RECORD(locked);
+	va_end(ap);
+
+	return retVal;
+}
+
+int LogDurableStub_vm(LogLevel logLevel,
+		const char* file,const char* funcName, const int lineNum,
+		const char* fmt,...)
+{
+	va_list ap;
+	int retVal = 0;
+	LogWriter* writer;
+	va_start(ap,fmt);
+	retVal = vsLogStub(logLevel,file,funcName,lineNum,fmt,ap);
+	va_end(ap);
+	writer = pLogWriter;
+	if( (retVal < 0) || !writer )
+		return retVal;
+	/* the sync is shared with the other durable records, outside of the logger mutex. */
+	if(writer->commit)
+	{
+		if(writer->commit(writer))
+			retVal = -1;
+	}
+	else if(writer->sync)
+	{
+		__LOCK_MUTEX;
+		if(pLogWriter && pLogWriter->sync(pLogWriter))
+			retVal = -1;
+		__UNLOCK_MUTEX;
+	}
+	return retVal;
+}
+
+/* Returns non zero if a record of this level would not be dropped for its level. */
+int LogLevelEnabled(LogLevel level)
+{
+	if ((int)level < sLevelGate)
+	    return 0;
+	/* the logger is initialized by the record. */
+	if (!pLogWriter)
+	    return 1;
+	return (level >= THREAD_LOG_LEVEL) && ((int)level >= sGovernor.level);
+}
+
+/** The size of the format buffer used to report the suppressed records. */
+#define LIMITED_FMT_MAX	512
+
+int LogStubLimited_vm(LogLevel logLevel, long suppressed,
+		const char* file,const char* funcName, const int lineNum,
+		const char* fmt,...)
+{
+	va_list ap; 
+	int retVal = 0;
+	char fmtBuf[LIMITED_FMT_MAX];
+	char* limitedFmt = fmtBuf;
+	va_start(ap,fmt);
+	/* the log writers which write the notes apart keep the call site of the format. */
+	if((suppressed > 0) && !(pLogWriter && pLogWriter->notesApart))
+	{
+		/* the count is appended to the format, digits need no escaping. */
+		size_t size = strlen(fmt) + 64;
+		if(size > sizeof(fmtBuf))
+			limitedFmt = (char*)malloc(size);
+		if(limitedFmt)
+		{
+			snprintf(limitedFmt,size,"%s (suppressed %ld similar records)",fmt,suppressed);
+			fmt = limitedFmt;
+			suppressed = 0;
+		}
+	}
+	retVal = sLogRecord(logLevel,file,funcName,lineNum,suppressed,fmt,ap);
+	va_end(ap);
+	if(limitedFmt && (limitedFmt != fmtBuf))
+		free(limitedFmt);
+	return retVal;
+}
+
 #else
 
 int LogTrace(const char* fmt,...)
@@ -245,23 +808,344 @@ int LogFatal (const char* fmt,...)
 int FuncLogEntry(const char* funcName)
 {
 	int retVal = 0;
+	int locked;
+	/* the binary capture replaces the text records. */
+	if(LLTraceEnabled())
+		return LLTraceFunc(LL_TRACE_BEGIN,funcName,0);
+	if (sLevelGate > Trace)
+	    return -1;
 	CHECK_AND_INIT_LOGGER;
-	if (pLogWriter->logLevel > Trace)
+	if ( (THREAD_LOG_LEVEL > Trace) || (sGovernor.level > Trace) )
 	    return -1;
-	__LOCK_MUTEX;
+	__LOCK_RECORD(locked,0);
 	retVal = pLogWriter->logFuncEntry(pLogWriter,funcName);
-	__UNLOCK_MUTEX;
+	__UNLOCK_RECORD(locked);
 	return retVal;
 }
 
 int FuncLogExit(const char* funcName,const int lineNumber)
 {
 	int retVal = 0;
+	int locked;
+	if(LLTraceEnabled())
+		return LLTraceFunc(LL_TRACE_END,funcName,lineNumber);
+	if (sLevelGate > Trace)
+	    return -1;
 	CHECK_AND_INIT_LOGGER;
-	if (pLogWriter->logLevel > Trace)
+	if ( (THREAD_LOG_LEVEL > Trace) || (sGovernor.level > Trace) )
 	    return -1;
-	__LOCK_MUTEX;
+	__LOCK_RECORD(locked,0);
 	retVal = pLogWriter->logFuncExit(pLogWriter,funcName,lineNumber);
+	__UNLOCK_RECORD(locked);
+	return retVal;
+}
+
+/* Log the exit of a scope with its duration. */
+int FuncLogScopeExit(const char* scopeName,const char* file,const char* funcName,
+		const int lineNumber,unsigned long long elapsedNs)
+{
+	int retVal = 0;
+	int locked;
+	if(LLTraceEnabled())
+		return LLTraceFunc(LL_TRACE_END,scopeName,lineNumber);
+	if (sLevelGate > Trace)
+	    return -1;
+	CHECK_AND_INIT_LOGGER;
+	if ( (THREAD_LOG_LEVEL > Trace) || (sGovernor.level > Trace) )
+	    return -1;
+	__LOCK_RECORD(locked,0);
+	retVal = sWriterLog(Trace,file,funcName,lineNumber,"%s : %d } %llu ns",
+			scopeName,lineNumber,elapsedNs);
+	__UNLOCK_RECORD(locked);
+	return retVal;
+}
+
+/* Override the log level of the calling thread. */
+int LogSetThreadLevel(LogLevel level)
+{
+	if( ((level < Trace) || (level > Fatal)) && (level != Disable) )
+	{
+		fprintf(stderr,"[liblogger] invalid thread log level %d\n",(int)level);
+		return -1;
+	}
+#ifndef DISABLE_THREAD_SAFETY
+	/* the count of the thread is removed when it exits, even if the override is not. */
+	if(sThreadLevelKey)
+		PLSetThreadKey(sThreadLevelKey,(level <= Fatal) ? (void*)(size_t)level : NULL);
+#endif
+	if(sThreadLevel && (sThreadLevel <= Fatal))
+		PLAtomicAdd64(&sThreadLevelCounts[sThreadLevel],-1);
+	if(level <= Fatal)
+		PLAtomicInc64(&sThreadLevelCounts[level]);
+	sThreadLevel = level;
+	__LOCK_MUTEX;
+	sUpdateLevelGate();
+	__UNLOCK_MUTEX;
+	return 0;
+}
+
+/* Returns the log level override of the calling thread. */
+LogLevel LogGetThreadLevel(void)
+{
+	return sThreadLevel;
+}
+
+/* Remove the log level override of the calling thread. */
+void LogClearThreadLevel(void)
+{
+	if(!sThreadLevel)
+		return;
+	if(sThreadLevel <= Fatal)
+		PLAtomicAdd64(&sThreadLevelCounts[sThreadLevel],-1);
+	sThreadLevel = (LogLevel)0;
+#ifndef DISABLE_THREAD_SAFETY
+	if(sThreadLevelKey)
+		PLSetThreadKey(sThreadLevelKey,NULL);
+#endif
+	__LOCK_MUTEX;
+	sUpdateLevelGate();
+	__UNLOCK_MUTEX;
+}
+
+#ifndef DISABLE_THREAD_SAFETY
+/* helper function to remove the log level override of an exiting thread. */
+static void sThreadLevelExit(void* value)
+{
+	PLAtomicAdd64(&sThreadLevelCounts[(size_t)value],-1);
+	__LOCK_MUTEX;
+	sUpdateLevelGate();
 	__UNLOCK_MUTEX;
+}
+#endif
+
+/* helper function to update sLevelGate, the mutex must be locked. */
+static void sUpdateLevelGate(void)
+{
+	int gate = 0;
+	int level;
+	/* 0 lets every record through to CHECK_AND_INIT_LOGGER. */
+	if(pLogWriter)
+	{
+		gate = (int)pLogWriter->logLevel;
+		for(level = Trace; (level < gate) && (level <= Fatal); level++)
+		{
+			if(PLAtomicLoad64(&sThreadLevelCounts[level]) > 0)
+			{
+				gate = level;
+				break;
+			}
+		}
+	}
+	sLevelGate = gate;
+}
+
+/* Starts the log governor. */
+int InitLogGovernor(const tLogGovernorParams* params)
+{
+	if(!params)
+	{
+		fprintf(stderr,"Invalid args to function InitLogGovernor\n");
+		return -1;
+	}
+	__LOCK_MUTEX;
+	memset(&sGovernor,0,sizeof(sGovernor));
+	sGovernor.params = *params;
+	if(!sGovernor.params.maxLevel)
+		sGovernor.params.maxLevel = Error;
+	if(!sGovernor.params.coolDownSec)
+		sGovernor.params.coolDownSec = 5;
+	sGovernor.windowStartNs = LLGetMonotonicNs();
+	sGovernor.enabled = 1;
+	__UNLOCK_MUTEX;
+	return 0;
+}
+
+/* Stops the log governor. */
+void DeInitLogGovernor(void)
+{
+	__LOCK_MUTEX;
+	memset(&sGovernor,0,sizeof(sGovernor));
+	__UNLOCK_MUTEX;
+}
+
+/* Appends the call stack to the records. */
+int InitStackTrace(const tStackTraceParams* params)
+{
+	if(!params || (params->maxFrames > LL_STACK_MAX_FRAMES))
+	{
+		fprintf(stderr,"Invalid args to function InitStackTrace\n");
+		return -1;
+	}
+	LLStackInit();
+	__LOCK_MUTEX;
+	sStackFrames = params->maxFrames ? (int)params->maxFrames : 16;
+	sStackLevel = params->minLevel ? (int)params->minLevel : Error;
+	__UNLOCK_MUTEX;
+	return 0;
+}
+
+/* Stops appending the call stack to the records. */
+void DeInitStackTrace(void)
+{
+	__LOCK_MUTEX;
+	sStackLevel = 0;
+	LLStackDeInit();
+	__UNLOCK_MUTEX;
+}
+
+/* helper function to append the rendering of a stack to a format / message, the mutex must be locked. */
+static const char* sAppendStack(const char* fmt,void* const* frames,int numFrames,int escape)
+{
+	int len = (int)strlen(fmt);
+	/* the record is logged without the stack if the format takes most of the buffer. */
+	if(len > STACK_FMT_MAX / 2)
+		return fmt;
+	if(pLogWriter->notesApart)
+	{
+		/* the call site of the record stays the one of its format. */
+		LLStackFormat(sStackBuf,STACK_FMT_MAX,frames,numFrames,0);
+		pLogWriter->stack = sStackBuf;
+		return fmt;
+	}
+	memcpy(sStackBuf,fmt,len);
+	LLStackFormat(sStackBuf + len,STACK_FMT_MAX - len,frames,numFrames,escape);
+	return sStackBuf;
+}
+
+/* helper function to log with the log writer directly, the mutex must be locked. */
+static int sWriterLog(LogLevel logLevel,
+		const char* file,const char* funcName, const int lineNum,
+		const char* fmt,...)
+{
+	va_list ap; 
+	int retVal = 0;
+	va_start(ap,fmt);
+	retVal = pLogWriter->log(pLogWriter,logLevel,
+#ifdef VARIADIC_MACROS
+			pLogWriter->moduleName,file,funcName,lineNum,
+#endif
+			fmt,ap);
+	va_end(ap);
 	return retVal;
 }
+
+#ifdef VARIADIC_MACROS
+/* helper function to log a terminated message with the log writer, the mutex must be locked. */
+static int sWriterLogStr(LogLevel logLevel,
+		const char* file,const char* funcName, const int lineNum,
+		const char* fmt,const char* msg)
+{
+	if(!msg)
+		msg = "(null)";
+	return pLogWriter->logStr(pLogWriter,logLevel,pLogWriter->moduleName,
+			file,funcName,lineNum,fmt,msg,(int)strlen(msg));
+}
+#endif
+
+/* helper function to log a payload appended to the message, the payload is truncated to
+ * the largest record of the queue, the log writers truncate the record further. */
+static int sWriterLogBlob(LogLevel logLevel,
+		const char* file,const char* funcName, const int lineNum,
+		int encoding,const void* data,int len,
+		const char* fmt,va_list ap)
+{
+	char msg[LIMITED_FMT_MAX];
+	char tail[LL_BLOB_TAIL_MAX];
+	LLBlobBuf scratch = {0};
+	int srcLen = LLBlobSourceLen(encoding,LL_ASYNC_RECORD_MAX);
+	int retVal = -1;
+	char* out;
+	if(srcLen > len)
+		srcLen = len;
+	vsnprintf(msg,sizeof(msg),fmt,ap);
+	out = LLBlobBufReserve(&scratch,LLBlobEncodedLen(encoding,srcLen) + 1);
+	if(out)
+	{
+		int n = LLBlobEncode(encoding,data,srcLen,out);
+		tail[LLBlobFormatTail(tail,OutputFormatText,encoding,len - srcLen)] = '\0';
+		retVal = sWriterLog(logLevel,file,funcName,lineNum,"%s%.*s%s",msg,n,out,tail);
+	}
+	LLBlobBufFree(&scratch);
+	return retVal;
+}
+
+/* helper function to account a record dropped by the governor, and to end the window. */
+static void sGovernorTick(LogLevel logLevel)
+{
+	PLAtomicInc64(&sGovernor.dropped[logLevel]);
+	/* the window is checked without the lock first, to keep dropped records cheap. */
+	if(LLGetMonotonicNs() - sGovernor.windowStartNs < GOVERNOR_WINDOW_NS)
+		return;
+	__LOCK_MUTEX;
+	if(sGovernor.enabled && pLogWriter)
+		sGovernorAccount(-1);
+	__UNLOCK_MUTEX;
+}
+
+/* helper function to account a record, and to adjust the level at the end of a window. 
+ * bytes is -1 to only check the end of the window. */
+static void sGovernorAccount(int bytes)
+{
+	unsigned long long now, elapsed;
+	unsigned long recordsPerSec, bytesPerSec;
+	unsigned long long dropped[Fatal + 1];
+	unsigned long long lowerRecords = 0;
+	unsigned long lowerRecordsPerSec, lowerBytesPerSec;
+	int level, lowerLevel, i;
+
+	if(bytes >= 0)
+	{
+		sGovernor.records++;
+		sGovernor.bytes += bytes;
+	}
+	now = LLGetMonotonicNs();
+	elapsed = now - sGovernor.windowStartNs;
+	if(elapsed < GOVERNOR_WINDOW_NS)
+		return;
+
+	recordsPerSec = (unsigned long)(sGovernor.records * (double)GOVERNOR_WINDOW_NS / elapsed);
+	bytesPerSec = (unsigned long)(sGovernor.bytes * (double)GOVERNOR_WINDOW_NS / elapsed);
+	if(sGovernor.records)
+		sGovernor.recordBytes = sGovernor.bytes / sGovernor.records;
+	for(i = 0; i <= Fatal; i++)
+		dropped[i] = (unsigned long long)PLAtomicExchange64(&sGovernor.dropped[i],0);
+	sGovernor.windowStartNs = now;
+	sGovernor.records = 0;
+	sGovernor.bytes = 0;
+
+	/* the load once lowered by one step, with the records dropped at the levels it lets through. */
+	lowerLevel = (sGovernor.level - 1 > (int)pLogWriter->logLevel) ? sGovernor.level - 1 : 0;
+	for(i = lowerLevel; i <= Fatal; i++)
+		lowerRecords += dropped[i];
+	lowerRecordsPerSec = recordsPerSec + (unsigned long)(lowerRecords * (double)GOVERNOR_WINDOW_NS / elapsed);
+	lowerBytesPerSec = bytesPerSec + (unsigned long)(lowerRecords * sGovernor.recordBytes * (double)GOVERNOR_WINDOW_NS / elapsed);
+
+	/* the level in effect is the highest of the log writer and governor levels. */
+	level = ((int)pLogWriter->logLevel > sGovernor.level) ? (int)pLogWriter->logLevel : sGovernor.level;
+	if( (sGovernor.params.maxRecordsPerSec && (recordsPerSec > sGovernor.params.maxRecordsPerSec)) ||
+		(sGovernor.params.maxBytesPerSec && (bytesPerSec > sGovernor.params.maxBytesPerSec)) )
+	{
+		sGovernor.quietWindows = 0;
+		if(level < (int)sGovernor.params.maxLevel)
+		{
+			sGovernor.level = level + 1;
+			sWriterLog(Warn,"liblogger","LogGovernor",0,"log governor : %lu records/s, %lu bytes/s over budget, raised the log level to %s",
+					recordsPerSec,bytesPerSec,LLLevelName((LogLevel)sGovernor.level));
+		}
+	}
+	else if( sGovernor.level &&
+		(!sGovernor.params.maxRecordsPerSec || (lowerRecordsPerSec < sGovernor.params.maxRecordsPerSec / 2)) &&
+		(!sGovernor.params.maxBytesPerSec || (lowerBytesPerSec < sGovernor.params.maxBytesPerSec / 2)) )
+	{
+		/* hysteresis : the level is lowered only after a few quiet windows, one step at a time. */
+		if(++sGovernor.quietWindows >= sGovernor.params.coolDownSec)
+		{
+			sGovernor.quietWindows = 0;
+			sGovernor.level = lowerLevel;
+			sWriterLog(Warn,"liblogger","LogGovernor",0,"log governor : %lu records/s, %lu bytes/s with the dropped records, lowered the log level to %s",
+					lowerRecordsPerSec,lowerBytesPerSec,LLLevelName(sGovernor.level ? (LogLevel)sGovernor.level : pLogWriter->logLevel));
+		}
+	}
+	else
+		sGovernor.quietWindows = 0;
+}
@@ -0,0 +1,274 @@
+/*
+       Licensed to the Apache Software Foundation (ASF) under one
+       or more contributor license agreements.  See the NOTICE file
+       distributed with this work for additional information
+       regarding copyright ownership.  The ASF licenses this file
+       to you under the Apache License, Version 2.0 (the
+       "License"); you may not use this file except in compliance
+       with the License.  You may obtain a copy of the License at
+
+         http://www.apache.org/licenses/LICENSE-2.0
+
+       Unless required by applicable law or agreed to in writing,
+       software distributed under the License is distributed on an
+       "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+       KIND, either express or implied.  See the License for the
+       specific language governing permissions and limitations
+       under the License.
+ */
+/**
+ * \file Implementation of the mapped diagnostic context, see \ref GRP_CONTEXT.
+ * The context lives in thread local storage, it is never shared between threads
+ * and therefore needs no lock.
+ * */
+#include "log_context.h"
+#include "json_encoder.h"
+#include <string.h>
+
+#ifndef DISABLE_THREAD_SAFETY
+	#include "tPLThread.h"
+	#define LL_THREAD_LOCAL	PL_THREAD_LOCAL
+#else
+	#define LL_THREAD_LOCAL
+#endif
+
+/** The maximum length of the rendered context, the pairs which do not fit are omitted. */
+#define CONTEXT_RENDER_MAX	1024
+
+/** A key / value pair of the context. */
+typedef struct LLContextEntry
+{
+	char	key[LL_CONTEXT_MAX_KEY + 1];
+	char	value[LL_CONTEXT_MAX_VALUE + 1];
+} LLContextEntry;
+
+/** The context of a thread. */
+typedef struct LLThreadContext
+{
+	/** Set once the thread id and name are read. */
+	int				initialized;
+	/** The thread id, read once per thread. */
+	unsigned long	tid;
+	/** The thread name, empty if unknown. */
+	char			threadName[LL_CONTEXT_MAX_VALUE + 1];
+	/** The number of pairs pushed. */
+	int				depth;
+	LLContextEntry	entries[LL_CONTEXT_MAX_ENTRIES];
+	/** Per output format, set while \ref rendered is up to date. */
+	int				valid[2];
+	/** Per output format, the length of \ref rendered. */
+	int				len[2];
+	/** Per output format, the cached rendering. */
+	char			rendered[2][CONTEXT_RENDER_MAX + LL_OUT_RESERVE];
+} LLThreadContext;
+
+/** The context of the calling thread. */
+static LL_THREAD_LOCAL LLThreadContext sContext;
+
+/* helper function to copy a string, truncated to the size of dst. */
+static void sCopy(char* dst, const char* src, int size)
+{
+	strncpy(dst, src, size - 1);
+	dst[size - 1] = 0;
+}
+
+/* helper function to get the context of the calling thread, the thread id and name
+ * are read on first use. */
+static LLThreadContext* sGetContext(void)
+{
+	LLThreadContext* ctx = &sContext;
+	if(!ctx->initialized)
+	{
+#ifndef DISABLE_THREAD_SAFETY
+		ctx->tid = PLGetThreadId();
+		if(PLGetThreadName(ctx->threadName, sizeof(ctx->threadName)) != 0)
+			ctx->threadName[0] = 0;
+#endif
+		ctx->initialized = 1;
+	}
+	return ctx;
+}
+
+/* helper function to mark the renderings stale. */
+static void sInvalidate(LLThreadContext* ctx)
+{
+	ctx->valid[OutputFormatText] = 0;
+	ctx->valid[OutputFormatJson] = 0;
+}
+
+/* Push a key / value pair on the context of the calling thread. */
+int LogContextPush(const char* key, const char* value)
+{
+	LLThreadContext* ctx = sGetContext();
+	if(!key || !(*key) || !value || (ctx->depth >= LL_CONTEXT_MAX_ENTRIES))
+		return -1;
+	sCopy(ctx->entries[ctx->depth].key, key, sizeof(ctx->entries[0].key));
+	sCopy(ctx->entries[ctx->depth].value, value, sizeof(ctx->entries[0].value));
+	ctx->depth++;
+	sInvalidate(ctx);
+	return 0;
+}
+
+/* Pop the pair pushed last on the context of the calling thread. */
+int LogContextPop(void)
+{
+	LLThreadContext* ctx = sGetContext();
+	if(!ctx->depth)
+		return -1;
+	ctx->depth--;
+	sInvalidate(ctx);
+	return 0;
+}
+
+/* Remove all the pairs from the context of the calling thread. */
+void LogContextClear(void)
+{
+	LLThreadContext* ctx = sGetContext();
+	ctx->depth = 0;
+	sInvalidate(ctx);
+}
+
+/* Set the thread name written in the context of the calling thread. */
+void LogSetThreadName(const char* name)
+{
+	LLThreadContext* ctx = sGetContext();
+	sCopy(ctx->threadName, name ? name : "", sizeof(ctx->threadName));
+	sInvalidate(ctx);
+}
+
+/* helper function to append a text value, quoted only if it would be ambiguous. */
+static void sAppendTextValue(LLOutBuf* b, const char* value)
+{
+	int len = (int)strlen(value);
+	int i;
+	for(i = 0; i < len; i++)
+	{
+		unsigned char c = (unsigned char)value[i];
+		if((c <= ' ') || (c == '"') || (c == ']') || (c == '='))
+		{
+			LLJsonAppendString(b, value, len);
+			return;
+		}
+	}
+	LLOutAppend(b, value, len);
+}
+
+/* helper function to append a pair, the pair is omitted as a whole if it does not fit. */
+static void sAppendPair(LLOutBuf* b, tOutputFormat format, const char* key,
+		const char* value, unsigned long num)
+{
+	int start = b->len;
+	if(OutputFormatJson == format)
+	{
+		LLJsonAppendKey(b, key);
+		if(value)
+			LLJsonAppendString(b, value, (int)strlen(value));
+		else
+			LLJsonAppendUInt(b, num);
+	}
+	else
+	{
+		char digits[24];
+		int numLen = 0;
+		if(start > 1)
+			LLOutAppend(b, " ", 1);
+		LLOutAppend(b, key, (int)strlen(key));
+		LLOutAppend(b, "=", 1);
+		if(value)
+			sAppendTextValue(b, value);
+		else
+		{
+			do
+			{
+				digits[sizeof(digits) - 1 - numLen++] = (char)('0' + num % 10);
+				num /= 10;
+			} while(num);
+			LLOutAppend(b, digits + sizeof(digits) - numLen, numLen);
+		}
+	}
+	if(b->truncated)
+	{
+		b->len = start;
+		b->truncated = 0;
+	}
+}
+
+/* helper function to render the context. */
+static void sRender(LLThreadContext* ctx, tOutputFormat format)
+{
+	LLOutBuf b;
+	int i, j;
+	LLOutInit(&b, ctx->rendered[format], sizeof(ctx->rendered[format]));
+	if(OutputFormatText == format)
+		LLOutAppend(&b, "[", 1);
+	if(ctx->tid)
+		sAppendPair(&b, format, "tid", NULL, ctx->tid);
+	if(ctx->threadName[0])
+		sAppendPair(&b, format, "thread", ctx->threadName, 0);
+	for(i = 0; i < ctx->depth; i++)
+	{
+		/* a key pushed again hides the previous values. */
+		for(j = i + 1; j < ctx->depth; j++)
+		{
+			if(!strcmp(ctx->entries[i].key, ctx->entries[j].key))
+				break;
+		}
+		if(j == ctx->depth)
+			sAppendPair(&b, format, ctx->entries[i].key, ctx->entries[i].value, 0);
+	}
+	if(OutputFormatText == format)
+	{
+		if(1 == b.len)
+			b.len = 0;
+		else
+		{
+			/* the closing bracket fits in the reserve. */
+			memcpy(b.data + b.len, "] ", 2);
+			b.len += 2;
+		}
+	}
+	ctx->len[format] = b.len;
+	ctx->valid[format] = 1;
+}
+
+/* Returns the context of the calling thread rendered in format. */
+const char* LLGetContext(tOutputFormat format, int* len)
+{
+	LLThreadContext* ctx = sGetContext();
+	if(OutputFormatJson != format)
+		format = OutputFormatText;
+	if(!ctx->valid[format])
+		sRender(ctx, format);
+	*len = ctx->len[format];
+	return ctx->rendered[format];
+}
+
+/* Copies the context of the calling thread rendered in format. */
+int LLCopyContext(char* dst, int size, tOutputFormat format)
+{
+	int len;
+	const char* rendered = LLGetContext(format, &len);
+	if(len > size)
+		return 0;
+	memcpy(dst, rendered, len);
+	return len;
+}
+
+/* Returns the name of the calling thread and its id. */
+const char* LLGetThreadName(unsigned long* tid)
+{
+	LLThreadContext* ctx = sGetContext();
+	*tid = ctx->tid;
+	return ctx->threadName;
+}
+
+/* Reads the thread id again, called in the child after fork(). */
+void LLContextAfterFork(void)
+{
+	LLThreadContext* ctx = &sContext;
+	if(!ctx->initialized)
+		return;
+	ctx->initialized = 0;
+	sGetContext();
+	sInvalidate(ctx);
+}
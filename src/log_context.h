@@ -0,0 +1,48 @@
+/*
+       Licensed to the Apache Software Foundation (ASF) under one
+       or more contributor license agreements.  See the NOTICE file
+       distributed with this work for additional information
+       regarding copyright ownership.  The ASF licenses this file
+       to you under the Apache License, Version 2.0 (the
+       "License"); you may not use this file except in compliance
+       with the License.  You may obtain a copy of the License at
+
+         http://www.apache.org/licenses/LICENSE-2.0
+
+       Unless required by applicable law or agreed to in writing,
+       software distributed under the License is distributed on an
+       "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+       KIND, either express or implied.  See the License for the
+       specific language governing permissions and limitations
+       under the License.
+ */
+/**
+ * \file The mapped diagnostic context of the threads, see \ref GRP_CONTEXT.
+ * */
+#ifndef __LOG_CONTEXT_IMPL_H__
+#define __LOG_CONTEXT_IMPL_H__
+
+#include <liblogger/liblogger.h>
+
+/** Returns the context of the calling thread rendered in \a format, the rendering is
+ * cached until the context of the thread changes.
+ * Text : "[tid=4242 thread=main key=value] ", JSON : ,"tid":4242,"thread":"main","key":"value"
+ * \param [in]  format	The output format.
+ * \param [out] len		The length of the rendering.
+ * \returns the rendering, not null terminated.
+ * */
+const char* LLGetContext(tOutputFormat format, int* len);
+
+/** Copies the context of the calling thread rendered in \a format to \a dst.
+ * \returns the length copied, 0 if the context is empty or does not fit in \a size bytes.
+ * */
+int LLCopyContext(char* dst, int size, tOutputFormat format);
+
+/** Returns the name of the calling thread, empty if unknown, and its id in \a tid. */
+const char* LLGetThreadName(unsigned long* tid);
+
+/** Reads the thread id again, called in the child after fork() : the thread of the child
+ * keeps the context of the thread which forked, with the id of this thread. */
+void LLContextAfterFork(void);
+
+#endif // __LOG_CONTEXT_IMPL_H__
@@ -0,0 +1,225 @@
+/*
+       Licensed to the Apache Software Foundation (ASF) under one
+       or more contributor license agreements.  See the NOTICE file
+       distributed with this work for additional information
+       regarding copyright ownership.  The ASF licenses this file
+       to you under the Apache License, Version 2.0 (the
+       "License"); you may not use this file except in compliance
+       with the License.  You may obtain a copy of the License at
+
+         http://www.apache.org/licenses/LICENSE-2.0
+
+       Unless required by applicable law or agreed to in writing,
+       software distributed under the License is distributed on an
+       "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+       KIND, either express or implied.  See the License for the
+       specific language governing permissions and limitations
+       under the License.
+ */
+/**
+ * \file A fast LZ77 block codec, see lz_codec.h.
+ * The compressor is greedy : the positions of the 4 bytes sequences are hashed in a table,
+ * a match is taken as soon as the table points to the same 4 bytes, and the search skips
+ * ahead faster while no match is found (incompressible data).
+ * */
+#include "lz_codec.h"
+#include <string.h>
+
+#define HASH_LOG		12
+#define MIN_MATCH		4
+/** The last bytes of a block are always literals. */
+#define LAST_LITERALS	5
+/** A match starts at least this far from the end of the block. */
+#define MF_LIMIT		12
+#define MAX_DISTANCE	65535
+/** The search step grows by one every 2^SKIP_TRIGGER bytes without a match. */
+#define SKIP_TRIGGER	6
+
+static unsigned int sRead32(const unsigned char* p)
+{
+	unsigned int v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+static unsigned int sHash(unsigned int seq)
+{
+	return (seq * 2654435761u) >> (32 - HASH_LOG);
+}
+
+/* helper function to write a length continuation, 255 per byte. */
+static unsigned char* sPutLength(unsigned char* op, int len)
+{
+	while(len >= 255)
+	{
+		*op++ = 255;
+		len -= 255;
+	}
+	*op++ = (unsigned char)len;
+	return op;
+}
+
+/* Compresses a block. */
+int LLLzCompress(const char* src, int srcLen, char* dst, int dstSize, void* work)
+{
+	const unsigned char* base = (const unsigned char*)src;
+	const unsigned char* ip = base;
+	const unsigned char* anchor = base;
+	const unsigned char* end = base + srcLen;
+	const unsigned char* matchLimit = end - LAST_LITERALS;
+	const unsigned char* mfLimit = end - MF_LIMIT;
+	unsigned char* op = (unsigned char*)dst;
+	unsigned char* oend = op + dstSize;
+	unsigned int* table = (unsigned int*)work;
+	int litLen;
+
+	memset(table, 0, LL_LZ_WORKMEM_SIZE);
+	if(srcLen > MF_LIMIT)
+	{
+		unsigned int searched = 1 << SKIP_TRIGGER;
+		while(ip < mfLimit)
+		{
+			unsigned int seq = sRead32(ip);
+			unsigned int h = sHash(seq);
+			const unsigned char* ref = base + table[h];
+			int len, ml;
+			unsigned char* token;
+			table[h] = (unsigned int)(ip - base);
+			if( (ref >= ip) || (ip - ref > MAX_DISTANCE) || (sRead32(ref) != seq) )
+			{
+				ip += searched++ >> SKIP_TRIGGER;
+				continue;
+			}
+			searched = 1 << SKIP_TRIGGER;
+			/* extend the match backwards, into the pending literals, then forwards. */
+			while((ip > anchor) && (ref > base) && (ip[-1] == ref[-1]))
+			{
+				ip--;
+				ref--;
+			}
+			len = MIN_MATCH;
+			while((ip + len < matchLimit) && (ip[len] == ref[len]))
+				len++;
+
+			litLen = (int)(ip - anchor);
+			if(op + 1 + litLen / 255 + 1 + litLen + 2 + (len - MIN_MATCH) / 255 + 1 > oend)
+				return 0;
+			token = op++;
+			if(litLen >= 15)
+			{
+				*token = 15 << 4;
+				op = sPutLength(op, litLen - 15);
+			}
+			else
+				*token = (unsigned char)(litLen << 4);
+			memcpy(op, anchor, litLen);
+			op += litLen;
+			*op++ = (unsigned char)((ip - ref) & 0xff);
+			*op++ = (unsigned char)((ip - ref) >> 8);
+			ml = len - MIN_MATCH;
+			if(ml >= 15)
+			{
+				*token |= 15;
+				op = sPutLength(op, ml - 15);
+			}
+			else
+				*token |= (unsigned char)ml;
+
+			ip += len;
+			anchor = ip;
+			/* the end of the match is a likely start of the next one. */
+			if(ip < mfLimit)
+				table[sHash(sRead32(ip - 2))] = (unsigned int)(ip - 2 - base);
+		}
+	}
+
+	/* the last literals. */
+	litLen = (int)(end - anchor);
+	if(op + 1 + litLen / 255 + 1 + litLen > oend)
+		return 0;
+	if(litLen >= 15)
+	{
+		*op++ = 15 << 4;
+		op = sPutLength(op, litLen - 15);
+	}
+	else
+		*op++ = (unsigned char)(litLen << 4);
+	memcpy(op, anchor, litLen);
+	op += litLen;
+	return (int)(op - (unsigned char*)dst);
+}
+
+/* helper function to read a length continuation. \returns -1 if the data is truncated. */
+static int sGetLength(const unsigned char** ip, const unsigned char* iend, int len)
+{
+	unsigned char b;
+	do
+	{
+		if((*ip >= iend) || (len > 0x7fffffff - 255))
+			return -1;
+		b = *(*ip)++;
+		len += b;
+	} while(255 == b);
+	return len;
+}
+
+/* Decompresses a block. */
+int LLLzDecompress(const char* src, int srcLen, char* dst, int dstSize)
+{
+	const unsigned char* ip = (const unsigned char*)src;
+	const unsigned char* iend = ip + srcLen;
+	unsigned char* op = (unsigned char*)dst;
+	unsigned char* oend = op + dstSize;
+
+	while(ip < iend)
+	{
+		unsigned int token = *ip++;
+		int litLen = token >> 4;
+		int ml = token & 15;
+		int offset;
+		const unsigned char* ref;
+		if(15 == litLen)
+		{
+			litLen = sGetLength(&ip, iend, litLen);
+			if(litLen < 0)
+				return -1;
+		}
+		if((litLen > iend - ip) || (litLen > oend - op))
+			return -1;
+		memcpy(op, ip, litLen);
+		op += litLen;
+		ip += litLen;
+		/* the last sequence has no match. */
+		if(ip >= iend)
+			break;
+
+		if(iend - ip < 2)
+			return -1;
+		offset = ip[0] | (ip[1] << 8);
+		ip += 2;
+		if(!offset || (offset > op - (unsigned char*)dst))
+			return -1;
+		if(15 == ml)
+		{
+			ml = sGetLength(&ip, iend, ml);
+			if(ml < 0)
+				return -1;
+		}
+		ml += MIN_MATCH;
+		if(ml > oend - op)
+			return -1;
+		ref = op - offset;
+		/* the match may overlap the bytes it produces. */
+		if(offset >= ml)
+		{
+			memcpy(op, ref, ml);
+			op += ml;
+		}
+		else
+		{
+			while(ml--)
+				*op++ = *ref++;
+		}
+	}
+	return (int)(op - (unsigned char*)dst);
+}
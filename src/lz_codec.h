@@ -0,0 +1,52 @@
+/*
+       Licensed to the Apache Software Foundation (ASF) under one
+       or more contributor license agreements.  See the NOTICE file
+       distributed with this work for additional information
+       regarding copyright ownership.  The ASF licenses this file
+       to you under the Apache License, Version 2.0 (the
+       "License"); you may not use this file except in compliance
+       with the License.  You may obtain a copy of the License at
+
+         http://www.apache.org/licenses/LICENSE-2.0
+
+       Unless required by applicable law or agreed to in writing,
+       software distributed under the License is distributed on an
+       "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+       KIND, either express or implied.  See the License for the
+       specific language governing permissions and limitations
+       under the License.
+ */
+/**
+ * \file A fast LZ77 block codec, with the block format of LZ4 : a sequence of literals and
+ * matches of at least 4 bytes within the last 64 KiB, without any header or checksum.
+ * The blocks are independent, a block is decompressed without the previous ones.
+ * */
+#ifndef __LZ_CODEC_H__
+#define __LZ_CODEC_H__
+
+/** The maximum size of the compressed data of \a n bytes, when it is not compressible. */
+#define LL_LZ_COMPRESS_BOUND(n)	((n) + (n) / 255 + 16)
+
+/** The size of the work memory of \ref LLLzCompress. */
+#define LL_LZ_WORKMEM_SIZE		(sizeof(unsigned int) << 12)
+
+/** Compresses a block.
+ * \param [in]  src		The data to compress.
+ * \param [in]  srcLen	The length of \a src.
+ * \param [out] dst		The compressed data.
+ * \param [in]  dstSize	The size of \a dst.
+ * \param [in]  work	\ref LL_LZ_WORKMEM_SIZE bytes, aligned for an unsigned int.
+ * \returns the length of the compressed data, 0 if it does not fit in \a dst.
+ * */
+int LLLzCompress(const char* src, int srcLen, char* dst, int dstSize, void* work);
+
+/** Decompresses a block, the compressed data is checked so a corrupted block is rejected.
+ * \param [in]  src		The compressed data.
+ * \param [in]  srcLen	The length of \a src.
+ * \param [out] dst		The decompressed data.
+ * \param [in]  dstSize	The size of \a dst.
+ * \returns the length of the decompressed data, -1 if \a src is corrupted or does not fit in \a dst.
+ * */
+int LLLzDecompress(const char* src, int srcLen, char* dst, int dstSize);
+
+#endif // __LZ_CODEC_H__
@@ -0,0 +1,78 @@
+/*
+       Licensed to the Apache Software Foundation (ASF) under one
+       or more contributor license agreements.  See the NOTICE file
+       distributed with this work for additional information
+       regarding copyright ownership.  The ASF licenses this file
+       to you under the Apache License, Version 2.0 (the
+       "License"); you may not use this file except in compliance
+       with the License.  You may obtain a copy of the License at
+
+         http://www.apache.org/licenses/LICENSE-2.0
+
+       Unless required by applicable law or agreed to in writing,
+       software distributed under the License is distributed on an
+       "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+       KIND, either express or implied.  See the License for the
+       specific language governing permissions and limitations
+       under the License.
+ */
+/**
+ * \file Platform Layer for asynchronous file writes, with io_uring on Linux.
+ * The data is copied to a few registered buffers, which are appended to the file by a chain
+ * of linked writes, so that they are written in order while the caller goes on. Only one
+ * chain is in flight at a time, the buffers filled meanwhile are submitted as the next chain.
+ * The file is written in append mode, so that the other writers of the file (stdio, the crash
+ * handler, the child processes) append to it too.
+ * Where io_uring is not available, \ref PLAsyncFileOpen fails and the caller writes the file
+ * with the other functions of the platform layer.
+ * */
+#ifndef __PLASYNCFILE_H__
+#define __PLASYNCFILE_H__
+
+/** Abstract handle for a file written asynchronously. */
+typedef struct PLAsyncFile* tPLAsyncFile;
+
+/** Start writing a file asynchronously, the file is switched to append mode.
+ * \param [out] af			The handle.
+ * \param [in]  fd			The file descriptor, it is not closed by \ref PLAsyncFileClose.
+ * \param [in]  numBuffers	The number of buffers, which is the largest number of writes in flight.
+ * \param [in]  bufferSize	The size of a buffer in bytes.
+ * \returns 0 on success, -1 if asynchronous writes are not available.
+ * */
+int PLAsyncFileOpen(tPLAsyncFile* af, int fd, int numBuffers, int bufferSize);
+
+/** Copy data to the buffers, the full buffers are submitted once the chain in flight is done,
+ * waiting for it only if no buffer is free.
+ * \returns 0 on success, -1 if a write failed.
+ * */
+int PLAsyncFileWrite(tPLAsyncFile af, const void* data, int len);
+
+/** Collect the completed writes and submit the buffered data, if no chain is in flight.
+ * \param [in] wait		Non zero to wait for the chain in flight, so that the data is always submitted.
+ * \returns 0 on success, -1 if a write failed.
+ * */
+int PLAsyncFileSubmit(tPLAsyncFile af, int wait);
+
+/** Returns the number of bytes buffered and not yet submitted. */
+int PLAsyncFilePending(tPLAsyncFile af);
+
+/** Submit the buffered data followed by a flush of the file to the storage device
+ * (fdatasync), and wait for them.
+ * \returns 0 on success, -1 on failure.
+ * */
+int PLAsyncFileSync(tPLAsyncFile af);
+
+/** Append the data which is not known to be written (buffered or in flight), then \a data,
+ * with synchronous writes. Async-signal-safe, called from a signal handler.
+ * */
+int PLAsyncFileCrashWrite(tPLAsyncFile af, const void* data, int len);
+
+/** Called in the child process after fork() : the ring of the parent is left to it and the
+ * buffered data is discarded (the parent writes it), a new ring is set up for the child.
+ * */
+void PLAsyncFileAfterFork(tPLAsyncFile af);
+
+/** Write the buffered data, wait for the writes in flight and free the handle. */
+void PLAsyncFileClose(tPLAsyncFile* af);
+
+#endif // __PLASYNCFILE_H__
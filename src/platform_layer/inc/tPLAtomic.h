@@ -0,0 +1,71 @@
+/*
+       Licensed to the Apache Software Foundation (ASF) under one
+       or more contributor license agreements.  See the NOTICE file
+       distributed with this work for additional information
+       regarding copyright ownership.  The ASF licenses this file
+       to you under the Apache License, Version 2.0 (the
+       "License"); you may not use this file except in compliance
+       with the License.  You may obtain a copy of the License at
+
+         http://www.apache.org/licenses/LICENSE-2.0
+
+       Unless required by applicable law or agreed to in writing,
+       software distributed under the License is distributed on an
+       "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+       KIND, either express or implied.  See the License for the
+       specific language governing permissions and limitations
+       under the License.
+ */
+/**
+ * \file Platform Layer for atomic operations on 64 bit integers.
+ * The operations are implemented with compiler intrinsics, they are lock-free
+ * and act as full memory barriers.
+ * */
+#ifndef __T_PLATOMIC_H__
+#define __T_PLATOMIC_H__
+
+#if defined(_MSC_VER)
+/* Windows */
+#include <windows.h>
+/** An integer accessed with the atomic operations. */
+typedef volatile LONGLONG tPLAtomic64;
+/** Atomically increment the value, returns the new value. */
+#define PLAtomicInc64(p)				InterlockedIncrement64((p))
+/** Atomically add to the value, returns the new value. */
+#define PLAtomicAdd64(p, v)				(InterlockedExchangeAdd64((p), (v)) + (v))
+/** Atomically replace the value, returns the previous value. */
+#define PLAtomicExchange64(p, v)		InterlockedExchange64((p), (v))
+/** Atomically replace the value if it is equal to \a oldVal, returns non zero on success. */
+#define PLAtomicCAS64(p, oldVal, newVal)	(InterlockedCompareExchange64((p), (newVal), (oldVal)) == (oldVal))
+/** Atomically read the value. */
+#define PLAtomicLoad64(p)				InterlockedCompareExchange64((p), 0, 0)
+#elif defined(__GNUC__)
+/* GCC / clang */
+/** An integer accessed with the atomic operations. */
+typedef volatile long long tPLAtomic64;
+/** Atomically increment the value, returns the new value. */
+#define PLAtomicInc64(p)				__sync_add_and_fetch((p), 1)
+/** Atomically add to the value, returns the new value. */
+#define PLAtomicAdd64(p, v)				__sync_add_and_fetch((p), (v))
+/** Atomically replace the value, returns the previous value. */
+#define PLAtomicExchange64(p, v)		sPLAtomicExchange64((p), (v))
+/** Atomically replace the value if it is equal to \a oldVal, returns non zero on success. */
+#define PLAtomicCAS64(p, oldVal, newVal)	__sync_bool_compare_and_swap((p), (oldVal), (newVal))
+/** Atomically read the value. */
+#define PLAtomicLoad64(p)				__sync_add_and_fetch((p), 0)
+
+/* __sync_lock_test_and_set() is only an acquire barrier, use a CAS loop instead. */
+static __inline__ long long sPLAtomicExchange64(tPLAtomic64* p, long long v)
+{
+	long long old;
+	do
+	{
+		old = *p;
+	} while(!__sync_bool_compare_and_swap(p, old, v));
+	return old;
+}
+#else
+/* Unsupported platform. */
+#endif
+
+#endif // __T_PLATOMIC_H__
@@ -0,0 +1,61 @@
+/*
+       Licensed to the Apache Software Foundation (ASF) under one
+       or more contributor license agreements.  See the NOTICE file
+       distributed with this work for additional information
+       regarding copyright ownership.  The ASF licenses this file
+       to you under the Apache License, Version 2.0 (the
+       "License"); you may not use this file except in compliance
+       with the License.  You may obtain a copy of the License at
+
+         http://www.apache.org/licenses/LICENSE-2.0
+
+       Unless required by applicable law or agreed to in writing,
+       software distributed under the License is distributed on an
+       "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+       KIND, either express or implied.  See the License for the
+       specific language governing permissions and limitations
+       under the License.
+ */
+/**
+ * \file Platform Layer for low level file functions.
+ * The functions declared here operate on raw file descriptors, and on POSIX
+ * systems they are async-signal-safe, so they can be used from a signal handler.
+ * */
+#ifndef __PLFILE_H__
+#define __PLFILE_H__
+
+/** The largest number of parts written by \ref PLFileWriteV / \ref PLSockSendV. */
+#define PL_IOV_MAX	8
+
+/** A part of the data written by a vectored write. */
+typedef struct tPLIoVec
+{
+	const void*	data;
+	int			len;
+} tPLIoVec;
+
+/** Write data to a raw file descriptor, retrying on short writes / interrupts.
+ * \param [in] fd		The file descriptor.
+ * \param [in] data		The data to write.
+ * \param [in] dataSize	The size of data.
+ * \returns the amount of bytes written, -1 on failure.
+ * */
+int PLFileWrite(int fd, const void* data, const int dataSize);
+
+/** Write the parts of the data to a raw file descriptor with a single system call
+ * (writev()) where available, retrying on short writes / interrupts.
+ * \param [in] fd		The file descriptor.
+ * \param [in] iov		The parts of the data.
+ * \param [in] count	The number of parts, at most \ref PL_IOV_MAX.
+ * \returns the amount of bytes written, -1 on failure.
+ * */
+int PLFileWriteV(int fd, const tPLIoVec* iov, int count);
+
+/** Flush the data of a raw file descriptor to the storage device
+ * (fdatasync() where available).
+ * \param [in] fd	The file descriptor.
+ * \returns 0 on success, -1 on failure.
+ * */
+int PLFileSync(int fd);
+
+#endif // __PLFILE_H__
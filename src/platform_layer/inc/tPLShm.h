@@ -0,0 +1,66 @@
+/*
+       Licensed to the Apache Software Foundation (ASF) under one
+       or more contributor license agreements.  See the NOTICE file
+       distributed with this work for additional information
+       regarding copyright ownership.  The ASF licenses this file
+       to you under the Apache License, Version 2.0 (the
+       "License"); you may not use this file except in compliance
+       with the License.  You may obtain a copy of the License at
+
+         http://www.apache.org/licenses/LICENSE-2.0
+
+       Unless required by applicable law or agreed to in writing,
+       software distributed under the License is distributed on an
+       "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+       KIND, either express or implied.  See the License for the
+       specific language governing permissions and limitations
+       under the License.
+ */
+/**
+ * \file Platform Layer for named shared memory, shared by several processes, and for the
+ * wakeup of a process waiting on a word of the shared memory.
+ * */
+#ifndef __PLSHM_H__
+#define __PLSHM_H__
+
+/** Handle of a shared memory mapping. */
+typedef struct PLShm* tPLShm;
+
+/** Open a named shared memory, created if it does not exist.
+ * \param [in]  name	The name of the shared memory, a file of /dev/shm on Linux.
+ * \param [in]  size	The size of the shared memory when it is created.
+ * \param [out] shm		The handle of the mapping.
+ * \param [out] addr	The address of the mapping.
+ * \param [out] mapSize	The size of the mapping, the size of an existing shared memory.
+ * \returns 1 if the shared memory is created (it is zeroed), 0 if it exists, -1 on failure.
+ * */
+int PLShmOpen(const char* name, unsigned int size, tPLShm* shm, void** addr, unsigned int* mapSize);
+
+/** Unmap the shared memory, it remains until it is removed with \ref PLShmRemove. */
+void PLShmClose(tPLShm* shm);
+
+/** Remove a named shared memory, the current mappings remain valid.
+ * \returns 0 on success, -1 on failure.
+ * */
+int PLShmRemove(const char* name);
+
+/** Wait until the word is changed by \ref PLShmWake, or for \a timeoutMs ms.
+ * Returns at once if the word is not equal to \a value.
+ * */
+void PLShmWait(volatile int* word, int value, int timeoutMs);
+
+/** Increment the word, a full memory barrier, and wake the processes waiting on it.
+ * Async-signal-safe.
+ * */
+void PLShmWake(volatile int* word);
+
+/** \returns the id of the calling process. */
+int PLGetProcessId(void);
+
+/** \returns 0 if the process is known to be gone, non zero if it exists or if it is not known. */
+int PLProcessExists(int pid);
+
+/** Sleep for \a ms ms. */
+void PLSleepMs(int ms);
+
+#endif // __PLSHM_H__
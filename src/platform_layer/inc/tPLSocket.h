@@ -22,6 +22,8 @@
 #ifndef __PLSOCKET_H__
 #define __PLSOCKET_H__
 
+#include "tPLFile.h"
+
 #if defined(WIN32) || (_WIN32)
 /* Windows */
 #include <winsock2.h>
@@ -51,6 +53,15 @@ int PLCreateConnectedSocket(const char* server, int port, tPLSocket *sock);
  * */
 int PLSockSend(tPLSocket sock,const void* data,const int dataSize);
 
+/** Send the parts of the data over socket with a single system call (sendmsg / WSASend),
+ * retrying on short sends.
+ * \param [in] tPLSocket 	The socket handle created via \ref CreateConnectedSocket.
+ * \param [in] iov			The parts of the data.
+ * \param [in] count		The number of parts, at most \ref PL_IOV_MAX.
+ * \return On success, the amount of bytes sent, -1 otherwise.
+ * */
+int PLSockSendV(tPLSocket sock,const tPLIoVec* iov,int count);
+
 /** Close the Socket.
  * \param [in,out] sock	The socket handle created via \ref CreateConnectedSocket.
  * */
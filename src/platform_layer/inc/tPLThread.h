@@ -0,0 +1,102 @@
+/*
+       Licensed to the Apache Software Foundation (ASF) under one
+       or more contributor license agreements.  See the NOTICE file
+       distributed with this work for additional information
+       regarding copyright ownership.  The ASF licenses this file
+       to you under the Apache License, Version 2.0 (the
+       "License"); you may not use this file except in compliance
+       with the License.  You may obtain a copy of the License at
+
+         http://www.apache.org/licenses/LICENSE-2.0
+
+       Unless required by applicable law or agreed to in writing,
+       software distributed under the License is distributed on an
+       "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+       KIND, either express or implied.  See the License for the
+       specific language governing permissions and limitations
+       under the License.
+ */
+/**
+ * \file Platform Layer for threads and monitors (a mutex with a condition variable).
+ * */
+#ifndef __PLTHREAD_H__
+#define __PLTHREAD_H__
+
+/** Abstract handle for a thread. */
+typedef struct PLThread* tPLThread;
+/** Abstract handle for a monitor. */
+typedef struct PLMonitor* tPLMonitor;
+/** Abstract handle for a thread specific value, see \ref PLCreateThreadKey. */
+typedef struct PLThreadKey* tPLThreadKey;
+
+/** Storage class specifier of thread local variables. */
+#if defined(_MSC_VER)
+	#define PL_THREAD_LOCAL	__declspec(thread)
+#else
+	#define PL_THREAD_LOCAL	__thread
+#endif
+
+/** The thread entry function. */
+typedef void (*tPLThreadFunc)(void* arg);
+
+/** Create and start a thread.
+ * \param [out] thread	The thread handle.
+ * \param [in]  func	The thread entry function.
+ * \param [in]  arg		The argument passed to \a func.
+ * \returns 0 on success, -1 on failure.
+ * */
+int PLCreateThread(tPLThread* thread, tPLThreadFunc func, void* arg);
+
+/** Wait for a thread to exit and release the thread handle.
+ * \param [in,out] thread	The thread handle created via \ref PLCreateThread.
+ * \returns 0 on success, -1 on failure.
+ * */
+int PLJoinThread(tPLThread* thread);
+
+/** Get the id of the calling thread, as shown by the system tools (the kernel thread id on Linux). */
+unsigned long PLGetThreadId(void);
+
+/** Get the name of the calling thread.
+ * \param [out] buf	The buffer where the name is copied.
+ * \param [in]  size	The size of \a buf.
+ * \returns 0 on success, -1 if the thread name is not available.
+ * */
+int PLGetThreadName(char* buf, int size);
+
+/** Register the functions called around fork() : \a prepare in the parent before the fork,
+ * \a parent and \a child in each process after it. Does nothing where fork() does not exist.
+ * \returns 0 on success, -1 on failure.
+ * */
+int PLRegisterAtFork(void (*prepare)(void), void (*parent)(void), void (*child)(void));
+
+/** Create a key for a thread specific value, whose destructor is called when a thread
+ * which has set a value (not NULL) exits. The key can not be destroyed.
+ * \param [out] key			The key handle.
+ * \param [in]  destructor	The function called with the value of the exiting thread.
+ * \returns 0 on success, -1 on failure.
+ * */
+int PLCreateThreadKey(tPLThreadKey* key, void (*destructor)(void* value));
+
+/** Set the value of the calling thread for a key, NULL to not call the destructor.
+ * \returns 0 on success, -1 on failure.
+ * */
+int PLSetThreadKey(tPLThreadKey key, void* value);
+
+/** Create a monitor. */
+int PLCreateMonitor(tPLMonitor* mon);
+/** Enter (lock) the monitor. */
+int PLEnterMonitor(tPLMonitor mon);
+/** Exit (unlock) the monitor. */
+int PLExitMonitor(tPLMonitor mon);
+/** Wait on the monitor until notified, the monitor must be entered.
+ * \param [in] mon			The monitor.
+ * \param [in] timeoutMs	The maximum time to wait in milliseconds, -1 to wait forever.
+ * \returns 0 when notified, 1 on timeout, -1 on failure.
+ * */
+int PLWaitMonitor(tPLMonitor mon, int timeoutMs);
+/** Wake up all the threads waiting on the monitor. */
+int PLNotifyMonitor(tPLMonitor mon);
+/** Destroy the monitor. */
+int PLDestroyMonitor(tPLMonitor* mon);
+
+#endif // __PLTHREAD_H__
@@ -0,0 +1,55 @@
+/*
+       Licensed to the Apache Software Foundation (ASF) under one
+       or more contributor license agreements.  See the NOTICE file
+       distributed with this work for additional information
+       regarding copyright ownership.  The ASF licenses this file
+       to you under the Apache License, Version 2.0 (the
+       "License"); you may not use this file except in compliance
+       with the License.  You may obtain a copy of the License at
+
+         http://www.apache.org/licenses/LICENSE-2.0
+
+       Unless required by applicable law or agreed to in writing,
+       software distributed under the License is distributed on an
+       "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+       KIND, either express or implied.  See the License for the
+       specific language governing permissions and limitations
+       under the License.
+ */
+/**
+ * \file Platform Layer for the time stamp counter (TSC) of the x86 processors.
+ * The counter is read with a compiler intrinsic in a few cycles, without a system call.
+ * \ref PL_HAS_TSC is defined where the counter can be read, elsewhere \ref PLReadTsc
+ * returns 0 and \ref PLTscInvariant fails.
+ * */
+#ifndef __T_PLTSC_H__
+#define __T_PLTSC_H__
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+/* Windows */
+#include <intrin.h>
+/** Defined if the time stamp counter can be read. */
+#define PL_HAS_TSC
+/** Read the time stamp counter, in ticks. */
+#define PLReadTsc()		((unsigned long long)__rdtsc())
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+/* GCC / clang */
+#include <x86intrin.h>
+/** Defined if the time stamp counter can be read. */
+#define PL_HAS_TSC
+/** Read the time stamp counter, in ticks. */
+#define PLReadTsc()		((unsigned long long)__rdtsc())
+#else
+/* Unsupported platform. */
+#define PLReadTsc()		0ULL
+#endif
+
+/** Check if the time stamp counter can be used as a clock : it must be invariant (its rate
+ * does not change with the frequency nor the power states of the processor), and the
+ * operating system must not have found it unreliable (not synchronized between the
+ * processors for example).
+ * \returns non zero if the counter is usable.
+ * */
+int PLTscInvariant(void);
+
+#endif // __T_PLTSC_H__
@@ -0,0 +1,581 @@
+/*
+       Licensed to the Apache Software Foundation (ASF) under one
+       or more contributor license agreements.  See the NOTICE file
+       distributed with this work for additional information
+       regarding copyright ownership.  The ASF licenses this file
+       to you under the Apache License, Version 2.0 (the
+       "License"); you may not use this file except in compliance
+       with the License.  You may obtain a copy of the License at
+
+         http://www.apache.org/licenses/LICENSE-2.0
+
+       Unless required by applicable law or agreed to in writing,
+       software distributed under the License is distributed on an
+       "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+       KIND, either express or implied.  See the License for the
+       specific language governing permissions and limitations
+       under the License.
+ */
+/**
+ * \file Implementation of the asynchronous file API for POSIX platforms.
+ * On Linux the writes go through io_uring, set up with the raw system calls : the buffers
+ * and the file are registered, a chain of linked writes appends the buffers in order and a
+ * flush to the storage device is linked at the end of the chain. A write which fails or is
+ * short cancels the rest of its chain, the data not written is then appended with write(2),
+ * as the data of all the writes once the ring can not be used (a child process which can
+ * not set up its own ring, for example). Asynchronous writes are not available on the
+ * other systems.
+ * */
+#include "tPLAsyncFile.h"
+#include "tPLFile.h"
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#if defined(__linux__)
+#include <sys/syscall.h>
+#if defined(__has_include)
+	#if __has_include(<linux/io_uring.h>) && defined(__NR_io_uring_setup)
+		#define PL_HAVE_IO_URING
+	#endif
+#endif
+#endif
+
+#ifdef PL_HAVE_IO_URING
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+
+/** The largest number of buffers. */
+#define MAX_BUFFERS		64
+/** The user data of the flush at the end of a chain, the writes have the index of their buffer. */
+#define SYNC_TAG		0xFFFFFFFFull
+
+typedef struct PLAsyncBuf
+{
+	char*	data;
+	int		len;
+	/** The result of the write of the buffer, -1 until it is known. */
+	int		done;
+} PLAsyncBuf;
+
+struct PLAsyncFile
+{
+	int					fd;
+	/** The io_uring, -1 if the data is written with write(2). */
+	int					ringFd;
+	void*				sqRing;
+	size_t				sqRingSize;
+	void*				cqRing;
+	size_t				cqRingSize;
+	struct io_uring_sqe*	sqes;
+	size_t				sqesSize;
+	unsigned*			sqTail;
+	unsigned			sqMask;
+	unsigned*			sqArray;
+	unsigned*			cqHead;
+	unsigned*			cqTail;
+	unsigned			cqMask;
+	struct io_uring_cqe*	cqes;
+	/** Non zero if the file / the buffers are registered. */
+	int					fixedFile;
+	int					fixedBuffers;
+	/** The memory of the buffers. */
+	char*				mem;
+	size_t				memSize;
+	PLAsyncBuf			bufs[MAX_BUFFERS];
+	int					numBuffers;
+	int					bufferSize;
+	/** The oldest buffer in flight, followed by the buffers queued and by the one being
+	 * filled, at (head + numInFlight + numQueued) % numBuffers. */
+	int					head;
+	int					numInFlight;
+	int					numQueued;
+	/** The number of bytes buffered and not submitted. */
+	int					pendingBytes;
+	/** The completions expected for the chain in flight. */
+	int					chainLeft;
+	/** Non zero if the chain in flight ends with a flush, and its result. */
+	int					syncInFlight;
+	int					syncResult;
+	/** Non zero once a write or a flush failed. */
+	int					error;
+};
+
+static int sUringSetup(unsigned entries, struct io_uring_params* p)
+{
+	return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int sUringEnter(int ringFd, unsigned toSubmit, unsigned minComplete, unsigned flags)
+{
+	return (int)syscall(__NR_io_uring_enter, ringFd, toSubmit, minComplete, flags, NULL, 0);
+}
+
+static int sUringRegister(int ringFd, unsigned opcode, void* arg, unsigned numArgs)
+{
+	return (int)syscall(__NR_io_uring_register, ringFd, opcode, arg, numArgs);
+}
+
+/* helper function to free the ring, the buffers are kept. */
+static void sTeardownRing(struct PLAsyncFile* af)
+{
+	if(af->sqes && (af->sqes != MAP_FAILED))
+		munmap(af->sqes, af->sqesSize);
+	if(af->cqRing && (af->cqRing != MAP_FAILED) && (af->cqRing != af->sqRing))
+		munmap(af->cqRing, af->cqRingSize);
+	if(af->sqRing && (af->sqRing != MAP_FAILED))
+		munmap(af->sqRing, af->sqRingSize);
+	if(af->ringFd >= 0)
+		close(af->ringFd);
+	af->sqes = 0;
+	af->cqRing = 0;
+	af->sqRing = 0;
+	af->ringFd = -1;
+	af->fixedFile = 0;
+	af->fixedBuffers = 0;
+}
+
+/* helper function to set up the ring, and to register the file and the buffers. */
+static int sSetupRing(struct PLAsyncFile* af)
+{
+	struct io_uring_params p;
+	struct iovec iov[MAX_BUFFERS];
+	char* sq;
+	char* cq;
+	int i;
+	memset(&p, 0, sizeof(p));
+	/* a chain has a write per buffer and a flush. */
+	af->ringFd = sUringSetup(af->numBuffers + 1, &p);
+	if(af->ringFd < 0)
+		return -1;
+	af->sqRingSize = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+	af->cqRingSize = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+	if(p.features & IORING_FEAT_SINGLE_MMAP)
+	{
+		if(af->cqRingSize > af->sqRingSize)
+			af->sqRingSize = af->cqRingSize;
+		af->cqRingSize = af->sqRingSize;
+	}
+	af->sqRing = mmap(0, af->sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+			af->ringFd, IORING_OFF_SQ_RING);
+	if(MAP_FAILED == af->sqRing)
+		goto FAIL;
+	if(p.features & IORING_FEAT_SINGLE_MMAP)
+		af->cqRing = af->sqRing;
+	else
+	{
+		af->cqRing = mmap(0, af->cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+				af->ringFd, IORING_OFF_CQ_RING);
+		if(MAP_FAILED == af->cqRing)
+			goto FAIL;
+	}
+	af->sqesSize = p.sq_entries * sizeof(struct io_uring_sqe);
+	af->sqes = (struct io_uring_sqe*)mmap(0, af->sqesSize, PROT_READ | PROT_WRITE,
+			MAP_SHARED | MAP_POPULATE, af->ringFd, IORING_OFF_SQES);
+	if(MAP_FAILED == (void*)af->sqes)
+		goto FAIL;
+	sq = (char*)af->sqRing;
+	cq = (char*)af->cqRing;
+	af->sqTail = (unsigned*)(sq + p.sq_off.tail);
+	af->sqMask = *(unsigned*)(sq + p.sq_off.ring_mask);
+	af->sqArray = (unsigned*)(sq + p.sq_off.array);
+	af->cqHead = (unsigned*)(cq + p.cq_off.head);
+	af->cqTail = (unsigned*)(cq + p.cq_off.tail);
+	af->cqMask = *(unsigned*)(cq + p.cq_off.ring_mask);
+	af->cqes = (struct io_uring_cqe*)(cq + p.cq_off.cqes);
+
+	/* the registrations save the lookups of each write, they are optional. */
+	af->fixedFile = (0 == sUringRegister(af->ringFd, IORING_REGISTER_FILES, &af->fd, 1));
+	for(i = 0; i < af->numBuffers; i++)
+	{
+		iov[i].iov_base = af->bufs[i].data;
+		iov[i].iov_len = af->bufferSize;
+	}
+	af->fixedBuffers = (0 == sUringRegister(af->ringFd, IORING_REGISTER_BUFFERS, iov, af->numBuffers));
+	return 0;
+
+FAIL:
+	sTeardownRing(af);
+	return -1;
+}
+
+/* helper function to append the data of the chain which was not written, once it is complete. */
+static void sChainDone(struct PLAsyncFile* af)
+{
+	int i;
+	for(i = 0; i < af->numInFlight; i++)
+	{
+		PLAsyncBuf* b = &af->bufs[(af->head + i) % af->numBuffers];
+		int done = (b->done > 0) ? b->done : 0;
+		/* the writes after a failed one are cancelled, so the data stays in order. */
+		if( (done < b->len) && (PLFileWrite(af->fd, b->data + done, b->len - done) < 0) )
+			af->error = 1;
+		b->len = 0;
+		b->done = -1;
+	}
+	if( af->syncInFlight && (af->syncResult < 0) && PLFileSync(af->fd) )
+		af->error = 1;
+	af->head = (af->head + af->numInFlight) % af->numBuffers;
+	af->numInFlight = 0;
+	af->syncInFlight = 0;
+}
+
+/* helper function to collect the completions of the chain in flight. */
+static void sReap(struct PLAsyncFile* af, int wait)
+{
+	while(af->chainLeft > 0)
+	{
+		unsigned head = *af->cqHead;
+		unsigned tail = __atomic_load_n(af->cqTail, __ATOMIC_ACQUIRE);
+		if(head == tail)
+		{
+			if(!wait)
+				return;
+			if( (sUringEnter(af->ringFd, 0, 1, IORING_ENTER_GETEVENTS) < 0) && (EINTR != errno) )
+			{
+				/* the ring is not usable, the whole chain is written again. */
+				af->chainLeft = 0;
+				break;
+			}
+			continue;
+		}
+		for(; head != tail; head++)
+		{
+			struct io_uring_cqe* cqe = &af->cqes[head & af->cqMask];
+			if(SYNC_TAG == cqe->user_data)
+				af->syncResult = cqe->res;
+			else if(cqe->user_data < (unsigned long long)af->numBuffers)
+				af->bufs[cqe->user_data].done = cqe->res;
+			af->chainLeft--;
+		}
+		__atomic_store_n(af->cqHead, head, __ATOMIC_RELEASE);
+	}
+	if(af->numInFlight || af->syncInFlight)
+		sChainDone(af);
+}
+
+/* helper function to submit the buffers queued and the one being filled, there must not be
+ * a chain in flight. The flush is linked at the end of the chain only if it has all the data.
+ * \returns non zero if all the data is submitted.
+ * */
+static int sSubmitChain(struct PLAsyncFile* af, int withSync)
+{
+	int fill = (af->head + af->numQueued) % af->numBuffers;
+	int count = af->numQueued;
+	unsigned tail;
+	int i, ret;
+	/* the buffer being filled is taken if another one is left to be filled. */
+	if( af->bufs[fill].len && (count + 1 < af->numBuffers) )
+		count++;
+	if(count < af->numQueued + (af->bufs[fill].len ? 1 : 0))
+		withSync = 0;
+	if(!count && !withSync)
+		return 1;
+	if(af->ringFd < 0)
+	{
+		/* synchronous writes. */
+		af->numInFlight = count;
+		af->numQueued -= (count > af->numQueued) ? af->numQueued : count;
+		af->pendingBytes = 0;
+		for(i = 0; i < count; i++)
+			af->bufs[(af->head + i) % af->numBuffers].done = -1;
+		af->syncInFlight = withSync;
+		af->syncResult = -1;
+		sChainDone(af);
+		af->pendingBytes = af->bufs[(af->head + af->numQueued) % af->numBuffers].len;
+		return !af->pendingBytes;
+	}
+
+	tail = *af->sqTail;
+	for(i = 0; i < count + withSync; i++)
+	{
+		struct io_uring_sqe* sqe = &af->sqes[tail & af->sqMask];
+		memset(sqe, 0, sizeof(*sqe));
+		sqe->fd = af->fixedFile ? 0 : af->fd;
+		sqe->flags = af->fixedFile ? IOSQE_FIXED_FILE : 0;
+		if(i < count)
+		{
+			int b = (af->head + i) % af->numBuffers;
+			/* the file is in append mode, the offset is ignored. */
+			sqe->opcode = af->fixedBuffers ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+			sqe->addr = (unsigned long)af->bufs[b].data;
+			sqe->len = af->bufs[b].len;
+			sqe->buf_index = af->fixedBuffers ? b : 0;
+			sqe->user_data = b;
+			af->bufs[b].done = -1;
+			af->pendingBytes -= af->bufs[b].len;
+			if(i + 1 < count + withSync)
+				sqe->flags |= IOSQE_IO_LINK;
+		}
+		else
+		{
+			sqe->opcode = IORING_OP_FSYNC;
+			sqe->fsync_flags = IORING_FSYNC_DATASYNC;
+			sqe->user_data = SYNC_TAG;
+		}
+		af->sqArray[tail & af->sqMask] = tail & af->sqMask;
+		tail++;
+	}
+	__atomic_store_n(af->sqTail, tail, __ATOMIC_RELEASE);
+	af->numInFlight = count;
+	af->numQueued -= (count > af->numQueued) ? af->numQueued : count;
+	af->syncInFlight = withSync;
+	af->syncResult = -1;
+	af->chainLeft = count + withSync;
+	do
+	{
+		ret = sUringEnter(af->ringFd, count + withSync, 0, 0);
+	} while( (ret < 0) && ((EINTR == errno) || (EAGAIN == errno) || (EBUSY == errno)) );
+	if(ret < 0)
+	{
+		/* not submitted, the chain is written with write(2) from now on. */
+		*af->sqTail = tail - count - withSync;
+		af->chainLeft = 0;
+		sTeardownRing(af);
+		sChainDone(af);
+	}
+	return !af->pendingBytes;
+}
+
+/* Start writing a file asynchronously. */
+int PLAsyncFileOpen(tPLAsyncFile* handle, int fd, int numBuffers, int bufferSize)
+{
+	struct PLAsyncFile* af;
+	long pageSize = sysconf(_SC_PAGESIZE);
+	int flags, i;
+	if(!handle || (fd < 0) || (bufferSize <= 0))
+		return -1;
+	*handle = 0;
+	if(numBuffers < 2)
+		numBuffers = 2;
+	else if(numBuffers > MAX_BUFFERS)
+		numBuffers = MAX_BUFFERS;
+	if(pageSize <= 0)
+		pageSize = 4096;
+	bufferSize = (int)((bufferSize + pageSize - 1) / pageSize * pageSize);
+	/* the chains are appended, as are the writes of the other writers of the file. */
+	flags = fcntl(fd, F_GETFL);
+	if( (flags < 0) || (!(flags & O_APPEND) && (fcntl(fd, F_SETFL, flags | O_APPEND) < 0)) )
+		return -1;
+	af = (struct PLAsyncFile*)calloc(1, sizeof(struct PLAsyncFile));
+	if(!af)
+		return -1;
+	af->fd = fd;
+	af->ringFd = -1;
+	af->numBuffers = numBuffers;
+	af->bufferSize = bufferSize;
+	af->memSize = (size_t)numBuffers * bufferSize;
+	af->mem = (char*)mmap(0, af->memSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if(MAP_FAILED == af->mem)
+	{
+		free(af);
+		return -1;
+	}
+	for(i = 0; i < numBuffers; i++)
+	{
+		af->bufs[i].data = af->mem + (size_t)i * bufferSize;
+		af->bufs[i].done = -1;
+	}
+	if(sSetupRing(af))
+	{
+		munmap(af->mem, af->memSize);
+		free(af);
+		return -1;
+	}
+	*handle = af;
+	return 0;
+}
+
+/* Copy data to the buffers. */
+int PLAsyncFileWrite(tPLAsyncFile af, const void* data, int len)
+{
+	const char* p = (const char*)data;
+	if(!af || !data || (len < 0))
+		return -1;
+	while(len > 0)
+	{
+		PLAsyncBuf* b = &af->bufs[(af->head + af->numInFlight + af->numQueued) % af->numBuffers];
+		int n = af->bufferSize - b->len;
+		if(!n)
+		{
+			if(af->numInFlight + af->numQueued + 1 < af->numBuffers)
+				af->numQueued++;
+			else
+			{
+				/* no buffer is free, wait for the chain in flight. */
+				sReap(af, 1);
+				sSubmitChain(af, 0);
+			}
+			continue;
+		}
+		if(n > len)
+			n = len;
+		memcpy(b->data + b->len, p, n);
+		b->len += n;
+		af->pendingBytes += n;
+		p += n;
+		len -= n;
+	}
+	return af->error ? -1 : 0;
+}
+
+/* Collect the completed writes and submit the buffered data. */
+int PLAsyncFileSubmit(tPLAsyncFile af, int wait)
+{
+	if(!af)
+		return -1;
+	do
+	{
+		sReap(af, wait);
+		if(!af->numInFlight)
+			sSubmitChain(af, 0);
+	} while(wait && af->pendingBytes);
+	return af->error ? -1 : 0;
+}
+
+/* Returns the number of bytes buffered and not yet submitted. */
+int PLAsyncFilePending(tPLAsyncFile af)
+{
+	return af ? af->pendingBytes : 0;
+}
+
+/* Submit the buffered data followed by a flush, and wait for them. */
+int PLAsyncFileSync(tPLAsyncFile af)
+{
+	int synced;
+	if(!af)
+		return -1;
+	do
+	{
+		sReap(af, 1);
+		synced = sSubmitChain(af, 1);
+	} while(!synced);
+	sReap(af, 1);
+	return af->error ? -1 : 0;
+}
+
+/* Append the data not known to be written, then the data, async-signal-safe. */
+int PLAsyncFileCrashWrite(tPLAsyncFile af, const void* data, int len)
+{
+	int i, ret = 0;
+	if(!af)
+		return -1;
+	/* the writes completed are not written again, the others might be written twice. */
+	if(af->ringFd >= 0)
+	{
+		unsigned head = *af->cqHead;
+		unsigned tail = __atomic_load_n(af->cqTail, __ATOMIC_ACQUIRE);
+		for(; head != tail; head++)
+		{
+			struct io_uring_cqe* cqe = &af->cqes[head & af->cqMask];
+			if(cqe->user_data < (unsigned long long)af->numBuffers)
+				af->bufs[cqe->user_data].done = cqe->res;
+		}
+		*af->cqHead = head;
+	}
+	for(i = 0; i <= af->numInFlight + af->numQueued; i++)
+	{
+		PLAsyncBuf* b = &af->bufs[(af->head + i) % af->numBuffers];
+		int done = ((i < af->numInFlight) && (b->done > 0)) ? b->done : 0;
+		if( (done < b->len) && (PLFileWrite(af->fd, b->data + done, b->len - done) < 0) )
+			ret = -1;
+		b->len = 0;
+		b->done = -1;
+	}
+	af->head = (af->head + af->numInFlight + af->numQueued) % af->numBuffers;
+	af->numInFlight = 0;
+	af->numQueued = 0;
+	af->pendingBytes = 0;
+	af->chainLeft = 0;
+	af->syncInFlight = 0;
+	if( (len > 0) && (PLFileWrite(af->fd, data, len) < 0) )
+		ret = -1;
+	return ret;
+}
+
+/* Set up a new ring in the child process after fork(). */
+void PLAsyncFileAfterFork(tPLAsyncFile af)
+{
+	int i;
+	if(!af)
+		return;
+	/* the mappings of the ring are shared with the parent, only the child's are removed. */
+	sTeardownRing(af);
+	for(i = 0; i < af->numBuffers; i++)
+	{
+		af->bufs[i].len = 0;
+		af->bufs[i].done = -1;
+	}
+	af->head = 0;
+	af->numInFlight = 0;
+	af->numQueued = 0;
+	af->pendingBytes = 0;
+	af->chainLeft = 0;
+	af->syncInFlight = 0;
+	af->error = 0;
+	/* the data is written with write(2) if the child can not have a ring. */
+	sSetupRing(af);
+}
+
+/* Write the buffered data, wait for the writes in flight and free the handle. */
+void PLAsyncFileClose(tPLAsyncFile* handle)
+{
+	struct PLAsyncFile* af;
+	if(!handle || !*handle)
+		return;
+	af = *handle;
+	PLAsyncFileSubmit(af, 1);
+	sReap(af, 1);
+	sTeardownRing(af);
+	munmap(af->mem, af->memSize);
+	free(af);
+	*handle = 0;
+}
+
+#else // PL_HAVE_IO_URING
+
+/* Asynchronous writes are not available, the file is written with write(2). */
+int PLAsyncFileOpen(tPLAsyncFile* handle, int fd, int numBuffers, int bufferSize)
+{
+	if(handle)
+		*handle = 0;
+	return -1;
+}
+
+int PLAsyncFileWrite(tPLAsyncFile af, const void* data, int len)
+{
+	return -1;
+}
+
+int PLAsyncFileSubmit(tPLAsyncFile af, int wait)
+{
+	return -1;
+}
+
+int PLAsyncFilePending(tPLAsyncFile af)
+{
+	return 0;
+}
+
+int PLAsyncFileSync(tPLAsyncFile af)
+{
+	return -1;
+}
+
+int PLAsyncFileCrashWrite(tPLAsyncFile af, const void* data, int len)
+{
+	return -1;
+}
+
+void PLAsyncFileAfterFork(tPLAsyncFile af)
+{
+}
+
+void PLAsyncFileClose(tPLAsyncFile* handle)
+{
+}
+
+#endif // PL_HAVE_IO_URING
@@ -0,0 +1,101 @@
+/*
+       Licensed to the Apache Software Foundation (ASF) under one
+       or more contributor license agreements.  See the NOTICE file
+       distributed with this work for additional information
+       regarding copyright ownership.  The ASF licenses this file
+       to you under the Apache License, Version 2.0 (the
+       "License"); you may not use this file except in compliance
+       with the License.  You may obtain a copy of the License at
+
+         http://www.apache.org/licenses/LICENSE-2.0
+
+       Unless required by applicable law or agreed to in writing,
+       software distributed under the License is distributed on an
+       "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+       KIND, either express or implied.  See the License for the
+       specific language governing permissions and limitations
+       under the License.
+ */
+/**
+ * \file Implementation of the low level file API for POSIX platforms.
+ * */
+#include "tPLFile.h"
+#include <unistd.h>
+#include <errno.h>
+#include <sys/uio.h>
+
+/* Write data to a raw file descriptor, retrying on short writes / interrupts.
+ * Only async-signal-safe calls are used here.
+ * */
+int PLFileWrite(int fd, const void* data, const int dataSize)
+{
+	const char* p = (const char*)data;
+	int written = 0;
+	if( (fd < 0) || !data || (dataSize < 0) )
+		return -1;
+	while(written < dataSize)
+	{
+		ssize_t ret = write(fd, p + written, dataSize - written);
+		if(ret < 0)
+		{
+			if(errno == EINTR)
+				continue;
+			return -1;
+		}
+		written += (int)ret;
+	}
+	return written;
+}
+
+/* Write the parts of the data with writev(), the parts written by a short write are
+ * skipped and the rest is written again. Only async-signal-safe calls are used here.
+ * */
+int PLFileWriteV(int fd, const tPLIoVec* iov, int count)
+{
+	struct iovec vec[PL_IOV_MAX];
+	int written = 0;
+	int i, n = 0;
+	if( (fd < 0) || !iov || (count < 0) || (count > PL_IOV_MAX) )
+		return -1;
+	for(i = 0; i < count; i++)
+	{
+		if(iov[i].len <= 0)
+			continue;
+		vec[n].iov_base = (void*)iov[i].data;
+		vec[n].iov_len = iov[i].len;
+		n++;
+	}
+	i = 0;
+	while(i < n)
+	{
+		ssize_t ret = writev(fd, vec + i, n - i);
+		if(ret < 0)
+		{
+			if(errno == EINTR)
+				continue;
+			return -1;
+		}
+		written += (int)ret;
+		while( (i < n) && ((size_t)ret >= vec[i].iov_len) )
+			ret -= vec[i++].iov_len;
+		if(i < n)
+		{
+			vec[i].iov_base = (char*)vec[i].iov_base + ret;
+			vec[i].iov_len -= ret;
+		}
+	}
+	return written;
+}
+
+/* Flush the data of a raw file descriptor to the storage device. */
+int PLFileSync(int fd)
+{
+	if(fd < 0)
+		return -1;
+#if defined(__APPLE__)
+	/* no fdatasync() on Mac OS X. */
+	return fsync(fd);
+#else
+	return fdatasync(fd);
+#endif
+}
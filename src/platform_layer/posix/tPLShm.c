@@ -0,0 +1,180 @@
+/*
+       Licensed to the Apache Software Foundation (ASF) under one
+       or more contributor license agreements.  See the NOTICE file
+       distributed with this work for additional information
+       regarding copyright ownership.  The ASF licenses this file
+       to you under the Apache License, Version 2.0 (the
+       "License"); you may not use this file except in compliance
+       with the License.  You may obtain a copy of the License at
+
+         http://www.apache.org/licenses/LICENSE-2.0
+
+       Unless required by applicable law or agreed to in writing,
+       software distributed under the License is distributed on an
+       "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+       KIND, either express or implied.  See the License for the
+       specific language governing permissions and limitations
+       under the License.
+ */
+/**
+ * \file Implementation of the shared memory API for POSIX platforms.
+ * The waits use a futex on Linux, they poll the word on the other systems.
+ * */
+#include "tPLShm.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+struct PLShm
+{
+	void*			addr;
+	unsigned int	size;
+};
+
+/* helper function to make the name of a POSIX shared memory, "/name". */
+static void sShmName(char* buf, int size, const char* name)
+{
+	snprintf(buf, size, "%s%s", ('/' == name[0]) ? "" : "/", name);
+}
+
+/* Open a named shared memory, created if it does not exist. */
+int PLShmOpen(const char* name, unsigned int size, tPLShm* shm, void** addr, unsigned int* mapSize)
+{
+	char shmName[256];
+	struct stat st;
+	struct PLShm* s;
+	int created = 1;
+	int fd;
+	if(!name || !shm || !addr || !mapSize)
+		return -1;
+	*shm = 0;
+	sShmName(shmName, sizeof(shmName), name);
+	fd = shm_open(shmName, O_RDWR | O_CREAT | O_EXCL, 0600);
+	if((fd < 0) && (EEXIST == errno))
+	{
+		created = 0;
+		fd = shm_open(shmName, O_RDWR, 0600);
+	}
+	if(fd < 0)
+		return -1;
+	if(created)
+	{
+		/* the new pages are zeroed. */
+		if(ftruncate(fd, size) != 0)
+		{
+			close(fd);
+			shm_unlink(shmName);
+			return -1;
+		}
+	}
+	else
+	{
+		/* the size of the creator, it may still be setting it. */
+		int tries;
+		for(tries = 0; (0 == fstat(fd, &st)) && !st.st_size && (tries < 1000); tries++)
+			PLSleepMs(1);
+		if(!st.st_size)
+		{
+			close(fd);
+			return -1;
+		}
+		size = (unsigned int)st.st_size;
+	}
+	s = (struct PLShm*)malloc(sizeof(struct PLShm));
+	if(!s)
+	{
+		close(fd);
+		return -1;
+	}
+	s->addr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	/* the mapping remains once the descriptor is closed. */
+	close(fd);
+	if(MAP_FAILED == s->addr)
+	{
+		free(s);
+		return -1;
+	}
+	s->size = size;
+	*shm = s;
+	*addr = s->addr;
+	*mapSize = size;
+	return created;
+}
+
+/* Unmap the shared memory. */
+void PLShmClose(tPLShm* shm)
+{
+	if(!shm || !*shm)
+		return;
+	munmap((*shm)->addr, (*shm)->size);
+	free(*shm);
+	*shm = 0;
+}
+
+/* Remove a named shared memory. */
+int PLShmRemove(const char* name)
+{
+	char shmName[256];
+	sShmName(shmName, sizeof(shmName), name);
+	return shm_unlink(shmName);
+}
+
+/* Wait until the word is changed by PLShmWake. */
+void PLShmWait(volatile int* word, int value, int timeoutMs)
+{
+#if defined(__linux__)
+	struct timespec ts;
+	ts.tv_sec = timeoutMs / 1000;
+	ts.tv_nsec = (timeoutMs % 1000) * 1000000L;
+	/* not FUTEX_PRIVATE_FLAG, the word is shared by several processes. */
+	syscall(SYS_futex, word, FUTEX_WAIT, value, &ts, NULL, 0);
+#else
+	int waited;
+	for(waited = 0; (*word == value) && (waited < timeoutMs); waited++)
+		PLSleepMs(1);
+#endif
+}
+
+/* Increment the word and wake the processes waiting on it. */
+void PLShmWake(volatile int* word)
+{
+	__sync_add_and_fetch(word, 1);
+#if defined(__linux__)
+	syscall(SYS_futex, word, FUTEX_WAKE, 0x7fffffff, NULL, NULL, 0);
+#endif
+}
+
+/* Returns the id of the calling process. */
+int PLGetProcessId(void)
+{
+	return (int)getpid();
+}
+
+/* Returns 0 if the process is known to be gone. */
+int PLProcessExists(int pid)
+{
+	if(pid <= 0)
+		return 1;
+	return !((kill((pid_t)pid, 0) < 0) && (ESRCH == errno));
+}
+
+/* Sleep for ms ms. */
+void PLSleepMs(int ms)
+{
+	struct timespec ts;
+	ts.tv_sec = ms / 1000;
+	ts.tv_nsec = (ms % 1000) * 1000000L;
+	while((nanosleep(&ts, &ts) < 0) && (EINTR == errno))
+		;
+}
@@ -26,6 +26,7 @@
 #include <sys/types.h>
 #include <netinet/in.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <arpa/inet.h>
 
 
@@ -82,6 +83,50 @@ int PLSockSend(tPLSocket sock,const void* data,const int dataSize)
 	return send((int) sock,data,dataSize,0);
 }
 
+/* Send the parts of the data with sendmsg(), the parts sent by a short send are skipped
+ * and the rest is sent again. */
+int PLSockSendV(tPLSocket sock,const tPLIoVec* iov,int count)
+{
+	struct iovec vec[PL_IOV_MAX];
+	struct msghdr msg;
+	int sent = 0;
+	int i, n = 0;
+	if( !iov || (count < 0) || (count > PL_IOV_MAX) )
+		return -1;
+	for(i = 0; i < count; i++)
+	{
+		if(iov[i].len <= 0)
+			continue;
+		vec[n].iov_base = (void*)iov[i].data;
+		vec[n].iov_len = iov[i].len;
+		n++;
+	}
+	i = 0;
+	while(i < n)
+	{
+		ssize_t ret;
+		memset(&msg, 0, sizeof(msg));
+		msg.msg_iov = vec + i;
+		msg.msg_iovlen = n - i;
+		ret = sendmsg((int) sock, &msg, 0);
+		if(ret < 0)
+		{
+			if(errno == EINTR)
+				continue;
+			return -1;
+		}
+		sent += (int)ret;
+		while( (i < n) && ((size_t)ret >= vec[i].iov_len) )
+			ret -= vec[i++].iov_len;
+		if(i < n)
+		{
+			vec[i].iov_base = (char*)vec[i].iov_base + ret;
+			vec[i].iov_len -= ret;
+		}
+	}
+	return sent;
+}
+
 /* Close the Socket.
  * \param [in,out] sock	The socket handle created via \ref CreateConnectedSocket.
  * */
@@ -0,0 +1,249 @@
+/*
+       Licensed to the Apache Software Foundation (ASF) under one
+       or more contributor license agreements.  See the NOTICE file
+       distributed with this work for additional information
+       regarding copyright ownership.  The ASF licenses this file
+       to you under the Apache License, Version 2.0 (the
+       "License"); you may not use this file except in compliance
+       with the License.  You may obtain a copy of the License at
+
+         http://www.apache.org/licenses/LICENSE-2.0
+
+       Unless required by applicable law or agreed to in writing,
+       software distributed under the License is distributed on an
+       "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+       KIND, either express or implied.  See the License for the
+       specific language governing permissions and limitations
+       under the License.
+ */
+/**
+ * \file Implementation of the thread / monitor API for POSIX platforms.
+ * */
+#include "tPLThread.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <time.h>
+#include <errno.h>
+#include <unistd.h>
+#include <string.h>
+#if defined(__linux__)
+	#include <sys/syscall.h>
+	#include <sys/prctl.h>
+#endif
+
+struct PLThread
+{
+	pthread_t		thread;
+	tPLThreadFunc	func;
+	void*			arg;
+};
+
+struct PLMonitor
+{
+	pthread_mutex_t	mutex;
+	pthread_cond_t	cond;
+	/** The clock used by cond for timed waits. */
+	clockid_t		clock;
+};
+
+struct PLThreadKey
+{
+	pthread_key_t	key;
+};
+
+/** Trampoline from the pthread entry signature to \ref tPLThreadFunc. */
+static void* sThreadEntry(void* arg)
+{
+	struct PLThread* t = (struct PLThread*)arg;
+	t->func(t->arg);
+	return NULL;
+}
+
+/* Create and start a thread. */
+int PLCreateThread(tPLThread* thread, tPLThreadFunc func, void* arg)
+{
+	struct PLThread* t;
+	if(!thread || !func)
+		return -1;
+	t = (struct PLThread*)malloc(sizeof(struct PLThread));
+	if(!t)
+		return -1;
+	t->func = func;
+	t->arg = arg;
+	if(pthread_create(&t->thread, NULL, sThreadEntry, t) != 0)
+	{
+		free(t);
+		return -1;
+	}
+	*thread = t;
+	return 0;
+}
+
+/* Wait for a thread to exit and release the thread handle. */
+int PLJoinThread(tPLThread* thread)
+{
+	if(!thread || !(*thread))
+		return -1;
+	if(pthread_join((*thread)->thread, NULL) != 0)
+		return -1;
+	free(*thread);
+	*thread = 0;
+	return 0;
+}
+
+/* Get the id of the calling thread. */
+unsigned long PLGetThreadId(void)
+{
+#if defined(__linux__) && defined(SYS_gettid)
+	return (unsigned long)syscall(SYS_gettid);
+#elif defined(__APPLE__)
+	unsigned long long tid = 0;
+	pthread_threadid_np(NULL, &tid);
+	return (unsigned long)tid;
+#else
+	return (unsigned long)pthread_self();
+#endif
+}
+
+/* Get the name of the calling thread. */
+int PLGetThreadName(char* buf, int size)
+{
+#if defined(__linux__)
+	/* the kernel name is at most 16 bytes, including the terminating null. */
+	char name[17];
+	memset(name, 0, sizeof(name));
+	if(!buf || (size <= 0) || (prctl(PR_GET_NAME, name, 0, 0, 0) != 0))
+		return -1;
+	strncpy(buf, name, size - 1);
+	buf[size - 1] = 0;
+	return 0;
+#elif defined(__APPLE__)
+	if(!buf || (size <= 0))
+		return -1;
+	return (pthread_getname_np(pthread_self(), buf, size) == 0) ? 0 : -1;
+#else
+	(void)buf;
+	(void)size;
+	return -1;
+#endif
+}
+
+/* Register the functions called around fork(). */
+int PLRegisterAtFork(void (*prepare)(void), void (*parent)(void), void (*child)(void))
+{
+	return (pthread_atfork(prepare, parent, child) == 0) ? 0 : -1;
+}
+
+/* Create a key for a thread specific value. */
+int PLCreateThreadKey(tPLThreadKey* key, void (*destructor)(void* value))
+{
+	struct PLThreadKey* k;
+	if(!key)
+		return -1;
+	k = (struct PLThreadKey*)malloc(sizeof(struct PLThreadKey));
+	if(!k)
+		return -1;
+	if(pthread_key_create(&k->key, destructor) != 0)
+	{
+		free(k);
+		return -1;
+	}
+	*key = k;
+	return 0;
+}
+
+/* Set the value of the calling thread for a key. */
+int PLSetThreadKey(tPLThreadKey key, void* value)
+{
+	if(!key)
+		return -1;
+	return (pthread_setspecific(key->key, value) == 0) ? 0 : -1;
+}
+
+/* Create a monitor. */
+int PLCreateMonitor(tPLMonitor* mon)
+{
+	struct PLMonitor* m;
+	pthread_condattr_t attr;
+	if(!mon)
+		return -1;
+	m = (struct PLMonitor*)malloc(sizeof(struct PLMonitor));
+	if(!m)
+		return -1;
+	pthread_mutex_init(&m->mutex, NULL);
+	pthread_condattr_init(&attr);
+	m->clock = CLOCK_REALTIME;
+#if defined(_POSIX_MONOTONIC_CLOCK) && !defined(__APPLE__)
+	/* timed waits should not be affected by changes to the wall clock. */
+	if(pthread_condattr_setclock(&attr, CLOCK_MONOTONIC) == 0)
+		m->clock = CLOCK_MONOTONIC;
+#endif
+	pthread_cond_init(&m->cond, &attr);
+	pthread_condattr_destroy(&attr);
+	*mon = m;
+	return 0;
+}
+
+/* Enter (lock) the monitor. */
+int PLEnterMonitor(tPLMonitor mon)
+{
+	if(!mon)
+		return -1;
+	return (pthread_mutex_lock(&mon->mutex) == 0) ? 0 : -1;
+}
+
+/* Exit (unlock) the monitor. */
+int PLExitMonitor(tPLMonitor mon)
+{
+	if(!mon)
+		return -1;
+	return (pthread_mutex_unlock(&mon->mutex) == 0) ? 0 : -1;
+}
+
+/* Wait on the monitor until notified. */
+int PLWaitMonitor(tPLMonitor mon, int timeoutMs)
+{
+	int ret;
+	if(!mon)
+		return -1;
+	if(timeoutMs < 0)
+	{
+		ret = pthread_cond_wait(&mon->cond, &mon->mutex);
+	}
+	else
+	{
+		struct timespec ts;
+		clock_gettime(mon->clock, &ts);
+		ts.tv_sec += timeoutMs / 1000;
+		ts.tv_nsec += (long)(timeoutMs % 1000) * 1000000L;
+		if(ts.tv_nsec >= 1000000000L)
+		{
+			ts.tv_sec++;
+			ts.tv_nsec -= 1000000000L;
+		}
+		ret = pthread_cond_timedwait(&mon->cond, &mon->mutex, &ts);
+	}
+	if(ret == ETIMEDOUT)
+		return 1;
+	return (ret == 0) ? 0 : -1;
+}
+
+/* Wake up all the threads waiting on the monitor. */
+int PLNotifyMonitor(tPLMonitor mon)
+{
+	if(!mon)
+		return -1;
+	return (pthread_cond_broadcast(&mon->cond) == 0) ? 0 : -1;
+}
+
+/* Destroy the monitor. */
+int PLDestroyMonitor(tPLMonitor* mon)
+{
+	if(!mon || !(*mon))
+		return -1;
+	pthread_cond_destroy(&(*mon)->cond);
+	pthread_mutex_destroy(&(*mon)->mutex);
+	free(*mon);
+	*mon = 0;
+	return 0;
+}
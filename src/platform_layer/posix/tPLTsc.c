@@ -0,0 +1,57 @@
+/*
+       Licensed to the Apache Software Foundation (ASF) under one
+       or more contributor license agreements.  See the NOTICE file
+       distributed with this work for additional information
+       regarding copyright ownership.  The ASF licenses this file
+       to you under the Apache License, Version 2.0 (the
+       "License"); you may not use this file except in compliance
+       with the License.  You may obtain a copy of the License at
+
+         http://www.apache.org/licenses/LICENSE-2.0
+
+       Unless required by applicable law or agreed to in writing,
+       software distributed under the License is distributed on an
+       "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+       KIND, either express or implied.  See the License for the
+       specific language governing permissions and limitations
+       under the License.
+ */
+/**
+ * \file Implementation of the time stamp counter checks for POSIX platforms.
+ * */
+#include "tPLTsc.h"
+#include <stdio.h>
+#include <string.h>
+
+#ifdef PL_HAS_TSC
+	#include <cpuid.h>
+#endif
+
+/* Check if the time stamp counter can be used as a clock. */
+int PLTscInvariant(void)
+{
+#ifdef PL_HAS_TSC
+	unsigned int eax, ebx, ecx, edx;
+	/* CPUID.80000007H:EDX[8], the invariant TSC. */
+	if(!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) || !(edx & (1u << 8)))
+		return 0;
+#if defined(__linux__)
+	{
+		/* the kernel stops using the TSC as its clock when it finds it unreliable. */
+		char clocksource[32];
+		FILE* fp = fopen("/sys/devices/system/clocksource/clocksource0/current_clocksource", "r");
+		if(fp)
+		{
+			if(!fgets(clocksource, sizeof(clocksource), fp))
+				clocksource[0] = 0;
+			fclose(fp);
+			if(strncmp(clocksource, "tsc", 3))
+				return 0;
+		}
+	}
+#endif
+	return 1;
+#else
+	return 0;
+#endif
+}
@@ -0,0 +1,65 @@
+/*
+       Licensed to the Apache Software Foundation (ASF) under one
+       or more contributor license agreements.  See the NOTICE file
+       distributed with this work for additional information
+       regarding copyright ownership.  The ASF licenses this file
+       to you under the Apache License, Version 2.0 (the
+       "License"); you may not use this file except in compliance
+       with the License.  You may obtain a copy of the License at
+
+         http://www.apache.org/licenses/LICENSE-2.0
+
+       Unless required by applicable law or agreed to in writing,
+       software distributed under the License is distributed on an
+       "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+       KIND, either express or implied.  See the License for the
+       specific language governing permissions and limitations
+       under the License.
+ */
+/**
+ * \file Implementation of the asynchronous file API for Win32 platform.
+ * Asynchronous writes are not available, the callers write the file with the other
+ * functions of the platform layer.
+ * */
+#include "tPLAsyncFile.h"
+#include <stdlib.h>
+
+int PLAsyncFileOpen(tPLAsyncFile* handle, int fd, int numBuffers, int bufferSize)
+{
+	if(handle)
+		*handle = 0;
+	return -1;
+}
+
+int PLAsyncFileWrite(tPLAsyncFile af, const void* data, int len)
+{
+	return -1;
+}
+
+int PLAsyncFileSubmit(tPLAsyncFile af, int wait)
+{
+	return -1;
+}
+
+int PLAsyncFilePending(tPLAsyncFile af)
+{
+	return 0;
+}
+
+int PLAsyncFileSync(tPLAsyncFile af)
+{
+	return -1;
+}
+
+int PLAsyncFileCrashWrite(tPLAsyncFile af, const void* data, int len)
+{
+	return -1;
+}
+
+void PLAsyncFileAfterFork(tPLAsyncFile af)
+{
+}
+
+void PLAsyncFileClose(tPLAsyncFile* handle)
+{
+}
@@ -0,0 +1,66 @@
+/*
+       Licensed to the Apache Software Foundation (ASF) under one
+       or more contributor license agreements.  See the NOTICE file
+       distributed with this work for additional information
+       regarding copyright ownership.  The ASF licenses this file
+       to you under the Apache License, Version 2.0 (the
+       "License"); you may not use this file except in compliance
+       with the License.  You may obtain a copy of the License at
+
+         http://www.apache.org/licenses/LICENSE-2.0
+
+       Unless required by applicable law or agreed to in writing,
+       software distributed under the License is distributed on an
+       "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+       KIND, either express or implied.  See the License for the
+       specific language governing permissions and limitations
+       under the License.
+ */
+/**
+ * \file Implementation of the low level file API for Win32 platform.
+ * */
+#include "tPLFile.h"
+#include <io.h>
+
+/* Write data to a raw file descriptor, retrying on short writes. */
+int PLFileWrite(int fd, const void* data, const int dataSize)
+{
+	const char* p = (const char*)data;
+	int written = 0;
+	if( (fd < 0) || !data || (dataSize < 0) )
+		return -1;
+	while(written < dataSize)
+	{
+		int ret = _write(fd, p + written, dataSize - written);
+		if(ret <= 0)
+			return -1;
+		written += ret;
+	}
+	return written;
+}
+
+/* Write the parts of the data one after the other, there is no writev() on Win32. */
+int PLFileWriteV(int fd, const tPLIoVec* iov, int count)
+{
+	int written = 0;
+	int i;
+	if( (fd < 0) || !iov || (count < 0) || (count > PL_IOV_MAX) )
+		return -1;
+	for(i = 0; i < count; i++)
+	{
+		if(iov[i].len <= 0)
+			continue;
+		if(PLFileWrite(fd, iov[i].data, iov[i].len) < 0)
+			return -1;
+		written += iov[i].len;
+	}
+	return written;
+}
+
+/* Flush the data of a raw file descriptor to the storage device. */
+int PLFileSync(int fd)
+{
+	if(fd < 0)
+		return -1;
+	return _commit(fd);
+}
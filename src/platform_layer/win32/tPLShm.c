@@ -0,0 +1,127 @@
+/*
+       Licensed to the Apache Software Foundation (ASF) under one
+       or more contributor license agreements.  See the NOTICE file
+       distributed with this work for additional information
+       regarding copyright ownership.  The ASF licenses this file
+       to you under the Apache License, Version 2.0 (the
+       "License"); you may not use this file except in compliance
+       with the License.  You may obtain a copy of the License at
+
+         http://www.apache.org/licenses/LICENSE-2.0
+
+       Unless required by applicable law or agreed to in writing,
+       software distributed under the License is distributed on an
+       "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+       KIND, either express or implied.  See the License for the
+       specific language governing permissions and limitations
+       under the License.
+ */
+/**
+ * \file Implementation of the shared memory API for Win32 platform.
+ * The shared memory is a named file mapping of the session, "Local\name", it is removed
+ * once the last process closes it. The waits poll the word.
+ * */
+#include "tPLShm.h"
+#include <windows.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+struct PLShm
+{
+	HANDLE	mapping;
+	void*	addr;
+};
+
+/* Open a named shared memory, created if it does not exist. */
+int PLShmOpen(const char* name, unsigned int size, tPLShm* shm, void** addr, unsigned int* mapSize)
+{
+	char shmName[256];
+	MEMORY_BASIC_INFORMATION info;
+	struct PLShm* s;
+	int created;
+	if(!name || !shm || !addr || !mapSize)
+		return -1;
+	*shm = 0;
+	_snprintf(shmName, sizeof(shmName) - 1, "Local\\%s", name);
+	shmName[sizeof(shmName) - 1] = 0;
+	s = (struct PLShm*)malloc(sizeof(struct PLShm));
+	if(!s)
+		return -1;
+	/* the new pages are zeroed. */
+	s->mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, size, shmName);
+	if(!s->mapping)
+	{
+		free(s);
+		return -1;
+	}
+	created = (GetLastError() != ERROR_ALREADY_EXISTS);
+	s->addr = MapViewOfFile(s->mapping, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+	if(!s->addr || !VirtualQuery(s->addr, &info, sizeof(info)))
+	{
+		CloseHandle(s->mapping);
+		free(s);
+		return -1;
+	}
+	*shm = s;
+	*addr = s->addr;
+	/* the size of an existing mapping, rounded to a page. */
+	*mapSize = created ? size : (unsigned int)info.RegionSize;
+	return created;
+}
+
+/* Unmap the shared memory. */
+void PLShmClose(tPLShm* shm)
+{
+	if(!shm || !*shm)
+		return;
+	UnmapViewOfFile((*shm)->addr);
+	CloseHandle((*shm)->mapping);
+	free(*shm);
+	*shm = 0;
+}
+
+/* The mapping is removed with its last handle. */
+int PLShmRemove(const char* name)
+{
+	return 0;
+}
+
+/* Wait until the word is changed by PLShmWake. */
+void PLShmWait(volatile int* word, int value, int timeoutMs)
+{
+	int waited;
+	for(waited = 0; (*word == value) && (waited < timeoutMs); waited++)
+		Sleep(1);
+}
+
+/* Increment the word. */
+void PLShmWake(volatile int* word)
+{
+	InterlockedIncrement((volatile LONG*)word);
+}
+
+/* Returns the id of the calling process. */
+int PLGetProcessId(void)
+{
+	return (int)GetCurrentProcessId();
+}
+
+/* Returns 0 if the process is known to be gone. */
+int PLProcessExists(int pid)
+{
+	DWORD code;
+	HANDLE process = OpenProcess(PROCESS_QUERY_INFORMATION, FALSE, (DWORD)pid);
+	int exists = 1;
+	if(!process)
+		return (GetLastError() != ERROR_INVALID_PARAMETER);
+	if(GetExitCodeProcess(process, &code) && (code != STILL_ACTIVE))
+		exists = 0;
+	CloseHandle(process);
+	return exists;
+}
+
+/* Sleep for ms ms. */
+void PLSleepMs(int ms)
+{
+	Sleep(ms);
+}
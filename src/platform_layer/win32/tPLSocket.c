@@ -100,6 +100,29 @@ int PLSockSend(tPLSocket sock,const void* data,const int dataSize)
 	return send((SOCKET) sock,data,dataSize,0);
 }
 
+/* Send the parts of the data with WSASend(), which sends all of them on a blocking socket. */
+int PLSockSendV(tPLSocket sock,const tPLIoVec* iov,int count)
+{
+	WSABUF bufs[PL_IOV_MAX];
+	DWORD sent = 0;
+	int i, n = 0;
+	if( !iov || (count < 0) || (count > PL_IOV_MAX) )
+		return -1;
+	for(i = 0; i < count; i++)
+	{
+		if(iov[i].len <= 0)
+			continue;
+		bufs[n].buf = (char*)iov[i].data;
+		bufs[n].len = (ULONG)iov[i].len;
+		n++;
+	}
+	if(!n)
+		return 0;
+	if(0 != WSASend((SOCKET) sock,bufs,n,&sent,0,NULL,NULL))
+		return -1;
+	return (int)sent;
+}
+
 /* Close the Socket.
  * \param [in,out] sock	The socket handle created via \ref CreateConnectedSocket.
  * */
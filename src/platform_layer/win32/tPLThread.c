@@ -0,0 +1,220 @@
+/*
+       Licensed to the Apache Software Foundation (ASF) under one
+       or more contributor license agreements.  See the NOTICE file
+       distributed with this work for additional information
+       regarding copyright ownership.  The ASF licenses this file
+       to you under the Apache License, Version 2.0 (the
+       "License"); you may not use this file except in compliance
+       with the License.  You may obtain a copy of the License at
+
+         http://www.apache.org/licenses/LICENSE-2.0
+
+       Unless required by applicable law or agreed to in writing,
+       software distributed under the License is distributed on an
+       "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+       KIND, either express or implied.  See the License for the
+       specific language governing permissions and limitations
+       under the License.
+ */
+/**
+ * \file Implementation of the thread / monitor API for Win32 platform.
+ * Condition variables need Windows Vista or later.
+ * */
+#include "tPLThread.h"
+#include <windows.h>
+#include <process.h>
+#include <stdlib.h>
+
+struct PLThread
+{
+	HANDLE			thread;
+	tPLThreadFunc	func;
+	void*			arg;
+};
+
+struct PLMonitor
+{
+	CRITICAL_SECTION	cs;
+	CONDITION_VARIABLE	cond;
+};
+
+/** The number of keys, the fiber local storage callbacks get the value only : each key
+ * has its own trampoline, which calls the destructor of the key. */
+#define PL_MAX_THREAD_KEYS	8
+
+struct PLThreadKey
+{
+	DWORD	index;
+};
+
+static void (*sKeyDestructors[PL_MAX_THREAD_KEYS])(void* value);
+static LONG sNumKeys = 0;
+
+#define PL_KEY_TRAMPOLINE(i)	static VOID WINAPI sKeyDestructor##i(PVOID value)	\
+	{ if(value && sKeyDestructors[i]) sKeyDestructors[i](value); }
+PL_KEY_TRAMPOLINE(0) PL_KEY_TRAMPOLINE(1) PL_KEY_TRAMPOLINE(2) PL_KEY_TRAMPOLINE(3)
+PL_KEY_TRAMPOLINE(4) PL_KEY_TRAMPOLINE(5) PL_KEY_TRAMPOLINE(6) PL_KEY_TRAMPOLINE(7)
+
+static const PFLS_CALLBACK_FUNCTION sKeyTrampolines[PL_MAX_THREAD_KEYS] =
+{
+	sKeyDestructor0, sKeyDestructor1, sKeyDestructor2, sKeyDestructor3,
+	sKeyDestructor4, sKeyDestructor5, sKeyDestructor6, sKeyDestructor7
+};
+
+/** Trampoline from the win32 thread entry signature to \ref tPLThreadFunc. */
+static unsigned __stdcall sThreadEntry(void* arg)
+{
+	struct PLThread* t = (struct PLThread*)arg;
+	t->func(t->arg);
+	return 0;
+}
+
+/* Create and start a thread. */
+int PLCreateThread(tPLThread* thread, tPLThreadFunc func, void* arg)
+{
+	struct PLThread* t;
+	if(!thread || !func)
+		return -1;
+	t = (struct PLThread*)malloc(sizeof(struct PLThread));
+	if(!t)
+		return -1;
+	t->func = func;
+	t->arg = arg;
+	t->thread = (HANDLE)_beginthreadex(NULL, 0, sThreadEntry, t, 0, NULL);
+	if(!t->thread)
+	{
+		free(t);
+		return -1;
+	}
+	*thread = t;
+	return 0;
+}
+
+/* Wait for a thread to exit and release the thread handle. */
+int PLJoinThread(tPLThread* thread)
+{
+	if(!thread || !(*thread))
+		return -1;
+	if(WaitForSingleObject((*thread)->thread, INFINITE) != WAIT_OBJECT_0)
+		return -1;
+	CloseHandle((*thread)->thread);
+	free(*thread);
+	*thread = 0;
+	return 0;
+}
+
+/* Get the id of the calling thread. */
+unsigned long PLGetThreadId(void)
+{
+	return (unsigned long)GetCurrentThreadId();
+}
+
+/* Get the name of the calling thread, thread descriptions are not read. */
+int PLGetThreadName(char* buf, int size)
+{
+	(void)buf;
+	(void)size;
+	return -1;
+}
+
+/* There is no fork() on Windows. */
+int PLRegisterAtFork(void (*prepare)(void), void (*parent)(void), void (*child)(void))
+{
+	return 0;
+}
+
+/* Create a key for a thread specific value, with fiber local storage : unlike the TLS
+ * slots, its callback is called when a thread exits. */
+int PLCreateThreadKey(tPLThreadKey* key, void (*destructor)(void* value))
+{
+	struct PLThreadKey* k;
+	LONG i;
+	if(!key)
+		return -1;
+	i = InterlockedIncrement(&sNumKeys) - 1;
+	if(i >= PL_MAX_THREAD_KEYS)
+		return -1;
+	k = (struct PLThreadKey*)malloc(sizeof(struct PLThreadKey));
+	if(!k)
+		return -1;
+	sKeyDestructors[i] = destructor;
+	k->index = FlsAlloc(sKeyTrampolines[i]);
+	if(k->index == FLS_OUT_OF_INDEXES)
+	{
+		free(k);
+		return -1;
+	}
+	*key = k;
+	return 0;
+}
+
+/* Set the value of the calling thread for a key. */
+int PLSetThreadKey(tPLThreadKey key, void* value)
+{
+	if(!key)
+		return -1;
+	return FlsSetValue(key->index, value) ? 0 : -1;
+}
+
+/* Create a monitor. */
+int PLCreateMonitor(tPLMonitor* mon)
+{
+	struct PLMonitor* m;
+	if(!mon)
+		return -1;
+	m = (struct PLMonitor*)malloc(sizeof(struct PLMonitor));
+	if(!m)
+		return -1;
+	InitializeCriticalSection(&m->cs);
+	InitializeConditionVariable(&m->cond);
+	*mon = m;
+	return 0;
+}
+
+/* Enter (lock) the monitor. */
+int PLEnterMonitor(tPLMonitor mon)
+{
+	if(!mon)
+		return -1;
+	EnterCriticalSection(&mon->cs);
+	return 0;
+}
+
+/* Exit (unlock) the monitor. */
+int PLExitMonitor(tPLMonitor mon)
+{
+	if(!mon)
+		return -1;
+	LeaveCriticalSection(&mon->cs);
+	return 0;
+}
+
+/* Wait on the monitor until notified. */
+int PLWaitMonitor(tPLMonitor mon, int timeoutMs)
+{
+	if(!mon)
+		return -1;
+	if(!SleepConditionVariableCS(&mon->cond, &mon->cs, (timeoutMs < 0) ? INFINITE : (DWORD)timeoutMs))
+		return (GetLastError() == ERROR_TIMEOUT) ? 1 : -1;
+	return 0;
+}
+
+/* Wake up all the threads waiting on the monitor. */
+int PLNotifyMonitor(tPLMonitor mon)
+{
+	if(!mon)
+		return -1;
+	WakeAllConditionVariable(&mon->cond);
+	return 0;
+}
+
+/* Destroy the monitor. */
+int PLDestroyMonitor(tPLMonitor* mon)
+{
+	if(!mon || !(*mon))
+		return -1;
+	DeleteCriticalSection(&(*mon)->cs);
+	free(*mon);
+	*mon = 0;
+	return 0;
+}
@@ -0,0 +1,38 @@
+/*
+       Licensed to the Apache Software Foundation (ASF) under one
+       or more contributor license agreements.  See the NOTICE file
+       distributed with this work for additional information
+       regarding copyright ownership.  The ASF licenses this file
+       to you under the Apache License, Version 2.0 (the
+       "License"); you may not use this file except in compliance
+       with the License.  You may obtain a copy of the License at
+
+         http://www.apache.org/licenses/LICENSE-2.0
+
+       Unless required by applicable law or agreed to in writing,
+       software distributed under the License is distributed on an
+       "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+       KIND, either express or implied.  See the License for the
+       specific language governing permissions and limitations
+       under the License.
+ */
+/**
+ * \file Implementation of the time stamp counter checks for Win32 platform.
+ * */
+#include "tPLTsc.h"
+
+/* Check if the time stamp counter can be used as a clock. */
+int PLTscInvariant(void)
+{
+#ifdef PL_HAS_TSC
+	int regs[4];
+	__cpuid(regs, 0x80000000);
+	if((unsigned int)regs[0] < 0x80000007)
+		return 0;
+	/* CPUID.80000007H:EDX[8], the invariant TSC. */
+	__cpuid(regs, 0x80000007);
+	return (regs[3] & (1 << 8)) != 0;
+#else
+	return 0;
+#endif
+}
@@ -0,0 +1,158 @@
+/*
+       Licensed to the Apache Software Foundation (ASF) under one
+       or more contributor license agreements.  See the NOTICE file
+       distributed with this work for additional information
+       regarding copyright ownership.  The ASF licenses this file
+       to you under the Apache License, Version 2.0 (the
+       "License"); you may not use this file except in compliance
+       with the License.  You may obtain a copy of the License at
+
+         http://www.apache.org/licenses/LICENSE-2.0
+
+       Unless required by applicable law or agreed to in writing,
+       software distributed under the License is distributed on an
+       "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+       KIND, either express or implied.  See the License for the
+       specific language governing permissions and limitations
+       under the License.
+ */
+/**
+ * \file Cache of the prefixes of the text records, see prefix_cache.h.
+ * */
+#include "prefix_cache.h"
+#include "win32_support.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/** The capacity of the table on first use. */
+#define INITIAL_SITES	64
+
+/** A call site, with the rendering of its prefix after the date time. */
+typedef struct LLPrefixSite
+{
+	const char*	file;
+	const char*	funcName;
+	int			line;
+	int			level;
+	/** The rendered prefix, NULL for an empty slot. */
+	char*		text;
+	int			len;
+} LLPrefixSite;
+
+/* helper function to hash the key of a call site. */
+static unsigned int sHashSite(const char* file, const char* funcName, int line, int level)
+{
+	size_t h = ((size_t)file >> 3) ^ ((size_t)funcName >> 3) * 31;
+	h ^= (size_t)line * 2654435761u;
+	return (unsigned int)(h ^ (h >> 15) ^ (size_t)level);
+}
+
+/* helper function to double the size of the table. */
+static int sGrowSites(LLPrefixCache* c)
+{
+	unsigned int newCapacity = c->capacity ? c->capacity * 2 : INITIAL_SITES;
+	LLPrefixSite* sites = (LLPrefixSite*)calloc(newCapacity, sizeof(LLPrefixSite));
+	unsigned int i;
+	if(!sites)
+		return -1;
+	for(i = 0; i < c->capacity; i++)
+	{
+		unsigned int j;
+		if(!c->sites[i].text)
+			continue;
+		j = sHashSite(c->sites[i].file, c->sites[i].funcName, c->sites[i].line, c->sites[i].level) & (newCapacity - 1);
+		while(sites[j].text)
+			j = (j + 1) & (newCapacity - 1);
+		sites[j] = c->sites[i];
+	}
+	free(c->sites);
+	c->sites = sites;
+	c->capacity = newCapacity;
+	return 0;
+}
+
+/* helper function to find a call site, it is added if needed. Returns NULL if the site
+ * can not be cached. */
+static LLPrefixSite* sGetSite(LLPrefixCache* c, LogLevel level, const char* levelPrefix,
+		const char* moduleName, const char* file, const char* funcName, int line)
+{
+	char text[512];
+	unsigned int i;
+	LLPrefixSite* s;
+	int len;
+	if(!c->capacity && sGrowSites(c))
+		return NULL;
+	i = sHashSite(file, funcName, line, (int)level) & (c->capacity - 1);
+	for(;; i = (i + 1) & (c->capacity - 1))
+	{
+		s = &c->sites[i];
+		if(!s->text)
+			break;
+		if( (s->file == file) && (s->funcName == funcName) && (s->line == line) && (s->level == (int)level) )
+			return s;
+	}
+	/* a new call site. */
+	if(c->numSites >= LL_PREFIX_SITES_MAX)
+		return NULL;
+	if(4 * (c->numSites + 1) > 3 * c->capacity)
+	{
+		if(sGrowSites(c))
+			return NULL;
+		return sGetSite(c, level, levelPrefix, moduleName, file, funcName, line);
+	}
+	len = snprintf(text, sizeof(text), "%s %s::%s#%d:%s() - ", levelPrefix, moduleName, file, line, funcName);
+	/* the long names are not cached. */
+	if((len < 0) || (len > (int)sizeof(text) - 1))
+		return NULL;
+	s->text = (char*)malloc(len + 1);
+	if(!s->text)
+		return NULL;
+	memcpy(s->text, text, len + 1);
+	s->len = len;
+	s->file = file;
+	s->funcName = funcName;
+	s->line = line;
+	s->level = (int)level;
+	c->numSites++;
+	return s;
+}
+
+/* Renders the prefix of a text record. */
+int LLPrefixFormat(LLPrefixCache* c, char* out, int size, const char* lead, const char* dateTime,
+		LogLevel level, const char* levelPrefix, const char* moduleName,
+		const char* file, const char* funcName, int line)
+{
+	LLPrefixSite* s = sGetSite(c, level, levelPrefix, moduleName, file, funcName, line);
+	int leadLen = (int)strlen(lead);
+	int dateLen = (int)strlen(dateTime);
+	int len;
+	if(s && (leadLen + dateLen + 3 + s->len < size))
+	{
+		memcpy(out, lead, leadLen);
+		len = leadLen;
+		out[len++] = '[';
+		memcpy(out + len, dateTime, dateLen);
+		len += dateLen;
+		out[len++] = ']';
+		out[len++] = ' ';
+		/* the terminating character is copied too. */
+		memcpy(out + len, s->text, s->len + 1);
+		return len + s->len;
+	}
+	len = snprintf(out, size, "%s[%s] %s %s::%s#%d:%s() - ", lead, dateTime, levelPrefix,
+			moduleName, file, line, funcName);
+	if((len < 0) || (len > size - 1))
+		len = size - 1;
+	return len;
+}
+
+/* Frees the cached prefixes. */
+void LLPrefixCacheDestroy(LLPrefixCache* c)
+{
+	unsigned int i;
+	for(i = 0; c->sites && (i < c->capacity); i++)
+		free(c->sites[i].text);
+	free(c->sites);
+	memset(c, 0, sizeof(*c));
+}
@@ -0,0 +1,66 @@
+/*
+       Licensed to the Apache Software Foundation (ASF) under one
+       or more contributor license agreements.  See the NOTICE file
+       distributed with this work for additional information
+       regarding copyright ownership.  The ASF licenses this file
+       to you under the Apache License, Version 2.0 (the
+       "License"); you may not use this file except in compliance
+       with the License.  You may obtain a copy of the License at
+
+         http://www.apache.org/licenses/LICENSE-2.0
+
+       Unless required by applicable law or agreed to in writing,
+       software distributed under the License is distributed on an
+       "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+       KIND, either express or implied.  See the License for the
+       specific language governing permissions and limitations
+       under the License.
+ */
+/**
+ * \file Cache of the prefixes of the text records, rendered once per call site.
+ * The prefix of a record is "[date time] [I] module::file#line:function() - ", only the
+ * date time changes from one record of a call site to the next. The part which follows
+ * the date time is rendered the first time a call site logs, and is copied afterwards.
+ * */
+#ifndef __PREFIX_CACHE_H__
+#define __PREFIX_CACHE_H__
+
+#include <liblogger/liblogger_levels.h>
+
+/** The largest number of cached call sites, the prefixes of the other sites are formatted. */
+#define LL_PREFIX_SITES_MAX	(64 * 1024)
+
+/** A call site of the cache. */
+struct LLPrefixSite;
+
+/** The prefixes of the call sites of a log writer. The call sites are identified by the
+ * addresses of their file and function names, as \ref LLBinEncoder does, and by their
+ * line and log level. The module name of the log writer does not change while the cache
+ * is in use.
+ * The writer must serialize the calls, the logger mutex does it, the sharded logger has a
+ * cache per thread.
+ * */
+typedef struct LLPrefixCache
+{
+	/** The call sites, an open addressing hash table, allocated on first use. */
+	struct LLPrefixSite*	sites;
+	unsigned int			capacity;
+	unsigned int			numSites;
+} LLPrefixCache;
+
+/** Renders the prefix of a text record : \a lead, the date time between brackets and the
+ * cached part of the call site.
+ * \param [out] out		The record buffer.
+ * \param [in]  size	The size of \a out, the prefix is truncated and terminated.
+ * \param [in]  lead	The characters before the date time, "" for none.
+ * \param [in]  levelPrefix	The rendering of the log level, such as "[I]".
+ * \returns the length of the prefix, at most \a size - 1.
+ * */
+int LLPrefixFormat(LLPrefixCache* c, char* out, int size, const char* lead, const char* dateTime,
+		LogLevel level, const char* levelPrefix, const char* moduleName,
+		const char* file, const char* funcName, int line);
+
+/** Frees the cached prefixes. */
+void LLPrefixCacheDestroy(LLPrefixCache* c);
+
+#endif // __PREFIX_CACHE_H__
@@ -0,0 +1,101 @@
+/*
+       Licensed to the Apache Software Foundation (ASF) under one
+       or more contributor license agreements.  See the NOTICE file
+       distributed with this work for additional information
+       regarding copyright ownership.  The ASF licenses this file
+       to you under the Apache License, Version 2.0 (the
+       "License"); you may not use this file except in compliance
+       with the License.  You may obtain a copy of the License at
+
+         http://www.apache.org/licenses/LICENSE-2.0
+
+       Unless required by applicable law or agreed to in writing,
+       software distributed under the License is distributed on an
+       "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+       KIND, either express or implied.  See the License for the
+       specific language governing permissions and limitations
+       under the License.
+ */
+/**
+ * \file Per call site rate limiting of the logs, see \ref GRP_RATE_LIMIT.
+ * The state of a call site is updated with atomic operations only, so the
+ * decision is lock-free and is taken before the message is formatted.
+ * */
+#include <liblogger/liblogger.h>
+#include "tPLAtomic.h"
+#include "LLTimeUtil.h"
+#include <stddef.h>
+
+/** helper function to note down a suppressed record. */
+static long sSuppress(LLSiteLimit* site)
+{
+	PLAtomicInc64((tPLAtomic64*)&site->suppressed);
+	return -1;
+}
+
+/** helper function to get (and reset) the number of suppressed records, when a record is emitted. */
+static long sEmit(LLSiteLimit* site)
+{
+	if(!site->suppressed)
+		return 0;
+	return (long)PLAtomicExchange64((tPLAtomic64*)&site->suppressed, 0);
+}
+
+/* Emit the 1st, (n+1)th, (2n+1)th ... record of the call site. */
+long LLSiteEveryN(LLSiteLimit* site, unsigned long n)
+{
+	long long count = PLAtomicInc64((tPLAtomic64*)&site->count) - 1;
+	if( (n > 1) && (count % n) )
+		return sSuppress(site);
+	return sEmit(site);
+}
+
+/* Emit at most one record of the call site every ms milliseconds. */
+long LLSiteEveryMs(LLSiteLimit* site, unsigned long ms)
+{
+	long long now = (long long)LLGetMonotonicNs();
+	long long next = site->next;
+	/* the first record is always emitted, and only one thread wins the CAS when the time is up. */
+	if( (next && (now < next)) || 
+			!PLAtomicCAS64((tPLAtomic64*)&site->next, next, now + (long long)ms * 1000000LL) )
+		return sSuppress(site);
+	return sEmit(site);
+}
+
+/* Emit a record of the call site with the given probability. */
+long LLSiteSampled(LLSiteLimit* site, double probability)
+{
+	/* a hash of the call counter (splitmix64) is used as a random number,
+	 * no state shared with other call sites, no lock. */
+	unsigned long long x = (unsigned long long)PLAtomicInc64((tPLAtomic64*)&site->count);
+	x += (unsigned long long)(size_t)site;
+	x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+	x ^= x >> 31;
+	if( (double)(x >> 11) * (1.0 / 9007199254740992.0) >= probability )
+		return sSuppress(site);
+	return sEmit(site);
+}
+
+/* Emit the records of the call site at an average rate, with a maximum burst size.
+ * Implemented as GCRA : site->next is the theoretical arrival time of the next record,
+ * a record is allowed if it does not move the arrival time more than burst intervals
+ * ahead of the current time. */
+long LLSiteTokenBucket(LLSiteLimit* site, double ratePerSec, unsigned long burst)
+{
+	long long interval, now, tat, newTat;
+	if(ratePerSec <= 0)
+		return sSuppress(site);
+	interval = (long long)(1000000000.0 / ratePerSec);
+	if(!burst)
+		burst = 1;
+	now = (long long)LLGetMonotonicNs();
+	do
+	{
+		tat = site->next;
+		newTat = ((tat > now) ? tat : now) + interval;
+		if(newTat - now > interval * (long long)burst)
+			return sSuppress(site);
+	} while(!PLAtomicCAS64((tPLAtomic64*)&site->next, tat, newTat));
+	return sEmit(site);
+}
@@ -0,0 +1,110 @@
+/*
+       Licensed to the Apache Software Foundation (ASF) under one
+       or more contributor license agreements.  See the NOTICE file
+       distributed with this work for additional information
+       regarding copyright ownership.  The ASF licenses this file
+       to you under the Apache License, Version 2.0 (the
+       "License"); you may not use this file except in compliance
+       with the License.  You may obtain a copy of the License at
+
+         http://www.apache.org/licenses/LICENSE-2.0
+
+       Unless required by applicable law or agreed to in writing,
+       software distributed under the License is distributed on an
+       "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+       KIND, either express or implied.  See the License for the
+       specific language governing permissions and limitations
+       under the License.
+ */
+#include "repeat_filter.h"
+#include "LLTimeUtil.h"
+
+/** The call site of the records logged without the file name. */
+static const char sNoFile[] = "";
+
+/** helper function to hash a message (FNV-1a). */
+static unsigned long long sHash(const char* msg, int len)
+{
+	unsigned long long h = 14695981039346656037ULL;
+	int i;
+	for(i = 0; i < len; i++)
+	{
+		h ^= (unsigned char)msg[i];
+		h *= 1099511628211ULL;
+	}
+	return h;
+}
+
+/* Checks if a record repeats the previous one. */
+int LLRepeatFilterCheck(LLRepeatFilter* f, LogLevel level, const char* file, int line,
+		const char* msg, int len)
+{
+	unsigned long long hash;
+	if(!f->enabled)
+		return 0;
+	if(!msg)
+	{
+		/* the record can not be compared, it ends the current run. */
+		LLRepeatFilterReset(f);
+		return 0;
+	}
+	if(!file)
+		file = sNoFile;
+	hash = sHash(msg, len);
+	if( f->file && (hash == f->hash) && (len == f->len) && (file == f->file) 
+			&& (line == f->line) && (level == f->level) )
+	{
+		f->lastNs = LLGetMonotonicNs();
+		if(!f->repeats++)
+			f->pendingNs = f->lastNs;
+		return 1;
+	}
+	LLRepeatFilterReset(f);
+	f->hash = hash;
+	f->len = len;
+	f->file = file;
+	f->line = line;
+	f->level = level;
+	f->firstNs = f->lastNs = LLGetMonotonicNs();
+	return 0;
+}
+
+/* Returns non zero if the repeats not yet reported wait for too long. */
+int LLRepeatFilterDue(const LLRepeatFilter* f)
+{
+	return f->repeats && (f->lastNs - f->pendingNs >= LL_REPEAT_SUMMARY_NS);
+}
+
+/* Returns the summary of the suppressed repeats not yet reported, and resets it. */
+unsigned long LLRepeatFilterTakeSummary(LLRepeatFilter* f, LogLevel* level, unsigned long long* spanNs)
+{
+	unsigned long repeats;
+	if(f->endedRepeats)
+	{
+		repeats = f->endedRepeats;
+		*level = f->endedLevel;
+		*spanNs = f->endedSpanNs;
+		f->endedRepeats = 0;
+		return repeats;
+	}
+	/* the current run is still going on, report what was suppressed so far. */
+	repeats = f->repeats;
+	*level = f->level;
+	*spanNs = f->lastNs - f->firstNs;
+	f->repeats = 0;
+	f->firstNs = f->lastNs;
+	return repeats;
+}
+
+/* Forgets the last record. */
+void LLRepeatFilterReset(LLRepeatFilter* f)
+{
+	if(f->repeats)
+	{
+		f->endedRepeats = f->repeats;
+		f->endedSpanNs = f->lastNs - f->firstNs;
+		f->endedLevel = f->level;
+	}
+	f->repeats = 0;
+	f->file = 0;
+}
@@ -0,0 +1,86 @@
+/*
+       Licensed to the Apache Software Foundation (ASF) under one
+       or more contributor license agreements.  See the NOTICE file
+       distributed with this work for additional information
+       regarding copyright ownership.  The ASF licenses this file
+       to you under the Apache License, Version 2.0 (the
+       "License"); you may not use this file except in compliance
+       with the License.  You may obtain a copy of the License at
+
+         http://www.apache.org/licenses/LICENSE-2.0
+
+       Unless required by applicable law or agreed to in writing,
+       software distributed under the License is distributed on an
+       "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+       KIND, either express or implied.  See the License for the
+       specific language governing permissions and limitations
+       under the License.
+ */
+#ifndef __REPEAT_FILTER_H__
+#define __REPEAT_FILTER_H__
+
+#include <liblogger/liblogger_levels.h>
+
+/** The longest time (ns) the suppressed repeats of a run wait for their summary while the
+ * run goes on, see \ref LLRepeatFilterDue. */
+#define LL_REPEAT_SUMMARY_NS	30000000000ULL
+
+/** Detects runs of identical consecutive records, as syslog's "last message repeated N times".
+ * Two records are identical when they come from the same call site and the hashes of
+ * their formatted messages (without the date time prefix) match.
+ * The writer must serialize the calls, the logger mutex does it.
+ * */
+typedef struct LLRepeatFilter
+{
+	/** Non zero if the filter is enabled. */
+	int					enabled;
+	/** The last record, identified by its call site and the hash of its message. */
+	unsigned long long	hash;
+	int					len;
+	const char*			file;
+	int					line;
+	LogLevel			level;
+	/** The number of repeats of the last record, which were suppressed. */
+	unsigned long		repeats;
+	/** The time (monotonic clock, ns) of the first record of the run and of the last repeat. */
+	unsigned long long	firstNs;
+	unsigned long long	lastNs;
+	/** The time (monotonic clock, ns) of the first repeat not yet reported. */
+	unsigned long long	pendingNs;
+	/** The run ended by the last record, not yet reported. */
+	unsigned long		endedRepeats;
+	unsigned long long	endedSpanNs;
+	LogLevel			endedLevel;
+} LLRepeatFilter;
+
+/** Checks if a record repeats the previous one.
+ * \param [in] f		The filter.
+ * \param [in] level	The log level of the record.
+ * \param [in] file		The source file of the call site (NULL if unknown).
+ * \param [in] line		The line of the call site.
+ * \param [in] msg		The formatted message, NULL if the record can not be compared.
+ * \param [in] len		The length of \a msg.
+ * \returns 1 if the record is a repeat and should be suppressed, 0 if it should be emitted,
+ * after the summary returned by \ref LLRepeatFilterTakeSummary.
+ * */
+int LLRepeatFilterCheck(LLRepeatFilter* f, LogLevel level, const char* file, int line,
+		const char* msg, int len);
+
+/** Returns non zero if the repeats not yet reported wait for \ref LL_REPEAT_SUMMARY_NS,
+ * checked when a repeat is suppressed so that the summary of a long run is written as it goes.
+ * */
+int LLRepeatFilterDue(const LLRepeatFilter* f);
+
+/** Returns the summary of the suppressed repeats not yet reported, and resets it, called 
+ * before a new record is emitted, when the repeats are due (see \ref LLRepeatFilterDue),
+ * when the log is flushed and when the writer is deinitialized.
+ * \param [out] level	The log level of the repeated record.
+ * \param [out] spanNs	The time between the first record of the run and the last repeat.
+ * \returns the number of suppressed repeats, 0 if there is nothing to report.
+ * */
+unsigned long LLRepeatFilterTakeSummary(LLRepeatFilter* f, LogLevel* level, unsigned long long* spanNs);
+
+/** Forgets the last record, so that the next one is always emitted. */
+void LLRepeatFilterReset(LLRepeatFilter* f);
+
+#endif // __REPEAT_FILTER_H__
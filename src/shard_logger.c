@@ -0,0 +1,661 @@
+/*
+       Licensed to the Apache Software Foundation (ASF) under one
+       or more contributor license agreements.  See the NOTICE file
+       distributed with this work for additional information
+       regarding copyright ownership.  The ASF licenses this file
+       to you under the Apache License, Version 2.0 (the
+       "License"); you may not use this file except in compliance
+       with the License.  You may obtain a copy of the License at
+
+         http://www.apache.org/licenses/LICENSE-2.0
+
+       Unless required by applicable law or agreed to in writing,
+       software distributed under the License is distributed on an
+       "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+       KIND, either express or implied.  See the License for the
+       specific language governing permissions and limitations
+       under the License.
+ */
+/**
+ * \file The Sharded Logger, see shard_logger.h.
+ * Each logging thread owns a shard : a file, a buffer and a cache of the prefixes. A record
+ * is formatted in the buffer of the thread, behind room kept for its head, the head is
+ * written once the length of the record is known. The list of the shards is only locked
+ * when a thread logs its first record or exits, for the crash handler, fork() and the
+ * deinitialization. The shard of a thread is written, closed and freed as the thread exits.
+ * */
+#include "shard_logger_impl.h"
+#include "crash_handler.h"
+#include "prefix_cache.h"
+#include "json_encoder.h"
+#include "log_context.h"
+#include "LLTimeUtil.h"
+#include "tPLFile.h"
+#include <win32_support.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(WIN32) || defined(_WIN32)
+	#define fileno _fileno
+#endif
+
+#ifndef DISABLE_THREAD_SAFETY
+	#include "tPLMutex.h"
+	#include "tPLThread.h"
+	#define LL_THREAD_LOCAL	PL_THREAD_LOCAL
+	#define __LOCK_SHARDS	PLLockMutex(sShardLogWriter.mutex)
+	#define __UNLOCK_SHARDS	PLUnLockMutex(sShardLogWriter.mutex)
+#else
+	#define LL_THREAD_LOCAL
+	#define __LOCK_SHARDS	/* NOP */
+	#define __UNLOCK_SHARDS	/* NOP */
+#endif
+
+/** The default size of the buffer of a thread. */
+#define DEFAULT_BUFFER_SIZE		(64 * 1024)
+/** The smallest size of the buffer of a thread. */
+#define MIN_BUFFER_SIZE			4096
+/** The buffer is written when less than this is left, the room a record is formatted in. */
+#define RECORD_ROOM_MIN			1024
+/** The default largest time a record stays in the buffer, in ms. */
+#define DEFAULT_FLUSH_INTERVAL_MS	1000
+
+/** The shard of a thread. */
+typedef struct LLShard
+{
+	/** The next shard of the log writer. */
+	struct LLShard*	next;
+	unsigned long	tid;
+	FILE*			fp;
+	/** The file descriptor of \ref fp, -1 if the shard could not be opened. */
+	int				fd;
+	/** The records not written yet. */
+	char*			buf;
+	int				len;
+	/** The time of the oldest record of \ref buf, and of the record being formatted, in ns. */
+	unsigned long long	firstNs;
+	unsigned long long	recordNs;
+	/** The date time of the records, rendered once per second. */
+	long long		dateSec;
+	char			dateTime[32];
+	LLPrefixCache	prefixes;
+} LLShard;
+
+/** Helper function to log a record to the shard of the calling thread. */
+static int sWriteToShard(LogWriter *_this,const LogLevel logLevel,
+#ifdef VARIADIC_MACROS
+		const char* moduleName,
+		const char* file,const char* funcName, const int lineNum,
+#endif
+		const char* fmt,va_list ap);
+
+/** Helper function to log a record with key / value fields. */
+static int sWriteKVToShard(LogWriter *_this,const LogLevel logLevel,
+		const char* moduleName,
+		const char* file,const char* funcName, const int lineNum,
+		const char* msg,va_list fields);
+
+/** Helper function to log a message which is not a format. */
+static int sWriteStrToShard(LogWriter *_this,const LogLevel logLevel,
+		const char* moduleName,
+		const char* file,const char* funcName, const int lineNum,
+		const char* fmt,const char* msg,int len);
+
+static int sShardFuncLogEntry(LogWriter *_this,const char* funcName);
+
+static int sShardFuncLogExit(LogWriter* _this,const char* funcName,const int lineNumber);
+
+static int sShardLoggerDeInit(LogWriter* _this);
+
+static int sShardLoggerSync(LogWriter* _this);
+
+static int sShardLoggerCrashFlush(LogWriter* _this,int signum);
+
+static int sShardLoggerAtFork(LogWriter* _this,int phase);
+
+/* helper function to get the log prefix */
+static const char* sGetLogPrefix(const LogLevel logLevel);
+
+typedef struct ShardLogWriter
+{
+	LogWriter	base;
+	/** The path of the shards, NULL when the logger is not initialized. */
+	char*		fileName;
+	/** The size of the buffer of a thread. */
+	int			bufferSize;
+	/** The largest time a record stays in the buffer, in ns. */
+	unsigned long long	flushIntervalNs;
+	/** Non zero to add the context of the logging thread to the records. */
+	int			includeContext;
+	/** Incremented on each initialization, to detect the shards of a previous one. */
+	volatile unsigned int	generation;
+	/** The shards of all the threads. */
+	LLShard*	shards;
+#ifndef DISABLE_THREAD_SAFETY
+	/** Locks \ref shards. */
+	tPLMutex	mutex;
+#endif
+}ShardLogWriter;
+
+static ShardLogWriter sShardLogWriter =
+{
+	{
+		/* .base.logLevel	= */Trace,
+		/* .base.moduleName	= */{0},
+		/* .base.log 		= */sWriteToShard,
+		/* .base.logFuncEntry 	= */sShardFuncLogEntry,
+		/* .base.logFuncExit	= */sShardFuncLogExit,
+		/* .base.loggerDeInit 	= */sShardLoggerDeInit,
+		/* .base.sync		= */sShardLoggerSync,
+		/* .base.crashFlush	= */sShardLoggerCrashFlush,
+		/* .base.logKV		= */sWriteKVToShard,
+		/* .base.atFork		= */sShardLoggerAtFork,
+		/* .base.commit		= */0,
+		/* .base.commitStats	= */0,
+		/* .base.logBlob	= */0,
+		/* .base.logStr	= */sWriteStrToShard,
+		/* .base.perThread	= */1,
+	},
+	/* .fileName = */0,
+	/* .bufferSize = */0,
+	/* .flushIntervalNs = */0,
+	/* .includeContext = */0,
+	/* .generation = */0,
+	/* .shards = */0
+};
+
+/** The shard of the calling thread, valid if \ref sThreadGeneration is the current generation. */
+static LL_THREAD_LOCAL LLShard* sThreadShard = 0;
+static LL_THREAD_LOCAL unsigned int sThreadGeneration = 0;
+
+#ifndef DISABLE_THREAD_SAFETY
+/** The key whose destructor releases the shard of an exiting thread, never destroyed. */
+static tPLThreadKey sShardKey = 0;
+
+/* helper function to release the shard of an exiting thread, unless the logger has been
+ * deinitialized and the shard freed since the thread logged. */
+static void sReleaseShard(void* value);
+#endif
+
+int InitShardLogger(LogWriter** logWriter,tShardLoggerInitParams *initParams)
+{
+	if(!logWriter || !initParams || !initParams->fileName)
+	{
+		fprintf(stderr,"Invalid args to function InitShardLogger\n");
+		return -1;
+	}
+	*logWriter = 0;
+
+	if (sShardLogWriter.fileName)
+	{
+		sShardLoggerDeInit((LogWriter*)&sShardLogWriter);
+	}
+	/* Set log module name */
+	if (initParams->moduleName)
+	{
+	    strncpy(sShardLogWriter.base.moduleName, initParams->moduleName, sizeof(sShardLogWriter.base.moduleName) - 1);
+	    sShardLogWriter.base.moduleName[sizeof(sShardLogWriter.base.moduleName) - 1] = '\0';
+	}
+	sShardLogWriter.fileName = (char*)malloc(strlen(initParams->fileName) + 1);
+	if(!sShardLogWriter.fileName)
+		return -1;
+	strcpy(sShardLogWriter.fileName,initParams->fileName);
+#ifndef DISABLE_THREAD_SAFETY
+	if(PLCreateMutex(&sShardLogWriter.mutex))
+	{
+		free(sShardLogWriter.fileName);
+		sShardLogWriter.fileName = 0;
+		return -1;
+	}
+#endif
+	sShardLogWriter.bufferSize = initParams->bufferSize ? (int)initParams->bufferSize : DEFAULT_BUFFER_SIZE;
+	if(sShardLogWriter.bufferSize < MIN_BUFFER_SIZE)
+		sShardLogWriter.bufferSize = MIN_BUFFER_SIZE;
+#ifndef DISABLE_THREAD_SAFETY
+	/* the key outlives the logger, the threads which logged to a previous one find their
+	 * shard gone as they exit. */
+	if(!sShardKey && PLCreateThreadKey(&sShardKey,sReleaseShard))
+		fprintf(stderr,"[liblogger] could not create the thread key of the shards, they are closed by DeInitLogger() only\n");
+#endif
+	sShardLogWriter.flushIntervalNs = (unsigned long long)(initParams->flushIntervalMs ?
+			initParams->flushIntervalMs : DEFAULT_FLUSH_INTERVAL_MS) * 1000000ULL;
+	sShardLogWriter.includeContext = initParams->includeContext;
+	sShardLogWriter.generation++;
+
+	/* Set log level */
+	sShardLogWriter.base.logLevel = initParams->logLevel;
+
+	*logWriter = (LogWriter*)&sShardLogWriter;
+	return 0; // success!
+}
+
+/* helper function to write the records of a shard to its file. */
+static void sFlushShard(LLShard* s)
+{
+	if(s->len && (s->fd >= 0))
+		PLFileWrite(s->fd,s->buf,s->len);
+	s->len = 0;
+}
+
+/* helper function to free a shard, its records are written if flush is set. */
+static void sFreeShard(LLShard* s,int flush)
+{
+	if(flush)
+		sFlushShard(s);
+	if(s->fp)
+		fclose(s->fp);
+	LLPrefixCacheDestroy(&s->prefixes);
+	free(s->buf);
+	free(s);
+}
+
+/* helper function to get the shard of the calling thread, it is created or taken over on
+ * the first record of the thread. Returns NULL if the shard could not be opened. */
+static LLShard* sGetShard(ShardLogWriter* sw)
+{
+	LLShard* s = sThreadShard;
+	unsigned long tid = 0;
+	char* name;
+	if(s && (sThreadGeneration == sw->generation))
+		return (s->fd >= 0) ? s : NULL;
+#ifndef DISABLE_THREAD_SAFETY
+	tid = PLGetThreadId();
+#endif
+	__LOCK_SHARDS;
+	/* the thread ids are reused, the shard of a thread which ended without releasing it is
+	 * taken over, with its records, so that a shard stays in time order. */
+	for(s = sw->shards; s && (s->tid != tid); s = s->next)
+		;
+	if(!s)
+	{
+		s = (LLShard*)calloc(1,sizeof(LLShard));
+		name = (char*)malloc(strlen(sw->fileName) + 32);
+		if(s)
+			s->buf = (char*)malloc(sw->bufferSize);
+		if(!s || !s->buf || !name)
+		{
+			__UNLOCK_SHARDS;
+			if(s)
+				free(s->buf);
+			free(s);
+			free(name);
+			return NULL;
+		}
+		s->tid = tid;
+		s->dateSec = -1;
+		sprintf(name,"%s.%lu",sw->fileName,tid);
+		s->fp = fopen(name,"ab");
+		s->fd = s->fp ? fileno(s->fp) : -1;
+		if(!s->fp)
+			fprintf(stderr,"[liblogger] could not open the log shard %s, the records of the thread are dropped\n",name);
+		free(name);
+		s->next = sw->shards;
+		sw->shards = s;
+	}
+	sThreadShard = s;
+	sThreadGeneration = sw->generation;
+#ifndef DISABLE_THREAD_SAFETY
+	if(sShardKey)
+		PLSetThreadKey(sShardKey,s);
+#endif
+	__UNLOCK_SHARDS;
+	return (s->fd >= 0) ? s : NULL;
+}
+
+#ifndef DISABLE_THREAD_SAFETY
+/* helper function to release the shard of an exiting thread, unless the logger has been
+ * deinitialized and the shard freed since the thread logged. */
+static void sReleaseShard(void* value)
+{
+	ShardLogWriter* sw = &sShardLogWriter;
+	unsigned long tid = PLGetThreadId();
+	LLShard** prev;
+	if(!sw->fileName)
+		return;
+	__LOCK_SHARDS;
+	/* the shard is looked up, the address of a freed one may be reused by another thread. */
+	for(prev = &sw->shards; *prev && ((*prev != value) || ((*prev)->tid != tid)); prev = &(*prev)->next)
+		;
+	if(*prev)
+	{
+		LLShard* s = *prev;
+		*prev = s->next;
+		sFreeShard(s,1);
+	}
+	__UNLOCK_SHARDS;
+	sThreadShard = 0;
+}
+#endif
+
+/* helper function to render the head of a record, see LL_SHARD_HEAD_LEN. */
+static void sFormatRecordHead(char* out,unsigned long long ns,unsigned int len)
+{
+	int i;
+	for(i = 18; i >= 0; i--, ns /= 10)
+		out[i] = (char)('0' + ns % 10);
+	out[19] = ' ';
+	for(i = 27; i >= 20; i--, len /= 10)
+		out[i] = (char)('0' + len % 10);
+	out[28] = ' ';
+}
+
+/* helper function to start a record in the shard : the buffer is written if the room left
+ * is short, the prefix is rendered in the room after the head. Returns the length of the
+ * prefix, the text of the record starts at *text, in *room bytes. */
+static int sBeginRecord(ShardLogWriter* sw,LLShard* s,const LogLevel logLevel,
+		const char* file,const char* funcName,const int lineNum,char** text,int* room)
+{
+	long long sec;
+	int len;
+	if(sw->bufferSize - s->len - LL_SHARD_HEAD_LEN < RECORD_ROOM_MIN)
+		sFlushShard(s);
+	s->recordNs = LLGetWallClockNs();
+	sec = (long long)(s->recordNs / 1000000000ULL);
+	if(sec != s->dateSec)
+	{
+		if(LLGetCurDateTime(s->dateTime,sizeof(s->dateTime)))
+			s->dateTime[0] = 0;
+		s->dateSec = sec;
+	}
+	*text = s->buf + s->len + LL_SHARD_HEAD_LEN;
+	*room = sw->bufferSize - s->len - LL_SHARD_HEAD_LEN;
+	if(file && funcName)
+		len = LLPrefixFormat(&s->prefixes,*text,*room,"",s->dateTime,logLevel,sGetLogPrefix(logLevel),
+				sw->base.moduleName,file,funcName,lineNum);
+	else
+	{
+		len = snprintf(*text,*room,"[%s] %s - ",s->dateTime,sGetLogPrefix(logLevel));
+		if((len < 0) || (len > *room - 1))
+			len = *room - 1;
+	}
+	if(sw->includeContext)
+		len += LLCopyContext(*text + len,*room - len,OutputFormatText);
+	return len;
+}
+
+/* helper function to end the record of the shard, of len bytes, with a newline and its head.
+ * Returns the length of the record. */
+static int sEndRecord(ShardLogWriter* sw,LLShard* s,char* text,int len)
+{
+	text[len++] = '\n';
+	sFormatRecordHead(s->buf + s->len,s->recordNs,(unsigned int)len);
+	if(!s->len)
+		s->firstNs = s->recordNs;
+	s->len += LL_SHARD_HEAD_LEN + len;
+	if( (sw->bufferSize - s->len - LL_SHARD_HEAD_LEN < RECORD_ROOM_MIN) ||
+			(s->recordNs - s->firstNs >= sw->flushIntervalNs) )
+		sFlushShard(s);
+	return len;
+}
+
+/** Helper function to log a record to the shard of the calling thread. */
+static int sWriteToShard(LogWriter *_this,const LogLevel logLevel,
+#ifdef VARIADIC_MACROS
+		const char* moduleName,
+		const char* file,const char* funcName, const int lineNum,
+#endif
+		const char* fmt,va_list ap)
+{
+	ShardLogWriter *sw = (ShardLogWriter*) _this;
+	LLShard* s;
+	char* text;
+	int room;
+	int len;
+	if(!_this || !sw->fileName)
+	{
+		fprintf(stderr,"invalid args for sWriteToShard");
+		return -1;
+	}
+	s = sGetShard(sw);
+	if(!s)
+		return -1;
+	for(;;)
+	{
+		va_list apCopy;
+		int bytes;
+#ifdef VARIADIC_MACROS
+		len = sBeginRecord(sw,s,logLevel,file,funcName,lineNum,&text,&room);
+#else
+		len = sBeginRecord(sw,s,logLevel,NULL,NULL,0,&text,&room);
+#endif
+		va_copy(apCopy,ap);
+		bytes = vsnprintf(text + len,room - len,fmt,apCopy);
+		va_end(apCopy);
+		if(bytes < 0)
+			break;
+		if(len + bytes < room)
+		{
+			len += bytes;
+			break;
+		}
+		/* the record does not fit in the room left, it is formatted again once the buffer
+		 * is written, or truncated if the buffer is empty. */
+		if(!s->len)
+		{
+			len = room - 1;
+			break;
+		}
+		sFlushShard(s);
+	}
+	return sEndRecord(sw,s,text,len);
+}
+
+/** Helper function to log a record with key / value fields. */
+static int sWriteKVToShard(LogWriter *_this,const LogLevel logLevel,
+		const char* moduleName,
+		const char* file,const char* funcName, const int lineNum,
+		const char* msg,va_list fields)
+{
+	ShardLogWriter *sw = (ShardLogWriter*) _this;
+	LLShard* s;
+	LLOutBuf out;
+	va_list fieldsCopy;
+	char* text;
+	int room;
+	if(!_this || !sw->fileName || !msg)
+	{
+		fprintf(stderr,"invalid args for sWriteKVToShard");
+		return -1;
+	}
+	s = sGetShard(sw);
+	if(!s)
+		return -1;
+	/* the message and the fields, key=value, follow the usual prefix. The record is formatted
+	 * again once the buffer is written if it is truncated, as the formatted records. */
+	for(;;)
+	{
+		int len = sBeginRecord(sw,s,logLevel,file,funcName,lineNum,&text,&room);
+		/* room is kept for the newline. */
+		LLOutInit(&out,text,room - 1);
+		out.len = (len < out.size) ? len : out.size;
+		LLOutAppend(&out,msg,(int)strlen(msg));
+		va_copy(fieldsCopy,fields);
+		LLAppendKVFields(&out,OutputFormatText,fieldsCopy);
+		va_end(fieldsCopy);
+		if(!out.truncated || !s->len)
+			break;
+		sFlushShard(s);
+	}
+	return sEndRecord(sw,s,text,out.len);
+}
+
+/** Helper function to log a message which is not a format. */
+static int sWriteStrToShard(LogWriter *_this,const LogLevel logLevel,
+		const char* moduleName,
+		const char* file,const char* funcName, const int lineNum,
+		const char* fmt,const char* msg,int len)
+{
+	ShardLogWriter *sw = (ShardLogWriter*) _this;
+	LLShard* s;
+	char* text;
+	int room;
+	int prefixLen;
+	if(!_this || !sw->fileName || !msg)
+	{
+		fprintf(stderr,"invalid args for sWriteStrToShard");
+		return -1;
+	}
+	s = sGetShard(sw);
+	if(!s)
+		return -1;
+	prefixLen = sBeginRecord(sw,s,logLevel,file,funcName,lineNum,&text,&room);
+	if((prefixLen + len >= room) && s->len)
+	{
+		sFlushShard(s);
+		prefixLen = sBeginRecord(sw,s,logLevel,file,funcName,lineNum,&text,&room);
+	}
+	/* room is kept for the newline. */
+	if(prefixLen + len > room - 1)
+		len = room - 1 - prefixLen;
+	memcpy(text + prefixLen,msg,len);
+	return sEndRecord(sw,s,text,prefixLen + len);
+}
+
+/* helper function to log a record of the function trace. */
+static int sWriteFuncRecord(ShardLogWriter* sw,const char* fmt,const char* funcName,int lineNumber)
+{
+	LLShard* s;
+	char* text;
+	int room;
+	int len;
+	if(!sw->fileName)
+	{
+		fprintf(stderr,"invalid args for the function trace of the shard logger");
+		return -1;
+	}
+	s = sGetShard(sw);
+	if(!s)
+		return -1;
+	/* the prefix is not used, the time is in the head of the record. */
+	sBeginRecord(sw,s,Trace,NULL,NULL,0,&text,&room);
+	len = snprintf(text,room,fmt,funcName,lineNumber);
+	if((len < 0) || (len > room - 2))
+		len = room - 2;
+	return sEndRecord(sw,s,text,len);
+}
+
+static int sShardFuncLogEntry(LogWriter *_this,const char* funcName)
+{
+	return sWriteFuncRecord((ShardLogWriter*)_this,"{ %s",funcName,0);
+}
+
+static int sShardFuncLogExit(LogWriter* _this,const char* funcName,const int lineNumber)
+{
+	return sWriteFuncRecord((ShardLogWriter*)_this,"%s : %d }",funcName,lineNumber);
+}
+
+/** The records of all the shards are written and the shards are closed, the logging threads
+ * must have stopped logging. */
+static int sShardLoggerDeInit(LogWriter* _this)
+{
+	ShardLogWriter *sw = (ShardLogWriter*) _this;
+	if(!sw->fileName)
+		return 0;
+	__LOCK_SHARDS;
+	while(sw->shards)
+	{
+		LLShard* s = sw->shards;
+		sw->shards = s->next;
+		sFreeShard(s,1);
+	}
+	free(sw->fileName);
+	sw->fileName = 0;
+	/* the shards cached by the threads are detected by the generation. */
+	sw->generation++;
+	__UNLOCK_SHARDS;
+#ifndef DISABLE_THREAD_SAFETY
+	PLDestroyMutex(&sw->mutex);
+#endif
+	sw->base.logLevel = Trace;
+	memset(&(sw->base.moduleName), 0, sizeof(sw->base.moduleName));
+	sw->includeContext = 0;
+	return 0;
+}
+
+/** Writes the records of the calling thread and flushes its shard to the storage device,
+ * the shards of the other threads are written by their threads. */
+static int sShardLoggerSync(LogWriter* _this)
+{
+	ShardLogWriter *sw = (ShardLogWriter*) _this;
+	LLShard* s;
+	if(!_this || !sw->fileName)
+		return -1;
+	s = sGetShard(sw);
+	if(!s)
+		return -1;
+	sFlushShard(s);
+	return PLFileSync(s->fd);
+}
+
+/** Writes the records of all the shards and the final record when a fatal signal is caught,
+ * with async-signal-safe calls only. The other threads may be formatting a record, the end
+ * of their buffer is not written. */
+static int sShardLoggerCrashFlush(LogWriter* _this,int signum)
+{
+	ShardLogWriter *sw = (ShardLogWriter*) _this;
+	LLShard* s;
+	LLShard* own = NULL;
+	char record[512];
+	int len;
+	if(!_this || !sw->fileName)
+		return -1;
+	if(sThreadShard && (sThreadGeneration == sw->generation))
+		own = sThreadShard;
+	for(s = sw->shards; s; s = s->next)
+	{
+		if(s->len && (s->fd >= 0))
+			PLFileWrite(s->fd,s->buf,s->len);
+		s->len = 0;
+		if(!own && (s->fd >= 0))
+			own = s;
+	}
+	if(!own || (own->fd < 0))
+		return -1;
+	len = LLFormatCrashRecord(record + LL_SHARD_HEAD_LEN,sizeof(record) - LL_SHARD_HEAD_LEN - 1,
+			sw->base.moduleName,signum,OutputFormatText);
+	record[LL_SHARD_HEAD_LEN + len++] = '\n';
+	sFormatRecordHead(record,LLGetWallClockNs(),(unsigned int)len);
+	return PLFileWrite(own->fd,record,LL_SHARD_HEAD_LEN + len);
+}
+
+/** Called around fork(), the child starts with no shard : the records buffered by the
+ * threads of the parent are written by the parent, the threads of the child log to shards
+ * named after their own ids. */
+static int sShardLoggerAtFork(LogWriter* _this,int phase)
+{
+	ShardLogWriter *sw = (ShardLogWriter*) _this;
+	if(!_this || !sw->fileName)
+		return -1;
+	if(LL_FORK_CHILD == phase)
+	{
+		while(sw->shards)
+		{
+			LLShard* s = sw->shards;
+			sw->shards = s->next;
+			sFreeShard(s,0);
+		}
+		sw->generation++;
+#ifndef DISABLE_THREAD_SAFETY
+		/* the mutex may be owned by a thread of the parent. */
+		sw->mutex = 0;
+		PLCreateMutex(&sw->mutex);
+#endif
+	}
+	return 0;
+}
+
+/* helper function to get the log prefix */
+static const char* sGetLogPrefix(const LogLevel logLevel)
+{
+	switch (logLevel)
+	{
+		case Trace:	return "[T]";
+		case Debug: return "[D]";
+		case Info:	return "[I]";
+		case Warn:	return "[W]";
+		case Error:	return "[E]";
+		case Fatal:	return "[F]";
+		default:	return "";
+	}
+}
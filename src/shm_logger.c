@@ -0,0 +1,434 @@
+/*
+       Licensed to the Apache Software Foundation (ASF) under one
+       or more contributor license agreements.  See the NOTICE file
+       distributed with this work for additional information
+       regarding copyright ownership.  The ASF licenses this file
+       to you under the Apache License, Version 2.0 (the
+       "License"); you may not use this file except in compliance
+       with the License.  You may obtain a copy of the License at
+
+         http://www.apache.org/licenses/LICENSE-2.0
+
+       Unless required by applicable law or agreed to in writing,
+       software distributed under the License is distributed on an
+       "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+       KIND, either express or implied.  See the License for the
+       specific language governing permissions and limitations
+       under the License.
+ */
+/**
+ * \file The Shared memory Logger, see shm_logger.h.
+ * Each record is formatted by the logging thread and written to the ring, see shm_ring.h.
+ * */
+#include "shm_logger_impl.h"
+#include "crash_handler.h"
+#include "shm_ring.h"
+#include "json_encoder.h"
+#include "log_context.h"
+#include "LLTimeUtil.h"
+#include <win32_support.h>
+#include <string.h>
+
+/** The maximum size of the log. */
+#define BUF_MAX 1024
+
+/** \ref sShmLoggerSync gives up once the collector reads nothing for this long. */
+#define SYNC_STALL_MS	10
+
+/** Helper function to print the logs to a buffer and write it to the ring. */
+static int sWriteToShm(LogWriter *_this,const LogLevel logLevel,
+#ifdef VARIADIC_MACROS
+		const char* moduleName,
+		const char* file,const char* funcName, const int lineNum,
+#endif
+		const char* fmt,va_list ap);
+
+/** Helper function to write a record with key / value fields. */
+static int sWriteKVToShm(LogWriter *_this,const LogLevel logLevel,
+		const char* moduleName,
+		const char* file,const char* funcName, const int lineNum,
+		const char* msg,va_list fields);
+
+static int sShmFuncLogEntry(LogWriter *_this,const char* funcName);
+
+static int sShmFuncLogExit(LogWriter* _this,const char* funcName,const int lineNumber);
+
+static int sShmLoggerDeInit(LogWriter* _this);
+
+static int sShmLoggerSync(LogWriter* _this);
+
+static int sShmLoggerCrashFlush(LogWriter* _this,int signum);
+
+static int sShmLoggerAtFork(LogWriter* _this,int phase);
+
+/* helper function to get the log prefix */
+static const char* sGetLogPrefix(const LogLevel logLevel);
+
+typedef struct ShmLogWriter
+{
+	LogWriter	base;
+	/** The mapping of the ring. */
+	LLShmRing	ring;
+	/** The output format. */
+	tOutputFormat	outputFormat;
+	/** Non zero to add the context of the logging thread to the records. */
+	int		includeContext;
+}ShmLogWriter;
+
+/* helper function to encode a record as JSON and to write it. */
+static int sWriteJsonRecord(ShmLogWriter* shw,const LogLevel logLevel,
+		const char* file,const char* funcName,const int lineNum,
+		const char* msg,int msgLen,va_list* fields);
+
+/* helper function to write a record to the ring. */
+static int sEmitRecord(ShmLogWriter* shw,const char* buf,int len);
+
+static ShmLogWriter sShmLogWriter =
+{
+	{
+		/* .base.logLevel	= */Trace,
+		/* .base.moduleName	= */{0},
+		/* .base.log 		= */sWriteToShm,
+		/* .base.logFuncEntry 	= */sShmFuncLogEntry,
+		/* .base.logFuncExit	= */sShmFuncLogExit,
+		/* .base.loggerDeInit 	= */sShmLoggerDeInit,
+		/* .base.sync		= */sShmLoggerSync,
+		/* .base.crashFlush	= */sShmLoggerCrashFlush,
+		/* .base.logKV		= */sWriteKVToShm,
+		/* .base.atFork		= */sShmLoggerAtFork,
+		/* .base.commit		= */0,
+		/* .base.commitStats	= */0,
+		/* .base.logBlob	= */0,
+		/* .base.logStr	= */0,
+	},
+	/* .ring = */{0},
+	/* .outputFormat = */OutputFormatText,
+	/* .includeContext = */0
+};
+
+
+int InitShmLogger(LogWriter** logWriter,tShmLoggerInitParams *initParams)
+{
+	if(!logWriter || !initParams || !initParams->shmName)
+	{
+		fprintf(stderr,"Invalid args to function InitShmLogger\n");
+		return -1;
+	}
+	*logWriter = 0;
+
+	if (sShmLogWriter.ring.header)
+	{
+		sShmLoggerDeInit((LogWriter*)&sShmLogWriter);
+	}
+	/* Set log module name */
+	if (initParams->moduleName)
+	{
+	    strncpy(sShmLogWriter.base.moduleName, initParams->moduleName, sizeof(sShmLogWriter.base.moduleName) - 1);
+	    sShmLogWriter.base.moduleName[sizeof(sShmLogWriter.base.moduleName) - 1] = '\0';
+	}
+	if (initParams->logLevel != Disable)
+	{
+		char curDateTime[32];
+		char tempBuf[128];
+		if( -1 == LLShmRingOpen(&sShmLogWriter.ring,initParams->shmName,initParams->ringSize) )
+		{
+			fprintf(stderr,"could not open the shared memory log ring %s\n",initParams->shmName);
+			return -1;
+		}
+		sShmLogWriter.outputFormat = initParams->outputFormat;
+		if(OutputFormatBinary == initParams->outputFormat)
+		{
+			fprintf(stderr,"The binary output format is not supported by the shared memory logger, text will be used.\n");
+			sShmLogWriter.outputFormat = OutputFormatText;
+		}
+		/* emit the current date / time. */
+		if( !LLGetCurDateTime(curDateTime,sizeof(curDateTime)) )
+		{
+			int bytes;
+			if(OutputFormatJson == sShmLogWriter.outputFormat)
+			{
+				LLOutBuf out;
+				LLOutInit(&out,tempBuf,sizeof(tempBuf) - 1);
+				LLJsonAppendRecordStart(&out,curDateTime);
+				LLJsonAppendRecordInfo(&out,Info,sShmLogWriter.base.moduleName,NULL,NULL,0);
+				LLJsonAppendKey(&out,"msg");
+				LLJsonAppendString(&out,"Logging Started",15);
+				LLJsonAppendRecordEnd(&out);
+				tempBuf[out.len] = '\n';
+				bytes = out.len + 1;
+			}
+			else
+				bytes = snprintf(tempBuf,sizeof(tempBuf),"\n----- Logging Started on %s -----\n",curDateTime);
+			if( (bytes == -1) || (bytes > sizeof(tempBuf)) )
+				bytes = sizeof(tempBuf);
+			sEmitRecord(&sShmLogWriter,tempBuf,bytes);
+		}
+	}
+
+	/* Set log level */
+	sShmLogWriter.base.logLevel = initParams->logLevel;
+	sShmLogWriter.includeContext = initParams->includeContext;
+
+	*logWriter = (LogWriter*)&sShmLogWriter;
+	return 0; // success!
+}
+
+/** Helper function to print the logs to a buffer and write it to the ring. */
+static int sWriteToShm(LogWriter *_this,const LogLevel logLevel,
+#ifdef VARIADIC_MACROS
+		const char* moduleName,
+		const char* file,const char* funcName, const int lineNum,
+#endif
+		const char* fmt,va_list ap)
+{
+	ShmLogWriter *shw = (ShmLogWriter*) _this;
+	if(!_this || !shw->ring.header)
+	{
+		fprintf(stderr,"invalid args for sWriteToShm");
+		return -1;
+	}
+	else if(OutputFormatJson == shw->outputFormat)
+	{
+		/* the message is formatted first, then escaped in the record. */
+		char msg[BUF_MAX];
+		int msgLen = vsnprintf(msg,BUF_MAX,fmt,ap);
+		if((msgLen < 0) || (msgLen > BUF_MAX - 1))
+			msgLen = (int)strlen(msg);
+#ifdef VARIADIC_MACROS
+		return sWriteJsonRecord(shw,logLevel,file,funcName,lineNum,msg,msgLen,NULL);
+#else
+		return sWriteJsonRecord(shw,logLevel,NULL,NULL,0,msg,msgLen,NULL);
+#endif
+	}
+	else
+	{
+		char buf[BUF_MAX];
+		char curDateTime[32];
+		int bytes = 0;
+
+		memset(curDateTime, 0, sizeof(curDateTime));
+		LLGetCurDateTime(curDateTime, sizeof(curDateTime));
+#ifdef VARIADIC_MACROS
+		bytes = snprintf(buf,BUF_MAX-1,"\n[%s] %s %s::%s#%d:%s() - ", curDateTime, sGetLogPrefix(logLevel),
+				moduleName,file,lineNum,funcName);
+#else
+		bytes = snprintf(buf,BUF_MAX-1,"\n[%s] %s - ", curDateTime, sGetLogPrefix(logLevel));
+#endif
+		if(shw->includeContext && (bytes >= 0) && (bytes < (BUF_MAX -1)))
+			bytes += LLCopyContext(buf+bytes,BUF_MAX-1-bytes,OutputFormatText);
+		// to be on safer side, check if required size is available.
+		if(bytes < (BUF_MAX -1) )
+			bytes += vsnprintf(buf+bytes,BUF_MAX-1-bytes,fmt,ap);
+		buf[BUF_MAX-1] = 0;
+		if((-1 == bytes ) || (bytes>BUF_MAX-1))
+		{
+			fprintf(stderr,"WARNING : shared memory log truncated, increase BUF_MAX\n");
+			bytes = BUF_MAX-1;
+		}
+		return sEmitRecord(shw,buf,bytes);
+	}
+}
+
+/** Helper function to write a record with key / value fields. */
+static int sWriteKVToShm(LogWriter *_this,const LogLevel logLevel,
+		const char* moduleName,
+		const char* file,const char* funcName, const int lineNum,
+		const char* msg,va_list fields)
+{
+	ShmLogWriter *shw = (ShmLogWriter*) _this;
+	if(!_this || !shw->ring.header || !msg)
+	{
+		fprintf(stderr,"invalid args for sWriteKVToShm");
+		return -1;
+	}
+	else
+	{
+		va_list fieldsCopy;
+		int bytes = 0;
+		va_copy(fieldsCopy,fields);
+		if(OutputFormatJson == shw->outputFormat)
+			bytes = sWriteJsonRecord(shw,logLevel,file,funcName,lineNum,msg,(int)strlen(msg),&fieldsCopy);
+		else
+		{
+			char buf[BUF_MAX];
+			char curDateTime[32];
+			int prefixLen;
+			LLOutBuf out;
+			memset(curDateTime, 0, sizeof(curDateTime));
+			LLGetCurDateTime(curDateTime, sizeof(curDateTime));
+			prefixLen = snprintf(buf,BUF_MAX-1,"\n[%s] %s %s::%s#%d:%s() - ", curDateTime, sGetLogPrefix(logLevel),
+					moduleName,file,lineNum,funcName);
+			if((prefixLen < 0) || (prefixLen > BUF_MAX - LL_OUT_RESERVE))
+				prefixLen = 0;
+			/* the message and the fields, key=value, follow the usual prefix. */
+			LLOutInit(&out,buf,BUF_MAX);
+			out.len = prefixLen;
+			if(shw->includeContext)
+				out.len += LLCopyContext(buf + prefixLen,out.size - prefixLen,OutputFormatText);
+			LLOutAppend(&out,msg,(int)strlen(msg));
+			LLAppendKVFields(&out,OutputFormatText,fieldsCopy);
+			bytes = sEmitRecord(shw,buf,out.len);
+		}
+		va_end(fieldsCopy);
+		return bytes;
+	}
+}
+
+/* helper function to encode a record as JSON and to write it. */
+static int sWriteJsonRecord(ShmLogWriter* shw,const LogLevel logLevel,
+		const char* file,const char* funcName,const int lineNum,
+		const char* msg,int msgLen,va_list* fields)
+{
+	char buf[BUF_MAX];
+	char curDateTime[32];
+	LLOutBuf out;
+	memset(curDateTime, 0, sizeof(curDateTime));
+	LLGetCurDateTime(curDateTime, sizeof(curDateTime));
+	/* room is kept for the newline. */
+	LLOutInit(&out,buf,BUF_MAX - 1);
+	LLJsonAppendRecordStart(&out,curDateTime);
+	LLJsonAppendRecordInfo(&out,logLevel,shw->base.moduleName,file,funcName,lineNum);
+	if(shw->includeContext)
+		out.len += LLCopyContext(buf + out.len,out.size - out.len,OutputFormatJson);
+	LLJsonAppendKey(&out,"msg");
+	LLJsonAppendString(&out,msg,msgLen);
+	if(fields)
+		LLAppendKVFields(&out,OutputFormatJson,*fields);
+	LLJsonAppendRecordEnd(&out);
+	buf[out.len] = '\n';
+	return sEmitRecord(shw,buf,out.len + 1);
+}
+
+static int sShmFuncLogEntry(LogWriter *_this,const char* funcName)
+{
+	ShmLogWriter *shw = (ShmLogWriter*) _this;
+	if(!_this || !shw->ring.header)
+	{
+		fprintf(stderr,"invalid args for sShmFuncLogEntry");
+		return -1;
+	}
+	else if(OutputFormatJson == shw->outputFormat)
+		return sWriteJsonRecord(shw,Trace,NULL,funcName,0,"function entry",14,NULL);
+	else
+	{
+		char buf[BUF_MAX];
+		int bytes = snprintf(buf,BUF_MAX-1,"\n{ %s", funcName);
+		buf[BUF_MAX-1] = 0;
+		if((-1 == bytes ) || (bytes>BUF_MAX-1))
+			bytes = BUF_MAX-1;
+		return sEmitRecord(shw,buf,bytes);
+	}
+}
+
+static int sShmFuncLogExit(LogWriter* _this,const char* funcName,const int lineNumber)
+{
+	ShmLogWriter *shw = (ShmLogWriter*) _this;
+	if(!_this || !shw->ring.header)
+	{
+		fprintf(stderr,"invalid args for sShmFuncLogExit");
+		return -1;
+	}
+	else if(OutputFormatJson == shw->outputFormat)
+		return sWriteJsonRecord(shw,Trace,NULL,funcName,lineNumber,"function exit",13,NULL);
+	else
+	{
+		char buf[BUF_MAX];
+		int bytes = snprintf(buf,BUF_MAX-1,"\n%s : %d }", funcName,lineNumber);
+		buf[BUF_MAX-1] = 0;
+		if((-1 == bytes ) || (bytes>BUF_MAX-1))
+			bytes = BUF_MAX-1;
+		return sEmitRecord(shw,buf,bytes);
+	}
+}
+
+/** The ring is unmapped, the records not read yet remain for the collector. */
+static int sShmLoggerDeInit(LogWriter* _this)
+{
+	ShmLogWriter *shw = (ShmLogWriter*) _this;
+	if(shw && shw->ring.header)
+		LLShmRingClose(&shw->ring);
+	shw->base.logLevel = Trace;
+	memset(&(shw->base.moduleName), 0, sizeof(shw->base.moduleName));
+	shw->outputFormat = OutputFormatText;
+	shw->includeContext = 0;
+	return 0;
+}
+
+/** Waits until the collector has read the records, the records in the ring are kept if the
+ * process ends, so it gives up as soon as the collector stops reading.
+ * \returns -1 if the collector is not running.
+ * */
+static int sShmLoggerSync(LogWriter* _this)
+{
+	ShmLogWriter *shw = (ShmLogWriter*) _this;
+	long long consumed = -1;
+	int stalled = 0;
+	if(!_this || !shw->ring.header)
+		return -1;
+	while(LLShmRingPending(&shw->ring))
+	{
+		if(consumed != shw->ring.header->consumed)
+		{
+			consumed = shw->ring.header->consumed;
+			stalled = 0;
+		}
+		else if(++stalled >= SYNC_STALL_MS)
+			return -1;
+		PLSleepMs(1);
+	}
+	return 0;
+}
+
+/** Write the final record when a fatal signal is caught, writing to the ring is
+ * async-signal-safe. The records logged so far are already in the ring. */
+static int sShmLoggerCrashFlush(LogWriter* _this,int signum)
+{
+	ShmLogWriter *shw = (ShmLogWriter*) _this;
+	char record[512];
+	int len = 0;
+	if(!_this || !shw->ring.header)
+		return -1;
+	if(OutputFormatJson == shw->outputFormat)
+	{
+		len = LLFormatCrashRecord(record,sizeof(record) - 1,shw->base.moduleName,signum,OutputFormatJson);
+		record[len++] = '\n';
+	}
+	else
+	{
+		record[len++] = '\n';
+		len += LLFormatCrashRecord(record + len,sizeof(record) - len,shw->base.moduleName,signum,OutputFormatText);
+	}
+	return LLShmRingWrite(&shw->ring,record,len);
+}
+
+/** Called around fork(), the mapping is shared with the child, which writes with its own id. */
+static int sShmLoggerAtFork(LogWriter* _this,int phase)
+{
+	ShmLogWriter *shw = (ShmLogWriter*) _this;
+	if(!_this || !shw->ring.header)
+		return -1;
+	if(LL_FORK_CHILD == phase)
+		shw->ring.pid = PLGetProcessId();
+	return 0;
+}
+
+/* helper function to write a record to the ring. */
+static int sEmitRecord(ShmLogWriter* shw,const char* buf,int len)
+{
+	return (0 == LLShmRingWrite(&shw->ring,buf,len)) ? len : -1;
+}
+
+/* helper function to get the log prefix */
+static const char* sGetLogPrefix(const LogLevel logLevel)
+{
+	switch (logLevel)
+	{
+		case Trace:	return "[T]";
+		case Debug: return "[D]";
+		case Info:	return "[I]";
+		case Warn:	return "[W]";
+		case Error:	return "[E]";
+		case Fatal:	return "[F]";
+		default:	return "";
+	}
+}
@@ -0,0 +1,253 @@
+/*
+       Licensed to the Apache Software Foundation (ASF) under one
+       or more contributor license agreements.  See the NOTICE file
+       distributed with this work for additional information
+       regarding copyright ownership.  The ASF licenses this file
+       to you under the Apache License, Version 2.0 (the
+       "License"); you may not use this file except in compliance
+       with the License.  You may obtain a copy of the License at
+
+         http://www.apache.org/licenses/LICENSE-2.0
+
+       Unless required by applicable law or agreed to in writing,
+       software distributed under the License is distributed on an
+       "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+       KIND, either express or implied.  See the License for the
+       specific language governing permissions and limitations
+       under the License.
+ */
+/**
+ * \file The shared memory ring of \ref LogToSharedMemory, see shm_ring.h.
+ * */
+#include "shm_ring.h"
+#include "LLTimeUtil.h"
+#include <stdio.h>
+#include <string.h>
+
+#define ALIGN_RECORD(n)		(((n) + LL_SHM_RECORD_HEADER - 1) & ~(LL_SHM_RECORD_HEADER - 1))
+#define RECORD_WORD(len, state)	(((long long)(len) << 32) | (state))
+#define RECORD_LEN(word)	((unsigned int)((unsigned long long)(word) >> 32))
+#define RECORD_STATE(word)	((int)((word) & 0xff))
+
+/* Maps the ring, it is created if it does not exist. */
+int LLShmRingOpen(LLShmRing* r, const char* name, unsigned int capacity)
+{
+	unsigned int mapSize = 0;
+	void* addr = 0;
+	int created, tries;
+	unsigned int size = LL_SHM_RING_MIN;
+	memset(r, 0, sizeof(*r));
+	if(!capacity)
+		capacity = LL_SHM_RING_DEFAULT;
+	while((size < capacity) && (size < LL_SHM_RING_MAX))
+		size <<= 1;
+	created = PLShmOpen(name, LL_SHM_HEADER_SIZE + size, &r->shm, &addr, &mapSize);
+	if(created < 0)
+	{
+		fprintf(stderr,"[liblogger] could not open the shared memory %s\n",name);
+		return -1;
+	}
+	r->header = (LLShmRingHeader*)addr;
+	if(created)
+	{
+		r->header->capacity = size;
+		r->header->maxRecord = size / 4;
+		PLAtomicExchange64(&r->header->magic, LL_SHM_MAGIC);
+	}
+	else
+	{
+		/* the creator may still be initializing the header. */
+		for(tries = 0; (PLAtomicLoad64(&r->header->magic) != LL_SHM_MAGIC) && (tries < 1000); tries++)
+			PLSleepMs(1);
+		size = r->header->capacity;
+		if( (PLAtomicLoad64(&r->header->magic) != LL_SHM_MAGIC) || (size & (size - 1))
+				|| (size < LL_SHM_RING_MIN) || (mapSize < LL_SHM_HEADER_SIZE + size) )
+		{
+			fprintf(stderr,"[liblogger] the shared memory %s is not a log ring\n",name);
+			LLShmRingClose(r);
+			return -1;
+		}
+	}
+	r->data = (char*)addr + LL_SHM_HEADER_SIZE;
+	r->mask = size - 1;
+	r->pid = PLGetProcessId();
+	return 0;
+}
+
+/* Unmaps the ring. */
+void LLShmRingClose(LLShmRing* r)
+{
+	PLShmClose(&r->shm);
+	r->header = 0;
+	r->data = 0;
+}
+
+/* Adds a record to the ring, lock-free and async-signal-safe. */
+int LLShmRingWrite(LLShmRing* r, const char* data, int len)
+{
+	LLShmRingHeader* h = r->header;
+	unsigned int capacity = r->mask + 1;
+	unsigned int need, off, pad;
+	long long pos;
+	unsigned long long used;
+	LLShmRecord* rec;
+	if(!h || (len < 0))
+		return -1;
+	if((unsigned int)len > h->maxRecord - LL_SHM_RECORD_HEADER)
+		len = (int)(h->maxRecord - LL_SHM_RECORD_HEADER);
+	need = ALIGN_RECORD(LL_SHM_RECORD_HEADER + len);
+	do
+	{
+		/* plain reads, the consumed position is not written by the producers, an older
+		 * value only makes the free space smaller. */
+		pos = h->reserved;
+		off = (unsigned int)pos & r->mask;
+		/* a record never wraps, the end of the ring is padded. */
+		pad = (off + need > capacity) ? capacity - off : 0;
+		used = (unsigned long long)(pos + pad + need - h->consumed);
+		if(used > capacity)
+		{
+			PLAtomicInc64(&h->dropped);
+			return -1;
+		}
+	} while(!PLAtomicCAS64(&h->reserved, pos, pos + pad + need));
+
+	if(pad)
+	{
+		rec = (LLShmRecord*)(r->data + off);
+		rec->pid = r->pid;
+		PLAtomicExchange64(&rec->word, RECORD_WORD(pad - LL_SHM_RECORD_HEADER, LL_SHM_PADDING));
+		off = 0;
+	}
+	rec = (LLShmRecord*)(r->data + off);
+	rec->pid = r->pid;
+	/* the length is known before the commit, to skip the record if the process ends.
+	 * A full barrier : the data is never visible in the space of a record without header. */
+	PLAtomicExchange64(&rec->word, RECORD_WORD(len, LL_SHM_WRITING));
+	memcpy(rec + 1, data, len);
+	/* a full barrier : the data is visible before the commit, the commit before
+	 * the waiting flag is read. */
+	PLAtomicExchange64(&rec->word, RECORD_WORD(len, LL_SHM_COMMITTED));
+	/* a single producer wakes the collector, once there is a batch of records. */
+	if( h->waiting && (used >= (capacity >> LL_SHM_WAKE_FILL))
+			&& PLAtomicCAS64(&h->waiting, 1, 0) )
+		PLShmWake(&h->wakeSeq);
+	return 0;
+}
+
+/* Returns non zero if the records written so far are not all read. */
+int LLShmRingPending(LLShmRing* r)
+{
+	return r->header && (PLAtomicLoad64(&r->header->consumed) != PLAtomicLoad64(&r->header->reserved));
+}
+
+/* helper function to release the space of the record at the consumed position. */
+static void sConsume(LLShmRing* r, long long pos, unsigned int size)
+{
+	memset(r->data + ((unsigned int)pos & r->mask), 0, size);
+	/* a full barrier : the space is zeroed before the producers can reserve it. */
+	PLAtomicExchange64(&r->header->consumed, pos + size);
+	r->stallSinceNs = 0;
+	r->resync = 0;
+}
+
+/* helper function to time the stall of the collector on the record at the consumed position,
+ * the reserved position is noted as the stall starts.
+ * \returns non zero once the record is stalled for LL_SHM_STALL_MS. */
+static int sStalled(LLShmRing* r)
+{
+	if(!r->stallSinceNs)
+	{
+		r->stallSinceNs = LLGetMonotonicNs();
+		r->stallReserved = PLAtomicLoad64(&r->header->reserved);
+		return 0;
+	}
+	return LLGetMonotonicNs() - r->stallSinceNs > LL_SHM_STALL_MS * 1000000ULL;
+}
+
+/* Reads the next record. */
+int LLShmRingRead(LLShmRing* r, char* buf, int size)
+{
+	LLShmRingHeader* h = r->header;
+	for(;;)
+	{
+		long long pos = h->consumed;
+		unsigned int off = (unsigned int)pos & r->mask;
+		LLShmRecord* rec = (LLShmRecord*)(r->data + off);
+		long long word;
+		unsigned int len, recSize;
+		if(pos == PLAtomicLoad64(&h->reserved))
+		{
+			/* the next record is not reserved yet, it is not stalled. */
+			r->stallSinceNs = 0;
+			r->resync = 0;
+			return 0;
+		}
+		word = PLAtomicLoad64(&rec->word);
+		len = RECORD_LEN(word);
+		recSize = ALIGN_RECORD(LL_SHM_RECORD_HEADER + len);
+		if(RECORD_STATE(word) && (recSize > r->mask + 1 - off))
+		{
+			/* not a record, the ring is corrupted : the reserved records are skipped. */
+			fprintf(stderr,"[liblogger] corrupted record at %lld, the ring is reset\n",pos);
+			memset(r->data, 0, r->mask + 1);
+			PLAtomicExchange64(&h->consumed, PLAtomicLoad64(&h->reserved));
+			return 0;
+		}
+		switch(RECORD_STATE(word))
+		{
+			case LL_SHM_COMMITTED:
+				if((int)len > size)
+					len = (unsigned int)size;
+				memcpy(buf, rec + 1, len);
+				sConsume(r, pos, recSize);
+				if(len)
+					return (int)len;
+				break;
+			case LL_SHM_PADDING:
+				sConsume(r, pos, recSize);
+				break;
+			case LL_SHM_WRITING:
+				/* the record is being written, it is skipped if its process is gone. */
+				if(sStalled(r) && !PLProcessExists(rec->pid))
+				{
+					r->lost++;
+					sConsume(r, pos, recSize);
+					break;
+				}
+				return 0;
+			default:
+				/* the space is reserved, the header is not written yet. A producer gone
+				 * before writing it leaves zeroes up to the next record, whose length is
+				 * unknown : they are skipped a header at a time, until the next header.
+				 * The space reserved once the stall started is not skipped, its producers
+				 * may still be writing : the stall starts again from there. */
+				if(r->resync && (pos >= r->stallReserved))
+				{
+					r->stallSinceNs = 0;
+					r->resync = 0;
+				}
+				if(!r->resync && !sStalled(r))
+					return 0;
+				if(!r->resync)
+					r->lost++;
+				memset(rec, 0, LL_SHM_RECORD_HEADER);
+				PLAtomicExchange64(&h->consumed, pos + LL_SHM_RECORD_HEADER);
+				r->resync = 1;
+				break;
+		}
+	}
+}
+
+/* Waits until the ring is filled over LL_SHM_WAKE_FILL. */
+void LLShmRingWait(LLShmRing* r, int timeoutMs)
+{
+	LLShmRingHeader* h = r->header;
+	int seq = h->wakeSeq;
+	/* a full barrier : the flag is set before the fill is checked, a producer
+	 * reserving afterwards sees the flag. */
+	PLAtomicExchange64(&h->waiting, 1);
+	if((unsigned long long)(PLAtomicLoad64(&h->reserved) - h->consumed) < ((r->mask + 1) >> LL_SHM_WAKE_FILL))
+		PLShmWait(&h->wakeSeq, seq, timeoutMs);
+	PLAtomicExchange64(&h->waiting, 0);
+}
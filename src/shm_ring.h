@@ -0,0 +1,151 @@
+/*
+       Licensed to the Apache Software Foundation (ASF) under one
+       or more contributor license agreements.  See the NOTICE file
+       distributed with this work for additional information
+       regarding copyright ownership.  The ASF licenses this file
+       to you under the Apache License, Version 2.0 (the
+       "License"); you may not use this file except in compliance
+       with the License.  You may obtain a copy of the License at
+
+         http://www.apache.org/licenses/LICENSE-2.0
+
+       Unless required by applicable law or agreed to in writing,
+       software distributed under the License is distributed on an
+       "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+       KIND, either express or implied.  See the License for the
+       specific language governing permissions and limitations
+       under the License.
+ */
+/**
+ * \file The shared memory ring of \ref LogToSharedMemory, written by the logging processes
+ * and read by a collector process (see llcollector).
+ *
+ * The shared memory is a 256 bytes header followed by the ring, a power of two bytes.
+ * A producer reserves the space of a record with a compare and swap of the reserved
+ * position, copies the record and then commits it, so the producers never lock nor make a
+ * system call. The collector waits for records with a timeout, it is woken early by the
+ * producer which fills the ring over \ref LL_SHM_WAKE_FILL, one system call per batch of
+ * records. A record which does not fit in the free space is dropped and counted, the
+ * producers never wait.
+ *
+ * A record is a 16 bytes header followed by the data, padded to 16 bytes : a 64 bits word,
+ * the length of the data in the high 32 bits and the state in the low ones, and the id of
+ * the process writing it. A record never wraps, the end of the ring is skipped with a
+ * padding record. The collector reads the records in order, zeroes them and moves the
+ * consumed position, a record being written stops it until it is committed, or until the
+ * process writing it is gone. The space of a record whose header is not written yet stops
+ * it for \ref LL_SHM_STALL_MS at most : the producer is then taken as gone between the
+ * reservation and the header, and the zeroes up to the next header are skipped, within the
+ * space reserved before the stall started.
+ *
+ * The records stay in the shared memory when the logging process ends or crashes, until
+ * the collector reads them.
+ * */
+#ifndef __SHM_RING_H__
+#define __SHM_RING_H__
+
+#include "tPLAtomic.h"
+#include "tPLShm.h"
+
+/** The magic of the header, "LLSHMRG1". */
+#define LL_SHM_MAGIC			0x4c4c53484d524731LL
+/** The size of the header of the shared memory. */
+#define LL_SHM_HEADER_SIZE		256
+/** The size of the header of a record, the records are aligned on it. */
+#define LL_SHM_RECORD_HEADER	16
+/** The limits / default of the size of the ring. */
+#define LL_SHM_RING_MIN			(64 * 1024)
+#define LL_SHM_RING_MAX			(1024 * 1024 * 1024)
+#define LL_SHM_RING_DEFAULT		(4 * 1024 * 1024)
+/** The collector is woken once the ring is filled over 1 / 2^LL_SHM_WAKE_FILL. */
+#define LL_SHM_WAKE_FILL		3
+/** A record being written for this long is skipped if the process writing it is gone,
+ * a reserved space without header for this long is skipped. */
+#define LL_SHM_STALL_MS			1000
+
+/** The states of a record. */
+#define LL_SHM_WRITING			1
+#define LL_SHM_COMMITTED		2
+#define LL_SHM_PADDING			3
+
+/** The header of the shared memory, the positions are byte counts since the creation of
+ * the ring, each one on its own cache line. */
+typedef struct LLShmRingHeader
+{
+	/** \ref LL_SHM_MAGIC, set once the header is initialized. */
+	tPLAtomic64		magic;
+	unsigned int	capacity;
+	/** The largest record, header included. */
+	unsigned int	maxRecord;
+	char			pad0[48];
+	/** The end of the space reserved by the producers. */
+	tPLAtomic64		reserved;
+	/** The number of records dropped as the ring was full. */
+	tPLAtomic64		dropped;
+	char			pad1[48];
+	/** The end of the records read by the collector. */
+	tPLAtomic64		consumed;
+	/** Non zero while the collector waits for records. */
+	tPLAtomic64		waiting;
+	/** The word the collector waits on. */
+	volatile int	wakeSeq;
+	char			pad2[108];
+} LLShmRingHeader;
+
+/** The header of a record. */
+typedef struct LLShmRecord
+{
+	/** The length of the data << 32 | the state. */
+	tPLAtomic64		word;
+	int				pid;
+	int				unused;
+} LLShmRecord;
+
+/** A process mapping of the ring. */
+typedef struct LLShmRing
+{
+	tPLShm				shm;
+	LLShmRingHeader*	header;
+	char*				data;
+	unsigned int		mask;
+	int					pid;
+	/** The collector state : the time a record being written was first seen, in ns,
+	 * and the number of records lost by the processes which are gone. */
+	unsigned long long	stallSinceNs;
+	unsigned long long	lost;
+	/** Non zero while the collector skips the space reserved by a process gone before
+	 * writing the header, up to the reserved position when the stall started. */
+	int					resync;
+	long long			stallReserved;
+} LLShmRing;
+
+/** Maps the ring, it is created if it does not exist.
+ * \param [in] name		The name of the shared memory.
+ * \param [in] capacity	The size of the ring when it is created, rounded to a power of two,
+ * 						0 for \ref LL_SHM_RING_DEFAULT.
+ * \returns 0 on success, -1 on failure.
+ * */
+int LLShmRingOpen(LLShmRing* r, const char* name, unsigned int capacity);
+
+/** Unmaps the ring, the records remain in the shared memory. */
+void LLShmRingClose(LLShmRing* r);
+
+/** Adds a record to the ring, lock-free and async-signal-safe, the longest records are
+ * truncated. \returns 0 on success, -1 if the ring is full and the record is dropped.
+ * */
+int LLShmRingWrite(LLShmRing* r, const char* data, int len);
+
+/** \returns non zero if the records written so far are not all read by the collector. */
+int LLShmRingPending(LLShmRing* r);
+
+/** Reads the next record, used by the collector only.
+ * \param [out] buf		The data of the record, truncated to \a size.
+ * \returns the length of the data, 0 if there is no record to read.
+ * */
+int LLShmRingRead(LLShmRing* r, char* buf, int size);
+
+/** Waits until the ring is filled over \ref LL_SHM_WAKE_FILL or for \a timeoutMs,
+ * used by the collector only. */
+void LLShmRingWait(LLShmRing* r, int timeoutMs);
+
+#endif // __SHM_RING_H__
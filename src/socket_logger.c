@@ -17,6 +17,14 @@
        under the License.
  */
 #include "socket_logger_impl.h"
+#include "crash_handler.h"
+#include "async_queue.h"
+#include "repeat_filter.h"
+#include "json_encoder.h"
+#include "log_context.h"
+#include "blob_encoder.h"
+#include "prefix_cache.h"
+#include "layout.h"
 #include "tPLSocket.h"
 #include "LLTimeUtil.h"
 #include <win32_support.h>
@@ -34,21 +42,87 @@ static int sSendToSock(LogWriter *_this,const LogLevel logLevel,
 #endif
 		const char* fmt,va_list ap);
 
+/** Helper function to send a record with key / value fields. */
+static int sSendKVToSock(LogWriter *_this,const LogLevel logLevel,
+		const char* moduleName,
+		const char* file,const char* funcName, const int lineNum, 
+		const char* msg,va_list fields);
+
+/** Helper function to send a record followed by a payload. */
+static int sSendBlobToSock(LogWriter *_this,const LogLevel logLevel,
+		const char* moduleName,
+		const char* file,const char* funcName, const int lineNum, 
+		int encoding,const void* data,int len,
+		const char* fmt,va_list ap);
+
 int sSockFuncLogEntry(LogWriter *_this,const char* funcName);
 
 int sSockFuncLogExit(LogWriter* _this,const char* funcName,const int lineNumber);
 
 int sSockLoggerDeInit(LogWriter* _this);
 
+static int sSockLoggerSync(LogWriter* _this);
+
+static int sSockLoggerCrashFlush(LogWriter* _this,int signum);
+
+static int sSockLoggerAtFork(LogWriter* _this,int phase);
+
 /* helper function to get the log prefix */
 static const char* sGetLogPrefix(const LogLevel logLevel);
 
+/* helper function to start the background writer thread, if asynchronous logging is enabled. */
+static void sStartAsyncWriter(const tAsyncLogParams* asyncParams);
+
 typedef struct SockLogWriter
 {
 	LogWriter	base;
 	tPLSocket	sock;
+	/** The queue of the background writer thread, NULL when logging synchronously. */
+	LLAsyncQueue	*queue;
+	/** The filter of repeated records. */
+	LLRepeatFilter	repeats;
+	/** The output format. */
+	tOutputFormat	outputFormat;
+	/** Non zero to add the context of the logging thread to the records. */
+	int		includeContext;
+	/** The buffer where the payloads of the blob records are encoded / escaped. */
+	LLBlobBuf	blobBuf;
+	/** The prefixes of the text records, rendered once per call site. */
+	LLPrefixCache	prefixes;
+	/** The layout of the text records, see \ref tFileLoggerInitParams::layout. */
+	LLLayout	layout;
 }SockLogWriter;
 
+/* helper function to encode a record as JSON and to send it. */
+static int sSendJsonRecord(SockLogWriter* slw,const LogLevel logLevel,
+		const char* file,const char* funcName,const int lineNum,
+		const char* msg,int msgLen,va_list* fields);
+
+/* helper function to hand a record to the queue or to the socket. */
+static int sEmitRecord(SockLogWriter* slw,const LogLevel logLevel,const char* buf,int len);
+
+/* helper function to send the summary of the repeated records suppressed so far. */
+static void sSendRepeatSummary(SockLogWriter* slw);
+
+/* helper function to send the summary of the repeated records when a repeat is suppressed,
+ * if the repeats wait for too long. Returns 0, the length of the suppressed record. */
+static int sSendDueRepeatSummary(SockLogWriter* slw);
+
+/* helper function to format the head of a text record to buf (BUF_MAX bytes), up to the
+ * message : the newline, then the layout, or the prefix followed by the context. bodyOffset
+ * is the offset of the part compared to find the repeated records, file is NULL for the
+ * records without call site. */
+static int sFormatHead(SockLogWriter* slw,char* buf,const LogLevel logLevel,const char* moduleName,
+		const char* file,const char* funcName,const int lineNum,int* bodyOffset);
+
+/* helper function to format the tail of the layout to tail (LL_LAYOUT_TAIL_MAX bytes). */
+static int sFormatTail(SockLogWriter* slw,char* tail,const LogLevel logLevel,const char* moduleName,
+		const char* file,const char* funcName,const int lineNum);
+
+/* helper function to format a record without call site with the layout, truncated to size bytes. */
+static int sFormatLayoutRecord(SockLogWriter* slw,char* out,int size,const LogLevel logLevel,
+		const char* funcName,const int lineNum,const char* msg,int msgLen);
+
 static SockLogWriter sSockLogWriter = 
 {
 	{
@@ -58,8 +132,23 @@ static SockLogWriter sSockLogWriter =
 		/* .base.logFuncEntry 	= */sSockFuncLogEntry,
 		/* .base.logFuncExit	= */sSockFuncLogExit,
 		/* .base.loggerDeInit 	= */sSockLoggerDeInit,	
+		/* .base.sync		= */sSockLoggerSync,
+		/* .base.crashFlush	= */sSockLoggerCrashFlush,
+		/* .base.logKV		= */sSendKVToSock,
+		/* .base.atFork		= */sSockLoggerAtFork,
+		/* .base.commit		= */0,
+		/* .base.commitStats	= */0,
+		/* .base.logBlob	= */sSendBlobToSock,
+		/* .base.logStr	= */0,
 	},
-	/* .sock  = */0
+	/* .sock  = */0,
+	/* .queue = */0,
+	/* .repeats = */{0},
+	/* .outputFormat = */OutputFormatText,
+	/* .includeContext = */0,
+	/* .blobBuf = */{0},
+	/* .prefixes = */{0},
+	/* .layout = */{0}
 };
 
 
@@ -88,18 +177,48 @@ int InitSocketLogger(LogWriter** logWriter,tSockLoggerInitParams *initParams)
 		    /* socket was opened successfully, emit the current date / time. */
 		    char curDateTime[32];	
 		    char tempBuf[128];
+		    sSockLogWriter.outputFormat = initParams->outputFormat;
+		    if(OutputFormatBinary == initParams->outputFormat)
+		    {
+			    fprintf(stderr,"The binary output format is not supported by the socket logger, text will be used.\n");
+			    sSockLogWriter.outputFormat = OutputFormatText;
+		    }
 		    if( !LLGetCurDateTime(curDateTime,sizeof(curDateTime)) )
 		    {
-			    int bytes = snprintf(tempBuf,sizeof(tempBuf),"\n----- Logging Started on %s -----\n",curDateTime);
+			    int bytes;
+			    if(OutputFormatJson == sSockLogWriter.outputFormat)
+			    {
+				    LLOutBuf out;
+				    LLOutInit(&out,tempBuf,sizeof(tempBuf) - 1);
+				    LLJsonAppendRecordStart(&out,curDateTime);
+				    LLJsonAppendKey(&out,"msg");
+				    LLJsonAppendString(&out,"Logging Started",15);
+				    LLJsonAppendRecordEnd(&out);
+				    tempBuf[out.len] = '\n';
+				    bytes = out.len + 1;
+			    }
+			    else
+				    bytes = snprintf(tempBuf,sizeof(tempBuf),"\n----- Logging Started on %s -----\n",curDateTime);
 			    if( (bytes == -1) || (bytes > sizeof(tempBuf)) )
 				    bytes = sizeof(tempBuf);
 			    PLSockSend(sSockLogWriter.sock,tempBuf,bytes);
 		    }
+		    sStartAsyncWriter(&initParams->asyncParams);
 	    }
 	}
 
 	/* Set log level */
 	sSockLogWriter.base.logLevel = initParams->logLevel;
+	sSockLogWriter.repeats.enabled = initParams->suppressRepeats;
+	sSockLogWriter.includeContext = initParams->includeContext;
+	LLLayoutDestroy(&sSockLogWriter.layout);
+	if(initParams->layout)
+	{
+		if(OutputFormatText != sSockLogWriter.outputFormat)
+			fprintf(stderr,"[liblogger] the layout is only used with the text output format\n");
+		else if(LLLayoutCompile(&sSockLogWriter.layout,initParams->layout))
+			fprintf(stderr,"[liblogger] the built-in layout will be used\n");
+	}
 
 	/* Set log module name */
 	if (initParams->moduleName)
@@ -127,31 +246,246 @@ static int sSendToSock(LogWriter *_this,const LogLevel logLevel,
 		fprintf(stderr,"invalid args for sSendToSock");
 		return -1;
 	}
+	else if(OutputFormatJson == slw->outputFormat)
+	{
+		/* the message is formatted first, then escaped in the record. */
+		char msg[BUF_MAX];
+		int msgLen = vsnprintf(msg,BUF_MAX,fmt,ap);
+		if((msgLen < 0) || (msgLen > BUF_MAX - 1))
+			msgLen = (int)strlen(msg);
+#ifdef VARIADIC_MACROS
+		return sSendJsonRecord(slw,logLevel,file,funcName,lineNum,msg,msgLen,NULL);
+#else
+		return sSendJsonRecord(slw,logLevel,NULL,NULL,0,msg,msgLen,NULL);
+#endif
+	}
 	else
 	{
 		char buf[BUF_MAX];
-		char curDateTime[32];
+		char tail[LL_LAYOUT_TAIL_MAX];
 		int bytes = 0;
+		int prefixLen = 0;
+		int tailLen = 0;
 
-		memset(curDateTime, 0, sizeof(curDateTime));
-		LLGetCurDateTime(curDateTime, sizeof(curDateTime));
+		/* the context is compared with the message. */
 #ifdef VARIADIC_MACROS
-		bytes = snprintf(buf,BUF_MAX-1,"\n[%s] %s %s::%s#%d:%s() - ", curDateTime, sGetLogPrefix(logLevel),
-				moduleName,file,lineNum,funcName);
+		bytes = sFormatHead(slw,buf,logLevel,moduleName,file,funcName,lineNum,&prefixLen);
+		tailLen = sFormatTail(slw,tail,logLevel,moduleName,file,funcName,lineNum);
 #else
-		bytes = snprintf(buf,BUF_MAX-1,"\n[%s] %s - ", curDateTime, sGetLogPrefix(logLevel));
+		bytes = sFormatHead(slw,buf,logLevel,slw->base.moduleName,NULL,NULL,0,&prefixLen);
+		tailLen = sFormatTail(slw,tail,logLevel,slw->base.moduleName,NULL,NULL,0);
 #endif
 		// to be on safer side, check if required size is available.
-		if(bytes < (BUF_MAX -1) )
-			bytes += vsnprintf(buf+bytes,BUF_MAX-1-bytes,fmt,ap);
+		if(bytes < (BUF_MAX -1 - tailLen) )
+			bytes += vsnprintf(buf+bytes,BUF_MAX-1-tailLen-bytes,fmt,ap);
 		buf[BUF_MAX-1] = 0;
-		if((-1 == bytes ) || (bytes>BUF_MAX-1))
+		if((-1 == bytes ) || (bytes>BUF_MAX-1-tailLen))
 		{
 			fprintf(stderr,"WARNING : socket log truncated, increase BUF_MAX\n");
-			bytes = BUF_MAX-1;
+			bytes = BUF_MAX-1-tailLen;
+		}
+		/* the date time is not part of the comparison. */
+		if( (prefixLen >= 0) && (prefixLen < bytes) && 
+#ifdef VARIADIC_MACROS
+			LLRepeatFilterCheck(&slw->repeats,logLevel,file,lineNum,buf + prefixLen,bytes - prefixLen) )
+#else
+			LLRepeatFilterCheck(&slw->repeats,logLevel,NULL,0,buf + prefixLen,bytes - prefixLen) )
+#endif
+			return sSendDueRepeatSummary(slw);
+		sSendRepeatSummary(slw);
+		memcpy(buf + bytes,tail,tailLen);
+		return sEmitRecord(slw,logLevel,buf,bytes + tailLen);
+	}
+}
+
+/** Helper function to send a record with key / value fields. */
+static int sSendKVToSock(LogWriter *_this,const LogLevel logLevel,
+		const char* moduleName,
+		const char* file,const char* funcName, const int lineNum, 
+		const char* msg,va_list fields)
+{
+	SockLogWriter *slw = (SockLogWriter*) _this;
+	if(!_this || (-1 == slw->sock) || !msg)
+	{
+		fprintf(stderr,"invalid args for sSendKVToSock");
+		return -1;
+	}
+	else
+	{
+		va_list fieldsCopy;
+		int bytes = 0;
+		va_copy(fieldsCopy,fields);
+		if(OutputFormatJson == slw->outputFormat)
+			bytes = sSendJsonRecord(slw,logLevel,file,funcName,lineNum,msg,(int)strlen(msg),&fieldsCopy);
+		else
+		{
+			char buf[BUF_MAX];
+			char tail[LL_LAYOUT_TAIL_MAX];
+			int prefixLen, headLen, tailLen;
+			LLOutBuf out;
+			headLen = sFormatHead(slw,buf,logLevel,moduleName,file,funcName,lineNum,&prefixLen);
+			tailLen = sFormatTail(slw,tail,logLevel,moduleName,file,funcName,lineNum);
+			if(headLen > BUF_MAX - LL_OUT_RESERVE - tailLen)
+				headLen = prefixLen = 0;
+			/* the message and the fields, key=value, follow the usual prefix. */
+			LLOutInit(&out,buf,BUF_MAX - tailLen);
+			out.len = headLen;
+			LLOutAppend(&out,msg,(int)strlen(msg));
+			LLAppendKVFields(&out,OutputFormatText,fieldsCopy);
+			if(!LLRepeatFilterCheck(&slw->repeats,logLevel,file,lineNum,buf + prefixLen,out.len - prefixLen))
+			{
+				sSendRepeatSummary(slw);
+				memcpy(buf + out.len,tail,tailLen);
+				bytes = sEmitRecord(slw,logLevel,buf,out.len + tailLen);
+			}
+			else
+				bytes = sSendDueRepeatSummary(slw);
 		}
-		return PLSockSend(slw->sock,buf,bytes);
+		va_end(fieldsCopy);
+		return bytes;
+	}
+}
+
+/** Helper function to send a record followed by a payload, with a single sendmsg() which
+ * references the payload of the caller, or encoded straight into the queue in asynchronous
+ * mode. The payload is not truncated to BUF_MAX.
+ * */
+static int sSendBlobToSock(LogWriter *_this,const LogLevel logLevel,
+		const char* moduleName,
+		const char* file,const char* funcName, const int lineNum, 
+		int encoding,const void* data,int len,
+		const char* fmt,va_list ap)
+{
+	SockLogWriter *slw = (SockLogWriter*) _this;
+	char buf[BUF_MAX];
+	char curDateTime[32];
+	char tail[LL_BLOB_TAIL_MAX + LL_LAYOUT_TAIL_MAX + 1];
+	LLRecordPart parts[3];
+	tPLIoVec iov[PL_IOV_MAX];
+	int jsonRaw = (OutputFormatJson == slw->outputFormat) && (LogBlobRaw == encoding);
+	char end[LL_LAYOUT_TAIL_MAX];
+	int headLen, msgLen, srcLen, tailLen, endLen, bodyOffset;
+	if(!_this || (-1 == slw->sock) || (len < 0) || (len && !data))
+	{
+		fprintf(stderr,"invalid args for sSendBlobToSock");
+		return -1;
+	}
+	/* the blob records are not compared with the previous one. */
+	LLRepeatFilterCheck(&slw->repeats,logLevel,NULL,0,NULL,0);
+	sSendRepeatSummary(slw);
+	if(OutputFormatJson == slw->outputFormat)
+	{
+		char msg[BUF_MAX];
+		LLOutBuf out;
+		memset(curDateTime, 0, sizeof(curDateTime));
+		LLGetCurDateTime(curDateTime, sizeof(curDateTime));
+		msgLen = vsnprintf(msg,BUF_MAX,fmt,ap);
+		if((msgLen < 0) || (msgLen > BUF_MAX - 1))
+			msgLen = (int)strlen(msg);
+		LLOutInit(&out,buf,BUF_MAX);
+		LLJsonAppendRecordStart(&out,curDateTime);
+		LLJsonAppendRecordInfo(&out,logLevel,moduleName,file,funcName,lineNum);
+		if(slw->includeContext)
+			out.len += LLCopyContext(buf + out.len,out.size - out.len,OutputFormatJson);
+		LLJsonAppendKey(&out,"blob_len");
+		LLJsonAppendUInt(&out,len);
+		LLJsonAppendKey(&out,"msg");
+		LLJsonAppendString(&out,msg,msgLen);
+		/* the message is closed even if it was truncated, the reserve holds the blob member. */
+		out.size += LL_OUT_RESERVE;
+		out.truncated = 0;
+		LLJsonAppendKey(&out,"blob");
+		if(LogBlobRaw != encoding)
+			LLOutAppend(&out,"\"",1);
+		headLen = out.len;
+	}
+	else
+	{
+		headLen = sFormatHead(slw,buf,logLevel,moduleName,file,funcName,lineNum,&bodyOffset);
+		msgLen = vsnprintf(buf + headLen,BUF_MAX - headLen,fmt,ap);
+		if((msgLen < 0) || (msgLen > BUF_MAX - 1 - headLen))
+			msgLen = BUF_MAX - 1 - headLen;
+		headLen += msgLen;
+	}
+	/* the text records start with the newline, the JSON records end with it. */
+	end[0] = '\n';
+	endLen = 1;
+	if(OutputFormatText == slw->outputFormat)
+		endLen = sFormatTail(slw,end,logLevel,moduleName,file,funcName,lineNum);
+	/* the records of the queue are truncated, a raw payload is escaped in JSON. */
+	srcLen = len;
+	if(slw->queue)
+	{
+		int room = LL_ASYNC_RECORD_MAX - headLen - LL_BLOB_TAIL_MAX - endLen;
+		if(jsonRaw)
+			room /= 6;
+		if(srcLen > LLBlobSourceLen(encoding,room))
+			srcLen = LLBlobSourceLen(encoding,room);
+	}
+	parts[0].data = buf;
+	parts[0].len = headLen;
+	parts[0].encoding = LogBlobRaw;
+	parts[1].data = data;
+	parts[1].len = srcLen;
+	parts[1].encoding = encoding;
+	if(jsonRaw)
+	{
+		LLOutBuf out;
+		int size = srcLen * 6 + 2 + LL_OUT_RESERVE;
+		char* escaped = LLBlobBufReserve(&slw->blobBuf,size);
+		if(!escaped)
+			return -1;
+		LLOutInit(&out,escaped,size);
+		LLJsonAppendString(&out,(const char*)data,srcLen);
+		parts[1].data = escaped;
+		parts[1].len = out.len;
+	}
+	tailLen = LLBlobFormatTail(tail,slw->outputFormat,encoding,len - srcLen);
+	memcpy(tail + tailLen,end,endLen);
+	tailLen += endLen;
+	parts[2].data = tail;
+	parts[2].len = tailLen;
+	parts[2].encoding = LogBlobRaw;
+	if(slw->queue)
+	{
+		if(LLAsyncQueuePushParts(slw->queue,logLevel,parts,3))
+			return -1;
+		return headLen + LLBlobEncodedLen(parts[1].encoding,parts[1].len) + tailLen;
 	}
+	if(LLBlobPartsToIoVec(parts,3,iov,&slw->blobBuf) < 0)
+		return -1;
+	return PLSockSendV(slw->sock,iov,3);
+}
+
+/* helper function to encode a record as JSON and to send it. */
+static int sSendJsonRecord(SockLogWriter* slw,const LogLevel logLevel,
+		const char* file,const char* funcName,const int lineNum,
+		const char* msg,int msgLen,va_list* fields)
+{
+	char buf[BUF_MAX];
+	char curDateTime[32];
+	int bodyOffset;
+	LLOutBuf out;
+	memset(curDateTime, 0, sizeof(curDateTime));
+	LLGetCurDateTime(curDateTime, sizeof(curDateTime));
+	/* room is kept for the newline. */
+	LLOutInit(&out,buf,BUF_MAX - 1);
+	LLJsonAppendRecordStart(&out,curDateTime);
+	/* the date time is not part of the comparison. */
+	bodyOffset = out.len;
+	LLJsonAppendRecordInfo(&out,logLevel,slw->base.moduleName,file,funcName,lineNum);
+	if(slw->includeContext)
+		out.len += LLCopyContext(buf + out.len,out.size - out.len,OutputFormatJson);
+	LLJsonAppendKey(&out,"msg");
+	LLJsonAppendString(&out,msg,msgLen);
+	if(fields)
+		LLAppendKVFields(&out,OutputFormatJson,*fields);
+	LLJsonAppendRecordEnd(&out);
+	if(LLRepeatFilterCheck(&slw->repeats,logLevel,file,lineNum,buf + bodyOffset,out.len - bodyOffset))
+		return sSendDueRepeatSummary(slw);
+	sSendRepeatSummary(slw);
+	buf[out.len] = '\n';
+	return sEmitRecord(slw,logLevel,buf,out.len + 1);
 }
 
 int sSockFuncLogEntry(LogWriter *_this,const char* funcName)
@@ -163,6 +497,8 @@ int sSockFuncLogEntry(LogWriter *_this,const char* funcName)
 		fprintf(stderr,"invalid args for sSockFuncLogEntry");
 		return -1;
 	}
+	else if(OutputFormatJson == slw->outputFormat)
+		return sSendJsonRecord(slw,Trace,NULL,funcName,0,"function entry",14,NULL);
 	else
 	{
 		char buf[BUF_MAX];
@@ -175,7 +511,15 @@ int sSockFuncLogEntry(LogWriter *_this,const char* funcName)
 		buf[BUF_MAX-1] = 0;
 		if((-1 == bytes ) || (bytes>BUF_MAX-1))
 			bytes = BUF_MAX-1;
-		return PLSockSend(slw->sock,buf,bytes);
+		if(slw->layout.ops)
+		{
+			char msg[BUF_MAX];
+			memcpy(msg,buf + 1,bytes - 1);
+			bytes = sFormatLayoutRecord(slw,buf,BUF_MAX,Trace,funcName,0,msg,bytes - 1);
+		}
+		LLRepeatFilterCheck(&slw->repeats,Trace,NULL,0,NULL,0);
+		sSendRepeatSummary(slw);
+		return sEmitRecord(slw,Trace,buf,bytes);
 	}
 	
 }
@@ -189,6 +533,8 @@ int sSockFuncLogExit(LogWriter* _this,const char* funcName,const int lineNumber)
 		fprintf(stderr,"invalid args for sSockFuncLogExit");
 		return -1;
 	}
+	else if(OutputFormatJson == slw->outputFormat)
+		return sSendJsonRecord(slw,Trace,NULL,funcName,lineNumber,"function exit",13,NULL);
 	else
 	{
 		char buf[BUF_MAX];
@@ -201,7 +547,15 @@ int sSockFuncLogExit(LogWriter* _this,const char* funcName,const int lineNumber)
 		buf[BUF_MAX-1] = 0;
 		if((-1 == bytes ) || (bytes>BUF_MAX-1))
 			bytes = BUF_MAX-1;
-		return PLSockSend(slw->sock,buf,bytes);
+		if(slw->layout.ops)
+		{
+			char msg[BUF_MAX];
+			memcpy(msg,buf + 1,bytes - 1);
+			bytes = sFormatLayoutRecord(slw,buf,BUF_MAX,Trace,funcName,lineNumber,msg,bytes - 1);
+		}
+		LLRepeatFilterCheck(&slw->repeats,Trace,NULL,0,NULL,0);
+		sSendRepeatSummary(slw);
+		return sEmitRecord(slw,Trace,buf,bytes);
 	}
 }
 
@@ -210,13 +564,223 @@ int sSockLoggerDeInit(LogWriter* _this)
 	SockLogWriter *slw = (SockLogWriter*) _this;
 	if(slw)
 	{
+		if(slw->sock)
+			sSendRepeatSummary(slw);
+		/* the pending records are sent before the socket is closed. */
+		if(slw->queue)
+		{
+			LLDestroyAsyncQueue(slw->queue);
+			slw->queue = 0;
+		}
 		PLDestroySocket(&slw->sock);
 	}
 	slw->base.logLevel = Trace;
 	memset(&(slw->base.moduleName), 0, sizeof(slw->base.moduleName));
+	memset(&slw->repeats, 0, sizeof(slw->repeats));
+	slw->outputFormat = OutputFormatText;
+	slw->includeContext = 0;
+	LLBlobBufFree(&slw->blobBuf);
+	LLPrefixCacheDestroy(&slw->prefixes);
+	LLLayoutDestroy(&slw->layout);
+	return 0;
+}
+
+/** Waits until the queued records are sent, in synchronous mode each record is
+ * sent as soon as it is logged, so there is nothing to drain. */
+static int sSockLoggerSync(LogWriter* _this)
+{
+	SockLogWriter *slw = (SockLogWriter*) _this;
+	if(!_this || (-1 == slw->sock))
+		return -1;
+	sSendRepeatSummary(slw);
+	if(slw->queue)
+		return LLAsyncQueueSync(slw->queue);
+	return 0;
+}
+
+/** Send the final record when a fatal signal is caught, send() is async-signal-safe. */
+static int sSockLoggerCrashFlush(LogWriter* _this,int signum)
+{
+	SockLogWriter *slw = (SockLogWriter*) _this;
+	char record[512];
+	int len = 0;
+	if(!_this || (-1 == slw->sock) || !slw->sock)
+		return -1;
+	if(slw->queue)
+		LLAsyncQueueCrashDrain(slw->queue);
+	if(OutputFormatJson == slw->outputFormat)
+	{
+		len = LLFormatCrashRecord(record,sizeof(record) - 1,slw->base.moduleName,signum,OutputFormatJson);
+		record[len++] = '\n';
+	}
+	else
+	{
+		record[len++] = '\n';
+		len += LLFormatCrashRecord(record + len,sizeof(record) - len,slw->base.moduleName,signum,OutputFormatText);
+	}
+	return PLSockSend(slw->sock,record,len);
+}
+
+/** Called around fork(), the child shares the connection and gets its own writer thread. */
+static int sSockLoggerAtFork(LogWriter* _this,int phase)
+{
+	SockLogWriter *slw = (SockLogWriter*) _this;
+	if(!_this || !slw->sock)
+		return -1;
+	LLAsyncQueueAtFork(slw->queue,phase);
+	if(LL_FORK_CHILD == phase)
+	{
+		int suppressRepeats = slw->repeats.enabled;
+		memset(&slw->repeats,0,sizeof(slw->repeats));
+		slw->repeats.enabled = suppressRepeats;
+	}
+	return 0;
+}
+
+/* helper function to hand a record to the queue or to the socket. */
+static int sEmitRecord(SockLogWriter* slw,const LogLevel logLevel,const char* buf,int len)
+{
+	if(slw->queue)
+		return (0 == LLAsyncQueuePush(slw->queue,logLevel,buf,len)) ? len : -1;
+	return PLSockSend(slw->sock,buf,len);
+}
+
+/* helper function to send the summary of the repeated records when a repeat is suppressed. */
+static int sSendDueRepeatSummary(SockLogWriter* slw)
+{
+	if(LLRepeatFilterDue(&slw->repeats))
+		sSendRepeatSummary(slw);
 	return 0;
 }
 
+/* helper function to send the summary of the repeated records suppressed so far. */
+static void sSendRepeatSummary(SockLogWriter* slw)
+{
+	char summary[512];
+	char curDateTime[32];
+	LogLevel level;
+	unsigned long long spanNs;
+	unsigned long repeats = LLRepeatFilterTakeSummary(&slw->repeats,&level,&spanNs);
+	int bytes;
+	if(!repeats)
+		return;
+	memset(curDateTime, 0, sizeof(curDateTime));
+	LLGetCurDateTime(curDateTime, sizeof(curDateTime));
+	if(OutputFormatJson == slw->outputFormat)
+	{
+		LLOutBuf out;
+		char msg[64];
+		int msgLen = snprintf(msg,sizeof(msg),"last message repeated %lu times",repeats);
+		LLOutInit(&out,summary,sizeof(summary) - 1);
+		LLJsonAppendRecordStart(&out,curDateTime);
+		LLJsonAppendRecordInfo(&out,level,slw->base.moduleName,NULL,NULL,0);
+		LLJsonAppendKey(&out,"msg");
+		LLJsonAppendString(&out,msg,msgLen);
+		LLJsonAppendKey(&out,"repeats");
+		LLJsonAppendUInt(&out,repeats);
+		LLJsonAppendKey(&out,"span_s");
+		LLJsonAppendDouble(&out,spanNs / 1e9);
+		LLJsonAppendRecordEnd(&out);
+		summary[out.len] = '\n';
+		bytes = out.len + 1;
+	}
+	else if(slw->layout.ops)
+	{
+		char msg[96];
+		int msgLen = snprintf(msg,sizeof(msg),"last message repeated %lu times over %.3f s",repeats,spanNs / 1e9);
+		bytes = sFormatLayoutRecord(slw,summary,sizeof(summary),level,NULL,0,msg,msgLen);
+	}
+	else
+	{
+		bytes = snprintf(summary,sizeof(summary),"\n[%s] %s %s - last message repeated %lu times over %.3f s",
+				curDateTime,sGetLogPrefix(level),slw->base.moduleName,repeats,spanNs / 1e9);
+		if((-1 == bytes) || (bytes > (int)sizeof(summary) - 1))
+			bytes = sizeof(summary) - 1;
+	}
+	sEmitRecord(slw,level,summary,bytes);
+}
+
+/* helper function to format the head of a text record. */
+static int sFormatHead(SockLogWriter* slw,char* buf,const LogLevel logLevel,const char* moduleName,
+		const char* file,const char* funcName,const int lineNum,int* bodyOffset)
+{
+	char curDateTime[32];
+	int len;
+	/* the context of a layout is placed by %X. */
+	if(slw->layout.ops)
+	{
+		buf[0] = '\n';
+		len = 1 + LLLayoutFormatHead(&slw->layout,buf + 1,BUF_MAX - 2,logLevel,moduleName,
+				file,funcName,lineNum,bodyOffset);
+		(*bodyOffset)++;
+		return len;
+	}
+	memset(curDateTime, 0, sizeof(curDateTime));
+	LLGetCurDateTime(curDateTime, sizeof(curDateTime));
+	if(file)
+		len = LLPrefixFormat(&slw->prefixes,buf,BUF_MAX-1,"\n",curDateTime,logLevel,
+				sGetLogPrefix(logLevel),moduleName,file,funcName,lineNum);
+	else
+	{
+		len = snprintf(buf,BUF_MAX-1,"\n[%s] %s - ", curDateTime, sGetLogPrefix(logLevel));
+		if((len < 0) || (len > BUF_MAX - 2))
+			len = BUF_MAX - 2;
+	}
+	*bodyOffset = len;
+	if(slw->includeContext)
+		len += LLCopyContext(buf + len,BUF_MAX - 1 - len,OutputFormatText);
+	return len;
+}
+
+/* helper function to format the tail of the layout. */
+static int sFormatTail(SockLogWriter* slw,char* tail,const LogLevel logLevel,const char* moduleName,
+		const char* file,const char* funcName,const int lineNum)
+{
+	if(!slw->layout.ops)
+		return 0;
+	return LLLayoutFormatTail(&slw->layout,tail,logLevel,moduleName,file,funcName,lineNum);
+}
+
+/* helper function to format a record without call site with the layout. */
+static int sFormatLayoutRecord(SockLogWriter* slw,char* out,int size,const LogLevel logLevel,
+		const char* funcName,const int lineNum,const char* msg,int msgLen)
+{
+	char tail[LL_LAYOUT_TAIL_MAX];
+	int bodyOffset;
+	int tailLen = sFormatTail(slw,tail,logLevel,slw->base.moduleName,NULL,funcName,lineNum);
+	int len;
+	out[0] = '\n';
+	len = 1 + LLLayoutFormatHead(&slw->layout,out + 1,size - 1 - tailLen,logLevel,slw->base.moduleName,
+			NULL,funcName,lineNum,&bodyOffset);
+	if(msgLen > size - tailLen - len)
+		msgLen = size - tailLen - len;
+	memcpy(out + len,msg,msgLen);
+	memcpy(out + len + msgLen,tail,tailLen);
+	return len + msgLen + tailLen;
+}
+
+/* Sink function used by the background writer thread, send() is async-signal-safe. */
+static int sSinkSend(void* ctx,const char* data,int len)
+{
+	return PLSockSend(((SockLogWriter*)ctx)->sock,data,len);
+}
+
+/* helper function to start the background writer thread, if asynchronous logging is enabled. */
+static void sStartAsyncWriter(const tAsyncLogParams* asyncParams)
+{
+	LLSink sink;
+	if(!asyncParams->queueSize)
+		return;
+	memset(&sink,0,sizeof(sink));
+	sink.write = sSinkSend;
+	sink.crashWrite = sSinkSend;
+	sink.ctx = &sSockLogWriter;
+	sink.outputFormat = sSockLogWriter.outputFormat;
+	sSockLogWriter.queue = LLCreateAsyncQueue(asyncParams,&sink);
+	if(!sSockLogWriter.queue)
+		fprintf(stderr,"[liblogger] could not start asynchronous logging, logging synchronously\n");
+}
+
 /* helper function to get the log prefix */
 static const char* sGetLogPrefix(const LogLevel logLevel)
 {
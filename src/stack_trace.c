@@ -0,0 +1,328 @@
+/*
+       Licensed to the Apache Software Foundation (ASF) under one
+       or more contributor license agreements.  See the NOTICE file
+       distributed with this work for additional information
+       regarding copyright ownership.  The ASF licenses this file
+       to you under the Apache License, Version 2.0 (the
+       "License"); you may not use this file except in compliance
+       with the License.  You may obtain a copy of the License at
+
+         http://www.apache.org/licenses/LICENSE-2.0
+
+       Unless required by applicable law or agreed to in writing,
+       software distributed under the License is distributed on an
+       "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+       KIND, either express or implied.  See the License for the
+       specific language governing permissions and limitations
+       under the License.
+ */
+/**
+ * \file Implementation of the capture of the call stack, see stack_trace.h.
+ * glibc / Apple unwind with backtrace(), Windows with CaptureStackBackTrace(), the other
+ * platforms capture nothing. Only the return addresses are captured, no symbol is looked
+ * up : the records name the module and the offset of each frame.
+ * */
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+	/* dl_iterate_phdr(). */
+	#define _GNU_SOURCE
+#endif
+#include "stack_trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(WIN32) || defined(_WIN32)
+	#include <windows.h>
+	#define snprintf _snprintf
+#elif defined(__GLIBC__) || defined(__APPLE__)
+	#include <execinfo.h>
+	#define HAVE_BACKTRACE
+	#if defined(__APPLE__)
+		#include <dlfcn.h>
+	#else
+		#include <link.h>
+		#include <unistd.h>
+		#define HAVE_DL_ITERATE_PHDR
+	#endif
+#endif
+
+#ifdef HAVE_DL_ITERATE_PHDR
+/** An executable segment of a loaded module. */
+typedef struct LLStackModule
+{
+	unsigned long	start;
+	unsigned long	end;
+	/** The load bias of the module, the address - the bias is the address in the module. */
+	unsigned long	bias;
+	/** The path of the module, shared by the segments of the module. */
+	const char*		path;
+} LLStackModule;
+
+/** The cached module map, sorted by address. */
+static LLStackModule*	sModules = NULL;
+static int				sNumModules = 0;
+static int				sMaxModules = 0;
+/** The paths of the modules, allocated in a single block. */
+static char*			sPaths = NULL;
+static int				sPathsLen = 0;
+static int				sPathsSize = 0;
+/** The number of modules loaded / unloaded by the dynamic linker when the map was built. */
+static unsigned long long	sDlGeneration = 0;
+/** The path of the executable, the dynamic linker does not name it. */
+static char				sExePath[1024];
+#endif // HAVE_DL_ITERATE_PHDR
+
+/* Prepares the capture. */
+void LLStackInit(void)
+{
+#ifdef HAVE_BACKTRACE
+	/* glibc loads the unwinder on the first call. */
+	void* frames[2];
+	backtrace(frames, 2);
+#endif
+#ifdef HAVE_DL_ITERATE_PHDR
+	if(!sExePath[0])
+	{
+		ssize_t len = readlink("/proc/self/exe", sExePath, sizeof(sExePath) - 1);
+		sExePath[(len > 0) ? len : 0] = 0;
+	}
+#endif
+}
+
+/* Frees the cached module map. */
+void LLStackDeInit(void)
+{
+#ifdef HAVE_DL_ITERATE_PHDR
+	free(sModules);
+	free(sPaths);
+	sModules = NULL;
+	sPaths = NULL;
+	sNumModules = sMaxModules = 0;
+	sPathsLen = sPathsSize = 0;
+	sDlGeneration = 0;
+#endif
+}
+
+/* Captures the return addresses of the calling thread. */
+int LLStackCapture(void** frames, int maxFrames, int skip)
+{
+	if(maxFrames > LL_STACK_MAX_FRAMES)
+		maxFrames = LL_STACK_MAX_FRAMES;
+#if defined(WIN32) || defined(_WIN32)
+	/* this function is skipped too. */
+	return (int)CaptureStackBackTrace((DWORD)(skip + 1), (DWORD)maxFrames, frames, NULL);
+#elif defined(HAVE_BACKTRACE)
+	{
+		void* all[LL_STACK_MAX_FRAMES + 8];
+		int num;
+		if(skip > 7)
+			skip = 7;
+		/* the first frame is this function. */
+		num = backtrace(all, maxFrames + skip + 1) - (skip + 1);
+		if(num <= 0)
+			return 0;
+		memcpy(frames, all + skip + 1, num * sizeof(void*));
+		return num;
+	}
+#else
+	(void)frames;
+	(void)skip;
+	return 0;
+#endif
+}
+
+#ifdef HAVE_DL_ITERATE_PHDR
+/* helper function to get the load / unload count of the dynamic linker. */
+static int sGenerationCallback(struct dl_phdr_info* info, size_t size, void* data)
+{
+	(void)size;
+	*(unsigned long long*)data = info->dlpi_adds + info->dlpi_subs;
+	/* the counts are the same for all the modules. */
+	return 1;
+}
+
+/* helper function to add the executable segments of a module to the map. */
+static int sModuleCallback(struct dl_phdr_info* info, size_t size, void* data)
+{
+	const char* path = (info->dlpi_name && info->dlpi_name[0]) ? info->dlpi_name : sExePath;
+	int pathOffset = -1;
+	int i;
+	(void)size;
+	(void)data;
+	for(i = 0; i < info->dlpi_phnum; i++)
+	{
+		const ElfW(Phdr)* ph = &info->dlpi_phdr[i];
+		if((ph->p_type != PT_LOAD) || !(ph->p_flags & PF_X))
+			continue;
+		if(pathOffset < 0)
+		{
+			int len = (int)strlen(path) + 1;
+			if(sPathsLen + len > sPathsSize)
+			{
+				int newSize = (sPathsSize + len) * 2;
+				char* paths = (char*)realloc(sPaths, newSize);
+				if(!paths)
+					return 1;
+				sPaths = paths;
+				sPathsSize = newSize;
+			}
+			memcpy(sPaths + sPathsLen, path, len);
+			pathOffset = sPathsLen;
+			sPathsLen += len;
+		}
+		if(sNumModules == sMaxModules)
+		{
+			int newMax = sMaxModules ? sMaxModules * 2 : 32;
+			LLStackModule* modules = (LLStackModule*)realloc(sModules, newMax * sizeof(LLStackModule));
+			if(!modules)
+				return 1;
+			sModules = modules;
+			sMaxModules = newMax;
+		}
+		sModules[sNumModules].start = (unsigned long)(info->dlpi_addr + ph->p_vaddr);
+		sModules[sNumModules].end = sModules[sNumModules].start + (unsigned long)ph->p_memsz;
+		sModules[sNumModules].bias = (unsigned long)info->dlpi_addr;
+		/* the paths are resolved once the block stops moving. */
+		sModules[sNumModules].path = (const char*)(size_t)pathOffset;
+		sNumModules++;
+	}
+	return 0;
+}
+
+/* helper function to order the segments by address. */
+static int sCompareModules(const void* a, const void* b)
+{
+	const LLStackModule* ma = (const LLStackModule*)a;
+	const LLStackModule* mb = (const LLStackModule*)b;
+	return (ma->start < mb->start) ? -1 : ((ma->start > mb->start) ? 1 : 0);
+}
+
+/* helper function to rebuild the module map if modules were loaded / unloaded since. */
+static void sRefreshModules(void)
+{
+	unsigned long long generation = 0;
+	int i;
+	dl_iterate_phdr(sGenerationCallback, &generation);
+	if(sModules && (generation == sDlGeneration))
+		return;
+	sNumModules = 0;
+	sPathsLen = 0;
+	dl_iterate_phdr(sModuleCallback, NULL);
+	for(i = 0; i < sNumModules; i++)
+		sModules[i].path = sPaths + (size_t)sModules[i].path;
+	if(sNumModules)
+		qsort(sModules, sNumModules, sizeof(LLStackModule), sCompareModules);
+	sDlGeneration = generation;
+}
+
+/* helper function to find the segment of an address. */
+static const LLStackModule* sFindModule(unsigned long addr)
+{
+	int lo = 0, hi = sNumModules - 1;
+	while(lo <= hi)
+	{
+		int mid = (lo + hi) / 2;
+		if(addr < sModules[mid].start)
+			hi = mid - 1;
+		else if(addr >= sModules[mid].end)
+			lo = mid + 1;
+		else
+			return &sModules[mid];
+	}
+	return NULL;
+}
+#endif // HAVE_DL_ITERATE_PHDR
+
+/* helper function to append a string, doubling the '%' if needed. */
+static int sAppend(char* buf, int pos, int size, const char* s, int escape)
+{
+	for(; *s && (pos < size - 1); s++)
+	{
+		if(escape && (*s == '%'))
+		{
+			if(pos >= size - 2)
+				break;
+			buf[pos++] = '%';
+		}
+		buf[pos++] = *s;
+	}
+	buf[pos] = 0;
+	return pos;
+}
+
+/* Renders the frames as " [stack: module+0xoffset ...]". */
+int LLStackFormat(char* buf, int size, void* const* frames, int numFrames, int escape)
+{
+	static const char closing[] = "]";
+	int pos;
+	int i;
+	if(size < (int)sizeof(" [stack: ]"))
+	{
+		if(size > 0)
+			buf[0] = 0;
+		return 0;
+	}
+	/* room is kept for the closing bracket. */
+	size -= sizeof(closing) - 1;
+	pos = sAppend(buf, 0, size, " [stack:", 0);
+#ifdef HAVE_DL_ITERATE_PHDR
+	if(!sModules)
+		sRefreshModules();
+#endif
+	for(i = 0; i < numFrames; i++)
+	{
+		unsigned long long addr = (unsigned long long)(size_t)frames[i];
+		const char* path = NULL;
+		unsigned long long offset = addr;
+		char num[32];
+		int start = pos;
+#if defined(HAVE_DL_ITERATE_PHDR)
+		const LLStackModule* m = sFindModule((unsigned long)addr);
+		if(!m)
+		{
+			/* a module loaded since the map was built. */
+			sRefreshModules();
+			m = sFindModule((unsigned long)addr);
+		}
+		if(m)
+		{
+			path = m->path;
+			offset = addr - m->bias;
+		}
+#elif defined(__APPLE__)
+		Dl_info info;
+		if(dladdr(frames[i], &info) && info.dli_fname)
+		{
+			path = info.dli_fname;
+			offset = addr - (unsigned long long)(size_t)info.dli_fbase;
+		}
+#elif defined(WIN32) || defined(_WIN32)
+		HMODULE module;
+		char modulePath[MAX_PATH];
+		if( GetModuleHandleExA(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT,
+					(LPCSTR)frames[i], &module)
+				&& GetModuleFileNameA(module, modulePath, sizeof(modulePath)) )
+		{
+			path = modulePath;
+			offset = addr - (unsigned long long)(size_t)module;
+		}
+#endif
+		pos = sAppend(buf, pos, size, " ", 0);
+		if(path)
+		{
+			pos = sAppend(buf, pos, size, path, escape);
+			snprintf(num, sizeof(num), "+0x%llx", offset);
+		}
+		else
+			snprintf(num, sizeof(num), "0x%llx", addr);
+		pos = sAppend(buf, pos, size, num, 0);
+		if(pos >= size - 1)
+		{
+			/* the frame is dropped if it does not fit. */
+			pos = start;
+			break;
+		}
+	}
+	buf[pos] = 0;
+	return sAppend(buf, pos, size + sizeof(closing) - 1, closing, 0);
+}
@@ -0,0 +1,59 @@
+/*
+       Licensed to the Apache Software Foundation (ASF) under one
+       or more contributor license agreements.  See the NOTICE file
+       distributed with this work for additional information
+       regarding copyright ownership.  The ASF licenses this file
+       to you under the Apache License, Version 2.0 (the
+       "License"); you may not use this file except in compliance
+       with the License.  You may obtain a copy of the License at
+
+         http://www.apache.org/licenses/LICENSE-2.0
+
+       Unless required by applicable law or agreed to in writing,
+       software distributed under the License is distributed on an
+       "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+       KIND, either express or implied.  See the License for the
+       specific language governing permissions and limitations
+       under the License.
+ */
+/**
+ * \file Capture of the call stack of the records, see \ref InitStackTrace.
+ * The frames are captured as raw return addresses and rendered as module+offset, with a
+ * cached map of the loaded modules, they are symbolised offline (tools/llstack).
+ * */
+#ifndef __STACK_TRACE_H__
+#define __STACK_TRACE_H__
+
+/** The maximum number of frames captured. */
+#define LL_STACK_MAX_FRAMES	64
+
+/** Prepares the capture, the first unwinding may load libraries and allocate memory,
+ * it is done here rather than on the first record.
+ * */
+void LLStackInit(void);
+
+/** Frees the cached module map. */
+void LLStackDeInit(void);
+
+/** Captures the return addresses of the calling thread.
+ * \param [out] frames		The return addresses, the innermost first.
+ * \param [in]  maxFrames	The size of \a frames, at most \ref LL_STACK_MAX_FRAMES.
+ * \param [in]  skip		The number of frames to skip, above the caller of this function.
+ * \returns the number of frames captured.
+ * */
+int LLStackCapture(void** frames, int maxFrames, int skip);
+
+/** Renders the frames as " [stack: module+0xoffset ...]". For ELF modules the offset
+ * is the address in the module (what addr2line expects), elsewhere the offset from the
+ * start of the module. The frames outside any module are rendered as raw addresses.
+ * The module map is not thread safe, the mutex of the logger must be locked.
+ * \param [out] buf			The buffer where the frames are rendered, null terminated.
+ * \param [in]  size		The size of \a buf, the last frames are dropped if it is too small.
+ * \param [in]  frames		The return addresses.
+ * \param [in]  numFrames	The number of frames.
+ * \param [in]  escape		Non zero to double the '%', to append the rendering to a format.
+ * \returns the length of the rendering.
+ * */
+int LLStackFormat(char* buf, int size, void* const* frames, int numFrames, int escape);
+
+#endif // __STACK_TRACE_H__
@@ -0,0 +1,540 @@
+/*
+       Licensed to the Apache Software Foundation (ASF) under one
+       or more contributor license agreements.  See the NOTICE file
+       distributed with this work for additional information
+       regarding copyright ownership.  The ASF licenses this file
+       to you under the Apache License, Version 2.0 (the
+       "License"); you may not use this file except in compliance
+       with the License.  You may obtain a copy of the License at
+
+         http://www.apache.org/licenses/LICENSE-2.0
+
+       Unless required by applicable law or agreed to in writing,
+       software distributed under the License is distributed on an
+       "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+       KIND, either express or implied.  See the License for the
+       specific language governing permissions and limitations
+       under the License.
+ */
+/**
+ * \file Implementation of the function trace capture, see \ref GRP_FUNC_TRACE.
+ * Each thread owns a buffer of events, the hot path stores an event in it without
+ * any lock. The capture mutex is only taken to append a full buffer to the capture
+ * file, and the first time a thread sees a function.
+ * A buffer is only freed by its thread : when the capture stops, the buffers are retired
+ * by the generation, and each thread frees its own when it sees the new generation or
+ * when it exits. The capture mutex is never destroyed, so that a thread still storing an
+ * event of the stopped capture can check the generation under it.
+ * */
+#include <liblogger/liblogger.h>
+#include "trace_buffer.h"
+#include "LLTimeUtil.h"
+#include "tPLTsc.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(WIN32) || defined(_WIN32)
+	#include <process.h>
+	#define getpid	_getpid
+#else
+	#include <unistd.h>
+#endif
+
+#ifndef DISABLE_THREAD_SAFETY
+	#include "tPLMutex.h"
+	#include "tPLThread.h"
+	#define LL_THREAD_LOCAL	PL_THREAD_LOCAL
+	#define __LOCK_TRACE	PLLockMutex(sTrace.mutex)
+	#define __UNLOCK_TRACE	PLUnLockMutex(sTrace.mutex)
+#else
+	#define LL_THREAD_LOCAL
+	#define __LOCK_TRACE	/* NOP */
+	#define __UNLOCK_TRACE	/* NOP */
+#endif
+
+/** The default size of the buffer of a thread, in events. */
+#define DEFAULT_BUFFER_EVENTS	8192
+/** The size of the function id cache of a thread, a power of 2. */
+#define SITE_CACHE_SIZE			64
+/** The maximum number of address ranges of \ref tFuncTraceParams::moduleFilter. */
+#define MAX_FILTER_RANGES		32
+/** The minimum interval between two calibration points of the TSC, in ns. */
+#define CLOCK_POINT_INTERVAL_NS	100000000ULL
+/** The number of readings of the wall clock per calibration point. */
+#define CALIBRATION_TRIES		5
+
+/** The buffer of a thread. */
+typedef struct LLTraceBuffer
+{
+	/** The next buffer of the capture. */
+	struct LLTraceBuffer*	next;
+	unsigned int	tid;
+	/** The capture of the buffer, it is retired once the generation changes. */
+	unsigned int	generation;
+	/** The number of events in \ref events, and its capacity. */
+	unsigned int	count;
+	unsigned int	size;
+	/** Direct mapped cache of the function ids, keyed by the address of the name. */
+	const char*		cacheKeys[SITE_CACHE_SIZE];
+	unsigned int	cacheIds[SITE_CACHE_SIZE];
+	LLTraceEvent	events[1];
+} LLTraceBuffer;
+
+/** An entry of the table of function ids. */
+typedef struct LLTraceSite
+{
+	const char*		name;
+	unsigned int	id;
+} LLTraceSite;
+
+/** The state of the capture. */
+static struct
+{
+	/** Non zero while capturing. */
+	volatile int	enabled;
+	/** Incremented on each capture, to detect the buffers of a previous capture. */
+	volatile unsigned int	generation;
+	FILE*			fp;
+	unsigned int	bufferEvents;
+	/** The buffers of all the threads, the retired ones until their thread frees them. */
+	LLTraceBuffer*	buffers;
+	/** Open addressing table of the function ids, keyed by the address of the name. */
+	LLTraceSite*	sites;
+	unsigned int	sitesSize;
+	unsigned int	numSites;
+	/** The address ranges of the functions captured by \ref LLTraceAddr, none captures all. */
+	unsigned long long	filterStart[MAX_FILTER_RANGES];
+	unsigned long long	filterEnd[MAX_FILTER_RANGES];
+	int				numFilterRanges;
+	/** Set if a module filter is given, nothing is captured if it matches no module. */
+	int				filterEnabled;
+	/** Non zero if the events are timestamped with the TSC. */
+	int				tsc;
+	/** The wall clock time of the last calibration point, in ns. */
+	unsigned long long	lastClockNs;
+#ifndef DISABLE_THREAD_SAFETY
+	/** Created by the first capture, and kept for the life of the process. */
+	tPLMutex		mutex;
+	/** The key of the thread buffers, to free them when their thread exits. */
+	tPLThreadKey	key;
+#endif
+} sTrace;
+
+/** The buffer of the calling thread, valid if its generation is the current generation. */
+static LL_THREAD_LOCAL LLTraceBuffer* sThreadBuffer = 0;
+
+#ifndef DISABLE_THREAD_SAFETY
+/* helper function to free the buffer of an exiting thread, its events are written first
+ * if the capture is still going on. */
+static void sReleaseThreadBuffer(void* value);
+#endif
+
+/* helper function to append a record, the capture mutex must be locked. */
+static void sWriteRecord(unsigned int type, const void* payload1, unsigned int size1,
+		const void* payload2, unsigned int size2)
+{
+	LLTraceRecordHeader hdr;
+	if(!sTrace.fp)
+		return;
+	hdr.type = type;
+	hdr.size = size1 + size2;
+	fwrite(&hdr, sizeof(hdr), 1, sTrace.fp);
+	if(size1)
+		fwrite(payload1, 1, size1, sTrace.fp);
+	if(size2)
+		fwrite(payload2, 1, size2, sTrace.fp);
+}
+
+/* helper function to pair a reading of the TSC with the wall clock. The reading of the
+ * wall clock is bracketed by two readings of the TSC, the tightest of a few tries is kept. */
+static void sCalibrate(LLTraceClockPoint* p)
+{
+	unsigned long long best = ~0ULL;
+	int i;
+	for(i = 0; i < CALIBRATION_TRIES; i++)
+	{
+		unsigned long long t0 = PLReadTsc();
+		unsigned long long ns = LLGetWallClockNs();
+		unsigned long long t1 = PLReadTsc();
+		if(t1 - t0 < best)
+		{
+			best = t1 - t0;
+			p->tsc = t0 + (t1 - t0) / 2;
+			p->wallNs = ns;
+		}
+	}
+}
+
+/* helper function to write a calibration point of the TSC, at most every
+ * CLOCK_POINT_INTERVAL_NS unless force is set. The capture mutex must be locked. */
+static void sWriteClockPoint(int force)
+{
+	LLTraceClockPoint p;
+	sCalibrate(&p);
+	if(!force && (p.wallNs - sTrace.lastClockNs < CLOCK_POINT_INTERVAL_NS))
+		return;
+	sTrace.lastClockNs = p.wallNs;
+	sWriteRecord(LL_TRACE_REC_CLOCK, &p, sizeof(p), NULL, 0);
+}
+
+/* helper function to write the events of a buffer, the capture mutex must be locked. */
+static void sFlushBuffer(LLTraceBuffer* b)
+{
+	if(b->count)
+		sWriteRecord(LL_TRACE_REC_EVENTS, b->events, b->count * sizeof(LLTraceEvent), NULL, 0);
+	b->count = 0;
+	if(sTrace.tsc)
+		sWriteClockPoint(0);
+}
+
+/* helper function to hash the address of a function name. */
+static unsigned int sHashPtr(const char* p)
+{
+	unsigned long long v = (unsigned long long)(size_t)p;
+	v ^= v >> 17;
+	v *= 0x9E3779B97F4A7C15ULL;
+	return (unsigned int)(v >> 32);
+}
+
+/* helper function to get the id of a function, assigned on first use,
+ * the capture mutex must be locked. */
+static unsigned int sLookupSite(const char* name)
+{
+	unsigned int i;
+	if((sTrace.numSites + 1) * 2 > sTrace.sitesSize)
+	{
+		/* grow the table. */
+		unsigned int newSize = sTrace.sitesSize ? sTrace.sitesSize * 2 : 256;
+		LLTraceSite* newSites = (LLTraceSite*)calloc(newSize, sizeof(LLTraceSite));
+		if(!newSites)
+			return 0;
+		for(i = 0; i < sTrace.sitesSize; i++)
+		{
+			if(sTrace.sites[i].name)
+			{
+				unsigned int j = sHashPtr(sTrace.sites[i].name) & (newSize - 1);
+				while(newSites[j].name)
+					j = (j + 1) & (newSize - 1);
+				newSites[j] = sTrace.sites[i];
+			}
+		}
+		free(sTrace.sites);
+		sTrace.sites = newSites;
+		sTrace.sitesSize = newSize;
+	}
+	i = sHashPtr(name) & (sTrace.sitesSize - 1);
+	while(sTrace.sites[i].name)
+	{
+		if(sTrace.sites[i].name == name)
+			return sTrace.sites[i].id;
+		i = (i + 1) & (sTrace.sitesSize - 1);
+	}
+	sTrace.sites[i].name = name;
+	sTrace.sites[i].id = ++sTrace.numSites;
+	sWriteRecord(LL_TRACE_REC_SITE, &sTrace.sites[i].id, sizeof(unsigned int), name, (unsigned int)strlen(name));
+	return sTrace.sites[i].id;
+}
+
+/* helper function to remove a buffer from the list of the capture, the capture mutex must be locked. */
+static void sUnlinkBuffer(LLTraceBuffer* b)
+{
+	LLTraceBuffer** prev;
+	for(prev = &sTrace.buffers; *prev && (*prev != b); prev = &(*prev)->next)
+		;
+	if(*prev)
+		*prev = b->next;
+}
+
+/* helper function to create the buffer of the calling thread, the retired buffer
+ * of the thread (NULL if none) is freed. */
+static LLTraceBuffer* sCreateThreadBuffer(LLTraceBuffer* retired)
+{
+	LLTraceBuffer* b = NULL;
+	unsigned int tid = 0;
+	char name[64];
+	name[0] = 0;
+#ifndef DISABLE_THREAD_SAFETY
+	tid = (unsigned int)PLGetThreadId();
+	if(PLGetThreadName(name, sizeof(name)) != 0)
+		name[0] = 0;
+#endif
+	__LOCK_TRACE;
+	if(retired)
+		sUnlinkBuffer(retired);
+	if(sTrace.enabled)
+		b = (LLTraceBuffer*)calloc(1, sizeof(LLTraceBuffer) + (sTrace.bufferEvents - 1) * sizeof(LLTraceEvent));
+	if(b)
+	{
+		b->tid = tid;
+		b->generation = sTrace.generation;
+		b->size = sTrace.bufferEvents;
+		b->next = sTrace.buffers;
+		sTrace.buffers = b;
+		if(name[0])
+			sWriteRecord(LL_TRACE_REC_THREAD, &b->tid, sizeof(unsigned int), name, (unsigned int)strlen(name));
+	}
+	sThreadBuffer = b;
+#ifndef DISABLE_THREAD_SAFETY
+	if(sTrace.key)
+		PLSetThreadKey(sTrace.key, b);
+#endif
+	__UNLOCK_TRACE;
+	free(retired);
+	return b;
+}
+
+#ifndef DISABLE_THREAD_SAFETY
+/* helper function to free the buffer of an exiting thread. */
+static void sReleaseThreadBuffer(void* value)
+{
+	LLTraceBuffer* b = (LLTraceBuffer*)value;
+	__LOCK_TRACE;
+	if(sTrace.enabled && (b->generation == sTrace.generation))
+		sFlushBuffer(b);
+	sUnlinkBuffer(b);
+	__UNLOCK_TRACE;
+	sThreadBuffer = 0;
+	free(b);
+}
+#endif
+
+/* Returns non zero if the function entry / exit events are captured. */
+int LLTraceEnabled(void)
+{
+	return sTrace.enabled;
+}
+
+/* helper function to store an event in the buffer of the calling thread. */
+static void sAppendEvent(LLTraceBuffer* b, int kind, unsigned int site, unsigned int line)
+{
+	LLTraceEvent* ev = &b->events[b->count];
+	ev->ts = sTrace.tsc ? PLReadTsc() : LLGetMonotonicNs();
+	ev->tid = b->tid;
+	ev->site = site;
+	ev->line = line;
+	ev->kind = (unsigned short)kind;
+	ev->reserved = 0;
+	if(++b->count == b->size)
+	{
+		__LOCK_TRACE;
+		/* the events stored after the capture stopped are dropped. */
+		if(b->generation == sTrace.generation)
+			sFlushBuffer(b);
+		else
+			b->count = 0;
+		__UNLOCK_TRACE;
+	}
+}
+
+/* Captures a function entry / exit event of the calling thread. */
+int LLTraceFunc(int kind, const char* funcName, int line)
+{
+	LLTraceBuffer* b = sThreadBuffer;
+	unsigned int slot;
+	if(!sTrace.enabled || !funcName)
+		return -1;
+	if(!b || (b->generation != sTrace.generation))
+	{
+		b = sCreateThreadBuffer(b);
+		if(!b)
+			return -1;
+	}
+	slot = sHashPtr(funcName) & (SITE_CACHE_SIZE - 1);
+	if(b->cacheKeys[slot] != funcName)
+	{
+		__LOCK_TRACE;
+		/* the table of the function ids is freed when the capture stops. */
+		if(b->generation != sTrace.generation)
+		{
+			__UNLOCK_TRACE;
+			return -1;
+		}
+		b->cacheIds[slot] = sLookupSite(funcName);
+		__UNLOCK_TRACE;
+		b->cacheKeys[slot] = funcName;
+	}
+	sAppendEvent(b, kind, b->cacheIds[slot], (unsigned int)line);
+	return 0;
+}
+
+/* Captures a function entry / exit event by the address of the function. */
+void LLTraceAddr(int kind, const void* func)
+{
+	LLTraceBuffer* b;
+	unsigned long long addr = (unsigned long long)(size_t)func;
+	if(!sTrace.enabled)
+		return;
+	if(sTrace.filterEnabled)
+	{
+		int i;
+		for(i = 0; i < sTrace.numFilterRanges; i++)
+		{
+			if((addr >= sTrace.filterStart[i]) && (addr < sTrace.filterEnd[i]))
+				break;
+		}
+		if(i == sTrace.numFilterRanges)
+			return;
+	}
+	b = sThreadBuffer;
+	if(!b || (b->generation != sTrace.generation))
+	{
+		b = sCreateThreadBuffer(b);
+		if(!b)
+			return;
+	}
+	sAppendEvent(b, kind, (unsigned int)(addr & 0xffffffffULL), (unsigned int)(addr >> 32));
+}
+
+#if defined(__linux__)
+/* helper function to read /proc/self/maps, the result must be freed. */
+static char* sReadMaps(unsigned int* size)
+{
+	char* data = 0;
+	unsigned int len = 0, cap = 0;
+	size_t n;
+	FILE* fp = fopen("/proc/self/maps", "r");
+	if(!fp)
+		return NULL;
+	do
+	{
+		if(len + 4096 > cap)
+		{
+			char* p = (char*)realloc(data, cap + 65536);
+			if(!p)
+				break;
+			data = p;
+			cap += 65536;
+		}
+		n = fread(data + len, 1, cap - len - 1, fp);
+		len += (unsigned int)n;
+	} while(n > 0);
+	fclose(fp);
+	if(data)
+		data[len] = 0;
+	*size = len;
+	return data;
+}
+
+/* helper function to write the memory map to the capture, so that the addresses can be
+ * symbolised offline, and to compute the ranges of the module filter. */
+static void sSnapshotMaps(const char* moduleFilter)
+{
+	unsigned int size = 0;
+	char* maps = sReadMaps(&size);
+	char* line;
+	if(!maps)
+		return;
+	sWriteRecord(LL_TRACE_REC_MAPS, maps, size, NULL, 0);
+	for(line = maps; moduleFilter && *line; )
+	{
+		char* eol = strchr(line, '\n');
+		unsigned long long start, end;
+		char perms[8];
+		if(eol)
+			*eol = 0;
+		if( (sscanf(line, "%llx-%llx %7s", &start, &end, perms) == 3) && strchr(perms, 'x') &&
+				strstr(line, moduleFilter) && (sTrace.numFilterRanges < MAX_FILTER_RANGES) )
+		{
+			sTrace.filterStart[sTrace.numFilterRanges] = start;
+			sTrace.filterEnd[sTrace.numFilterRanges] = end;
+			sTrace.numFilterRanges++;
+		}
+		if(!eol)
+			break;
+		line = eol + 1;
+	}
+	free(maps);
+}
+#else
+static void sSnapshotMaps(const char* moduleFilter)
+{
+	(void)moduleFilter;
+}
+#endif // __linux__
+
+/* Start capturing the function entry / exit events. */
+int InitFuncTrace(const tFuncTraceParams* params)
+{
+	LLTraceFileHeader hdr;
+	if(!params || !params->fileName)
+	{
+		fprintf(stderr, "[liblogger] invalid function trace parameters\n");
+		return -1;
+	}
+	if(sTrace.enabled)
+		DeInitFuncTrace();
+	sTrace.fp = fopen(params->fileName, "wb");
+	if(!sTrace.fp)
+	{
+		fprintf(stderr, "[liblogger] could not open the function trace file %s\n", params->fileName);
+		return -1;
+	}
+#ifndef DISABLE_THREAD_SAFETY
+	if(!sTrace.mutex && PLCreateMutex(&sTrace.mutex))
+	{
+		fclose(sTrace.fp);
+		sTrace.fp = 0;
+		return -1;
+	}
+	if(!sTrace.key && PLCreateThreadKey(&sTrace.key, sReleaseThreadBuffer))
+		fprintf(stderr, "[liblogger] could not create the thread key of the function trace, the buffers of the exited threads are not freed\n");
+#endif
+	memset(&hdr, 0, sizeof(hdr));
+	memcpy(hdr.magic, LL_TRACE_MAGIC, sizeof(hdr.magic));
+	hdr.version = LL_TRACE_VERSION;
+	hdr.pid = (unsigned int)getpid();
+	hdr.startNs = LLGetMonotonicNs();
+	fwrite(&hdr, sizeof(hdr), 1, sTrace.fp);
+
+	sTrace.bufferEvents = params->bufferEvents ? params->bufferEvents : DEFAULT_BUFFER_EVENTS;
+	sTrace.numFilterRanges = 0;
+	sTrace.filterEnabled = (params->moduleFilter != NULL);
+	sTrace.tsc = 0;
+	if(params->tscTimestamps)
+	{
+		if(PLTscInvariant())
+		{
+			sTrace.tsc = 1;
+			sWriteClockPoint(1);
+		}
+		else
+			fprintf(stderr, "[liblogger] the TSC is not usable as a clock, the function trace uses the monotonic clock\n");
+	}
+	sSnapshotMaps(params->moduleFilter);
+	__LOCK_TRACE;
+	sTrace.generation++;
+	sTrace.enabled = 1;
+	__UNLOCK_TRACE;
+	return 0;
+}
+
+/* Stop capturing, the buffers are written to the capture file and retired. */
+void DeInitFuncTrace(void)
+{
+	LLTraceBuffer* b;
+	if(!sTrace.enabled)
+		return;
+	__LOCK_TRACE;
+	sTrace.enabled = 0;
+	/* the threads may be storing events in their buffers, they free them. */
+	for(b = sTrace.buffers; b; b = b->next)
+	{
+		if(b->generation == sTrace.generation)
+			sFlushBuffer(b);
+	}
+	if(sTrace.tsc)
+		sWriteClockPoint(1);
+	sTrace.tsc = 0;
+	free(sTrace.sites);
+	sTrace.sites = 0;
+	sTrace.sitesSize = 0;
+	sTrace.numSites = 0;
+	/* the modules loaded since the start of the capture are added. */
+	sSnapshotMaps(NULL);
+	fclose(sTrace.fp);
+	sTrace.fp = 0;
+	/* the stale thread buffers are detected by the generation. */
+	sTrace.generation++;
+	__UNLOCK_TRACE;
+}
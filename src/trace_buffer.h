@@ -0,0 +1,125 @@
+/*
+       Licensed to the Apache Software Foundation (ASF) under one
+       or more contributor license agreements.  See the NOTICE file
+       distributed with this work for additional information
+       regarding copyright ownership.  The ASF licenses this file
+       to you under the Apache License, Version 2.0 (the
+       "License"); you may not use this file except in compliance
+       with the License.  You may obtain a copy of the License at
+
+         http://www.apache.org/licenses/LICENSE-2.0
+
+       Unless required by applicable law or agreed to in writing,
+       software distributed under the License is distributed on an
+       "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+       KIND, either express or implied.  See the License for the
+       specific language governing permissions and limitations
+       under the License.
+ */
+/**
+ * \file Function trace capture, see \ref GRP_FUNC_TRACE.
+ *
+ * The capture file starts with an \ref LLTraceFileHeader, followed by records made
+ * of an \ref LLTraceRecordHeader and its payload :
+ * - \ref LL_TRACE_REC_SITE : a uint32 function id followed by the function name,
+ *   written before any event refers to the id.
+ * - \ref LL_TRACE_REC_THREAD : a uint32 thread id followed by the thread name.
+ * - \ref LL_TRACE_REC_EVENTS : an array of \ref LLTraceEvent of a single thread,
+ *   in the order they were logged.
+ * - \ref LL_TRACE_REC_MAPS : the text of /proc/self/maps, written at the start and at
+ *   the end of the capture, used to symbolise the function addresses.
+ * - \ref LL_TRACE_REC_CLOCK : an \ref LLTraceClockPoint, if the events are timestamped
+ *   with the TSC. The timestamps are converted to the wall clock time when the capture is
+ *   read, by interpolation between the calibration points.
+ * Everything is in the byte order of the host which captured the trace.
+ * */
+#ifndef __TRACE_BUFFER_H__
+#define __TRACE_BUFFER_H__
+
+/** The magic at the start of a capture file. */
+#define LL_TRACE_MAGIC		"LLTRACE1"
+/** The version of the capture file format. */
+#define LL_TRACE_VERSION	2
+
+/** The record types. */
+#define LL_TRACE_REC_SITE	1
+#define LL_TRACE_REC_THREAD	2
+#define LL_TRACE_REC_EVENTS	3
+#define LL_TRACE_REC_MAPS	4
+#define LL_TRACE_REC_CLOCK	5
+
+/** The event kinds. */
+#define LL_TRACE_BEGIN		1
+#define LL_TRACE_END		2
+/** Entry / exit of an instrumented function (-finstrument-functions), the address of the
+ * function is stored in the event, see \ref LL_TRACE_EVENT_ADDR. */
+#define LL_TRACE_ADDR_BEGIN	3
+#define LL_TRACE_ADDR_END	4
+
+/** The address of the function of an \ref LL_TRACE_ADDR_BEGIN / \ref LL_TRACE_ADDR_END event. */
+#define LL_TRACE_EVENT_ADDR(ev)	(((unsigned long long)(ev)->line << 32) | (ev)->site)
+
+/** The header of a capture file. */
+typedef struct LLTraceFileHeader
+{
+	char			magic[8];
+	unsigned int	version;
+	/** The process id. */
+	unsigned int	pid;
+	/** The monotonic time when the capture started, in ns. */
+	unsigned long long	startNs;
+} LLTraceFileHeader;
+
+/** The header of a record. */
+typedef struct LLTraceRecordHeader
+{
+	unsigned int	type;
+	/** The size of the payload following the header. */
+	unsigned int	size;
+} LLTraceRecordHeader;
+
+/** A calibration point of the TSC, a reading of the TSC paired with the wall clock. */
+typedef struct LLTraceClockPoint
+{
+	unsigned long long	tsc;
+	/** The wall clock time, in ns since the epoch (UTC). */
+	unsigned long long	wallNs;
+} LLTraceClockPoint;
+
+/** A begin / end event, 24 bytes. */
+typedef struct LLTraceEvent
+{
+	/** The monotonic time of the event in ns, the TSC ticks if the capture has
+	 * \ref LL_TRACE_REC_CLOCK records. */
+	unsigned long long	ts;
+	unsigned int	tid;
+	/** The function id, see \ref LL_TRACE_REC_SITE (the low 32 bits of the address
+	 * of the function for the address events). */
+	unsigned int	site;
+	/** The line of the exit, 0 for a begin event (the high 32 bits of the address
+	 * of the function for the address events). */
+	unsigned int	line;
+	/** \ref LL_TRACE_BEGIN, \ref LL_TRACE_END, \ref LL_TRACE_ADDR_BEGIN or \ref LL_TRACE_ADDR_END. */
+	unsigned short	kind;
+	unsigned short	reserved;
+} LLTraceEvent;
+
+/** Returns non zero if the function entry / exit events are captured. */
+int LLTraceEnabled(void);
+
+/** Captures a function entry / exit event of the calling thread.
+ * \param [in] kind		\ref LL_TRACE_BEGIN or \ref LL_TRACE_END.
+ * \param [in] funcName	The function name, its address identifies the function.
+ * \param [in] line		The line of the exit.
+ * \returns 0 on success, -1 on failure.
+ * */
+int LLTraceFunc(int kind, const char* funcName, int line);
+
+/** Captures a function entry / exit event by the address of the function, if the
+ * function passes the module filter.
+ * \param [in] kind	\ref LL_TRACE_ADDR_BEGIN or \ref LL_TRACE_ADDR_END.
+ * \param [in] func	The address of the function.
+ * */
+void LLTraceAddr(int kind, const void* func);
+
+#endif // __TRACE_BUFFER_H__
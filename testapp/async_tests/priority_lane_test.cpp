@@ -0,0 +1,135 @@
+/**
+ * \file
+ * Checks the priority lane of the asynchronous file logger : the log is a fifo which is not
+ * read, so the writer thread stalls and the normal lane fills up, the thread logging the
+ * debug records waits for room. An error record must still be accepted at once, and be
+ * written before the debug records queued behind the stalled batch.
+ * Exits with 0 on success.
+ * */
+#include <liblogger/liblogger.h>
+#include <liblogger/file_logger.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+#define FIFO_NAME		"priority_lane_test.fifo"
+#define NUM_DEBUG		2000
+#define ERROR_MARKER	"priority record accepted"
+
+static volatile int sDebugDone = 0;
+static int sFifo = -1;
+
+/* logs enough debug records to fill the pipe, the batch and the normal lane. */
+static void* sDebugThread(void*)
+{
+	int i;
+	for(i = 0; i < NUM_DEBUG; i++)
+		LogDebug("debug %04d %0200d",i,0);
+	sDebugDone = 1;
+	return NULL;
+}
+
+/* reads the fifo until the writer closes it. */
+static void* sReaderThread(void* arg)
+{
+	std::string* out = (std::string*)arg;
+	char buf[4096];
+	int flags = fcntl(sFifo,F_GETFL);
+	fcntl(sFifo,F_SETFL,flags & ~O_NONBLOCK);
+	for(;;)
+	{
+		ssize_t n = read(sFifo,buf,sizeof(buf));
+		if(n > 0)
+			out->append(buf,n);
+		else if(n == 0)
+			break;
+	}
+	return NULL;
+}
+
+int main()
+{
+	tFileLoggerInitParams fileInitParams;
+	pthread_t debugThread, readerThread;
+	std::string log;
+	size_t errorPos, lastPos;
+	char last[32];
+	int i;
+
+	/* the test fails by timing out if a producer waits with the logger lock. */
+	alarm(30);
+	unlink(FIFO_NAME);
+	if(mkfifo(FIFO_NAME,0600))
+	{
+		perror("mkfifo");
+		return 1;
+	}
+	/* the read end is opened first, so that the logger can open the write end. */
+	sFifo = open(FIFO_NAME,O_RDONLY | O_NONBLOCK);
+
+	memset(&fileInitParams,0,sizeof(tFileLoggerInitParams));
+	fileInitParams.logLevel = Trace;
+	fileInitParams.moduleName = "priorityLaneTest";
+	fileInitParams.fileName = (char*)FIFO_NAME;
+	fileInitParams.asyncParams.queueSize = 4096;
+	fileInitParams.asyncParams.policy = BackPressureBlock;
+	if((sFifo < 0) || InitLogger(LogToFile,&fileInitParams))
+	{
+		fprintf(stderr,"could not log to %s\n",FIFO_NAME);
+		return 1;
+	}
+
+	pthread_create(&debugThread,NULL,sDebugThread,NULL);
+	/* wait for the debug thread to block on the full normal lane. */
+	for(i = 0; (i < 50) && !sDebugDone; i++)
+		usleep(20000);
+	if(sDebugDone)
+	{
+		fprintf(stderr,"the debug records did not fill the queue\n");
+		return 1;
+	}
+	if(LogError(ERROR_MARKER) < 0)
+	{
+		fprintf(stderr,"the error record was dropped\n");
+		return 1;
+	}
+	if(sDebugDone)
+	{
+		fprintf(stderr,"the debug thread did not wait for room\n");
+		return 1;
+	}
+
+	pthread_create(&readerThread,NULL,sReaderThread,&log);
+	pthread_join(debugThread,NULL);
+	DeInitLogger();
+	pthread_join(readerThread,NULL);
+	close(sFifo);
+	unlink(FIFO_NAME);
+
+	errorPos = log.find(ERROR_MARKER);
+	snprintf(last,sizeof(last),"debug %04d ",NUM_DEBUG - 1);
+	lastPos = log.find(last);
+	if(errorPos == std::string::npos)
+	{
+		fprintf(stderr,"the error record was not written\n");
+		return 1;
+	}
+	if(lastPos == std::string::npos)
+	{
+		fprintf(stderr,"the debug records were not all written\n");
+		return 1;
+	}
+	if(errorPos > lastPos)
+	{
+		fprintf(stderr,"the error record was written after the queued debug records\n");
+		return 1;
+	}
+	printf("priority lane test passed\n");
+	return 0;
+}
@@ -5,6 +5,7 @@
 #include <liblogger/liblogger.h>
 #include <liblogger/file_logger.h>
 #include <liblogger/socket_logger.h>
+#include <liblogger/log_scope.h>
 #include "logtest.h"
 #include <memory.h>
 
@@ -83,6 +84,25 @@ void TestLogFuncs()
 	LogError("Error level log" );
 	LogFatal("Fatal level log" );
 
+	// rate limited logs, only every 10th record of the loop is emitted.
+	for(int i = 0; i < 100; i++)
+		LogWarnEveryN(10, "Rate limited log %d", i);
+
+	// structured log, the fields are written as key=value pairs, or as JSON members.
+	LogInfoKV("Structured log", LL_INT("count", 42), LL_STR("name", "liblogger"), LL_BOOL("ok", true));
+
+	// mapped diagnostic context, written in the records when includeContext is set.
+	{
+		LogContextScope ctx("request", "42");
+		LogInfo("Log with a context");
+	}
+
+	// scoped tracing, the exit is logged with the elapsed time.
+	{
+		LL_SCOPE("scoped block");
+		LL_SCOPE_SLOW("slow block", 100);
+	}
+
 	
 	TestNoFilename();
 
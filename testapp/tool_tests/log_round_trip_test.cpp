@@ -0,0 +1,413 @@
+/**
+ * \file
+ * Checks that the log tools give back the text log : the same records are logged to a
+ * text log and to a binary, compressed or sharded log, which is converted with the tool
+ * given on the command line. The converted log must have the records of the text log, the
+ * dates aside. The sharded log is also written by many short lived threads at once, the
+ * merged log must have all their records in time order before the logger is deinitialized.
+ * \code
+ * usage : log_round_trip_test binary <lldecode>
+ *         log_round_trip_test compressed <llzcat>
+ *         log_round_trip_test shards <llmerge>
+ * \endcode
+ * Exits with 0 on success.
+ * */
+#include <liblogger/liblogger.h>
+#include <liblogger/file_logger.h>
+#include <liblogger/shard_logger.h>
+#include <pthread.h>
+#include <dirent.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#define TEXT_LOG		"log_round_trip_test.txt"
+#define CONVERTED_LOG	"log_round_trip_test.out"
+#define NUM_STACKS		20
+#define STACK_FORMAT	"record %d with a stack"
+/** The records of the rate limited call site, the last one of a log is emitted so that the
+ * site starts the next log as it started the first. */
+#define NUM_LIMITED		48
+#define LIMITED_FORMAT	"limited record %d"
+#define SHARD_LOG		"log_round_trip_test.shard"
+/** The threads of the ordering check, NUM_CONCURRENT at once, and their records. */
+#define NUM_THREADS		200
+#define NUM_CONCURRENT	8
+#define NUM_THREAD_RECORDS	50
+/** The limit of the open files of the ordering check, the threads must close their shards. */
+#define MAX_FILES		64
+
+/* logs an error from a stack of the given depth, each depth is a distinct stack. */
+static int sLogFromDepth(int depth, int i)
+{
+	if(depth > 0)
+		return sLogFromDepth(depth - 1, i) + 1;
+	LogError(STACK_FORMAT, i);
+	return 0;
+}
+
+/* logs the records of the check, the same in each log. */
+static void sLogRecords()
+{
+	int i;
+	for(i = 0; i < 10; i++)
+	{
+		LogDebug("debug %d %s %.2f", i, "text", i / 4.0);
+		LogInfo("info %05d %x %c", i * 7, i * 255, 'a' + i);
+		LogInfo("a constant message");
+		LogWarn("%s", "a string argument");
+	}
+	for(i = 0; i < NUM_STACKS; i++)
+		sLogFromDepth(i, i);
+	/* the emitted records report different counts of suppressed records. */
+	for(i = 0; i < NUM_LIMITED; i++)
+		LogEveryN(Info, 4 - i % 4, LIMITED_FORMAT, i);
+}
+
+/* logs the records to a log with the given destination and output format. */
+static int sWriteLog(const char* fileName, LogDest dest, tOutputFormat outputFormat,
+		unsigned int compressBlockSize)
+{
+	tFileLoggerInitParams fileInitParams;
+	tShardLoggerInitParams shardInitParams;
+	tStackTraceParams stackParams;
+	memset(&shardInitParams, 0, sizeof(tShardLoggerInitParams));
+	shardInitParams.logLevel = Trace;
+	shardInitParams.moduleName = (char*)"roundTripTest";
+	shardInitParams.fileName = (char*)fileName;
+	memset(&fileInitParams, 0, sizeof(tFileLoggerInitParams));
+	fileInitParams.logLevel = Trace;
+	fileInitParams.moduleName = (char*)"roundTripTest";
+	fileInitParams.fileName = (char*)fileName;
+	fileInitParams.outputFormat = outputFormat;
+	fileInitParams.compressBlockSize = compressBlockSize;
+	if(compressBlockSize)
+	{
+		/* a single lane, so that the errors keep their place in the log. */
+		fileInitParams.asyncParams.queueSize = 64 * 1024;
+		fileInitParams.asyncParams.priorityLevel = Disable;
+	}
+	memset(&stackParams, 0, sizeof(tStackTraceParams));
+	unlink(fileName);
+	if(InitLogger(dest, (LogToShards == dest) ? (void*)&shardInitParams : (void*)&fileInitParams))
+	{
+		fprintf(stderr, "could not log to %s\n", fileName);
+		return -1;
+	}
+	InitStackTrace(&stackParams);
+	sLogRecords();
+	DeInitStackTrace();
+	DeInitLogger();
+	return 0;
+}
+
+/* reads a file. */
+static int sReadFile(const char* fileName, std::string* data)
+{
+	char buf[4096];
+	size_t n;
+	FILE* fp = fopen(fileName, "rb");
+	if(!fp)
+	{
+		fprintf(stderr, "could not open %s\n", fileName);
+		return -1;
+	}
+	while((n = fread(buf, 1, sizeof(buf), fp)) > 0)
+		data->append(buf, n);
+	fclose(fp);
+	return 0;
+}
+
+/* reads the records of a text log, without their dates. The banners of the sessions are
+ * skipped, the shards have none. */
+static int sReadRecords(const char* fileName, std::vector<std::string>* records)
+{
+	std::string data;
+	size_t start = 0;
+	if(sReadFile(fileName, &data))
+		return -1;
+	while(start < data.size())
+	{
+		size_t end = data.find('\n', start);
+		std::string line;
+		if(end == std::string::npos)
+			end = data.size();
+		line = data.substr(start, end - start);
+		start = end + 1;
+		if(line.empty() || !line.compare(0, 5, "-----"))
+			continue;
+		if(('[' == line[0]) && (line.find("] ") != std::string::npos))
+			line = line.substr(line.find("] ") + 2);
+		records->push_back(line);
+	}
+	return 0;
+}
+
+/* counts the occurrences of a string in a file. */
+static int sCount(const char* fileName, const char* s)
+{
+	std::string data;
+	size_t pos = 0;
+	int count = 0;
+	if(sReadFile(fileName, &data))
+		return -1;
+	while((pos = data.find(s, pos)) != std::string::npos)
+	{
+		count++;
+		pos++;
+	}
+	return count;
+}
+
+/* checks that the converted log has the records of the text log. */
+static int sCompare(const char* textLog, const char* convertedLog)
+{
+	std::vector<std::string> expected, records;
+	size_t i;
+	if(sReadRecords(textLog, &expected) || sReadRecords(convertedLog, &records))
+		return -1;
+	for(i = 0; (i < expected.size()) && (i < records.size()); i++)
+	{
+		if(expected[i] != records[i])
+		{
+			fprintf(stderr, "record %d differs :\n  %s\n  %s\n", (int)i,
+					expected[i].c_str(), records[i].c_str());
+			return -1;
+		}
+	}
+	if(expected.size() != records.size())
+	{
+		fprintf(stderr, "%d records instead of %d\n", (int)records.size(), (int)expected.size());
+		return -1;
+	}
+	return 0;
+}
+
+/* runs a tool, the output is written to \ref CONVERTED_LOG. */
+static int sRun(const char* tool, const char* args)
+{
+	std::string cmd = std::string("\"") + tool + "\" " + args + " > " CONVERTED_LOG;
+	if(system(cmd.c_str()))
+	{
+		fprintf(stderr, "%s failed\n", cmd.c_str());
+		return -1;
+	}
+	return 0;
+}
+
+/* logs the records to the text log and to the given log. */
+static int sWriteLogs(const char* fileName, LogDest dest, tOutputFormat outputFormat,
+		unsigned int compressBlockSize)
+{
+	const char* logs[2] = { TEXT_LOG, fileName };
+	LogDest dests[2] = { LogToFile, dest };
+	tOutputFormat formats[2] = { OutputFormatText, outputFormat };
+	unsigned int blockSizes[2] = { 0, compressBlockSize };
+	int i;
+	/* the logs are written from the same call, so that the records have the same stacks. */
+	for(i = 0; i < 2; i++)
+		if(sWriteLog(logs[i], dests[i], formats[i], blockSizes[i]))
+			return -1;
+	return 0;
+}
+
+/* checks lldecode on a binary log. The records with a stack or a count of suppressed records
+ * keep the site of their format. */
+static int sCheckBinary(const char* tool)
+{
+	const char* binLog = "log_round_trip_test.bin";
+	int sites;
+	if(sWriteLogs(binLog, LogToFile, OutputFormatBinary, 0))
+		return -1;
+	sites = sCount(binLog, STACK_FORMAT);
+	if(1 != sites)
+	{
+		fprintf(stderr, "%d call sites for the records with a stack instead of 1\n", sites);
+		return -1;
+	}
+	sites = sCount(binLog, LIMITED_FORMAT);
+	if(1 != sites)
+	{
+		fprintf(stderr, "%d call sites for the rate limited records instead of 1\n", sites);
+		return -1;
+	}
+	if(sRun(tool, binLog) || sCompare(TEXT_LOG, CONVERTED_LOG))
+		return -1;
+	unlink(binLog);
+	return 0;
+}
+
+/* checks llzcat on a compressed log, the blocks are small so that the log has many of them. */
+static int sCheckCompressed(const char* tool)
+{
+	const char* zLog = "log_round_trip_test.z";
+	std::string idx = std::string(zLog) + ".idx";
+	unlink(idx.c_str());
+	if(sWriteLogs(zLog, LogToFile, OutputFormatText, 1024))
+		return -1;
+	if(sRun(tool, zLog) || sCompare(TEXT_LOG, CONVERTED_LOG))
+		return -1;
+	unlink(zLog);
+	unlink(idx.c_str());
+	return 0;
+}
+
+/* gets the shards of the sharded log, or removes them. */
+static void sListShards(std::string* names, int remove)
+{
+	std::string prefix = SHARD_LOG ".";
+	struct dirent* entry;
+	DIR* dir = opendir(".");
+	if(!dir)
+		return;
+	while((entry = readdir(dir)) != NULL)
+	{
+		if(strncmp(entry->d_name, prefix.c_str(), prefix.size()))
+			continue;
+		if(remove)
+			unlink(entry->d_name);
+		else
+			*names += std::string(" ") + entry->d_name;
+	}
+	closedir(dir);
+}
+
+/* logs the records of a thread of the ordering check. */
+static void* sShardThread(void* arg)
+{
+	int thread = (int)(size_t)arg;
+	int i;
+	for(i = 0; i < NUM_THREAD_RECORDS; i++)
+		LogInfo("thread %d record %d", thread, i);
+	return NULL;
+}
+
+/* checks the merged log of the ordering check : the records are in time order, and each
+ * thread has all its records, in order. */
+static int sCheckOrder()
+{
+	std::string data;
+	std::vector<int> next(NUM_THREADS, 0);
+	unsigned long long lastNs = 0;
+	size_t pos = 0;
+	int records = 0;
+	if(sReadFile(CONVERTED_LOG, &data))
+		return -1;
+	while(pos + LL_SHARD_HEAD_LEN <= data.size())
+	{
+		unsigned long long ns = strtoull(data.substr(pos, 19).c_str(), NULL, 10);
+		size_t len = (size_t)strtoul(data.substr(pos + 20, 8).c_str(), NULL, 10);
+		std::string record = data.substr(pos + LL_SHARD_HEAD_LEN, len);
+		size_t at = record.rfind("thread ");
+		int thread, i;
+		if((at == std::string::npos) || (sscanf(record.c_str() + at, "thread %d record %d", &thread, &i) != 2)
+				|| (thread < 0) || (thread >= NUM_THREADS))
+		{
+			fprintf(stderr, "unexpected record %s", record.c_str());
+			return -1;
+		}
+		if(ns < lastNs)
+		{
+			fprintf(stderr, "record out of time order : %s", record.c_str());
+			return -1;
+		}
+		if(i != next[thread])
+		{
+			fprintf(stderr, "record %d of thread %d instead of %d\n", i, thread, next[thread]);
+			return -1;
+		}
+		lastNs = ns;
+		next[thread]++;
+		records++;
+		pos += LL_SHARD_HEAD_LEN + len;
+	}
+	if(records != NUM_THREADS * NUM_THREAD_RECORDS)
+	{
+		fprintf(stderr, "%d records instead of %d\n", records, NUM_THREADS * NUM_THREAD_RECORDS);
+		return -1;
+	}
+	return 0;
+}
+
+/* checks llmerge on a sharded log, and the ordering of the records of many threads. The
+ * shards of the threads which ended are written and closed : the merged log has all their
+ * records before the logger is deinitialized, and the threads do not run out of files. */
+static int sCheckShards(const char* tool)
+{
+	tShardLoggerInitParams shardInitParams;
+	std::string shards;
+	struct rlimit files, limited;
+	pthread_t threads[NUM_CONCURRENT];
+	int i, j, rc;
+
+	sListShards(NULL, 1);
+	if(sWriteLogs(SHARD_LOG, LogToShards, OutputFormatText, 0))
+		return -1;
+	sListShards(&shards, 0);
+	if(sRun(tool, shards.c_str()) || sCompare(TEXT_LOG, CONVERTED_LOG))
+		return -1;
+	sListShards(NULL, 1);
+
+	memset(&shardInitParams, 0, sizeof(tShardLoggerInitParams));
+	shardInitParams.logLevel = Trace;
+	shardInitParams.moduleName = (char*)"roundTripTest";
+	shardInitParams.fileName = (char*)SHARD_LOG;
+	if(InitLogger(LogToShards, &shardInitParams))
+	{
+		fprintf(stderr, "could not log to %s\n", SHARD_LOG);
+		return -1;
+	}
+	getrlimit(RLIMIT_NOFILE, &files);
+	limited = files;
+	if((limited.rlim_cur == RLIM_INFINITY) || (limited.rlim_cur > MAX_FILES))
+		limited.rlim_cur = MAX_FILES;
+	setrlimit(RLIMIT_NOFILE, &limited);
+	for(i = 0; i < NUM_THREADS; i += NUM_CONCURRENT)
+	{
+		for(j = 0; j < NUM_CONCURRENT; j++)
+			pthread_create(&threads[j], NULL, sShardThread, (void*)(size_t)(i + j));
+		for(j = 0; j < NUM_CONCURRENT; j++)
+			pthread_join(threads[j], NULL);
+	}
+	/* the merge reads all the shards at once. */
+	setrlimit(RLIMIT_NOFILE, &files);
+	shards = "-k";
+	sListShards(&shards, 0);
+	rc = sRun(tool, shards.c_str());
+	DeInitLogger();
+	sListShards(NULL, 1);
+	if(rc || sCheckOrder())
+		return -1;
+	return 0;
+}
+
+int main(int argc, char** argv)
+{
+	int rc = -1;
+	if(argc != 3)
+	{
+		fprintf(stderr, "usage : %s binary <lldecode> | compressed <llzcat> | shards <llmerge>\n", argv[0]);
+		return 2;
+	}
+	if(!strcmp(argv[1], "binary"))
+		rc = sCheckBinary(argv[2]);
+	else if(!strcmp(argv[1], "compressed"))
+		rc = sCheckCompressed(argv[2]);
+	else if(!strcmp(argv[1], "shards"))
+		rc = sCheckShards(argv[2]);
+	else
+	{
+		fprintf(stderr, "unknown mode %s\n", argv[1]);
+		return 2;
+	}
+	if(rc)
+		return 1;
+	unlink(TEXT_LOG);
+	unlink(CONVERTED_LOG);
+	printf("%s round trip test passed\n", argv[1]);
+	return 0;
+}
@@ -0,0 +1,123 @@
+/**
+ * \file
+ * Checks the LZ codec of the compressed logs : blocks of incompressible, highly repetitive
+ * and log like data are compressed and decompressed back, and must be given back exactly.
+ * The incompressible blocks must fit in \ref LL_LZ_COMPRESS_BOUND, the repetitive ones must
+ * shrink, and the decompression must reject a destination too small and a truncated block.
+ * Exits with 0 on success.
+ * */
+extern "C"
+{
+#include "lz_codec.h"
+}
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+/** The largest block of the check. */
+#define MAX_BLOCK	(256 * 1024)
+
+static unsigned int sWork[LL_LZ_WORKMEM_SIZE / sizeof(unsigned int)];
+
+/* fills a block with pseudo random bytes, which do not compress. */
+static void sFillRandom(char* buf, int len)
+{
+	unsigned int seed = 0x12345678;
+	int i;
+	for(i = 0; i < len; i++)
+	{
+		seed = seed * 1103515245 + 12345;
+		buf[i] = (char)(seed >> 23);
+	}
+}
+
+/* fills a block with a pattern of the given period. */
+static void sFillPattern(char* buf, int len, int period)
+{
+	int i;
+	for(i = 0; i < len; i++)
+		buf[i] = (char)('a' + (i % period) % 26);
+}
+
+/* fills a block with log records, which differ by their numbers. */
+static void sFillRecords(char* buf, int len)
+{
+	int pos = 0, i = 0;
+	while(pos < len)
+	{
+		char record[128];
+		int n = snprintf(record, sizeof(record),
+				"[2024-01-31 12:34:%02d] [I] app::server.c#%d:handle() - request %d done in %d us\n",
+				i % 60, 100 + i % 7, i, (i * 37) % 1000);
+		if(n > len - pos)
+			n = len - pos;
+		memcpy(buf + pos, record, n);
+		pos += n;
+		i++;
+	}
+}
+
+/* compresses and decompresses a block.
+ * maxRatio is the largest compressed length in % of the block, 0 for the bound only. */
+static int sRoundTrip(const char* name, const char* src, int len, int maxRatio)
+{
+	std::vector<char> comp(LL_LZ_COMPRESS_BOUND(len));
+	std::vector<char> out(len + 1);
+	int compLen = LLLzCompress(src, len, &comp[0], (int)comp.size(), sWork);
+	int outLen;
+	if((compLen <= 0) && (len > 0))
+	{
+		fprintf(stderr, "%s %d bytes : the compressed block does not fit in the bound\n", name, len);
+		return -1;
+	}
+	if(maxRatio && ((long long)compLen * 100 > (long long)len * maxRatio))
+	{
+		fprintf(stderr, "%s %d bytes : compressed to %d bytes\n", name, len, compLen);
+		return -1;
+	}
+	outLen = LLLzDecompress(&comp[0], compLen, &out[0], len);
+	if((outLen != len) || memcmp(&out[0], src, len))
+	{
+		fprintf(stderr, "%s %d bytes : the block is not given back\n", name, len);
+		return -1;
+	}
+	if((len > 0) && (LLLzDecompress(&comp[0], compLen, &out[0], len - 1) >= 0))
+	{
+		fprintf(stderr, "%s %d bytes : the block is decompressed to a smaller destination\n", name, len);
+		return -1;
+	}
+	if((compLen > 1) && (LLLzDecompress(&comp[0], compLen - 1, &out[0], len + 1) == len))
+	{
+		fprintf(stderr, "%s %d bytes : the truncated block is given back\n", name, len);
+		return -1;
+	}
+	return 0;
+}
+
+int main()
+{
+	static const int sizes[] = { 0, 1, 4, 15, 16, 100, 4096, 65535, 65536, 65537, MAX_BLOCK };
+	std::vector<char> buf(MAX_BLOCK);
+	int errors = 0;
+	size_t i;
+
+	for(i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+	{
+		int len = sizes[i];
+		sFillRandom(&buf[0], len);
+		errors += sRoundTrip("random", &buf[0], len, 0);
+		memset(&buf[0], 0, len);
+		errors += sRoundTrip("zeros", &buf[0], len, (len >= 4096) ? 2 : 0);
+		sFillPattern(&buf[0], len, 3);
+		errors += sRoundTrip("period 3", &buf[0], len, (len >= 4096) ? 2 : 0);
+		sFillPattern(&buf[0], len, 1000);
+		errors += sRoundTrip("period 1000", &buf[0], len, (len >= 65536) ? 10 : 0);
+		sFillRecords(&buf[0], len);
+		errors += sRoundTrip("records", &buf[0], len, (len >= 4096) ? 50 : 0);
+	}
+	if(errors)
+		return 1;
+	printf("lz round trip test passed\n");
+	return 0;
+}
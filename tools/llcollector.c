@@ -0,0 +1,146 @@
+/*
+       Licensed to the Apache Software Foundation (ASF) under one
+       or more contributor license agreements.  See the NOTICE file
+       distributed with this work for additional information
+       regarding copyright ownership.  The ASF licenses this file
+       to you under the Apache License, Version 2.0 (the
+       "License"); you may not use this file except in compliance
+       with the License.  You may obtain a copy of the License at
+
+         http://www.apache.org/licenses/LICENSE-2.0
+
+       Unless required by applicable law or agreed to in writing,
+       software distributed under the License is distributed on an
+       "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+       KIND, either express or implied.  See the License for the
+       specific language governing permissions and limitations
+       under the License.
+ */
+/**
+ * \file llcollector : writes the records of a shared memory ring (see \ref LogToSharedMemory)
+ * to a log file.
+ * \code
+ * usage : llcollector [-s ringSize] [-r] <name> [output]
+ * \endcode
+ * The ring is created if the logging processes have not created it yet, the records are
+ * appended to the output, stdout by default, until the collector is interrupted.
+ * The records dropped as the ring was full are reported in the log.
+ * With -r the shared memory is removed when the collector ends, otherwise the records
+ * logged afterwards are read by the next collector.
+ * */
+#include "shm_ring.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+
+/** The collector sleeps at most this long, to notice the signals and the stalled records. */
+#define WAIT_MS	100
+
+static volatile sig_atomic_t sStop = 0;
+
+static void sOnSignal(int signum)
+{
+	sStop = 1;
+}
+
+/* helper function to report the records lost since the last report. */
+static void sReportLost(FILE* out, LLShmRing* ring, unsigned long long* dropped,
+		unsigned long long* lost)
+{
+	unsigned long long d = (unsigned long long)PLAtomicLoad64(&ring->header->dropped);
+	if(d != *dropped)
+	{
+		fprintf(out, "\n----- liblogger dropped %llu records, the ring was full -----\n", d - *dropped);
+		*dropped = d;
+	}
+	if(ring->lost != *lost)
+	{
+		fprintf(out, "\n----- liblogger lost %llu records of the processes which ended -----\n",
+				ring->lost - *lost);
+		*lost = ring->lost;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	LLShmRing ring;
+	FILE* out = stdout;
+	char* buf;
+	unsigned int ringSize = 0;
+	unsigned long long dropped, lost = 0, records = 0;
+	int removeRing = 0;
+	int argi = 1;
+
+	for(; (argi < argc) && ('-' == argv[argi][0]) && argv[argi][1] && !argv[argi][2]; argi++)
+	{
+		if(('s' == argv[argi][1]) && (argi + 1 < argc))
+			ringSize = (unsigned int)strtoul(argv[++argi], 0, 0);
+		else if('r' == argv[argi][1])
+			removeRing = 1;
+		else
+			break;
+	}
+	if((argc - argi < 1) || (argc - argi > 2) || ('-' == argv[argi][0]))
+	{
+		fprintf(stderr, "usage : %s [-s ringSize] [-r] <name> [output]\n", argv[0]);
+		fprintf(stderr, "  -s : the size of the ring in bytes if it is created, 4 MB by default\n");
+		fprintf(stderr, "  -r : remove the shared memory when the collector ends\n");
+		return 2;
+	}
+	if(argc - argi == 2)
+	{
+		out = fopen(argv[argi + 1], "ab");
+		if(!out)
+		{
+			fprintf(stderr, "could not open %s\n", argv[argi + 1]);
+			return 1;
+		}
+	}
+	if(LLShmRingOpen(&ring, argv[argi], ringSize))
+		return 1;
+	buf = (char*)malloc(ring.header->maxRecord);
+	if(!buf)
+	{
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+	signal(SIGINT, sOnSignal);
+	signal(SIGTERM, sOnSignal);
+	/* the records dropped before the collector started are reported. */
+	dropped = 0;
+
+	while(!sStop)
+	{
+		int len = LLShmRingRead(&ring, buf, (int)ring.header->maxRecord);
+		if(len > 0)
+		{
+			fwrite(buf, 1, len, out);
+			records++;
+			continue;
+		}
+		/* idle : the log is flushed before waiting. */
+		sReportLost(out, &ring, &dropped, &lost);
+		fflush(out);
+		LLShmRingWait(&ring, WAIT_MS);
+	}
+	/* the records committed so far. */
+	for(;;)
+	{
+		int len = LLShmRingRead(&ring, buf, (int)ring.header->maxRecord);
+		if(len <= 0)
+			break;
+		fwrite(buf, 1, len, out);
+		records++;
+	}
+	sReportLost(out, &ring, &dropped, &lost);
+
+	fprintf(stderr, "%llu records\n", records);
+	if(out != stdout)
+		fclose(out);
+	free(buf);
+	LLShmRingClose(&ring);
+	if(removeRing)
+		PLShmRemove(argv[argi]);
+	return 0;
+}
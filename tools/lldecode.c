@@ -0,0 +1,663 @@
+/*
+       Licensed to the Apache Software Foundation (ASF) under one
+       or more contributor license agreements.  See the NOTICE file
+       distributed with this work for additional information
+       regarding copyright ownership.  The ASF licenses this file
+       to you under the Apache License, Version 2.0 (the
+       "License"); you may not use this file except in compliance
+       with the License.  You may obtain a copy of the License at
+
+         http://www.apache.org/licenses/LICENSE-2.0
+
+       Unless required by applicable law or agreed to in writing,
+       software distributed under the License is distributed on an
+       "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+       KIND, either express or implied.  See the License for the
+       specific language governing permissions and limitations
+       under the License.
+ */
+/**
+ * \file lldecode : converts a binary log (see \ref OutputFormatBinary) to the text records
+ * written by the file logger.
+ * \code
+ * usage : lldecode [-l level] [-s start] [-e end] <log> [output]
+ * \endcode
+ * The level is a level name or its letter (T, D, I, W, E, F), the records of lower levels
+ * are skipped. The start / end times are "YYYY-MM-DD HH:MM:SS" in the local time of the
+ * logged records, or @<seconds since the epoch>.
+ * */
+#include "binary_log.h"
+#include "json_encoder.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+/** A call site of the log. */
+typedef struct DecSite
+{
+	int			defined;
+	int			kind;
+	int			level;
+	int			line;
+	char*		file;
+	char*		funcName;
+	char*		fmt;
+	int			numConvs;
+	LLBinConv	convs[LL_BIN_MAX_CONVS];
+} DecSite;
+
+/** A session of the log, the sites are indexed by id. */
+typedef struct DecSession
+{
+	char*		moduleName;
+	DecSite*	sites;
+	unsigned int	numSites;
+} DecSession;
+
+static DecSession* sSessions = 0;
+static unsigned int sNumSessions = 0;
+
+/** A time bound of the filter. */
+typedef struct TimeBound
+{
+	int			set;
+	/** Seconds since the epoch, else local seconds since 1970-01-01 00:00:00. */
+	int			epoch;
+	long long	secs;
+} TimeBound;
+
+/** The record being decoded. */
+typedef struct DecReader
+{
+	const char*	p;
+	int			len;
+	int			error;
+} DecReader;
+
+/** The message of a record. */
+#define MSG_BUF_SIZE	65536
+static char sMsg[MSG_BUF_SIZE];
+static int sMsgLen = 0;
+
+static unsigned long long sGetVarint(DecReader* r)
+{
+	unsigned long long v = 0;
+	int n = r->error ? 0 : LLBinGetVarint(r->p, r->len, &v);
+	if(!n)
+	{
+		r->error = 1;
+		return 0;
+	}
+	r->p += n;
+	r->len -= n;
+	return v;
+}
+
+static long long sGetSigned(DecReader* r)
+{
+	unsigned long long v = sGetVarint(r);
+	return (long long)(v >> 1) ^ -(long long)(v & 1);
+}
+
+static int sGetByte(DecReader* r)
+{
+	if(r->error || (r->len < 1))
+	{
+		r->error = 1;
+		return 0;
+	}
+	r->len--;
+	return (unsigned char)*r->p++;
+}
+
+/* helper function to read a string, \returns NULL for a NULL string. */
+static const char* sGetString(DecReader* r, int* len)
+{
+	const char* s;
+	unsigned long long v = sGetVarint(r);
+	*len = 0;
+	if(r->error || !v)
+		return 0;
+	if(v - 1 > (unsigned long long)r->len)
+	{
+		r->error = 1;
+		return 0;
+	}
+	s = r->p;
+	*len = (int)(v - 1);
+	r->p += *len;
+	r->len -= *len;
+	return s;
+}
+
+/* helper function to read a string in an allocated buffer. */
+static char* sDupString(DecReader* r)
+{
+	int len;
+	const char* s = sGetString(r, &len);
+	char* d;
+	if(!s)
+		return 0;
+	d = (char*)malloc(len + 1);
+	if(d)
+	{
+		memcpy(d, s, len);
+		d[len] = 0;
+	}
+	return d;
+}
+
+/* helper function to append to the message. */
+static void sAppend(const char* s, int len)
+{
+	if(len > MSG_BUF_SIZE - 1 - sMsgLen)
+		len = MSG_BUF_SIZE - 1 - sMsgLen;
+	memcpy(sMsg + sMsgLen, s, len);
+	sMsgLen += len;
+	sMsg[sMsgLen] = 0;
+}
+
+/* helper function to convert a local date to days since 1970-01-01. */
+static long long sDaysFromCivil(long long y, unsigned m, unsigned d)
+{
+	long long era;
+	unsigned yoe, doy, doe;
+	y -= (m <= 2);
+	era = (y >= 0 ? y : y - 399) / 400;
+	yoe = (unsigned)(y - era * 400);
+	doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+	doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+	return era * 146097 + (long long)doe - 719468;
+}
+
+/* helper function to write a local time, in seconds since 1970-01-01 00:00:00. */
+static void sFormatTime(char* buf, int size, long long secs)
+{
+	long long days = (secs >= 0 ? secs : secs - 86399) / 86400;
+	long long rem = secs - days * 86400;
+	long long z = days + 719468;
+	long long era = (z >= 0 ? z : z - 146096) / 146097;
+	unsigned doe = (unsigned)(z - era * 146097);
+	unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+	unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+	unsigned mp = (5 * doy + 2) / 153;
+	unsigned d = doy - (153 * mp + 2) / 5 + 1;
+	unsigned m = mp < 10 ? mp + 3 : mp - 9;
+	long long y = (long long)yoe + era * 400 + (m <= 2);
+	snprintf(buf, size, "%04lld-%02u-%02u %02d:%02d:%02d", y, m, d,
+			(int)(rem / 3600), (int)(rem / 60 % 60), (int)(rem % 60));
+}
+
+/* helper function to parse a time bound. */
+static int sParseTime(const char* s, TimeBound* t)
+{
+	int y, mo, d, h = 0, mi = 0, sec = 0;
+	t->set = 1;
+	if('@' == s[0])
+	{
+		t->epoch = 1;
+		t->secs = strtoll(s + 1, 0, 10);
+		return 0;
+	}
+	if(sscanf(s, "%d-%d-%d %d:%d:%d", &y, &mo, &d, &h, &mi, &sec) < 3)
+		return -1;
+	t->epoch = 0;
+	t->secs = sDaysFromCivil(y, mo, d) * 86400 + h * 3600 + mi * 60 + sec;
+	return 0;
+}
+
+/* helper function to parse a level name or letter. */
+static int sParseLevel(const char* s)
+{
+	int level;
+	for(level = Trace; level <= Fatal; level++)
+	{
+		const char* name = LLLevelName((LogLevel)level);
+		if( ((toupper((unsigned char)s[0]) == name[0]) && !s[1])
+				|| !strncasecmp(s, name, strlen(name)) )
+			return level;
+	}
+	return -1;
+}
+
+/* helper function to check a time against the filter. */
+static int sInRange(const TimeBound* start, const TimeBound* end,
+		unsigned long long wallUs, long utcOffset)
+{
+	long long epochSecs = (long long)(wallUs / 1000000);
+	long long localSecs = epochSecs + utcOffset;
+	if(!wallUs)
+		return 1;
+	if(start->set && ((start->epoch ? epochSecs : localSecs) < start->secs))
+		return 0;
+	if(end->set && ((end->epoch ? epochSecs : localSecs) > end->secs))
+		return 0;
+	return 1;
+}
+
+/* helper function to note down a site definition. */
+static int sAddSite(DecSession* session, DecReader* r)
+{
+	unsigned long long id = sGetVarint(r);
+	DecSite* site;
+	if(r->error || (id > 0xffffff))
+		return -1;
+	if(id >= session->numSites)
+	{
+		unsigned int newNum = (unsigned int)(id + 1) * 2;
+		DecSite* newSites = (DecSite*)realloc(session->sites, newNum * sizeof(DecSite));
+		if(!newSites)
+			return -1;
+		memset(newSites + session->numSites, 0, (newNum - session->numSites) * sizeof(DecSite));
+		session->sites = newSites;
+		session->numSites = newNum;
+	}
+	site = &session->sites[id];
+	/* defined again after a loss of records. */
+	if(site->defined)
+		return 0;
+	site->kind = sGetByte(r);
+	site->level = sGetByte(r);
+	site->line = (int)sGetVarint(r);
+	site->file = sDupString(r);
+	site->funcName = sDupString(r);
+	site->fmt = sDupString(r);
+	if(r->error)
+		return -1;
+	site->numConvs = site->fmt ? LLBinParseFormat(site->fmt, site->convs, LL_BIN_MAX_CONVS) : 0;
+	site->defined = 1;
+	return 0;
+}
+
+/* helper function to format a value with a conversion of the format. */
+#define FORMAT_VALUE(spec, stars, s0, s1, value)									\
+	do {																			\
+		char* dst = sMsg + sMsgLen;													\
+		int room = MSG_BUF_SIZE - sMsgLen;											\
+		int n;																		\
+		if(0 == (stars))															\
+			n = snprintf(dst, room, spec, value);									\
+		else if(1 == (stars))														\
+			n = snprintf(dst, room, spec, s0, value);								\
+		else																		\
+			n = snprintf(dst, room, spec, s0, s1, value);							\
+		if(n > 0)																	\
+			sMsgLen += (n < room) ? n : room - 1;									\
+	} while(0)
+
+/* helper function to format the arguments of a record with the format of its site. */
+static void sFormatArgs(const DecSite* site, DecReader* r)
+{
+	const char* fmt = site->fmt;
+	int pos = 0;
+	int i;
+	for(i = 0; (i < site->numConvs) && !r->error; i++)
+	{
+		const LLBinConv* c = &site->convs[i];
+		char spec[64];
+		int specLen = 0;
+		int end = c->start + c->len;
+		int convChar = fmt[end - 1];
+		int star[2] = {0, 0};
+		int k;
+		sAppend(fmt + pos, c->start - pos);
+		pos = end;
+		if(LL_BIN_ARG_NONE == c->arg)
+		{
+			sAppend("%", 1);
+			continue;
+		}
+		/* the conversion without its length modifier, the values are decoded as 64 bits. */
+		if(c->len > (int)sizeof(spec) - 4)
+		{
+			r->error = 1;
+			break;
+		}
+		memcpy(spec, fmt + c->start, c->len - 1);
+		specLen = c->len - 1;
+		while((specLen > 1) && strchr("hlqLjzt", spec[specLen - 1]))
+			specLen--;
+		if(((LL_BIN_ARG_INT == c->arg) || (LL_BIN_ARG_UINT == c->arg)) && ('c' != convChar))
+		{
+			spec[specLen++] = 'l';
+			spec[specLen++] = 'l';
+		}
+		spec[specLen++] = (char)convChar;
+		spec[specLen] = 0;
+		for(k = 0; k < c->stars; k++)
+			star[k] = (int)sGetSigned(r);
+
+		switch(c->arg)
+		{
+		case LL_BIN_ARG_INT:
+			{
+				long long v = sGetSigned(r);
+				if('c' == convChar)
+					FORMAT_VALUE(spec, c->stars, star[0], star[1], (int)v);
+				else
+					FORMAT_VALUE(spec, c->stars, star[0], star[1], v);
+			}
+			break;
+		case LL_BIN_ARG_UINT:
+			{
+				unsigned long long v = sGetVarint(r);
+				FORMAT_VALUE(spec, c->stars, star[0], star[1], v);
+			}
+			break;
+		case LL_BIN_ARG_PTR:
+			{
+				unsigned long long v = sGetVarint(r);
+				FORMAT_VALUE(spec, c->stars, star[0], star[1], (void*)(size_t)v);
+			}
+			break;
+		case LL_BIN_ARG_DOUBLE:
+			{
+				double v = 0;
+				if(r->len < (int)sizeof(v))
+					r->error = 1;
+				else
+				{
+					memcpy(&v, r->p, sizeof(v));
+					r->p += sizeof(v);
+					r->len -= sizeof(v);
+				}
+				FORMAT_VALUE(spec, c->stars, star[0], star[1], v);
+			}
+			break;
+		case LL_BIN_ARG_STR:
+			{
+				int len;
+				const char* s = sGetString(r, &len);
+				char* copy = (char*)malloc(len + 1);
+				if(!copy)
+				{
+					r->error = 1;
+					break;
+				}
+				if(s)
+					memcpy(copy, s, len);
+				copy[len] = 0;
+				FORMAT_VALUE(spec, c->stars, star[0], star[1], s ? copy : "(null)");
+				free(copy);
+			}
+			break;
+		default:
+			r->error = 1;
+			break;
+		}
+	}
+	sAppend(fmt + pos, (int)strlen(fmt + pos));
+}
+
+/* helper function to write a record of a call site. */
+static int sWriteLog(FILE* out, const DecSession* session, const DecSite* site, DecReader* r,
+		unsigned long long wallUs, long utcOffset)
+{
+	char date[32];
+	int flags;
+	int ctxLen = 0;
+	const char* ctx = 0;
+	sMsgLen = 0;
+	sMsg[0] = 0;
+	flags = sGetByte(r);
+	if(flags & LL_BIN_FLAG_CONTEXT)
+		ctx = sGetString(r, &ctxLen);
+	if(flags & LL_BIN_FLAG_TEXT)
+	{
+		int len;
+		const char* s = sGetString(r, &len);
+		if(s)
+			sAppend(s, len);
+	}
+	else if(site->numConvs < 0)
+		r->error = 1;
+	else if(site->fmt)
+		sFormatArgs(site, r);
+	/* the notes follow the message, as in the text log. */
+	if(flags & LL_BIN_FLAG_SUPPRESSED)
+	{
+		char note[64];
+		int len = snprintf(note, sizeof(note), " (suppressed %llu similar records)", sGetVarint(r));
+		sAppend(note, len);
+	}
+	if(flags & LL_BIN_FLAG_STACK)
+	{
+		int len;
+		const char* s = sGetString(r, &len);
+		if(s)
+			sAppend(s, len);
+	}
+	if(r->error)
+		return -1;
+
+	if(LL_BIN_SITE_FUNC_ENTRY == site->kind)
+	{
+		fprintf(out, "{ %s \n", site->funcName ? site->funcName : "");
+		return 0;
+	}
+	if(LL_BIN_SITE_FUNC_EXIT == site->kind)
+	{
+		fprintf(out, "%s : %d }\n", site->funcName ? site->funcName : "", site->line);
+		return 0;
+	}
+	sFormatTime(date, sizeof(date), (long long)(wallUs / 1000000) + utcOffset);
+	if(site->file)
+		fprintf(out, "[%s] [%c] %s::%s#%d:%s() - ", date, LLLevelName((LogLevel)site->level)[0],
+				session->moduleName ? session->moduleName : "", site->file, site->line,
+				site->funcName ? site->funcName : "");
+	else
+		fprintf(out, "[%s] [%c] ", date, LLLevelName((LogLevel)site->level)[0]);
+	if(ctx)
+		fwrite(ctx, 1, ctxLen, out);
+	fwrite(sMsg, 1, sMsgLen, out);
+	fputc('\n', out);
+	return 0;
+}
+
+/* helper function to read the next record of the log.
+ * \returns 1 if a record is read, 0 at the end of the log, -1 if the log is corrupted. */
+static int sNextRecord(const char** p, const char* end, int* type, DecReader* r)
+{
+	unsigned long long len;
+	int n;
+	if(*p >= end)
+		return 0;
+	*type = (unsigned char)**p;
+	n = LLBinGetVarint(*p + 1, (int)(end - *p - 1), &len);
+	if(!n || (len > (unsigned long long)(end - *p - 1 - n)))
+		return -1;
+	r->p = *p + 1 + n;
+	r->len = (int)len;
+	r->error = 0;
+	*p = r->p + len;
+	return 1;
+}
+
+int main(int argc, char** argv)
+{
+	FILE* in;
+	FILE* out = stdout;
+	char* data;
+	long size;
+	const char* p;
+	const char* end;
+	DecReader r;
+	int type;
+	int ret;
+	int minLevel = Trace;
+	TimeBound start = {0, 0, 0};
+	TimeBound stop = {0, 0, 0};
+	unsigned long numRecords = 0;
+	unsigned long numErrors = 0;
+	int argi = 1;
+	/* the current session. */
+	int sessionIndex = -1;
+	unsigned long long sessionWallUs = 0;
+	long utcOffset = 0;
+
+	for(; (argi + 1 < argc) && ('-' == argv[argi][0]) && argv[argi][1] && !argv[argi][2]; argi += 2)
+	{
+		if('l' == argv[argi][1])
+		{
+			minLevel = sParseLevel(argv[argi + 1]);
+			if(minLevel < 0)
+				break;
+		}
+		else if('s' == argv[argi][1])
+		{
+			if(sParseTime(argv[argi + 1], &start))
+				break;
+		}
+		else if('e' == argv[argi][1])
+		{
+			if(sParseTime(argv[argi + 1], &stop))
+				break;
+		}
+		else
+			break;
+	}
+	if((argc - argi < 1) || (argc - argi > 2) || ('-' == argv[argi][0]))
+	{
+		fprintf(stderr, "usage : %s [-l level] [-s start] [-e end] <log> [output]\n", argv[0]);
+		fprintf(stderr, "  -l : the lowest level written, Trace, Debug, Info, Warn, Error or Fatal (or T, D, I, W, E, F)\n");
+		fprintf(stderr, "  -s, -e : the first / last time written, \"YYYY-MM-DD HH:MM:SS\" as logged, or @<seconds since the epoch>\n");
+		return 2;
+	}
+	in = fopen(argv[argi], "rb");
+	if(!in)
+	{
+		fprintf(stderr, "could not open %s\n", argv[argi]);
+		return 1;
+	}
+	fseek(in, 0, SEEK_END);
+	size = ftell(in);
+	fseek(in, 0, SEEK_SET);
+	data = (char*)malloc(size > 0 ? size : 1);
+	if(!data || (fread(data, 1, size, in) != (size_t)size))
+	{
+		fprintf(stderr, "could not read %s\n", argv[argi]);
+		fclose(in);
+		return 1;
+	}
+	fclose(in);
+	end = data + size;
+	p = data;
+	if( (sNextRecord(&p, end, &type, &r) <= 0) || (LL_BIN_REC_SESSION != type)
+			|| (r.len < LL_BIN_MAGIC_LEN) || memcmp(r.p, LL_BIN_MAGIC, LL_BIN_MAGIC_LEN) )
+	{
+		fprintf(stderr, "%s is not a binary log\n", argv[argi]);
+		free(data);
+		return 1;
+	}
+	if(argc - argi == 2)
+	{
+		out = fopen(argv[argi + 1], "w");
+		if(!out)
+		{
+			fprintf(stderr, "could not open %s\n", argv[argi + 1]);
+			free(data);
+			return 1;
+		}
+	}
+
+	/* first pass : the site definitions, the asynchronous writer may write a record before
+	 * the definition of its site. */
+	p = data;
+	while((ret = sNextRecord(&p, end, &type, &r)) > 0)
+	{
+		if(LL_BIN_REC_SESSION == type)
+		{
+			DecSession* newSessions = (DecSession*)realloc(sSessions, (sNumSessions + 1) * sizeof(DecSession));
+			if(!newSessions)
+			{
+				fprintf(stderr, "out of memory\n");
+				return 1;
+			}
+			sSessions = newSessions;
+			memset(&sSessions[sNumSessions], 0, sizeof(DecSession));
+			/* the magic, version, wall clock, UTC offset then the module name. */
+			r.p += LL_BIN_MAGIC_LEN;
+			r.len -= LL_BIN_MAGIC_LEN;
+			sGetVarint(&r);
+			sGetVarint(&r);
+			sGetVarint(&r);
+			sSessions[sNumSessions].moduleName = sDupString(&r);
+			sNumSessions++;
+		}
+		else if((LL_BIN_REC_SITE == type) && sNumSessions)
+		{
+			if(sAddSite(&sSessions[sNumSessions - 1], &r))
+				numErrors++;
+		}
+	}
+	if(ret < 0)
+		fprintf(stderr, "%s is truncated at offset %ld\n", argv[argi], (long)(p - data));
+
+	/* second pass : the records. */
+	p = data;
+	while(sNextRecord(&p, end, &type, &r) > 0)
+	{
+		if(LL_BIN_REC_SESSION == type)
+		{
+			char date[32];
+			r.p += LL_BIN_MAGIC_LEN;
+			r.len -= LL_BIN_MAGIC_LEN;
+			sGetVarint(&r);
+			sessionWallUs = sGetVarint(&r);
+			utcOffset = (long)sGetSigned(&r);
+			sessionIndex++;
+			if(sInRange(&start, &stop, sessionWallUs, utcOffset))
+			{
+				sFormatTime(date, sizeof(date), (long long)(sessionWallUs / 1000000) + utcOffset);
+				fprintf(out, "\n----- Logging Started on %s -----\n", date);
+			}
+		}
+		else if((LL_BIN_REC_LOG == type) && (sessionIndex >= 0))
+		{
+			unsigned long long wallUs = sessionWallUs + sGetVarint(&r);
+			unsigned long long id;
+			const DecSession* session = &sSessions[sessionIndex];
+			sGetVarint(&r); /* the thread id. */
+			id = sGetVarint(&r);
+			if(r.error || (id >= session->numSites) || !session->sites[id].defined)
+			{
+				numErrors++;
+				continue;
+			}
+			if((session->sites[id].level < minLevel) || !sInRange(&start, &stop, wallUs, utcOffset))
+				continue;
+			if(sWriteLog(out, session, &session->sites[id], &r, wallUs, utcOffset))
+				numErrors++;
+			else
+				numRecords++;
+		}
+		else if(LL_BIN_REC_NOTE == type)
+		{
+			unsigned long long wallUs = sGetVarint(&r);
+			int level = sGetByte(&r);
+			int len;
+			const char* text = sGetString(&r, &len);
+			if(r.error)
+			{
+				numErrors++;
+				continue;
+			}
+			if((level < minLevel) || !sInRange(&start, &stop, wallUs, utcOffset))
+				continue;
+			if(text)
+				fwrite(text, 1, len, out);
+			numRecords++;
+		}
+		/* the sites are read by the first pass, unknown records are skipped. */
+	}
+
+	fprintf(stderr, "%lu records", numRecords);
+	if(numErrors)
+		fprintf(stderr, ", %lu could not be decoded", numErrors);
+	fprintf(stderr, "\n");
+	if(out != stdout)
+		fclose(out);
+	free(data);
+	return 0;
+}
@@ -0,0 +1,230 @@
+/*
+       Licensed to the Apache Software Foundation (ASF) under one
+       or more contributor license agreements.  See the NOTICE file
+       distributed with this work for additional information
+       regarding copyright ownership.  The ASF licenses this file
+       to you under the Apache License, Version 2.0 (the
+       "License"); you may not use this file except in compliance
+       with the License.  You may obtain a copy of the License at
+
+         http://www.apache.org/licenses/LICENSE-2.0
+
+       Unless required by applicable law or agreed to in writing,
+       software distributed under the License is distributed on an
+       "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+       KIND, either express or implied.  See the License for the
+       specific language governing permissions and limitations
+       under the License.
+ */
+/**
+ * \file llmerge : merges the shards of the sharded logger (see \ref LogToShards) into a
+ * single log, in time order.
+ * \code
+ * usage : llmerge [-k] [-o output] <shard>...
+ * \endcode
+ * The records of each shard are in time order, the shards are read at the same time and the
+ * oldest of their next records is written, picked with a binary heap : the merge reads each
+ * shard once and keeps a single record per shard in memory. The records with the same time
+ * are written in the order of the shards on the command line.
+ * The heads of the records are removed, with -k they are kept so that the output is a shard,
+ * which can be merged again.
+ * */
+#include <liblogger/shard_logger.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/** A shard being read, with its next record. */
+typedef struct LLShardReader
+{
+	const char*		name;
+	FILE*			fp;
+	/** The order of the shard on the command line, for the records with the same time. */
+	int				index;
+	/** The time of the next record, in ns. */
+	unsigned long long	ns;
+	/** The next record, with its head. */
+	char*			record;
+	unsigned int	len;
+	unsigned int	capacity;
+} LLShardReader;
+
+/* helper function to parse count digits. Returns -1 if a character is not a digit. */
+static int sParseDigits(const char* s, int count, unsigned long long* value)
+{
+	int i;
+	*value = 0;
+	for(i = 0; i < count; i++)
+	{
+		if((s[i] < '0') || (s[i] > '9'))
+			return -1;
+		*value = *value * 10 + (unsigned long long)(s[i] - '0');
+	}
+	return 0;
+}
+
+/* helper function to read the next record of a shard.
+ * Returns 1 if a record is read, 0 at the end of the shard, -1 if the shard is corrupted. */
+static int sReadRecord(LLShardReader* r)
+{
+	char head[LL_SHARD_HEAD_LEN];
+	unsigned long long len;
+	size_t n = fread(head, 1, LL_SHARD_HEAD_LEN, r->fp);
+	if(!n)
+		return 0;
+	if( (n != LL_SHARD_HEAD_LEN) || (' ' != head[19]) || (' ' != head[28]) ||
+			sParseDigits(head, 19, &r->ns) || sParseDigits(head + 20, 8, &len) )
+	{
+		fprintf(stderr, "%s : invalid record head, the rest of the shard is skipped\n", r->name);
+		return -1;
+	}
+	if(LL_SHARD_HEAD_LEN + len > r->capacity)
+	{
+		char* record = (char*)realloc(r->record, LL_SHARD_HEAD_LEN + (size_t)len);
+		if(!record)
+		{
+			fprintf(stderr, "out of memory\n");
+			return -1;
+		}
+		r->record = record;
+		r->capacity = LL_SHARD_HEAD_LEN + (unsigned int)len;
+	}
+	memcpy(r->record, head, LL_SHARD_HEAD_LEN);
+	r->len = LL_SHARD_HEAD_LEN + (unsigned int)len;
+	if(fread(r->record + LL_SHARD_HEAD_LEN, 1, (size_t)len, r->fp) != (size_t)len)
+	{
+		fprintf(stderr, "%s : truncated record, the rest of the shard is skipped\n", r->name);
+		return -1;
+	}
+	return 1;
+}
+
+/* helper function to compare the next records of two shards. */
+static int sBefore(const LLShardReader* a, const LLShardReader* b)
+{
+	if(a->ns != b->ns)
+		return a->ns < b->ns;
+	return a->index < b->index;
+}
+
+/* helper function to move the shard at position i of the heap down to its place. */
+static void sSiftDown(LLShardReader** heap, int count, int i)
+{
+	for(;;)
+	{
+		int child = 2 * i + 1;
+		LLShardReader* tmp;
+		if(child >= count)
+			return;
+		if((child + 1 < count) && sBefore(heap[child + 1], heap[child]))
+			child++;
+		if(!sBefore(heap[child], heap[i]))
+			return;
+		tmp = heap[i];
+		heap[i] = heap[child];
+		heap[child] = tmp;
+		i = child;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	LLShardReader* shards;
+	LLShardReader** heap;
+	FILE* out = stdout;
+	const char* outName = NULL;
+	unsigned long long records = 0;
+	int keepHeads = 0;
+	int numShards, count = 0;
+	int errors = 0;
+	int argi = 1;
+	int i;
+
+	for(; (argi < argc) && ('-' == argv[argi][0]) && argv[argi][1] && !argv[argi][2]; argi++)
+	{
+		if(('o' == argv[argi][1]) && (argi + 1 < argc))
+			outName = argv[++argi];
+		else if('k' == argv[argi][1])
+			keepHeads = 1;
+		else
+			break;
+	}
+	if((argi >= argc) || ('-' == argv[argi][0]))
+	{
+		fprintf(stderr, "usage : %s [-k] [-o output] <shard>...\n", argv[0]);
+		fprintf(stderr, "  -k : keep the heads of the records, the output is a shard\n");
+		fprintf(stderr, "  -o : the merged log, stdout by default\n");
+		return 2;
+	}
+	numShards = argc - argi;
+	shards = (LLShardReader*)calloc(numShards, sizeof(LLShardReader));
+	heap = (LLShardReader**)calloc(numShards, sizeof(LLShardReader*));
+	if(!shards || !heap)
+	{
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+	for(i = 0; i < numShards; i++)
+	{
+		LLShardReader* r = &shards[i];
+		int rc;
+		r->name = argv[argi + i];
+		r->index = i;
+		r->fp = fopen(r->name, "rb");
+		if(!r->fp)
+		{
+			fprintf(stderr, "could not open %s\n", r->name);
+			errors++;
+			continue;
+		}
+		rc = sReadRecord(r);
+		if(rc > 0)
+			heap[count++] = r;
+		else if(rc < 0)
+			errors++;
+	}
+	if(outName)
+	{
+		out = fopen(outName, "wb");
+		if(!out)
+		{
+			fprintf(stderr, "could not open %s\n", outName);
+			return 1;
+		}
+	}
+	for(i = count / 2 - 1; i >= 0; i--)
+		sSiftDown(heap, count, i);
+
+	while(count > 0)
+	{
+		LLShardReader* r = heap[0];
+		int rc;
+		if(keepHeads)
+			fwrite(r->record, 1, r->len, out);
+		else
+			fwrite(r->record + LL_SHARD_HEAD_LEN, 1, r->len - LL_SHARD_HEAD_LEN, out);
+		records++;
+		rc = sReadRecord(r);
+		if(rc <= 0)
+		{
+			/* the shard is done, the last shard of the heap takes its place. */
+			if(rc < 0)
+				errors++;
+			heap[0] = heap[--count];
+		}
+		sSiftDown(heap, count, 0);
+	}
+
+	for(i = 0; i < numShards; i++)
+	{
+		if(shards[i].fp)
+			fclose(shards[i].fp);
+		free(shards[i].record);
+	}
+	free(shards);
+	free(heap);
+	if(out != stdout)
+		fclose(out);
+	fprintf(stderr, "%llu records merged from %d shards\n", records, numShards);
+	return errors ? 1 : 0;
+}
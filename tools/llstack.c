@@ -0,0 +1,157 @@
+/*
+       Licensed to the Apache Software Foundation (ASF) under one
+       or more contributor license agreements.  See the NOTICE file
+       distributed with this work for additional information
+       regarding copyright ownership.  The ASF licenses this file
+       to you under the Apache License, Version 2.0 (the
+       "License"); you may not use this file except in compliance
+       with the License.  You may obtain a copy of the License at
+
+         http://www.apache.org/licenses/LICENSE-2.0
+
+       Unless required by applicable law or agreed to in writing,
+       software distributed under the License is distributed on an
+       "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+       KIND, either express or implied.  See the License for the
+       specific language governing permissions and limitations
+       under the License.
+ */
+/**
+ * \file llstack : symbolises the call stacks appended to the records (see \ref InitStackTrace),
+ * each module+0xoffset frame is replaced by function+0xoffset. The modules must still be
+ * present at the same paths, the frames which cannot be symbolised are left as they are.
+ * \code
+ * usage : llstack [log] [output]
+ * \endcode
+ * The log is read from the standard input if it is not given.
+ * */
+#include "llsym.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/** The marker of a stack in a record. */
+#define STACK_MARKER	" [stack:"
+
+/* helper function to read a line of any length.
+ * \returns the length of the line, -1 at the end of the input. */
+static int sReadLine(FILE* in, char** line, int* size)
+{
+	int len = 0;
+	if(!*line)
+	{
+		*size = 4096;
+		*line = (char*)malloc(*size);
+		if(!*line)
+			return -1;
+	}
+	while(fgets(*line + len, *size - len, in))
+	{
+		len += (int)strlen(*line + len);
+		if((len > 0) && ((*line)[len - 1] == '\n'))
+			return len;
+		if(len == *size - 1)
+		{
+			char* p = (char*)realloc(*line, *size * 2);
+			if(!p)
+				return len;
+			*line = p;
+			*size *= 2;
+		}
+	}
+	return len ? len : -1;
+}
+
+/* helper function to write a frame, symbolised if possible. */
+static void sWriteFrame(FILE* out, LLSymbolizer* sym, char* frame)
+{
+	char* plus = strstr(frame, "+0x");
+	char* p;
+	while(plus && (p = strstr(plus + 1, "+0x")))
+		plus = p;
+	if(plus)
+	{
+		unsigned long long vaddr = strtoull(plus + 3, NULL, 16);
+		unsigned long long symOffset = 0;
+		const char* name;
+		*plus = 0;
+		/* a return address, the call is the instruction before it. */
+		name = vaddr ? LLSymLookupModule(sym, frame, vaddr - 1, &symOffset) : NULL;
+		*plus = '+';
+		if(name)
+		{
+			fprintf(out, "%s+0x%llx", name, symOffset + 1);
+			return;
+		}
+	}
+	fputs(frame, out);
+}
+
+int main(int argc, char** argv)
+{
+	FILE* in = stdin;
+	FILE* out = stdout;
+	LLSymbolizer* sym;
+	char* line = NULL;
+	int size = 0;
+	int len;
+
+	if(argc > 3)
+	{
+		fprintf(stderr, "usage : %s [log] [output]\n", argv[0]);
+		return 2;
+	}
+	if(argc > 1)
+	{
+		in = fopen(argv[1], "r");
+		if(!in)
+		{
+			fprintf(stderr, "could not open %s\n", argv[1]);
+			return 1;
+		}
+	}
+	if(argc > 2)
+	{
+		out = fopen(argv[2], "w");
+		if(!out)
+		{
+			fprintf(stderr, "could not open %s\n", argv[2]);
+			return 1;
+		}
+	}
+	sym = LLSymCreate();
+	if(!sym)
+	{
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+	while((len = sReadLine(in, &line, &size)) >= 0)
+	{
+		char* stack = strstr(line, STACK_MARKER);
+		char* end;
+		char* frame;
+		if(!stack || !(end = strchr(stack, ']')))
+		{
+			fputs(line, out);
+			continue;
+		}
+		stack += sizeof(STACK_MARKER) - 1;
+		fwrite(line, 1, stack - line, out);
+		*end = 0;
+		/* the frames are separated by a space. */
+		for(frame = strtok(stack, " "); frame; frame = strtok(NULL, " "))
+		{
+			fputc(' ', out);
+			sWriteFrame(out, sym, frame);
+		}
+		fputc(']', out);
+		fputs(end + 1, out);
+	}
+	free(line);
+	LLSymDestroy(sym);
+	if(in != stdin)
+		fclose(in);
+	if(out != stdout)
+		fclose(out);
+	return 0;
+}
@@ -0,0 +1,366 @@
+/*
+       Licensed to the Apache Software Foundation (ASF) under one
+       or more contributor license agreements.  See the NOTICE file
+       distributed with this work for additional information
+       regarding copyright ownership.  The ASF licenses this file
+       to you under the Apache License, Version 2.0 (the
+       "License"); you may not use this file except in compliance
+       with the License.  You may obtain a copy of the License at
+
+         http://www.apache.org/licenses/LICENSE-2.0
+
+       Unless required by applicable law or agreed to in writing,
+       software distributed under the License is distributed on an
+       "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+       KIND, either express or implied.  See the License for the
+       specific language governing permissions and limitations
+       under the License.
+ */
+/**
+ * \file Implementation of the offline symboliser, see llsym.h.
+ * Only 64 bit ELF modules are supported, the addresses of the other modules are
+ * reported as module + offset.
+ * */
+#include "llsym.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__linux__)
+	#include <elf.h>
+	#define HAVE_ELF
+#endif
+
+/** A function symbol. */
+typedef struct LLSymbol
+{
+	unsigned long long	addr;
+	unsigned long long	size;
+	const char*			name;
+} LLSymbol;
+
+/** A loadable segment of a module. */
+typedef struct LLSegment
+{
+	unsigned long long	offset;
+	unsigned long long	vaddr;
+	unsigned long long	size;
+} LLSegment;
+
+/** A module file. */
+typedef struct LLModule
+{
+	char*		path;
+	/** Non zero once the symbols are loaded (or could not be). */
+	int			loaded;
+	/** The content of the file, the symbol names point in it. */
+	char*		data;
+	LLSymbol*	symbols;
+	int			numSymbols;
+	LLSegment*	segments;
+	int			numSegments;
+} LLModule;
+
+/** An executable mapping of a module. */
+typedef struct LLMapping
+{
+	unsigned long long	start;
+	unsigned long long	end;
+	unsigned long long	offset;
+	LLModule*			module;
+} LLMapping;
+
+struct LLSymbolizer
+{
+	LLMapping*	mappings;
+	int			numMappings;
+	LLModule**	modules;
+	int			numModules;
+};
+
+/* Create a symboliser. */
+LLSymbolizer* LLSymCreate(void)
+{
+	return (LLSymbolizer*)calloc(1, sizeof(LLSymbolizer));
+}
+
+/* helper function to get a module by path, it is created if needed. */
+static LLModule* sGetModule(LLSymbolizer* s, const char* path)
+{
+	int i;
+	LLModule** modules;
+	for(i = 0; i < s->numModules; i++)
+	{
+		if(!strcmp(s->modules[i]->path, path))
+			return s->modules[i];
+	}
+	modules = (LLModule**)realloc(s->modules, (s->numModules + 1) * sizeof(LLModule*));
+	if(!modules)
+		return NULL;
+	s->modules = modules;
+	modules[s->numModules] = (LLModule*)calloc(1, sizeof(LLModule));
+	if(!modules[s->numModules])
+		return NULL;
+	modules[s->numModules]->path = (char*)malloc(strlen(path) + 1);
+	if(!modules[s->numModules]->path)
+	{
+		free(modules[s->numModules]);
+		return NULL;
+	}
+	strcpy(modules[s->numModules]->path, path);
+	return modules[s->numModules++];
+}
+
+/* Add the executable mappings of a memory map. */
+void LLSymAddMaps(LLSymbolizer* s, const char* maps)
+{
+	const char* line = maps;
+	while(line && *line)
+	{
+		const char* eol = strchr(line, '\n');
+		char buf[4096];
+		int len = eol ? (int)(eol - line) : (int)strlen(line);
+		unsigned long long start, end, offset;
+		char perms[8];
+		int pathPos = 0;
+		if(len > (int)sizeof(buf) - 1)
+			len = sizeof(buf) - 1;
+		memcpy(buf, line, len);
+		buf[len] = 0;
+		line = eol ? eol + 1 : NULL;
+		/* start-end perms offset dev inode path */
+		if( (sscanf(buf, "%llx-%llx %7s %llx %*s %*s %n", &start, &end, perms, &offset, &pathPos) < 4)
+				|| !pathPos || !strchr(perms, 'x') || (buf[pathPos] != '/') )
+			continue;
+		{
+			LLMapping* mappings;
+			int i;
+			/* a mapping seen in an earlier snapshot is kept once. */
+			for(i = 0; i < s->numMappings; i++)
+			{
+				if((s->mappings[i].start == start) && (s->mappings[i].end == end)
+						&& !strcmp(s->mappings[i].module->path, buf + pathPos))
+					break;
+			}
+			if(i < s->numMappings)
+				continue;
+			mappings = (LLMapping*)realloc(s->mappings, (s->numMappings + 1) * sizeof(LLMapping));
+			if(!mappings)
+				return;
+			s->mappings = mappings;
+			mappings[s->numMappings].start = start;
+			mappings[s->numMappings].end = end;
+			mappings[s->numMappings].offset = offset;
+			mappings[s->numMappings].module = sGetModule(s, buf + pathPos);
+			if(mappings[s->numMappings].module)
+				s->numMappings++;
+		}
+	}
+}
+
+/* helper function to order the symbols by address. */
+static int sCompareSymbols(const void* a, const void* b)
+{
+	const LLSymbol* sa = (const LLSymbol*)a;
+	const LLSymbol* sb = (const LLSymbol*)b;
+	return (sa->addr < sb->addr) ? -1 : ((sa->addr > sb->addr) ? 1 : 0);
+}
+
+#ifdef HAVE_ELF
+/* helper function to load the function symbols and the segments of an ELF64 module. */
+static void sLoadElf(LLModule* m, long size)
+{
+	const Elf64_Ehdr* eh = (const Elf64_Ehdr*)m->data;
+	const Elf64_Shdr* sh;
+	int i, pass;
+	if( (size < (long)sizeof(Elf64_Ehdr)) || memcmp(eh->e_ident, ELFMAG, SELFMAG)
+			|| (eh->e_ident[EI_CLASS] != ELFCLASS64)
+			|| ((long)(eh->e_phoff + eh->e_phnum * sizeof(Elf64_Phdr)) > size)
+			|| ((long)(eh->e_shoff + eh->e_shnum * sizeof(Elf64_Shdr)) > size) )
+		return;
+
+	m->segments = (LLSegment*)calloc(eh->e_phnum ? eh->e_phnum : 1, sizeof(LLSegment));
+	for(i = 0; m->segments && (i < eh->e_phnum); i++)
+	{
+		const Elf64_Phdr* ph = (const Elf64_Phdr*)(m->data + eh->e_phoff) + i;
+		if(ph->p_type != PT_LOAD)
+			continue;
+		m->segments[m->numSegments].offset = ph->p_offset;
+		m->segments[m->numSegments].vaddr = ph->p_vaddr;
+		m->segments[m->numSegments].size = ph->p_filesz;
+		m->numSegments++;
+	}
+
+	/* the full symbol table if the module is not stripped, else the dynamic one. */
+	sh = (const Elf64_Shdr*)(m->data + eh->e_shoff);
+	for(pass = 0; (pass < 2) && !m->numSymbols; pass++)
+	{
+		Elf64_Word type = pass ? SHT_DYNSYM : SHT_SYMTAB;
+		for(i = 0; i < eh->e_shnum; i++)
+		{
+			const Elf64_Sym* syms;
+			const char* strtab;
+			unsigned long long n, j;
+			if((sh[i].sh_type != type) || (sh[i].sh_link >= eh->e_shnum)
+					|| ((long)(sh[i].sh_offset + sh[i].sh_size) > size)
+					|| ((long)(sh[sh[i].sh_link].sh_offset + sh[sh[i].sh_link].sh_size) > size))
+				continue;
+			syms = (const Elf64_Sym*)(m->data + sh[i].sh_offset);
+			strtab = m->data + sh[sh[i].sh_link].sh_offset;
+			n = sh[i].sh_size / sizeof(Elf64_Sym);
+			m->symbols = (LLSymbol*)malloc((size_t)(n ? n : 1) * sizeof(LLSymbol));
+			if(!m->symbols)
+				return;
+			for(j = 0; j < n; j++)
+			{
+				if((ELF64_ST_TYPE(syms[j].st_info) != STT_FUNC) || !syms[j].st_value
+						|| (syms[j].st_name >= sh[sh[i].sh_link].sh_size))
+					continue;
+				m->symbols[m->numSymbols].addr = syms[j].st_value;
+				m->symbols[m->numSymbols].size = syms[j].st_size;
+				m->symbols[m->numSymbols].name = strtab + syms[j].st_name;
+				m->numSymbols++;
+			}
+			break;
+		}
+	}
+	if(m->numSymbols)
+		qsort(m->symbols, m->numSymbols, sizeof(LLSymbol), sCompareSymbols);
+}
+#endif // HAVE_ELF
+
+/* helper function to load the symbols of a module on first use. */
+static void sLoadModule(LLModule* m)
+{
+	FILE* fp;
+	long size;
+	m->loaded = 1;
+	fp = fopen(m->path, "rb");
+	if(!fp)
+	{
+		fprintf(stderr, "could not open %s, its functions are not symbolised\n", m->path);
+		return;
+	}
+	fseek(fp, 0, SEEK_END);
+	size = ftell(fp);
+	fseek(fp, 0, SEEK_SET);
+	if(size > 0)
+		m->data = (char*)malloc(size);
+	if(m->data && (fread(m->data, 1, size, fp) == (size_t)size))
+	{
+#ifdef HAVE_ELF
+		sLoadElf(m, size);
+#endif
+	}
+	fclose(fp);
+}
+
+/* helper function to find the mapping of an address. */
+static LLMapping* sFindMapping(LLSymbolizer* s, unsigned long long addr)
+{
+	int i;
+	for(i = 0; i < s->numMappings; i++)
+	{
+		if((addr >= s->mappings[i].start) && (addr < s->mappings[i].end))
+			return &s->mappings[i];
+	}
+	return NULL;
+}
+
+/* Returns the path of the module containing an address and its offset in the module file. */
+const char* LLSymModule(LLSymbolizer* s, unsigned long long addr, unsigned long long* offset)
+{
+	LLMapping* map = sFindMapping(s, addr);
+	if(!map)
+		return NULL;
+	*offset = addr - map->start + map->offset;
+	return map->module->path;
+}
+
+/* helper function to find the function containing an address of a module. */
+static const LLSymbol* sFindSymbol(LLModule* m, unsigned long long vaddr)
+{
+	int lo, hi;
+	if(!m->loaded)
+		sLoadModule(m);
+	if(!m->numSymbols || (vaddr < m->symbols[0].addr))
+		return NULL;
+	/* the last symbol starting at or before the address. */
+	lo = 0;
+	hi = m->numSymbols - 1;
+	while(lo < hi)
+	{
+		int mid = (lo + hi + 1) / 2;
+		if(m->symbols[mid].addr <= vaddr)
+			lo = mid;
+		else
+			hi = mid - 1;
+	}
+	if(m->symbols[lo].size && (vaddr >= m->symbols[lo].addr + m->symbols[lo].size))
+		return NULL;
+	return &m->symbols[lo];
+}
+
+/* Returns the name of the function containing an address. */
+const char* LLSymLookup(LLSymbolizer* s, unsigned long long addr)
+{
+	LLMapping* map = sFindMapping(s, addr);
+	const LLSymbol* sym;
+	LLModule* m;
+	unsigned long long offset, vaddr = 0;
+	int i, found = 0;
+	if(!map)
+		return NULL;
+	m = map->module;
+	if(!m->loaded)
+		sLoadModule(m);
+	/* the address in the process, to the offset in the file, to the address in the module. */
+	offset = addr - map->start + map->offset;
+	for(i = 0; i < m->numSegments; i++)
+	{
+		if((offset >= m->segments[i].offset) && (offset < m->segments[i].offset + m->segments[i].size))
+		{
+			vaddr = offset - m->segments[i].offset + m->segments[i].vaddr;
+			found = 1;
+			break;
+		}
+	}
+	if(!found)
+		return NULL;
+	sym = sFindSymbol(m, vaddr);
+	return sym ? sym->name : NULL;
+}
+
+/* Returns the name of the function containing an address of a module. */
+const char* LLSymLookupModule(LLSymbolizer* s, const char* path, unsigned long long vaddr,
+		unsigned long long* symOffset)
+{
+	LLModule* m = sGetModule(s, path);
+	const LLSymbol* sym;
+	if(!m)
+		return NULL;
+	sym = sFindSymbol(m, vaddr);
+	if(!sym)
+		return NULL;
+	*symOffset = vaddr - sym->addr;
+	return sym->name;
+}
+
+/* Destroy a symboliser. */
+void LLSymDestroy(LLSymbolizer* s)
+{
+	int i;
+	if(!s)
+		return;
+	for(i = 0; i < s->numModules; i++)
+	{
+		free(s->modules[i]->path);
+		free(s->modules[i]->data);
+		free(s->modules[i]->symbols);
+		free(s->modules[i]->segments);
+		free(s->modules[i]);
+	}
+	free(s->modules);
+	free(s->mappings);
+	free(s);
+}
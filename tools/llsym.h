@@ -0,0 +1,55 @@
+/*
+       Licensed to the Apache Software Foundation (ASF) under one
+       or more contributor license agreements.  See the NOTICE file
+       distributed with this work for additional information
+       regarding copyright ownership.  The ASF licenses this file
+       to you under the Apache License, Version 2.0 (the
+       "License"); you may not use this file except in compliance
+       with the License.  You may obtain a copy of the License at
+
+         http://www.apache.org/licenses/LICENSE-2.0
+
+       Unless required by applicable law or agreed to in writing,
+       software distributed under the License is distributed on an
+       "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+       KIND, either express or implied.  See the License for the
+       specific language governing permissions and limitations
+       under the License.
+ */
+/**
+ * \file Offline symbolisation of the addresses captured in a process, with the memory map
+ * of the process (/proc/<pid>/maps) and the ELF symbol tables of the mapped modules.
+ * */
+#ifndef __LLSYM_H__
+#define __LLSYM_H__
+
+/** A symboliser. */
+typedef struct LLSymbolizer LLSymbolizer;
+
+/** Create a symboliser, without any module. */
+LLSymbolizer* LLSymCreate(void);
+
+/** Add the executable mappings of a memory map, in the /proc/<pid>/maps format.
+ * The modules are loaded on the first lookup of one of their addresses.
+ * */
+void LLSymAddMaps(LLSymbolizer* s, const char* maps);
+
+/** Returns the name of the function containing an address, NULL if it is unknown. */
+const char* LLSymLookup(LLSymbolizer* s, unsigned long long addr);
+
+/** Returns the path of the module containing an address and the offset of the address
+ * in the module file, NULL if the address is not mapped. */
+const char* LLSymModule(LLSymbolizer* s, unsigned long long addr, unsigned long long* offset);
+
+/** Returns the name of the function containing an address of a module, NULL if it is unknown.
+ * \param [in]  path		The path of the module.
+ * \param [in]  vaddr		The address in the module, as in its symbol table.
+ * \param [out] symOffset	The offset of \a vaddr from the start of the function.
+ * */
+const char* LLSymLookupModule(LLSymbolizer* s, const char* path, unsigned long long vaddr,
+		unsigned long long* symOffset);
+
+/** Destroy a symboliser. */
+void LLSymDestroy(LLSymbolizer* s);
+
+#endif // __LLSYM_H__
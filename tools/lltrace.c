@@ -0,0 +1,321 @@
+/*
+       Licensed to the Apache Software Foundation (ASF) under one
+       or more contributor license agreements.  See the NOTICE file
+       distributed with this work for additional information
+       regarding copyright ownership.  The ASF licenses this file
+       to you under the Apache License, Version 2.0 (the
+       "License"); you may not use this file except in compliance
+       with the License.  You may obtain a copy of the License at
+
+         http://www.apache.org/licenses/LICENSE-2.0
+
+       Unless required by applicable law or agreed to in writing,
+       software distributed under the License is distributed on an
+       "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+       KIND, either express or implied.  See the License for the
+       specific language governing permissions and limitations
+       under the License.
+ */
+/**
+ * \file lltrace : converts a function trace capture (see \ref GRP_FUNC_TRACE) to the
+ * Chrome Trace Event format, which chrome://tracing and https://ui.perfetto.dev load,
+ * or with -t to the text records written by LogFuncEntry / LogFuncExit.
+ * The addresses captured with -finstrument-functions are symbolised with the modules
+ * mapped in the traced process, these must still be present at the same paths.
+ * The TSC timestamps are converted to the wall clock time with the calibration points of
+ * the capture.
+ * \code
+ * usage : lltrace [-t] <capture> [output]
+ * \endcode
+ * */
+#include "trace_buffer.h"
+#include "llsym.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/** The function names, indexed by id. */
+static char** sSites = 0;
+static unsigned int sNumSites = 0;
+/** The symboliser of the addresses. */
+static LLSymbolizer* sSym = 0;
+/** The calibration points of the TSC, none if the events are timestamped in ns. */
+static LLTraceClockPoint* sClock = 0;
+static unsigned int sNumClock = 0;
+
+/* helper function to write a JSON string. */
+static void sWriteJsonString(FILE* out, const char* s)
+{
+	fputc('"', out);
+	for(; *s; s++)
+	{
+		unsigned char c = (unsigned char)*s;
+		if((c == '"') || (c == '\\'))
+			fprintf(out, "\\%c", c);
+		else if(c < 0x20)
+			fprintf(out, "\\u%04x", c);
+		else
+			fputc(c, out);
+	}
+	fputc('"', out);
+}
+
+/* helper function to note down the name of a function id. */
+static int sAddSite(unsigned int id, const char* name)
+{
+	if(id >= sNumSites)
+	{
+		unsigned int newNum = (id + 1) * 2;
+		char** newSites = (char**)realloc(sSites, newNum * sizeof(char*));
+		if(!newSites)
+			return -1;
+		memset(newSites + sNumSites, 0, (newNum - sNumSites) * sizeof(char*));
+		sSites = newSites;
+		sNumSites = newNum;
+	}
+	free(sSites[id]);
+	sSites[id] = (char*)malloc(strlen(name) + 1);
+	if(!sSites[id])
+		return -1;
+	strcpy(sSites[id], name);
+	return 0;
+}
+
+/* helper function to get the name of the function of an event. */
+static const char* sEventName(const LLTraceEvent* ev, char* buf, int bufSize)
+{
+	if((LL_TRACE_ADDR_BEGIN == ev->kind) || (LL_TRACE_ADDR_END == ev->kind))
+	{
+		unsigned long long addr = LL_TRACE_EVENT_ADDR(ev);
+		unsigned long long offset;
+		const char* name = LLSymLookup(sSym, addr);
+		const char* module;
+		if(name)
+			return name;
+		/* not symbolised : module+offset, or the raw address. */
+		module = LLSymModule(sSym, addr, &offset);
+		if(module)
+		{
+			const char* base = strrchr(module, '/');
+			snprintf(buf, bufSize, "%s+0x%llx", base ? base + 1 : module, offset);
+		}
+		else
+			snprintf(buf, bufSize, "0x%llx", addr);
+		return buf;
+	}
+	return ((ev->site < sNumSites) && sSites[ev->site]) ? sSites[ev->site] : "?";
+}
+
+/* helper function to note down a calibration point of the TSC. */
+static int sAddClockPoint(const char* payload)
+{
+	LLTraceClockPoint* newClock;
+	if(!(sNumClock & (sNumClock - 1)))
+	{
+		newClock = (LLTraceClockPoint*)realloc(sClock, (sNumClock ? sNumClock * 2 : 16) * sizeof(LLTraceClockPoint));
+		if(!newClock)
+			return -1;
+		sClock = newClock;
+	}
+	memcpy(&sClock[sNumClock++], payload, sizeof(LLTraceClockPoint));
+	return 0;
+}
+
+/* helper function to convert TSC ticks to the wall clock time in ns : the ticks are
+ * interpolated between the calibration points around them, or extrapolated from the
+ * first / last two points. */
+static unsigned long long sTscToWallNs(unsigned long long tsc)
+{
+	unsigned int lo = 0, hi = sNumClock - 1;
+	const LLTraceClockPoint* a;
+	const LLTraceClockPoint* b;
+	double nsPerTick;
+	if(sNumClock < 2)
+		return sClock[0].wallNs;
+	/* the last point at or before tsc, the first one if none, the one before the last if
+	 * tsc is after the last point. */
+	while(hi - lo > 1)
+	{
+		unsigned int mid = lo + (hi - lo) / 2;
+		if(sClock[mid].tsc <= tsc)
+			lo = mid;
+		else
+			hi = mid;
+	}
+	a = &sClock[lo];
+	b = &sClock[lo + 1];
+	if(b->tsc == a->tsc)
+		return a->wallNs;
+	nsPerTick = (double)(long long)(b->wallNs - a->wallNs) / (double)(b->tsc - a->tsc);
+	return a->wallNs + (unsigned long long)(long long)((double)(long long)(tsc - a->tsc) * nsPerTick);
+}
+
+/* helper function to read the next record of the capture.
+ * \returns 1 if a record is read, 0 at the end of the capture. */
+static int sReadRecord(FILE* in, LLTraceRecordHeader* rec, char** payload, unsigned int* payloadSize)
+{
+	if(fread(rec, sizeof(*rec), 1, in) != 1)
+		return 0;
+	if(rec->size + 1 > *payloadSize)
+	{
+		char* p = (char*)realloc(*payload, rec->size + 1);
+		if(!p)
+		{
+			fprintf(stderr, "out of memory\n");
+			return 0;
+		}
+		*payload = p;
+		*payloadSize = rec->size + 1;
+	}
+	if(fread(*payload, 1, rec->size, in) != rec->size)
+	{
+		fprintf(stderr, "the capture is truncated\n");
+		return 0;
+	}
+	(*payload)[rec->size] = 0;
+	return 1;
+}
+
+int main(int argc, char** argv)
+{
+	FILE* in;
+	FILE* out = stdout;
+	LLTraceFileHeader hdr;
+	LLTraceRecordHeader rec;
+	char* payload = 0;
+	unsigned int payloadSize = 0;
+	unsigned long numEvents = 0;
+	int text = 0;
+	int argi = 1;
+
+	if((argc > 1) && !strcmp(argv[1], "-t"))
+	{
+		text = 1;
+		argi++;
+	}
+	if((argc - argi < 1) || (argc - argi > 2))
+	{
+		fprintf(stderr, "usage : %s [-t] <capture> [output]\n", argv[0]);
+		fprintf(stderr, "  -t : write text records as LogFuncEntry / LogFuncExit, instead of Chrome trace JSON\n");
+		return 2;
+	}
+	in = fopen(argv[argi], "rb");
+	if(!in)
+	{
+		fprintf(stderr, "could not open %s\n", argv[argi]);
+		return 1;
+	}
+	if( (fread(&hdr, sizeof(hdr), 1, in) != 1) || memcmp(hdr.magic, LL_TRACE_MAGIC, sizeof(hdr.magic))
+			|| (hdr.version < 1) || (hdr.version > LL_TRACE_VERSION) )
+	{
+		fprintf(stderr, "%s is not a function trace capture\n", argv[argi]);
+		fclose(in);
+		return 1;
+	}
+	if(argc - argi == 2)
+	{
+		out = fopen(argv[argi + 1], "w");
+		if(!out)
+		{
+			fprintf(stderr, "could not open %s\n", argv[argi + 1]);
+			fclose(in);
+			return 1;
+		}
+	}
+
+	/* first pass : the memory maps, the last snapshot is written after the events, and the
+	 * calibration points of the TSC. */
+	sSym = LLSymCreate();
+	if(!sSym)
+	{
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+	while(sReadRecord(in, &rec, &payload, &payloadSize))
+	{
+		if(LL_TRACE_REC_MAPS == rec.type)
+			LLSymAddMaps(sSym, payload);
+		else if((LL_TRACE_REC_CLOCK == rec.type) && (rec.size >= sizeof(LLTraceClockPoint)) && sAddClockPoint(payload))
+		{
+			fprintf(stderr, "out of memory\n");
+			return 1;
+		}
+	}
+	fseek(in, sizeof(hdr), SEEK_SET);
+
+	if(!text)
+	{
+		fprintf(out, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+		fprintf(out, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%u,\"args\":{\"name\":\"pid %u\"}}",
+				hdr.pid, hdr.pid);
+	}
+	while(sReadRecord(in, &rec, &payload, &payloadSize))
+	{
+		if( ((LL_TRACE_REC_SITE == rec.type) || (LL_TRACE_REC_THREAD == rec.type)) && (rec.size >= sizeof(unsigned int)) )
+		{
+			unsigned int id;
+			memcpy(&id, payload, sizeof(id));
+			if(LL_TRACE_REC_SITE == rec.type)
+				sAddSite(id, payload + sizeof(id));
+			else if(!text)
+			{
+				fprintf(out, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%u,\"tid\":%u,\"args\":{\"name\":", hdr.pid, id);
+				sWriteJsonString(out, payload + sizeof(id));
+				fprintf(out, "}}");
+			}
+		}
+		else if(LL_TRACE_REC_EVENTS == rec.type)
+		{
+			unsigned int i;
+			for(i = 0; i + sizeof(LLTraceEvent) <= rec.size; i += sizeof(LLTraceEvent))
+			{
+				LLTraceEvent ev;
+				char nameBuf[64];
+				const char* name;
+				int begin;
+				memcpy(&ev, payload + i, sizeof(ev));
+				name = sEventName(&ev, nameBuf, sizeof(nameBuf));
+				begin = (LL_TRACE_BEGIN == ev.kind) || (LL_TRACE_ADDR_BEGIN == ev.kind);
+				numEvents++;
+				if(text)
+				{
+					/* the same records as the file logger. */
+					if(begin)
+						fprintf(out, "{ %s \n", name);
+					else
+						fprintf(out, "%s : %u }\n", name, (LL_TRACE_END == ev.kind) ? ev.line : 0);
+				}
+				else
+				{
+					unsigned long long rel = (ev.ts > hdr.startNs) ? ev.ts - hdr.startNs : 0;
+					/* the TSC ticks are relative to the first calibration point, the start. */
+					if(sNumClock)
+					{
+						unsigned long long ns = sTscToWallNs(ev.ts);
+						rel = (ns > sClock[0].wallNs) ? ns - sClock[0].wallNs : 0;
+					}
+					fprintf(out, ",\n{\"name\":");
+					sWriteJsonString(out, name);
+					/* the timestamps are in microseconds. */
+					fprintf(out, ",\"ph\":\"%s\",\"ts\":%llu.%03u,\"pid\":%u,\"tid\":%u",
+							begin ? "B" : "E", rel / 1000, (unsigned int)(rel % 1000), hdr.pid, ev.tid);
+					if((LL_TRACE_END == ev.kind) && ev.line)
+						fprintf(out, ",\"args\":{\"line\":%u}", ev.line);
+					fprintf(out, "}");
+				}
+			}
+		}
+		/* unknown records are skipped. */
+	}
+	if(!text)
+		fprintf(out, "\n]}\n");
+
+	fprintf(stderr, "%lu events\n", numEvents);
+	if(out != stdout)
+		fclose(out);
+	fclose(in);
+	free(payload);
+	free(sClock);
+	LLSymDestroy(sSym);
+	return 0;
+}
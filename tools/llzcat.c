@@ -0,0 +1,262 @@
+/*
+       Licensed to the Apache Software Foundation (ASF) under one
+       or more contributor license agreements.  See the NOTICE file
+       distributed with this work for additional information
+       regarding copyright ownership.  The ASF licenses this file
+       to you under the Apache License, Version 2.0 (the
+       "License"); you may not use this file except in compliance
+       with the License.  You may obtain a copy of the License at
+
+         http://www.apache.org/licenses/LICENSE-2.0
+
+       Unless required by applicable law or agreed to in writing,
+       software distributed under the License is distributed on an
+       "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+       KIND, either express or implied.  See the License for the
+       specific language governing permissions and limitations
+       under the License.
+ */
+/**
+ * \file llzcat : decompresses a compressed log (see \ref tFileLoggerInitParams::compressBlockSize).
+ * \code
+ * usage : llzcat [-s start] [-e end] <log> [output]
+ * \endcode
+ * With a time range, only the blocks of the range are read, found with the index "<log>.idx",
+ * and the text / JSON records out of the range are skipped. The start / end times are
+ * "YYYY-MM-DD HH:MM:SS" in the local time of the host, or @<seconds since the epoch>.
+ * A binary log is decompressed as a whole, then decoded with lldecode.
+ * */
+#include "compressed_log.h"
+#include "lz_codec.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/** The length of a date, "YYYY-MM-DD HH:MM:SS". */
+#define DATE_LEN	19
+
+/** The time range, in us since the epoch, and as local dates to filter the records. */
+static unsigned long long sStartUs = 0;
+static unsigned long long sEndUs = ~0ULL;
+static char sStartDate[DATE_LEN + 1] = "";
+static char sEndDate[DATE_LEN + 1] = "";
+static int sFilter = 0;
+/** Non zero while the records are in the range, the lines without a date follow the last record. */
+static int sKeep = 1;
+
+/** The buffers of a block. */
+static char* sComp = 0;
+static char* sRaw = 0;
+
+/* helper function to parse a time, \returns -1 if it is not valid. */
+static int sParseTime(const char* s, unsigned long long* us, char* date)
+{
+	struct tm tm;
+	time_t t;
+	if('@' == s[0])
+		t = (time_t)strtoll(s + 1, 0, 10);
+	else
+	{
+		memset(&tm, 0, sizeof(tm));
+		if(sscanf(s, "%d-%d-%d %d:%d:%d", &tm.tm_year, &tm.tm_mon, &tm.tm_mday,
+					&tm.tm_hour, &tm.tm_min, &tm.tm_sec) < 3)
+			return -1;
+		tm.tm_year -= 1900;
+		tm.tm_mon--;
+		tm.tm_isdst = -1;
+		t = mktime(&tm);
+		if((time_t)-1 == t)
+			return -1;
+	}
+	*us = (unsigned long long)t * 1000000ULL;
+	strftime(date, DATE_LEN + 1, "%Y-%m-%d %H:%M:%S", localtime(&t));
+	return 0;
+}
+
+/* helper function to get the date of a text or JSON record, NULL if the line has none. */
+static const char* sRecordDate(const char* line, int len)
+{
+	const char* date = 0;
+	if((len > DATE_LEN + 1) && ('[' == line[0]) && (']' == line[DATE_LEN + 1]))
+		date = line + 1;
+	else if((len > DATE_LEN + 7) && !memcmp(line, "{\"ts\":\"", 7))
+		date = line + 7;
+	if(date && ((date[4] != '-') || (date[10] != ' ')))
+		return 0;
+	return date;
+}
+
+/* helper function to write the data of a block, skipping the records out of the range. */
+static void sWriteData(FILE* out, const char* data, unsigned int len)
+{
+	const char* end = data + len;
+	if(!sFilter)
+	{
+		fwrite(data, 1, len, out);
+		return;
+	}
+	while(data < end)
+	{
+		const char* nl = (const char*)memchr(data, '\n', end - data);
+		const char* next = nl ? nl + 1 : end;
+		const char* date = sRecordDate(data, (int)(next - data));
+		if(date)
+			sKeep = (!sStartDate[0] || (strncmp(date, sStartDate, DATE_LEN) >= 0))
+					&& (!sEndDate[0] || (strncmp(date, sEndDate, DATE_LEN) <= 0));
+		if(sKeep)
+			fwrite(data, 1, next - data, out);
+		data = next;
+	}
+}
+
+/* helper function to read and write the block at the current offset of the log.
+ * \returns 1 if a block is written, 0 at the end of the log, -1 on error.
+ * */
+static int sCatBlock(FILE* in, FILE* out, long offset)
+{
+	char header[LL_LZ_BLOCK_HEADER];
+	unsigned int rawLen, compLen;
+	size_t n = fread(header, 1, sizeof(header), in);
+	if(!n)
+		return 0;
+	if((n != sizeof(header)) || LLLzGetBlockHeader(header, &rawLen, &compLen))
+	{
+		fprintf(stderr, "no block at offset %ld\n", offset);
+		return -1;
+	}
+	if(fread(sComp, 1, compLen, in) != compLen)
+	{
+		fprintf(stderr, "the block at offset %ld is truncated\n", offset);
+		return -1;
+	}
+	if(compLen == rawLen)
+		sWriteData(out, sComp, rawLen);
+	else if(LLLzDecompress(sComp, (int)compLen, sRaw, (int)rawLen) != (int)rawLen)
+	{
+		fprintf(stderr, "the block at offset %ld is corrupted\n", offset);
+		return -1;
+	}
+	else
+		sWriteData(out, sRaw, rawLen);
+	return 1;
+}
+
+/* helper function to write the blocks of the time range, found with the index.
+ * \returns the number of blocks written, -1 if there is no index.
+ * */
+static long sCatRange(FILE* in, FILE* out, const char* logName)
+{
+	char entryBuf[LL_LZ_INDEX_ENTRY];
+	char* idxName = (char*)malloc(strlen(logName) + sizeof(LL_LZ_INDEX_SUFFIX));
+	FILE* idx;
+	long numBlocks = 0;
+	int prevInRange = 0;
+	if(!idxName)
+		return -1;
+	sprintf(idxName, "%s%s", logName, LL_LZ_INDEX_SUFFIX);
+	idx = fopen(idxName, "rb");
+	if(!idx)
+	{
+		fprintf(stderr, "could not open the index %s, the whole log is read\n", idxName);
+		free(idxName);
+		return -1;
+	}
+	free(idxName);
+	while(fread(entryBuf, 1, sizeof(entryBuf), idx) == sizeof(entryBuf))
+	{
+		LLLzIndexEntry entry;
+		int inRange;
+		LLLzGetIndexEntry(entryBuf, &entry);
+		inRange = (entry.lastUs >= sStartUs) && (entry.firstUs <= sEndUs);
+		/* the records are queued before the writer gets them, the records at the end of
+		 * the range may be in the next block. */
+		if(!inRange && !(prevInRange && (entry.lastUs >= sStartUs)))
+		{
+			prevInRange = 0;
+			continue;
+		}
+		prevInRange = inRange;
+		sKeep = 1;
+		if( (fseek(in, (long)entry.offset, SEEK_SET) != 0) || (sCatBlock(in, out, (long)entry.offset) <= 0) )
+			break;
+		numBlocks++;
+	}
+	fclose(idx);
+	return numBlocks;
+}
+
+int main(int argc, char** argv)
+{
+	FILE* in;
+	FILE* out = stdout;
+	long numBlocks = -1;
+	int argi = 1;
+
+	for(; (argi + 1 < argc) && ('-' == argv[argi][0]) && argv[argi][1] && !argv[argi][2]; argi += 2)
+	{
+		if('s' == argv[argi][1])
+		{
+			if(sParseTime(argv[argi + 1], &sStartUs, sStartDate))
+				break;
+		}
+		else if('e' == argv[argi][1])
+		{
+			if(sParseTime(argv[argi + 1], &sEndUs, sEndDate))
+				break;
+			/* the whole last second. */
+			sEndUs += 999999;
+		}
+		else
+			break;
+		sFilter = 1;
+	}
+	if((argc - argi < 1) || (argc - argi > 2) || ('-' == argv[argi][0]))
+	{
+		fprintf(stderr, "usage : %s [-s start] [-e end] <log> [output]\n", argv[0]);
+		fprintf(stderr, "  -s, -e : the first / last time written, \"YYYY-MM-DD HH:MM:SS\" or @<seconds since the epoch>\n");
+		return 2;
+	}
+	in = fopen(argv[argi], "rb");
+	if(!in)
+	{
+		fprintf(stderr, "could not open %s\n", argv[argi]);
+		return 1;
+	}
+	if(argc - argi == 2)
+	{
+		out = fopen(argv[argi + 1], "wb");
+		if(!out)
+		{
+			fprintf(stderr, "could not open %s\n", argv[argi + 1]);
+			fclose(in);
+			return 1;
+		}
+	}
+	sComp = (char*)malloc(LL_LZ_RAW_MAX);
+	sRaw = (char*)malloc(LL_LZ_RAW_MAX);
+	if(!sComp || !sRaw)
+	{
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+
+	if(sFilter)
+		numBlocks = sCatRange(in, out, argv[argi]);
+	if(numBlocks < 0)
+	{
+		/* the whole log, block after block. */
+		int ret;
+		numBlocks = 0;
+		while((ret = sCatBlock(in, out, ftell(in))) > 0)
+			numBlocks++;
+	}
+
+	fprintf(stderr, "%ld blocks\n", numBlocks);
+	if(out != stdout)
+		fclose(out);
+	fclose(in);
+	free(sComp);
+	free(sRaw);
+	return 0;
+}